@@ -0,0 +1,35 @@
+#ifndef SCI_DRIVER_DISPLAY_CONVERT_H
+#define SCI_DRIVER_DISPLAY_CONVERT_H
+
+#include "sci/Utils/Types.h"
+
+// Instruction set levels of the pixel conversion, from the most portable.
+#define ISA_SCALAR 0
+#define ISA_SSE2   1
+#define ISA_AVX2   2
+#define NISALEVELS 3
+
+// A pixel of the framebuffer, laid out in memory as R, G, B, A bytes (on a
+// little-endian processor).
+#define RGBA32(r, g, b)                                                        \
+    ((uint32_t)(r) | ((uint32_t)(g) << 8) | ((uint32_t)(b) << 16) |            \
+     0xff000000U)
+
+// Return the best level supported by the processor.
+uint GetBestIsa(void);
+
+const char *GetIsaName(uint isa);
+
+// Select the level used by ConvertPixels(). Return FALSE if the processor
+// doesn't support it.
+bool SetConvertIsa(uint isa);
+
+uint GetConvertIsa(void);
+
+// Convert 'count' palette indices to pixels through 'clut'.
+void ConvertPixels(uint32_t       *dst,
+                   const uint8_t  *src,
+                   uint            count,
+                   const uint32_t *clut);
+
+#endif // SCI_DRIVER_DISPLAY_CONVERT_H
@@ -7,14 +7,42 @@
 #define DISPLAYWIDTH  640
 #define DISPLAYHEIGHT 480
 
-#ifdef __WINDOWS__
+// Upper bound on the rectangles waiting to be presented. Beyond it, a new
+// rectangle is merged with the one it grows the least.
+#define MAXDIRTY 16
+
+// Frame timing, in nanoseconds. The interpreter's side is the time spent
+// handing frames off in FlushDisplay(); the render thread's side is the time
+// spent converting and presenting them, and the latency from the flush to
+// the end of the present.
+typedef struct DisplayStats {
+    uint     flushes;
+    uint     merged; // flushes added to a frame the render thread hadn't taken
+    uint     frames; // frames presented
+    uint64_t recolored; // pixels converted again for a change of the CLUT
+    uint64_t flushNs;
+    uint64_t flushMaxNs;
+    uint64_t renderNs;
+    uint64_t latencyNs;
+    uint64_t latencyMaxNs;
+} DisplayStats;
+
+#if defined(__WINDOWS__) && !defined(SCI_HEADLESS_DISPLAY)
 extern HDC   g_hDcWnd;
 extern HGLRC g_hWgl;
+#elif defined(__IOS__) && !defined(SCI_HEADLESS_DISPLAY)
+// Implemented by the application, and called on the render thread.
+// SetGLContext() makes its EAGL context current on the calling thread, or no
+// context if 'current' is FALSE. SwapBuffers() presents its renderbuffer.
+void SetGLContext(bool current);
+void SwapBuffers(void);
 #endif
 
 void InitDisplay(void);
 void EndDisplay(void);
 
+// Copy the rectangle of bits to the display. It is presented by the next
+// FlushDisplay().
 void Display(int      top,
              int      left,
              int      bottom,
@@ -22,10 +50,37 @@ void Display(int      top,
              uint8_t *bits,
              uint     mapSet);
 
+// Hand the rectangles displayed since the last flush, if any, to the render
+// thread, which converts and presents them.
+void FlushDisplay(void);
+
+// Wait until the render thread has presented every flushed frame.
+void SyncDisplay(void);
+
+void GetDisplayStats(DisplayStats *stats);
+
+// The framebuffer: MAXWIDTH x MAXHEIGHT pixels in the format of Convert.h.
+// It belongs to the render thread: other threads must SyncDisplay() first.
+const uint32_t *GetDisplayPixels(void);
+
+// Move the rectangles of the framebuffer changed since the last present to
+// 'dirty', and return their count.
+uint TakeDirtyRects(RRect dirty[MAXDIRTY]);
+
 void GetDisplayCLUT(RPalette *pal);
 
+// Set the CLUT shown from the guns and intensities of a palette. The next
+// FlushDisplay() converts again the pixels whose colors changed.
 void SetDisplayCLUT(const RPalette *pal);
 
+// Implemented by the display backend, chosen when configuring the build.
+// These are called on the render thread.
+void InitDisplayBackend(void);
+void EndDisplayBackend(void);
+
+// Present the framebuffer, taking the dirty rectangles.
+void PresentDisplay(void);
+
 bool DisplayCursor(bool show);
 
 #endif // SCI_DRIVER_DISPLAY_DISPLAY_H
@@ -0,0 +1,28 @@
+#ifndef SCI_DRIVER_DISPLAY_HEADLESS_H
+#define SCI_DRIVER_DISPLAY_HEADLESS_H
+
+#include "sci/Utils/Types.h"
+
+// The headless display backend presents frames to memory only. Its frames
+// can be watched through a callback, or dumped to PPM files.
+//
+// Dumping can also be turned on without code through the environment:
+// SCI_DUMP_FRAMES=<n> dumps every n-th frame to SCI_DUMP_DIR (or the current
+// directory).
+
+// Called on the render thread with the framebuffer (see GetDisplayPixels())
+// after every present. 'frame' counts from 1.
+typedef void (*FrameProc)(const uint32_t *pixels, uint frame, void *arg);
+
+void SetFrameProc(FrameProc proc, void *arg);
+
+// Dump every 'every'-th frame to 'dir' as FRAMEnnnnnn.PPM; zero stops.
+void SetFrameDump(const char *dir, uint every);
+
+// Return the number of frames presented.
+uint GetFrameCount(void);
+
+// Write the framebuffer to a PPM file. Return FALSE on failure.
+bool WriteFramePPM(const char *fileName);
+
+#endif // SCI_DRIVER_DISPLAY_HEADLESS_H
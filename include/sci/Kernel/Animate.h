@@ -23,6 +23,15 @@
 #define ignrAct    0x4000 // can ignore other actors
 #define delObj     0x8000
 
+// Work done by Animate, for measuring it. A cast drawn in steady state
+// allocates nothing, and finds the views of its actors without looking them
+// up on the load list.
+typedef struct AnimateStats {
+    uint frames;    // casts drawn
+    uint allocs;    // heap blocks allocated while drawing them
+    uint viewLoads; // views looked up on the load list
+} AnimateStats;
+
 // Update all actors in cast.
 void Animate(List *cast, bool doit);
 
@@ -35,4 +44,9 @@ void AddToPic(List *cast);
 // Abandon last cast if there is one.
 void DisposeLastCast(void);
 
+// Forget the actors drawn with a view being unloaded.
+void DropActorViews(Handle view);
+
+void GetAnimateStats(AnimateStats *stats);
+
 #endif // SCI_KERNEL_ANIMATE_H
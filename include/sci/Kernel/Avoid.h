@@ -0,0 +1,63 @@
+#ifndef SCI_KERNEL_AVOID_H
+#define SCI_KERNEL_AVOID_H
+
+#include "sci/PMachine/Object.h"
+#include "sci/Utils/List.h"
+
+// Paths around the polygons of a room, for AvoidPath().
+//
+// The polygons of a room bar the way to the actors, or, for a contained
+// access polygon, keep them inside. The shortest path between two points goes
+// straight, or bends only at the corners of the polygons that stick out into
+// the free space. So for each set of polygons, the corners that see each other
+// without crossing an edge are joined once into a graph, which is kept for as
+// long as the polygons stay the same: the graphs are cached by the contents of
+// the polygons, points and types, rather than by list or object. A path is
+// then looked for with A*, the start and goal joined to the corners they see
+// as the search needs them.
+//
+// Whether a segment crosses the edges is found for many edges at once, by
+// kernels in the instruction set levels of Convert.h.
+
+// Types of polygons.
+#define PTotalAccess     0 // not to be crossed, the goal may be inside
+#define PNearestAccess   1 // not to be crossed nor entered
+#define PBarredAccess    2 // not to be crossed nor entered
+#define PContainedAccess 3 // not to be left
+
+// End of the points of a path.
+#define PATHEND 0x7777
+
+// Work done by the paths, for measuring them.
+typedef struct AvoidStats {
+    uint queries;  // paths looked for
+    uint builds;   // graphs built
+    uint segments; // segments tested against the edges
+    uint expanded; // nodes taken by the searches
+} AvoidStats;
+
+// Select the level used by the segment tests. Return FALSE if the processor
+// doesn't support it, or if there is no such kernel.
+bool SetAvoidIsa(uint isa);
+
+uint GetAvoidIsa(void);
+
+// Return a path from (x1,y1) to (x2,y2) around the polygon objects of
+// 'polygons': the points, x then y, from the start to where the path ends,
+// followed by PATHEND twice. The path is malloc()ed for the caller to free,
+// as scripts do with Memory(MDisposePtr).
+uintptr_t *AvoidPath(int x1, int y1, int x2, int y2, List *polygons);
+
+// Return TRUE if (x,y) is inside the polygon object 'polygon', or on its edge.
+bool InPolygon(int x, int y, Obj *polygon);
+
+// Return the number of edges of the polygon objects of 'polygons' crossed by
+// the segment from (x1,y1) to (x2,y2).
+uint Intersections(int x1, int y1, int x2, int y2, List *polygons);
+
+// Forget the graphs of the polygons.
+void ForgetPolygons(void);
+
+void GetAvoidStats(AvoidStats *stats);
+
+#endif // SCI_KERNEL_AVOID_H
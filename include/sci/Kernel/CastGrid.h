@@ -0,0 +1,58 @@
+#ifndef SCI_KERNEL_CASTGRID_H
+#define SCI_KERNEL_CASTGRID_H
+
+#include "sci/Kernel/GrTypes.h"
+#include "sci/PMachine/Object.h"
+#include "sci/Utils/List.h"
+
+// Grid of the base rectangles of a cast, for CantBeHere().
+//
+// CantBeHere() looks for the first actor of the cast, in the order of the
+// list, whose base rectangle meets the one of the actor moving. Every actor
+// moving does so every cycle, so instead of walking the whole cast each time,
+// the actors are sorted into cells of GRIDCELL by GRIDCELL pixels, and only
+// the actors in the cells under the rectangle are looked at, in list order.
+// Their signals and rectangles are read from the objects when looked at.
+//
+// The grid is built by the first query of each cycle and whenever the list of
+// the cast changes. An actor whose base rectangle is set, by BaseSetter(), by
+// CantBeHere() or by a script storing to the properties, is moved to its new
+// cells; one that moves too far is looked at by every query until the grid is
+// built again. The grid is also built again when an actor looked at is out of
+// its cells, its rectangle having been set some other way. A cast of fewer
+// than GRIDMIN actors is walked as a list, which is faster than building the
+// grid.
+
+#define GRIDCELL 16
+#define GRIDCOLS (MAXWIDTH / GRIDCELL)
+#define GRIDROWS ((MAXHEIGHT + GRIDCELL - 1) / GRIDCELL)
+#define GRIDMIN  24
+
+// Work done by the grid, for measuring it.
+typedef struct CastGridStats {
+    uint queries; // rectangles looked for
+    uint builds;  // times the grid was built
+    uint tested;  // actors looked at
+} CastGridStats;
+
+// Return the first actor of 'cast', other than 'him' and than the actors
+// stopped, hidden or ignoring actors, whose base rectangle meets 'rect', or
+// NULL.
+Obj *FindBaseHit(List *cast, Obj *him, const RRect *rect);
+
+// Note that the base rectangle of an actor was set.
+void NoteActorBase(Obj *actor);
+
+// Note that the property at index 'var' of an object was set by a script,
+// which moves the actor if it is one of its base rectangle.
+void NoteActorProp(Obj *obj, uint var);
+
+// Note that the nodes of a list changed.
+void CastListChanged(const List *list);
+
+// Build the grid again on its next use, as a new cycle starts.
+void ForgetCastGrid(void);
+
+void GetCastGridStats(CastGridStats *stats);
+
+#endif // SCI_KERNEL_CASTGRID_H
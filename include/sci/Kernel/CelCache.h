@@ -0,0 +1,64 @@
+#ifndef SCI_KERNEL_CELCACHE_H
+#define SCI_KERNEL_CELCACHE_H
+
+#include "sci/Kernel/Palette.h"
+#include "sci/Kernel/View.h"
+#include "sci/Utils/List.h"
+
+// Cache of decoded view cels.
+//
+// Drawing a cel from its RLE data decodes the control bytes of every pixel,
+// and a mirrored cel first has its data reversed in place (which is undone
+// again as soon as the unmirrored loop is drawn). The cache keeps each cel,
+// per mirror state, decoded to a linear bitmap with the view's palette
+// remapping already applied, along with the list of opaque spans of each row,
+// so drawing a cel only clips the spans and copies them.
+//
+// An entry is remade when the remapping of the view's palette has changed
+// since it was decoded, and dropped when its view is unloaded. Entries are
+// resource handles kept off the load list, and are limited to CELCACHEBYTES
+// in total; the least recently used are dropped first.
+
+#define CELCACHEBYTES (512 * 1024)
+
+// A run of opaque pixels in a row of a decoded cel.
+typedef struct CelSpan {
+    uint16_t start;
+    uint16_t count;
+} CelSpan;
+
+typedef struct CelBits {
+    Node            link;
+    struct CelBits *next; // next in the hash chain
+    View           *view;
+    Cel            *cel;
+    bool            mirror;
+    bool            remap;
+    uint8_t         mapTo[PAL_CLUT_SIZE];
+    uint            size;
+    uint            width;
+    uint            height;
+    uint16_t       *rows;   // index of the first span of each row, and the end
+    CelSpan        *spans;  // spans of all rows
+    uint8_t        *pixels; // width * height remapped colors
+} CelBits;
+
+// Return the decoded form of a cel of 'view', decoding it if it is not cached,
+// or NULL if there is no memory for it. 'pal' is the palette whose remapping
+// is applied to the colors, or NULL.
+const CelBits *GetCachedCel(View           *view,
+                            Cel            *cel,
+                            bool            mirror,
+                            const RPalette *pal);
+
+// Keep the cels returned until HoldCachedCels(FALSE) is called: while they
+// are held, GetCachedCel() returns NULL rather than drop a cel.
+void HoldCachedCels(bool hold);
+
+// Drop the decoded cels of a view being unloaded.
+void DropCachedCels(Handle view);
+
+// Free all decoded cels.
+void FlushCelCache(void);
+
+#endif // SCI_KERNEL_CELCACHE_H
@@ -1,10 +1,25 @@
 #ifndef SCI_KERNEL_CELS_H
 #define SCI_KERNEL_CELS_H
 
+#include "sci/Kernel/CelCache.h"
 #include "sci/Kernel/GrTypes.h"
 #include "sci/Kernel/Palette.h"
 #include "sci/Kernel/View.h"
 
+// A cel made ready by PrepareCel() to be drawn.
+typedef struct CelDraw {
+    const CelBits *bits; // the decoded cel, or NULL to draw it from its data
+    Cel           *cel;
+    RPalette      *pal;
+    bool           mirrored;
+    uint8_t        viewFlags;
+    int            x, y;       // as passed to DrawCel()
+    int            penX, penY; // position in the maps
+    RRect          clip;       // rectangle of the maps it is clipped to
+    uint           priority;
+    uint8_t        priComp, priMask, priStore;
+} CelDraw;
+
 // Entry point for drawing non-scaled views.
 void DrawCel(View        *view,
              uint         loop,
@@ -13,6 +28,24 @@ void DrawCel(View        *view,
              uint         priority,
              RPalette    *pal);
 
+// Do the part of DrawCel() that has to be done in order: remap the palette
+// of the view, and find the decoded cel. Returns FALSE if the cel is not
+// decoded, in which case it can only be drawn by DrawPreparedCel().
+bool PrepareCel(View        *view,
+                uint         loopNum,
+                uint         celNum,
+                const RRect *r,
+                uint         priority,
+                CelDraw     *draw);
+
+// Draw a cel made ready by PrepareCel().
+void DrawPreparedCel(const CelDraw *draw);
+
+// Draw the rows from 'top' to 'bottom' of the maps of a decoded cel. Nothing
+// but those rows of the maps is written, so that bands of rows may be drawn
+// by different threads.
+void DrawCelBand(const CelDraw *draw, int top, int bottom);
+
 void DrawBitMap(int       x,
                 int       y,
                 bool      mirror,
@@ -0,0 +1,40 @@
+#ifndef SCI_KERNEL_COLORMATCH_H
+#define SCI_KERNEL_COLORMATCH_H
+
+#include "sci/Kernel/Palette.h"
+
+// Index of the colors of the system palette, for matching.
+//
+// FastMatch() compares a color with all the entries of a palette, and a
+// palette merged into the system palette is matched an entry at a time. The
+// index sorts the entries in use of the system palette into buckets, a cube of
+// COLORSIDE by COLORSIDE by COLORSIDE over the RGB space, and searches the
+// buckets around a color in rings of growing distance, stopping as soon as no
+// bucket further out can hold a closer entry. Answers are those of FastMatch():
+// the least sum of absolute differences, the highest index among equals.
+//
+// Whatever changes the guns of the system palette says so with
+// SysColorsChanged(); the entries are moved between buckets when the index is
+// next used.
+
+#define COLORBITS 2 // bits of a gun selecting a bucket
+#define COLORSIDE (1 << COLORBITS)
+
+// Work done by the index, for measuring it.
+typedef struct ColorMatchStats {
+    uint matches; // colors matched
+    uint buckets; // buckets searched
+    uint moves;   // entries moved between buckets
+} ColorMatchStats;
+
+// Return what FastMatch(&g_sysPalette, redV, greenV, blueV, PAL_CLUT_SIZE,
+// least) does.
+uint MatchSysColor(uint8_t redV, uint8_t greenV, uint8_t blueV, uint least);
+
+// Note that the guns (or the flags) of entries first to last - 1 of the
+// system palette changed.
+void SysColorsChanged(uint first, uint last);
+
+void GetColorMatchStats(ColorMatchStats *stats);
+
+#endif // SCI_KERNEL_COLORMATCH_H
@@ -0,0 +1,38 @@
+#ifndef SCI_KERNEL_COMPOSE_H
+#define SCI_KERNEL_COMPOSE_H
+
+#include "sci/Kernel/Cels.h"
+
+// Drawing of a cast by several threads.
+//
+// The actors of a cast are drawn back to front, each saving the underbits of
+// its rectangle and then drawing over the ones before it. No row of the maps
+// depends on another, though, so the screen is split into horizontal bands,
+// one per thread, and each thread saves and draws every actor of the cast
+// clipped to its band, in the order of the cast. What has to be done in
+// order (remapping palettes, decoding cels, allocating the underbits) is
+// still done beforehand, by the thread queuing the cels.
+//
+// With a single thread, the default, Animate() draws the cast as it always
+// did. The number of threads can be set with the SCI_DRAW_THREADS environment
+// variable.
+
+#define MAXCOMPOSETHREADS 8
+
+// Set the number of threads drawing a cast, the calling one included.
+void SetComposeThreads(uint count);
+
+uint GetComposeThreads(void);
+
+// Queue a cel prepared by PrepareCel(), whose underbits from
+// ReserveFrameBits() (or NULL) are to be saved before it is drawn. The cels
+// decoded by the cel cache are held until the queue is flushed.
+void ComposeCel(Handle underBits, const CelDraw *draw);
+
+// Draw the queued cels.
+void FlushCompose(void);
+
+// Stop the threads.
+void EndCompose(void);
+
+#endif // SCI_KERNEL_COMPOSE_H
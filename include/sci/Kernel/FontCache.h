@@ -0,0 +1,55 @@
+#ifndef SCI_KERNEL_FONTCACHE_H
+#define SCI_KERNEL_FONTCACHE_H
+
+#include "sci/Kernel/GrTypes.h"
+
+// Cache of decoded fonts.
+//
+// Measuring or drawing a character used to look the font up on the load list
+// and, to draw it, shift the dots of its bit rows out one at a time. The cache
+// keeps each font decoded to an atlas: the width and height of every
+// character code, and for each character of the font a byte mask per dot
+// (0xff where the dot is on), so a row of a glyph is drawn as a span.
+//
+// An atlas is dropped when its font is unloaded. Atlases are resource handles
+// kept off the load list; at most MAXFONTS are kept, the least recently used
+// being dropped first.
+
+#define MAXFONTS 8
+
+typedef struct FontAtlas {
+    Handle   font;
+    uint     fontNum;
+    uint     lastUse;
+    uint     lowChar;
+    uint     highChar;
+    uint     pointSize;
+    uint8_t  widths[256];
+    uint8_t  heights[256];
+    uint8_t  dots[256];   // dots in a mask row; a row has one even if empty
+    uint32_t glyphs[256]; // offset of the masks from the atlas, or 0
+} FontAtlas;
+
+// Width of a character.
+#define GlyphWide(atlas, c) ((uint)(atlas)->widths[(uint8_t)(c)])
+
+// Height of a character.
+#define GlyphHigh(atlas, c) ((uint)(atlas)->heights[(uint8_t)(c)])
+
+// Masks of the rows of a character, or NULL if it is not in the font.
+#define GlyphMasks(atlas, c)                                                   \
+    ((atlas)->glyphs[(uint8_t)(c)] != 0                                        \
+       ? (const uint8_t *)(atlas) + (atlas)->glyphs[(uint8_t)(c)]              \
+       : NULL)
+
+// Return the atlas of font 'fontNum', loading and decoding the font if need
+// be, or NULL if there is no such font.
+const FontAtlas *GetFontAtlas(uint fontNum);
+
+// Drop the atlas of a font being unloaded.
+void DropFontAtlas(Handle font);
+
+// Free all atlases.
+void FlushFontCache(void);
+
+#endif // SCI_KERNEL_FONTCACHE_H
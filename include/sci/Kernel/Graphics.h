@@ -35,10 +35,17 @@ void CEndGraph(void);
 
 const RRect *GetBounds(void);
 
+// Display the rectangle of the maps. Rectangles shown during a game cycle are
+// presented together by FlushBits().
 void ShowBits(const RRect *rect, uint mapSet);
 
-// Draw the picture described by data at hndl, clear is boolean
-void DrawPic(Handle hndl, bool clear, uint mirror);
+// Present what was shown since the last flush. Done once per game cycle, and
+// by loops that wait on the screen, such as transitions, after every step.
+void FlushBits(void);
+
+// Draw the picture described by data at hndl, clear is boolean. Pictures are
+// restored from the picture cache by their number 'num' when possible.
+void DrawPic(Handle hndl, uint num, bool clear, uint mirror);
 
 // Load the numbered bitmap.
 void LoadBits(uint num);
@@ -131,6 +138,21 @@ uint OnControl(uint mapSet, const RRect *rect);
 // Save virtual bitmaps bounded by rect, in buffer we allocate locally.
 Handle SaveBits(const RRect *rect, uint mapSet);
 
+// Save virtual bitmaps bounded by rect for the current frame only, as the
+// underbits of actors being drawn. The bits are kept in an arena rather than
+// as a RES_MEM resource, and must be restored or unloaded before the end of
+// the frame.
+Handle SaveFrameBits(const RRect *rect, uint mapSet);
+
+// Allocate the underbits of SaveFrameBits() without saving the maps yet, for
+// them to be saved a band of rows at a time by SaveBitsRows().
+Handle ReserveFrameBits(const RRect *rect, uint mapSet);
+
+// Save the rows of the maps from 'top' to 'bottom' that are in the rectangle
+// of saved bits. Only the bits are written, so that bands of rows may be
+// saved by different threads.
+void SaveBitsRows(Handle hndl, int top, int bottom);
+
 // Restore virtual bitmaps with info and data from passed handle.
 // Dispose of handle.
 void RestoreBits(Handle hndl);
@@ -138,6 +160,9 @@ void RestoreBits(Handle hndl);
 // Dispose of handle.
 void UnloadBits(Handle hndl);
 
+// Release all frame underbits, as when the game restarts.
+void ResetFrameBits(void);
+
 void GetCLUT(RPalette *pal);
 
 void SetCLUT(const RPalette *pal);
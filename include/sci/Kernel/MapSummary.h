@@ -0,0 +1,49 @@
+#ifndef SCI_KERNEL_MAPSUMMARY_H
+#define SCI_KERNEL_MAPSUMMARY_H
+
+#include "sci/Kernel/GrTypes.h"
+
+// Summaries of the priority and control maps.
+//
+// OnControl() returns the set of priorities or controls found in a rectangle,
+// one bit per value. For each map, the summaries keep that set for every
+// block of SUMBLOCK pixels of a row and for every whole row, so a rectangle
+// is looked at a row at a time: rows that can't add to the set are skipped,
+// the blocks inside the rectangle are combined, and only the pixels at its
+// edges are read.
+//
+// Whatever writes to g_pcHndl says which rows of which maps it changed with
+// NoteMapRows(); those rows are summarized again when next looked at.
+
+#define SUMBLOCK  8
+#define SUMBLOCKS (MAXWIDTH / SUMBLOCK)
+
+// Work done by the summaries, for measuring them.
+typedef struct MapSummaryStats {
+    uint queries; // rectangles looked at
+    uint rows;    // rows summarized
+} MapSummaryStats;
+
+// The maps (PMAP and CMAP) in which pixels stored as (pixel & mask) | store
+// may change.
+#define MapsStored(mask, store)                                                \
+    (((((mask) & 0xf0) != 0xf0 || ((store) & 0xf0) != 0) ? PMAP : 0) |        \
+     ((((mask) & 0x0f) != 0x0f || ((store) & 0x0f) != 0) ? CMAP : 0))
+
+// Forget the summaries of both maps.
+void InitMapSummary(void);
+
+// Note that rows 'top' to 'bottom' - 1 of the maps in 'mapSet' changed.
+void NoteMapRows(uint mapSet, int top, int bottom);
+
+// Return the maps (PMAP and CMAP) that differ between 'count' bytes of the
+// priority/control map and bits about to replace them.
+uint MapsDiffer(const uint8_t *pcMap, const uint8_t *bits, uint count);
+
+// Return the set of values of the priority map (if 'mapSet' has PMAP) or of
+// the control map in a rectangle, in screen coordinates, within the maps.
+uint SummarizeMap(uint mapSet, const RRect *rect);
+
+void GetMapSummaryStats(MapSummaryStats *stats);
+
+#endif // SCI_KERNEL_MAPSUMMARY_H
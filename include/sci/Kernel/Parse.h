@@ -0,0 +1,102 @@
+#ifndef SCI_KERNEL_PARSE_H
+#define SCI_KERNEL_PARSE_H
+
+#include "sci/PMachine/Script.h"
+
+// The parser of the text typed by the player, for Parse() and Said().
+//
+// The vocabulary is read once into a trie of the words, each word ending on
+// its classes and group. The words of an input are looked up in it, then
+// their groups replaced by the synonyms of the room, and the words put in a
+// sentence of three phrases: the verb, the direct object and the indirect
+// object, each with the words that modify it.
+//
+// Said() is called with the same sentence by each handler of the event,
+// with the said specs of its script. The specs of a script are compiled into
+// matchers when the first of them is used, and kept with the script until it
+// is disposed of.
+
+// Vocabularies of the parser.
+#define WORDS_VOCAB  0   // words, one letter per entry of the index
+#define SUFFIX_VOCAB 901 // suffixes
+
+// Classes of the words.
+#define WC_NUMBER     0x001
+#define WC_PREP       0x002
+#define WC_ARTICLE    0x004
+#define WC_ADJECTIVE  0x008
+#define WC_PRONOUN    0x010
+#define WC_NOUN       0x020
+#define WC_INDICATIVE 0x040
+#define WC_ADVERB     0x080
+#define WC_IMPERATIVE 0x100
+
+// Group of the numbers typed.
+#define NUMBERGROUP 0xffd
+
+// Letters kept of a word.
+#define MAXWORDLEN 31
+
+// Operators of the said specs. Any other byte is the high byte of a group.
+#define SAID_COMMA    0xf0 // either
+#define SAID_AND      0xf1 // unused
+#define SAID_SLASH    0xf2 // next phrase
+#define SAID_OPEN     0xf3 // grouping
+#define SAID_CLOSE    0xf4
+#define SAID_OPTOPEN  0xf5 // optional
+#define SAID_OPTCLOSE 0xf6
+#define SAID_POUND    0xf7 // unused
+#define SAID_LT       0xf8 // modified by
+#define SAID_GT       0xf9 // the rest of the sentence may be anything
+#define SAID_END      0xff
+
+// Results of ParseInput().
+#define PARSE_OK       0
+#define PARSE_NOWORDS  1 // nothing but blanks
+#define PARSE_BADWORD  2 // a word isn't in the vocabulary
+#define PARSE_BADORDER 3 // the words don't make a sentence
+
+// Results of MatchSaid().
+#define SAID_NOMATCH 0
+#define SAID_MATCH   1
+#define SAID_PARTIAL 2 // the sentence goes on beyond the spec
+
+// Work done by the parser, for measuring it.
+typedef struct ParseStats {
+    uint inputs;   // inputs parsed
+    uint words;    // words looked up
+    uint compiles; // said specs compiled
+    uint matches;  // said specs matched against the sentence
+} ParseStats;
+
+// Parse 'input' into the sentence that MatchSaid() looks at. If a word isn't
+// in the vocabulary, copy it to 'badWord', which holds MAXWORDLEN + 1
+// characters.
+int ParseInput(const char *input, char *badWord);
+
+// Return whether the sentence parsed last matches the said spec 'spec'.
+int MatchSaid(const byte *spec);
+
+// Return TRUE if there is no sentence to match, or a said spec has claimed
+// it.
+bool SentenceClaimed(void);
+
+// Claim the sentence parsed last, so no other said spec is matched against
+// it.
+void ClaimSentence(void);
+
+// Forget the sentence parsed last, and whether it was claimed.
+void ForgetSentence(void);
+
+// Forget the synonyms of the rooms.
+void ClearSynonyms(void);
+
+// Add the synonyms of a script, from its SEG_SYNONYMS segment.
+void AddSynonyms(const SegHeader *seg);
+
+// Read the vocabulary again on its next use.
+void ForgetVocabulary(void);
+
+void GetParseStats(ParseStats *stats);
+
+#endif // SCI_KERNEL_PARSE_H
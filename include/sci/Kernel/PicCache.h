@@ -0,0 +1,48 @@
+#ifndef SCI_KERNEL_PICCACHE_H
+#define SCI_KERNEL_PICCACHE_H
+
+#include "sci/Kernel/Palette.h"
+
+// Cache of rasterized pictures.
+//
+// Drawing a picture interprets its whole vector opcode stream into the visual
+// and priority/control maps. The cache keeps the maps of the port as they
+// were left by a picture, keyed by the picture number, the mirror flag,
+// whether it was drawn as an overlay and the port's rectangle, so a room that
+// is entered again is restored with a copy. An overlay is also keyed by a
+// hash of the maps it was drawn on, so overlays are cached on top of (cached
+// or not) base pictures.
+//
+// Besides the maps, a picture sets the palette and the priority bands; these
+// are recorded as the picture is drawn and replayed on a hit. A picture whose
+// output depends on other state (a bitmap drawn before the picture has set its
+// palette) is not cached.
+//
+// Entries are resource handles kept off the load list, and are limited to
+// PICCACHEBYTES in total; the least recently used are dropped first.
+
+#define PICCACHEBYTES (1024 * 1024)
+
+// Restore picture 'num' into the maps of the current port, and replay its
+// palette and priority bands. Returns FALSE if it is not in the cache, after
+// which the picture's side effects are recorded until StoreCachedPic().
+bool LoadCachedPic(uint num, bool clear, bool mirror);
+
+// Store the maps of the current port as drawn since the failed
+// LoadCachedPic().
+void StoreCachedPic(void);
+
+// Record the side effects of the picture being drawn.
+void NotePicPalette(const RPalette *pal);
+void NotePicPriTable(int x, int y);
+void NotePicPriBands(const uint16_t *priPtr);
+
+// Note a bitmap being drawn. A bitmap drawn before the picture has set its
+// palette is remapped by the palette of an earlier picture, so the picture is
+// then not cached.
+void NotePicBitMap(void);
+
+// Free all cached pictures.
+void FlushPicCache(void);
+
+#endif // SCI_KERNEL_PICCACHE_H
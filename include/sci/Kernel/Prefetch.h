@@ -0,0 +1,36 @@
+#ifndef SCI_KERNEL_PREFETCH_H
+#define SCI_KERNEL_PREFETCH_H
+
+#include "sci/Utils/Types.h"
+
+// Background resource loading.
+//
+// Resources are loaded by a pool of threads into detached handles, which
+// ResLoad() claims when the resource is asked for. The resources each room
+// loads are remembered (also across sessions, in a file in the save
+// directory), and requested in the background as soon as the room is
+// entered again.
+
+#define PREFETCHTHREADS 2
+
+// Start the prefetch threads and read the room profiles.
+void InitPrefetch(void);
+
+// Stop the prefetch threads and write the room profiles.
+void EndPrefetch(void);
+
+// Request a resource to be loaded in the background.
+void ResLoadAsync(int resType, size_t resNum);
+
+// Return TRUE if there is no background load of the resource in progress.
+bool ResLoadDone(int resType, size_t resNum);
+
+// Claim the data of a background load, waiting for it to finish if needed.
+// Returns NULL if the resource wasn't requested (or failed to load).
+Handle TakePrefetched(int resType, size_t resNum);
+
+// Note the resource being loaded by the current room, warming up the
+// resources of the room if it just changed.
+void NoteRoomLoad(int resType, size_t resNum);
+
+#endif // SCI_KERNEL_PREFETCH_H
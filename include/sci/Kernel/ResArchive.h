@@ -0,0 +1,60 @@
+#ifndef SCI_KERNEL_RESARCHIVE_H
+#define SCI_KERNEL_RESARCHIVE_H
+
+#include "sci/Kernel/ResTypes.h"
+
+// The resource archive packs all the resources of a game into one file, as
+// written by sci-repack:
+//
+//   ArcHeader
+//   ArcEntry[numBuckets]   hash table of the resources, by ARCHASH()
+//   payloads               each starting on an ARCPAGESIZE boundary
+//
+// All values are little endian.
+
+#define ARCNAME     "RESOURCE.SCA"
+#define ARCMAGIC    0x31414353 // "SCA1"
+#define ARCPAGESIZE 4096
+
+// Payload compression.
+#define ARC_STORED 0
+#define ARC_LZ     1
+
+#define ARCHASH(resType, resNum)                                               \
+    ((((uint32_t)(resType) << 16) | (uint32_t)(resNum)) * 2654435761U)
+
+typedef struct ArcHeader {
+    uint32_t magic;
+    uint32_t numEntries;
+    uint32_t numBuckets; // power of two
+    uint32_t pageSize;
+} ArcHeader;
+
+typedef struct ArcEntry {
+    uint8_t  resType; // zero for an empty bucket
+    uint8_t  compression;
+    uint16_t resNum;
+    uint32_t packedSize;
+    uint32_t length;   // decoded size
+    uint32_t checksum; // ArcChecksum() of the decoded data
+    uint64_t offset;
+    uint32_t info;     // type specific: the number of loops of a view
+    uint32_t reserved;
+} ArcEntry;
+
+// Open the archive and add its resources to the resource index.
+bool OpenResArchive(const char *fileName);
+
+void CloseResArchive(void);
+
+// Find a resource in the archive through its hash table.
+const ArcEntry *FindArcEntry(int resType, size_t resNum);
+
+// Load the resource at the entry into a new resource handle. Returns NULL if
+// the payload doesn't decode to the data it was made from.
+Handle LoadArcEntry(const ArcEntry *entry);
+
+// Return the FNV-1a hash of the decoded data of a resource.
+uint32_t ArcChecksum(const void *data, size_t size);
+
+#endif // SCI_KERNEL_RESARCHIVE_H
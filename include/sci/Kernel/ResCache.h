@@ -0,0 +1,27 @@
+#ifndef SCI_KERNEL_RESCACHE_H
+#define SCI_KERNEL_RESCACHE_H
+
+#include "sci/Utils/Types.h"
+
+// On-disk cache of decompressed resources, kept in a directory next to the
+// saved games. Entries are tagged with a checksum of the resource map and the
+// resource volumes, so any change to those invalidates the whole cache.
+// Patch files are always loaded ahead of the cache.
+
+// Set to FALSE before InitResCache() to disable the cache.
+extern bool g_resCacheEnabled;
+
+// Open the cache for the given resource map and volume files.
+void InitResCache(const void *resMap, size_t mapSize, const char *volName);
+
+// Stop the writer thread, after writing out what is pending.
+void EndResCache(void);
+
+// Return a new resource handle with the cached data of the resource, or NULL
+// if it is not in the cache.
+Handle ResCacheLoad(int resType, size_t resNum);
+
+// Queue the decompressed data of a resource to be written to the cache.
+void ResCacheStore(int resType, size_t resNum, Handle data);
+
+#endif // SCI_KERNEL_RESCACHE_H
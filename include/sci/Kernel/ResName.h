@@ -15,6 +15,9 @@ typedef struct ResType {
 extern ResType g_resTypes[];
 #endif
 
+// Patch files are named <num>.<ext> rather than <type>.<num>.
+extern bool g_newResName;
+
 char *ResNameMake(char *dest, int resType, size_t resNum);
 char *ResNameMakeWildCard(char *dest, int resType);
 const char *ResName(int resType);
@@ -0,0 +1,68 @@
+#ifndef SCI_KERNEL_RESSOURCE_H
+#define SCI_KERNEL_RESSOURCE_H
+
+#include "sci/Kernel/ResTypes.h"
+
+// Resource sources, in order of priority: a resource is loaded from the first
+// source that has it.
+#define SRC_OVERRIDE 0 // in-memory overrides
+#define SRC_PATCH    1 // patch files
+#define SRC_ARCHIVE  2 // packed resource archive
+#define SRC_VOLUME   3 // resource map and volumes
+#define NRESSOURCES  4
+
+// A packed archive of resources, which adds its resources to the index with
+// AddResIndex(SRC_ARCHIVE, ...).
+typedef struct ResArchive {
+    const char *name;
+
+    // Load the resource found at 'loc'. Must be safe to call from any thread,
+    // and return NULL on failure.
+    Handle (*load)(int resType, size_t resNum, uint64_t loc);
+} ResArchive;
+
+// Add a resource to the index of a source.
+void AddResIndex(int source, int resType, size_t resNum, uint64_t loc);
+
+// Remove a resource from the index of a source.
+void RemoveResIndex(int source, int resType, size_t resNum);
+
+// Remove all the resources of a source from the index.
+void ClearResIndex(int source);
+
+// Return the sources that have the resource, as a mask of (1 << source),
+// filling in the location of the resource in each.
+uint FindResSources(int resType, size_t resNum, uint64_t loc[NRESSOURCES]);
+
+// Find the resource in a particular source.
+bool FindResInSource(int source, int resType, size_t resNum, uint64_t *loc);
+
+// Call proc for each resource of the source. The index is locked meanwhile,
+// so proc must not use it.
+void ForEachResIndex(int source,
+                     void (*proc)(int resType, size_t resNum, void *arg),
+                     void *arg);
+
+// Return TRUE if there is a patch file for the resource.
+bool FindPatchEntry(int resType, size_t resNum);
+
+// (Re)build the index of patch files, and start watching the patch directory
+// for changes where supported.
+void InitPatches(void);
+
+// Update the index of patch files with the changes to the patch directory.
+void PollPatchDir(void);
+
+// Make the resource load from a copy of 'data' rather than from the files.
+bool SetResOverride(int resType, size_t resNum, const void *data, uint size);
+
+void ClearResOverride(int resType, size_t resNum);
+
+// Return a new handle with the data of the resource's override, or NULL.
+Handle LoadResOverride(int resType, size_t resNum);
+
+void SetResArchive(const ResArchive *archive);
+
+const ResArchive *GetResArchive(void);
+
+#endif // SCI_KERNEL_RESSOURCE_H
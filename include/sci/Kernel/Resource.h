@@ -43,6 +43,10 @@ LoadLink *FindResEntry(int resType, size_t resNum);
 // Return a Handle in concert with the Resource Manager.
 Handle GetResHandle(uint size);
 
+// Return the number of handles GetResHandle has allocated on the calling
+// thread.
+uint GetResHandleCount(void);
+
 // Free the memory pointed to by the handle.
 void DisposeResHandle(Handle handle);
 
@@ -53,8 +57,4 @@ Handle LoadHandle(const char *fileName);
 // Return the size of the block pointed to by handle.
 #define ResHandleSize(handle) (*(((uint32_t *)(handle)) - 1))
 
-bool FindPatchEntry(int resType, size_t resNum);
-
-void InitPatches(void);
-
 #endif // SCI_KERNEL_RESOURCE_H
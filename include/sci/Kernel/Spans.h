@@ -0,0 +1,39 @@
+#ifndef SCI_KERNEL_SPANS_H
+#define SCI_KERNEL_SPANS_H
+
+#include "sci/Utils/Types.h"
+
+// Horizontal span writes to the virtual bitmaps: a run of one color in the
+// visual map, or of one or both nibbles in the priority/control map, the
+// opaque runs of a cel tested against the priority map, and the rows of a
+// glyph.
+//
+// The kernels come in the instruction set levels of Convert.h.
+
+// Select the level used by the span writes. Return FALSE if the processor
+// doesn't support it, or if there is no such kernel.
+bool SetSpanIsa(uint isa);
+
+uint GetSpanIsa(void);
+
+// Set 'count' bytes at dst to 'value'.
+void FillBytes(uint8_t *dst, uint8_t value, uint count);
+
+// Clear the bits of 'mask' in 'count' bytes at dst, and set those of 'value'.
+void FillBits(uint8_t *dst, uint8_t mask, uint8_t value, uint count);
+
+// Draw 'count' pixels of a cel to vis where the priority/control byte at pc
+// is not above priComp, setting that byte to (byte & priMask) | priStore.
+void BlitCelSpan(uint8_t       *vis,
+                 uint8_t       *pc,
+                 const uint8_t *pixels,
+                 uint           count,
+                 uint8_t        priComp,
+                 uint8_t        priMask,
+                 uint8_t        priStore);
+
+// Set the bytes at dst whose mask is 0xff to 'value', leaving those whose
+// mask is zero.
+void FillMasked(uint8_t *dst, const uint8_t *masks, uint8_t value, uint count);
+
+#endif // SCI_KERNEL_SPANS_H
@@ -32,4 +32,7 @@ void ShowText(const char *str, uint first, uint count);
 
 const char *GetTextPointer(uintptr_t native);
 
+// Free the cached layouts of wrapped text.
+void FlushTextLayouts(void);
+
 #endif // SCI_KERNEL_TEXT_H
@@ -10,4 +10,12 @@ void InitResource(void);
 
 Handle DoLoad(int resType, size_t resNum);
 
+// Load a resource from any thread. Returns NULL on failure, leaving the error
+// to be reported by a later DoLoad() of the same resource.
+Handle DoLoadDetached(int resType, size_t resNum);
+
+// Load a resource from the volumes only, passing over any override, patch
+// file or archive, as a detached load does. Returns NULL on failure.
+Handle DoLoadVolume(int resType, size_t resNum);
+
 #endif // SCI_KERNEL_VOLLOAD_H
@@ -88,7 +88,7 @@ void DisposeClone(Obj *obj);
 // Invoke an object method from the kernel.
 // 'obj' is the object to send the 'selector' message.
 // 'sel' is the number of arguments to the method,
-// 'argc' is the start of the argument list.
+// 'argc' is the start of the argument list, each argument a uintptr_t.
 uintptr_t InvokeMethod(Obj *obj, ObjID sel, uint argc, ...);
 
 // Send messages to the given object.
@@ -36,6 +36,9 @@ typedef struct Script {
     ExportTable *exports;
     uintptr_t   *vars;
     void        *synonyms;
+    byte        *saidSpecs; // said specs in the heap
+    uint         saidSize;  // bytes of them
+    void        *saids;     // their matchers, compiled by the parser
     bool         text;
     int          clones;
 } Script;
@@ -91,6 +94,9 @@ Script *ScriptPtr(uint num);
 // clear its local variables, and return a pointer to its script node.
 Script *LoadScript(uint num);
 
+// Return the script whose said specs hold 'spec', or NULL.
+Script *FindSaidScript(const byte *spec);
+
 // Dispose of the entire script list (for restart game).
 void DisposeAllScripts(void);
 
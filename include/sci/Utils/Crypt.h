@@ -3,6 +3,110 @@
 
 #include "sci/Utils/Types.h"
 
-bool DecompressLZW_1(uint8_t *dest, uint8_t *src, int length, int complength);
+// Resource compression methods (as stored in the resource segment header).
+#define COMP_NONE     0
+#define COMP_HUFFMAN  1
+#define COMP_LZW1     2
+#define COMP_DCL      8
+#define COMP_DCL_VIEW 18
+#define COMP_DCL_PIC  19
+#define COMP_DCL_ANY  20
+
+#define MAXCOMPRESSIONS 32
+
+// Result codes of a decompressor's decode procedure.
+#define DECOMP_ERROR (-1)
+#define DECOMP_MORE  0 // output buffer is full or input ran out
+#define DECOMP_END   1 // end of compressed data was reached
+
+// Bit reader over the compressed input that has been fed so far.
+// Reading past the end of the buffered input sets 'underflow' (and returns
+// zero bits), letting a decoder roll back to the start of the current token
+// and wait for more input.
+typedef struct BitStream {
+    const uint8_t *data;
+    size_t         size;   // bytes of buffered input
+    size_t         bitPos; // read position in bits
+    bool           underflow;
+} BitStream;
+
+// Read bits most significant first.
+uint GetBitsMSB(BitStream *bs, uint numBits);
+
+// Read bits least significant first.
+uint GetBitsLSB(BitStream *bs, uint numBits);
+
+// A decompressor decodes from 'in' into dest, storing in *written the number
+// of bytes produced. It must only consume complete tokens, and must keep any
+// state it needs (such as a history window) to continue with a new output
+// buffer on the next call.
+typedef struct Decompressor {
+    const char *name;
+    size_t      stateSize;
+    void (*init)(void *state);
+    int (*decode)(void      *state,
+                  BitStream *in,
+                  uint8_t   *dest,
+                  uint       size,
+                  uint      *written);
+} Decompressor;
+
+// Throughput accounting for a decompressor.
+typedef struct DecompStats {
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+    uint64_t nanoseconds;
+    uint     resources;
+} DecompStats;
+
+typedef struct DecompStream DecompStream;
+
+// Register the built-in decompressors and build their tables. Call it once
+// before any thread decompresses.
+void InitDecompressors(void);
+
+// Make a decompressor available for a compression method.
+bool RegisterDecompressor(uint compression, const Decompressor *decomp);
+
+// Return the decompressor registered for the compression method, or NULL.
+const Decompressor *FindDecompressor(uint compression);
+
+// Begin decoding a resource of 'length' decompressed bytes.
+// Returns NULL if there is no decompressor for the method.
+DecompStream *OpenDecompressor(uint compression, uint length);
+
+// Hand the next chunk of compressed input to the stream. 'last' marks the end
+// of the compressed data.
+bool FeedDecompressor(DecompStream *stream,
+                      const void   *src,
+                      uint          size,
+                      bool          last);
+
+// Decode into dest, returning the number of bytes produced (zero if more input
+// is needed) or -1 on a decoding error.
+int ReadDecompressor(DecompStream *stream, void *dest, uint size);
+
+// Return TRUE once all 'length' bytes have been produced.
+bool DecompressorDone(const DecompStream *stream);
+
+void CloseDecompressor(DecompStream *stream);
+
+// Decompress a whole buffer in one call.
+bool Decompress(uint        compression,
+                void       *dest,
+                uint        length,
+                const void *src,
+                uint        complength);
+
+// Fill in the throughput accounting of a compression method.
+void GetDecompStats(uint compression, DecompStats *stats);
+
+// Built-in decompressors.
+extern const Decompressor g_lzw1Decompressor;
+extern const Decompressor g_huffmanDecompressor;
+extern const Decompressor g_dclDecompressor;
+
+// Build the code tables shared by the DCL decoders.
+void BuildExplodeTables(void);
 
 #endif // SCI_UTILS_CRYPT_H
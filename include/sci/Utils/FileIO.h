@@ -38,6 +38,9 @@ typedef struct DirEntry {
 #define F_SUBDIR   0x10
 #define F_DIRTY    0x20
 
+// Open the file of a DOS path, looking in the resource directory first when
+// it is opened read-only. A file created is readable and writable by all,
+// less the umask.
 int fileopen(const char *name, int mode);
 
 char *fgets_no_eol(char *str, int len, int fd);
@@ -0,0 +1,27 @@
+#ifndef SCI_UTILS_LZ_H
+#define SCI_UTILS_LZ_H
+
+#include "sci/Utils/Types.h"
+
+// A fast byte oriented LZ77 compression, used by the resource archive.
+//
+// The data is a series of sequences, each made of a token byte (the high
+// nibble is the number of literals, the low nibble the match length less
+// LZ_MINMATCH), the literals, and a 16-bit little endian match offset. A
+// nibble of 15 is followed by bytes adding to it, up to the first one below
+// 255. The last sequence has only literals.
+
+#define LZ_MINMATCH 4
+
+// Return the size of the buffer LzCompress() needs in the worst case.
+#define LzBound(size) ((size) + (size) / 255 + 16)
+
+// Compress src into dest, returning the compressed size or 0 if it doesn't
+// fit into destSize bytes.
+uint LzCompress(void *dest, uint destSize, const void *src, uint size);
+
+// Decompress exactly 'length' bytes into dest. Returns FALSE if the data is
+// corrupt.
+bool LzDecompress(void *dest, uint length, const void *src, uint srcSize);
+
+#endif // SCI_UTILS_LZ_H
@@ -0,0 +1,16 @@
+#ifndef SCI_UTILS_SORT_H
+#define SCI_UTILS_SORT_H
+
+#include "sci/Utils/Types.h"
+
+// Sort 'num' elements of 'size' bytes at 'base' by 'compare', as qsort does,
+// but keeping elements that compare equal in the order they were in. Input
+// that is already sorted takes linear time. 'scratch' must have room for
+// (num / 2) elements.
+void StableSort(void  *base,
+                size_t num,
+                size_t size,
+                int (*compare)(const void *, const void *),
+                void *scratch);
+
+#endif // SCI_UTILS_SORT_H
@@ -0,0 +1,42 @@
+#ifndef SCI_UTILS_THREAD_H
+#define SCI_UTILS_THREAD_H
+
+#include "sci/Utils/Mutex.h"
+
+#if defined(__WINDOWS__)
+typedef HANDLE             Thread;
+typedef CONDITION_VARIABLE CondVar;
+#else
+typedef pthread_t      Thread;
+typedef pthread_cond_t CondVar;
+#endif
+
+// A variable of which each thread has its own copy.
+#if defined(__WINDOWS__)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+typedef void (*ThreadProc)(void *arg);
+
+// Run proc(arg) on a new thread. Returns FALSE if the thread can't be created.
+bool StartThread(Thread *thread, ThreadProc proc, void *arg);
+
+// Wait for the thread to finish.
+void JoinThread(Thread *thread);
+
+void CreateCondVar(CondVar *cond);
+void DestroyCondVar(CondVar *cond);
+
+// Atomically release the mutex and wait for the condition to be signaled.
+// The mutex is held again on return.
+void WaitCondVar(CondVar *cond, Mutex *mutex);
+
+// Wake one waiting thread.
+void SignalCondVar(CondVar *cond);
+
+// Wake all waiting threads.
+void BroadcastCondVar(CondVar *cond);
+
+#endif // SCI_UTILS_THREAD_H
@@ -57,10 +57,17 @@
 #define __IOS__  1
 #elif defined(__QNX__)
 #define __BLACKBERRY__  1
+#elif defined(__linux__)
+#define __LINUX__  1
 #else
 #error Unsupported Operating System!
 #endif
 
+// The calling convention of the drivers is the compiler's own on Linux.
+#if defined(__LINUX__) && !defined(__cdecl)
+#define __cdecl
+#endif
+
 #if defined(DEBUG) && !defined(_DEBUG)
 #define _DEBUG 1
 #endif
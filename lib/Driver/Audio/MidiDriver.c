@@ -4,6 +4,7 @@
 #elif defined(__IOS__)
 #include "sci/Utils/Path.h"
 #include <AudioToolbox/AUGraph.h>
+#elif defined(__LINUX__)
 #else
 #include <CoreMIDI/CoreMIDI.h>
 #endif
@@ -47,6 +48,7 @@ static HMIDIOUT s_hMidiOut  = NULL;
 static AUGraph   s_auGraph   = NULL;
 static AudioUnit s_synthUnit;
 static AudioUnit s_ioUnit;
+#elif defined(__LINUX__)
 #else
 MIDIClientRef   s_midiClient = 0;
 MIDIPortRef     s_midiPort   = 0;
@@ -130,6 +132,12 @@ static void SendMsg(uint16_t channel,
 #elif defined(__IOS__)
     MusicDeviceMIDIEvent(
       s_synthUnit, (uint8_t)channel | command, data1, data2, 0);
+#elif defined(__LINUX__)
+    // There is no synthesizer, so the messages go nowhere.
+    (void)channel;
+    (void)command;
+    (void)data1;
+    (void)data2;
 #else
     Byte msg[3] = { (uint8_t)channel | command, data1, data2 };
 
@@ -338,6 +346,7 @@ static uint __cdecl Init(void)
     // Start the graph
     result = AUGraphStart(s_auGraph);
     assert(result == noErr && "Unable to start audio processing graph.");
+#elif defined(__LINUX__)
 #else
     OSStatus    result;
     CFStringRef name;
@@ -389,6 +398,7 @@ static void __cdecl Terminate(void)
         DisposeAUGraph(s_auGraph);
         s_auGraph = NULL;
     }
+#elif defined(__LINUX__)
 #else
     if (s_midiPort != 0) {
         MIDIPortDispose(s_midiPort);
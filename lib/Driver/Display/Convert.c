@@ -0,0 +1,179 @@
+#include "sci/Driver/Display/Convert.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) ||            \
+  defined(_M_IX86)
+#define CONVERT_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// Let the compiler emit the instructions of a level in one function only.
+#if defined(__GNUC__)
+#define TARGET(isa) __attribute__((target(isa)))
+#else
+#define TARGET(isa)
+#endif
+
+typedef void (*ConvertProc)(uint32_t       *dst,
+                            const uint8_t  *src,
+                            uint            count,
+                            const uint32_t *clut);
+
+static void ConvertScalar(uint32_t       *dst,
+                          const uint8_t  *src,
+                          uint            count,
+                          const uint32_t *clut);
+#if defined(CONVERT_X86)
+static void ConvertSSE2(uint32_t       *dst,
+                        const uint8_t  *src,
+                        uint            count,
+                        const uint32_t *clut);
+static void ConvertAVX2(uint32_t       *dst,
+                        const uint8_t  *src,
+                        uint            count,
+                        const uint32_t *clut);
+#endif
+
+static const ConvertProc s_procs[NISALEVELS] = {
+    ConvertScalar,
+#if defined(CONVERT_X86)
+    ConvertSSE2,
+    ConvertAVX2,
+#else
+    NULL,
+    NULL,
+#endif
+};
+
+static const char *const s_isaNames[NISALEVELS] = { "scalar", "sse2", "avx2" };
+
+static uint s_isa     = NISALEVELS; // not chosen yet
+static uint s_bestIsa = NISALEVELS; // not detected yet
+
+uint GetBestIsa(void)
+{
+    if (s_bestIsa != NISALEVELS) {
+        return s_bestIsa;
+    }
+
+    s_bestIsa = ISA_SCALAR;
+#if defined(CONVERT_X86)
+#if defined(_MSC_VER)
+    {
+        int info[4];
+
+        __cpuid(info, 1);
+        if ((info[3] & (1 << 26)) != 0) {
+            s_bestIsa = ISA_SSE2;
+        }
+
+        // AVX2 needs the OS to save the YMM registers too.
+        if ((info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6) {
+            __cpuidex(info, 7, 0);
+            if ((info[1] & (1 << 5)) != 0) {
+                s_bestIsa = ISA_AVX2;
+            }
+        }
+    }
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        s_bestIsa = ISA_SSE2;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        s_bestIsa = ISA_AVX2;
+    }
+#endif
+#endif
+    return s_bestIsa;
+}
+
+const char *GetIsaName(uint isa)
+{
+    return (isa < NISALEVELS) ? s_isaNames[isa] : "unknown";
+}
+
+bool SetConvertIsa(uint isa)
+{
+    if (isa > GetBestIsa()) {
+        return false;
+    }
+
+    s_isa = isa;
+    return true;
+}
+
+uint GetConvertIsa(void)
+{
+    if (s_isa == NISALEVELS) {
+        s_isa = GetBestIsa();
+    }
+    return s_isa;
+}
+
+void ConvertPixels(uint32_t       *dst,
+                   const uint8_t  *src,
+                   uint            count,
+                   const uint32_t *clut)
+{
+    s_procs[GetConvertIsa()](dst, src, count, clut);
+}
+
+static void ConvertScalar(uint32_t       *dst,
+                          const uint8_t  *src,
+                          uint            count,
+                          const uint32_t *clut)
+{
+    uint i;
+
+    for (i = 0; i < count; ++i) {
+        dst[i] = clut[src[i]];
+    }
+}
+
+#if defined(CONVERT_X86)
+
+// SSE2 has no gather: look the pixels up one by one, but store them four at
+// a time.
+TARGET("sse2")
+static void ConvertSSE2(uint32_t       *dst,
+                        const uint8_t  *src,
+                        uint            count,
+                        const uint32_t *clut)
+{
+    uint i;
+
+    for (i = 0; i + 4 <= count; i += 4) {
+        _mm_storeu_si128((__m128i *)(dst + i),
+                         _mm_set_epi32((int)clut[src[i + 3]],
+                                       (int)clut[src[i + 2]],
+                                       (int)clut[src[i + 1]],
+                                       (int)clut[src[i]]));
+    }
+
+    ConvertScalar(dst + i, src + i, count - i, clut);
+}
+
+TARGET("avx2")
+static void ConvertAVX2(uint32_t       *dst,
+                        const uint8_t  *src,
+                        uint            count,
+                        const uint32_t *clut)
+{
+    __m256i indices;
+    uint    i;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        indices = _mm256_cvtepu8_epi32(
+          _mm_loadl_epi64((const __m128i *)(src + i)));
+        _mm256_storeu_si256(
+          (__m256i *)(dst + i),
+          _mm256_i32gather_epi32((const int *)clut, indices, 4));
+    }
+
+    ConvertScalar(dst + i, src + i, count - i, clut);
+}
+
+#endif
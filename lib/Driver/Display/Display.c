@@ -1,78 +1,144 @@
 #include "sci/Driver/Display/Display.h"
+#include "sci/Driver/Display/Convert.h"
 #include "sci/Kernel/Graphics.h"
-#if defined(__WINDOWS__)
-#include <GL/gl.h>
-#elif defined(__IOS__)
-#include <OpenGLES/ES1/gl.h>
-#include <dispatch/dispatch.h>
-#endif
-
-typedef struct Rgb {
-    uint8_t r;
-    uint8_t g;
-    uint8_t b;
-} Rgb;
-
-static Rgb s_clut[PAL_CLUT_SIZE] = { 0 };
-static Rgb s_pixels[MAXWIDTH * MAXHEIGHT] = { 0 };
-
-#if defined(__WINDOWS__)
-HDC   g_hDcWnd = NULL;
-HGLRC g_hWgl   = NULL;
-#elif defined(__IOS__)
-static dispatch_queue_t s_dispatchQueue = NULL;
-#endif
-
-static GLuint        s_texture       = 0;
-static const GLfloat s_texVertices[] = {
-    0.f, 0.f,
-    0.f, 1.f,
-    1.f, 0.f,
-    1.f, 1.f
-};
-static const GLfloat s_vertices[] = {
-    -1.f,  1.f,
-    -1.f, -1.f,
-     1.f,  1.f,
-     1.f, -1.f
-};
-
-#if defined(__IOS__)
-void SwapBuffers(void);
-void DispatchDisplay(void *);
-#endif
+#include "sci/Utils/Thread.h"
+#include "sci/Utils/Timer.h"
+
+// Merge two dirty rectangles when their union covers no more than this many
+// pixels besides theirs: a few rows are cheaper to upload than a separate
+// call.
+#define MERGESLACK (8 * MAXWIDTH)
+
+// Convert the whole frame again for a change of the CLUT when its changed
+// entries are shown by at least 1 / RECOLORALL of the pixels, rather than
+// look for the rows showing them.
+#define RECOLORALL 4
+
+// Which map a pixel of a snapshot shows.
+#define SHOW_VISUAL   0
+#define SHOW_PRIORITY 1
+
+typedef struct DirtyList {
+    RRect rects[MAXDIRTY];
+    uint  count;
+} DirtyList;
+
+// What the render thread needs to make a frame: the changed parts of the
+// screen, as palette indices, and the CLUT to show them with.
+typedef struct Snapshot {
+    uint8_t   index[MAXWIDTH * MAXHEIGHT];
+    uint8_t   show[MAXWIDTH * MAXHEIGHT];
+    uint32_t  clut[PAL_CLUT_SIZE];
+    DirtyList dirty;
+    uint64_t  flushTime; // of the oldest flush in the snapshot
+} Snapshot;
+
+// Interpreter side: the screen as last displayed, and what changed since the
+// last flush.
+static uint32_t  s_clut[PAL_CLUT_SIZE] = { 0 };
+static bool      s_clutChanged         = false;
+static uint8_t   s_index[MAXWIDTH * MAXHEIGHT];
+static uint8_t   s_show[MAXWIDTH * MAXHEIGHT];
+static DirtyList s_drawn;
+
+// Gun values scaled by each intensity up to MAX_INTENSITY.
+static uint8_t s_scaled[MAX_INTENSITY + 1][256];
+static bool    s_scaledReady = false;
+
+// The handoff: the interpreter fills s_back, and the render thread swaps it
+// with s_front once it is pending.
+static Snapshot  s_snapshots[2];
+static Snapshot *s_back    = &s_snapshots[0];
+static Snapshot *s_front   = &s_snapshots[1];
+static bool      s_pending = false;
+static uint      s_flushed = 0; // snapshots handed off
+static uint      s_done    = 0; // snapshots presented
+static Mutex     s_frameMutex;
+static CondVar   s_frameCond; // a snapshot is pending
+static CondVar   s_doneCond;  // a snapshot was presented
+
+// Render side: the framebuffer, and what changed in it since the backend's
+// last present.
+static uint32_t  s_pixels[MAXWIDTH * MAXHEIGHT] = { 0 };
+static DirtyList s_converted;
+static Mutex     s_convertedMutex;
+
+// Render side: what the framebuffer was converted from, and how many pixels
+// of each row show each color of the visual map, to find those to convert
+// again when the CLUT changes.
+static uint8_t  s_frameIndex[MAXWIDTH * MAXHEIGHT];
+static uint8_t  s_frameShow[MAXWIDTH * MAXHEIGHT];
+static uint32_t s_frameClut[PAL_CLUT_SIZE];
+static uint16_t s_rowColors[MAXHEIGHT][PAL_CLUT_SIZE];
+static uint     s_colors[PAL_CLUT_SIZE];
+
+// The colors of the priority map, indexed by the whole byte of the map.
+static uint32_t s_priClut[PAL_CLUT_SIZE];
+
+static Thread       s_renderThread;
+static bool         s_threaded = false;
+static bool         s_ready    = false;
+static bool         s_quit     = false;
+static DisplayStats s_stats;
+
+static void InitPriClut(void);
+static void InitFrame(void);
+static void InitScaled(void);
+static void AddDirtyRect(DirtyList *list, const RRect *rect);
+static void RenderThread(void *arg);
+static void RenderSnapshot(const Snapshot *snap);
+static void CopyToFrame(const Snapshot *snap, const RRect *rect);
+static uint Recolor(const uint32_t *clut);
+static void ConvertRect(const RRect *rect);
 
 void InitDisplay(void)
 {
-#if defined(__WINDOWS__)
-    g_hWgl = wglCreateContext(g_hDcWnd);
-    wglMakeCurrent(g_hDcWnd, g_hWgl);
-#elif defined(__IOS__)
-    s_dispatchQueue = dispatch_queue_create(NULL, 0);
-#endif
-
-    glClearColor(0.0, 0.0, 0.0, 1.0);
-    glViewport(0, 0, DISPLAYWIDTH, DISPLAYHEIGHT);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-
-    glGenTextures(1, &s_texture);
-    glBindTexture(GL_TEXTURE_2D, s_texture);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-#if defined(__IOS__)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-#endif
+    CreateMutex(&s_frameMutex, false);
+    CreateMutex(&s_convertedMutex, false);
+    CreateCondVar(&s_frameCond);
+    CreateCondVar(&s_doneCond);
+    InitPriClut();
+    InitFrame();
+
+    // The display may be initialized again after EndDisplay().
+    s_ready   = false;
+    s_quit    = false;
+    s_pending = false;
+    s_flushed = 0;
+    s_done    = 0;
+
+    // The backend is initialized on the thread that presents, as GL contexts
+    // belong to a thread.
+    s_threaded = StartThread(&s_renderThread, RenderThread, NULL);
+    if (s_threaded) {
+        LockMutex(&s_frameMutex);
+        while (!s_ready) {
+            WaitCondVar(&s_doneCond, &s_frameMutex);
+        }
+        UnlockMutex(&s_frameMutex);
+    } else {
+        InitDisplayBackend();
+    }
 }
 
 void EndDisplay(void)
 {
-#ifndef NOT_IMPL
-#error Not finished
-#endif
+    if (s_threaded) {
+        LockMutex(&s_frameMutex);
+        s_quit = true;
+        SignalCondVar(&s_frameCond);
+        UnlockMutex(&s_frameMutex);
+
+        JoinThread(&s_renderThread);
+        s_threaded = false;
+    } else {
+        EndDisplayBackend();
+    }
+
+    DestroyCondVar(&s_doneCond);
+    DestroyCondVar(&s_frameCond);
+    DestroyMutex(&s_convertedMutex);
+    DestroyMutex(&s_frameMutex);
 }
 
 void Display(int      top,
@@ -82,10 +148,18 @@ void Display(int      top,
              uint8_t *bits,
              uint     mapSet)
 {
-    int      width;
-    int      i;
-    uint8_t *index;
-    Rgb     *pixel;
+    RRect rect;
+    int   width;
+    int   show;
+    int   row;
+
+    if ((mapSet & VMAP) != 0) {
+        show = SHOW_VISUAL;
+    } else if ((mapSet & PMAP) != 0) {
+        show = SHOW_PRIORITY;
+    } else {
+        return;
+    }
 
     if (bottom > MAXHEIGHT) {
         bottom = MAXHEIGHT;
@@ -93,109 +167,128 @@ void Display(int      top,
     if (right > MAXWIDTH) {
         right = MAXWIDTH;
     }
+    if (top >= bottom || left >= right) {
+        return;
+    }
     width = right - left;
 
-    // Move to correct row.
-    pixel = s_pixels + (top * MAXWIDTH);
-    index = bits + (top * MAXWIDTH);
+    // Just take a copy: the conversion is done by the render thread.
+    for (row = top; row < bottom; ++row) {
+        memcpy(s_index + (row * MAXWIDTH) + left,
+               bits + (row * MAXWIDTH) + left,
+               width);
+        memset(s_show + (row * MAXWIDTH) + left, show, width);
+    }
 
-    // Offset to left.
-    pixel += left;
-    index += left;
+    rect.top    = (int16_t)top;
+    rect.left   = (int16_t)left;
+    rect.bottom = (int16_t)bottom;
+    rect.right  = (int16_t)right;
+    AddDirtyRect(&s_drawn, &rect);
+}
 
-    if ((mapSet & VMAP) != 0) {
-        for (; top < bottom; ++top) {
-            for (i = 0; i < width; ++i) {
-                pixel[i] = s_clut[index[i]];
-            }
+void FlushDisplay(void)
+{
+    const RRect *rect;
+    uint64_t     start;
+    uint64_t     elapsed;
+    uint         i;
+    int          row;
+    size_t       offset;
+
+    if (s_drawn.count == 0 && !s_clutChanged) {
+        return;
+    }
 
-            // Jump to next line.
-            pixel += MAXWIDTH;
-            index += MAXWIDTH;
-        }
-    } else if ((mapSet & PMAP) != 0) {
-        static const Rgb c_colors[0xf] = {
-            {   0,   0,   0 },
-            {   0,   0, 160 },
-            {   0, 160,   0 },
-            {   0, 160, 160 },
-            { 160,   0,   0 },
-            { 160,   0, 160 },
-            { 160,  80,   0 },
-            { 160, 160, 160 },
-            {  80,  80,  80 },
-            {  80,  80, 255 },
-            {  80, 255,   0 },
-            {  80, 255, 255 },
-            { 255,  80,  80 },
-            { 255,  80, 255 },
-            { 255, 255,  80 },
-        };
-
-        for (; top < bottom; ++top) {
-            for (i = 0; i < width; ++i) {
-                pixel[i] = c_colors[index[i] >> 4];
-            }
+    start = GetHighResolutionTime();
+    LockMutex(&s_frameMutex);
 
-            // Jump to next line.
-            pixel += MAXWIDTH;
-            index += MAXWIDTH;
-        }
+    // If the render thread hasn't taken the last snapshot yet, add to it.
+    if (s_pending) {
+        s_stats.merged++;
     } else {
-        return;
+        s_back->dirty.count = 0;
+        s_back->flushTime   = start;
     }
 
-#if defined(__IOS__)
-    dispatch_async_f(s_dispatchQueue, NULL, DispatchDisplay);
-}
+    for (i = 0; i < s_drawn.count; ++i) {
+        AddDirtyRect(&s_back->dirty, &s_drawn.rects[i]);
+    }
+    s_drawn.count = 0;
+
+    // Merged rectangles may cover more than what was drawn, so copy all of
+    // them from the current screen.
+    for (i = 0; i < s_back->dirty.count; ++i) {
+        rect = &s_back->dirty.rects[i];
+        for (row = rect->top; row < rect->bottom; ++row) {
+            offset = (size_t)(row * MAXWIDTH + rect->left);
+            memcpy(s_back->index + offset,
+                   s_index + offset,
+                   rect->right - rect->left);
+            memcpy(s_back->show + offset,
+                   s_show + offset,
+                   rect->right - rect->left);
+        }
+    }
+    memcpy(s_back->clut, s_clut, sizeof(s_clut));
+    s_clutChanged = false;
 
-void DoDisplay(void)
-{
-#endif
+    if (!s_pending) {
+        s_pending = true;
+        s_flushed++;
+    }
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-#if defined(__IOS__)
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-#endif
-    glEnable(GL_TEXTURE_2D);
-#if defined(__WINDOWS__)
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY_EXT);
-#elif defined(__IOS__)
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-#endif
-    glEnableClientState(GL_VERTEX_ARRAY);
+    elapsed = GetHighResolutionTime() - start;
+    s_stats.flushes++;
+    s_stats.flushNs += elapsed;
+    if (elapsed > s_stats.flushMaxNs) {
+        s_stats.flushMaxNs = elapsed;
+    }
 
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_RGB,
-                 MAXWIDTH,
-                 MAXHEIGHT,
-                 0,
-                 GL_RGB,
-                 GL_UNSIGNED_BYTE,
-                 s_pixels);
-    glBindTexture(GL_TEXTURE_2D, s_texture);
-    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    if (s_threaded) {
+        SignalCondVar(&s_frameCond);
+        UnlockMutex(&s_frameMutex);
+        return;
+    }
 
-    // vertex
-    glVertexPointer(2, GL_FLOAT, 0, s_vertices);
+    // No render thread: present right away.
+    s_pending = false;
+    RenderSnapshot(s_back);
+    s_done++;
+    UnlockMutex(&s_frameMutex);
+}
 
-    // texCoods
-    glTexCoordPointer(2, GL_FLOAT, 0, s_texVertices);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+void SyncDisplay(void)
+{
+    LockMutex(&s_frameMutex);
+    while (s_threaded && s_done != s_flushed) {
+        WaitCondVar(&s_doneCond, &s_frameMutex);
+    }
+    UnlockMutex(&s_frameMutex);
+}
+
+uint TakeDirtyRects(RRect dirty[MAXDIRTY])
+{
+    uint numDirty;
+
+    LockMutex(&s_convertedMutex);
+    numDirty = s_converted.count;
+    memcpy(dirty, s_converted.rects, numDirty * sizeof(RRect));
+    s_converted.count = 0;
+    UnlockMutex(&s_convertedMutex);
+    return numDirty;
+}
 
-    glDisableClientState(GL_VERTEX_ARRAY);
-#if defined(__WINDOWS__)
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY_EXT);
-#elif defined(__IOS__)
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-#endif
-    glDisable(GL_TEXTURE_2D);
+const uint32_t *GetDisplayPixels(void)
+{
+    return s_pixels;
+}
 
-#if defined(__WINDOWS__)
-    SwapBuffers(g_hDcWnd);
-#endif
+void GetDisplayStats(DisplayStats *stats)
+{
+    LockMutex(&s_frameMutex);
+    *stats = s_stats;
+    UnlockMutex(&s_frameMutex);
 }
 
 void GetDisplayCLUT(RPalette *pal)
@@ -204,31 +297,343 @@ void GetDisplayCLUT(RPalette *pal)
 
     for (i = 0; i < PAL_CLUT_SIZE; ++i) {
         pal->gun[i].flags = PAL_IN_USE;
-        pal->gun[i].r     = s_clut[i].r;
-        pal->gun[i].g     = s_clut[i].g;
-        pal->gun[i].b     = s_clut[i].b;
+        pal->gun[i].r     = (uint8_t)s_clut[i];
+        pal->gun[i].g     = (uint8_t)(s_clut[i] >> 8);
+        pal->gun[i].b     = (uint8_t)(s_clut[i] >> 16);
     }
 }
 
 void SetDisplayCLUT(const RPalette *pal)
 {
+    const uint8_t *scaled;
+    uint32_t       color;
+    uint           i;
+    int            intensity;
+
+    if (!s_scaledReady) {
+        InitScaled();
+    }
+
+    for (i = 0; i < PAL_CLUT_SIZE; ++i) {
+        intensity = (int)pal->palIntensity[i];
+        if ((uint)intensity <= MAX_INTENSITY) {
+            scaled = s_scaled[intensity];
+            color  = RGBA32(scaled[pal->gun[i].r],
+                           scaled[pal->gun[i].g],
+                           scaled[pal->gun[i].b]);
+        } else {
+            color = RGBA32(
+              (uint8_t)(((int)pal->gun[i].r * intensity) / MAX_INTENSITY),
+              (uint8_t)(((int)pal->gun[i].g * intensity) / MAX_INTENSITY),
+              (uint8_t)(((int)pal->gun[i].b * intensity) / MAX_INTENSITY));
+        }
+
+        // The next flush presents a change, even with nothing drawn.
+        if (color != s_clut[i]) {
+            s_clut[i]     = color;
+            s_clutChanged = true;
+        }
+    }
+}
+
+static void RenderThread(void *arg)
+{
+    Snapshot *snap;
+
+    InitDisplayBackend();
+
+    LockMutex(&s_frameMutex);
+    s_ready = true;
+    BroadcastCondVar(&s_doneCond);
+
+    while (!s_quit) {
+        if (!s_pending) {
+            WaitCondVar(&s_frameCond, &s_frameMutex);
+            continue;
+        }
+
+        snap      = s_back;
+        s_back    = s_front;
+        s_front   = snap;
+        s_pending = false;
+        UnlockMutex(&s_frameMutex);
+
+        RenderSnapshot(snap);
+
+        LockMutex(&s_frameMutex);
+        s_done++;
+        BroadcastCondVar(&s_doneCond);
+    }
+    UnlockMutex(&s_frameMutex);
+
+    EndDisplayBackend();
+}
+
+// Convert the dirty parts of the snapshot to the framebuffer, and the pixels
+// whose colors changed in the CLUT, and present.
+static void RenderSnapshot(const Snapshot *snap)
+{
+    uint64_t start;
+    uint64_t end;
+    uint     recolored;
+    uint     i;
+
+    start = GetHighResolutionTime();
+
+    for (i = 0; i < snap->dirty.count; ++i) {
+        CopyToFrame(snap, &snap->dirty.rects[i]);
+    }
+
+    // The whole frame may have been converted again.
+    recolored = Recolor(snap->clut);
+    if (recolored < MAXWIDTH * MAXHEIGHT) {
+        for (i = 0; i < snap->dirty.count; ++i) {
+            ConvertRect(&snap->dirty.rects[i]);
+        }
+    }
+
+    PresentDisplay();
+
+    end = GetHighResolutionTime();
+
+    // Without a render thread, the frame mutex is already held.
+    if (s_threaded) {
+        LockMutex(&s_frameMutex);
+    }
+    s_stats.frames++;
+    s_stats.recolored += recolored;
+    s_stats.renderNs += end - start;
+    s_stats.latencyNs += end - snap->flushTime;
+    if (end - snap->flushTime > s_stats.latencyMaxNs) {
+        s_stats.latencyMaxNs = end - snap->flushTime;
+    }
+    if (s_threaded) {
+        UnlockMutex(&s_frameMutex);
+    }
+}
+
+// Copy a rectangle of the snapshot to the frame, counting the colors of the
+// visual map in the rows it changes.
+static void CopyToFrame(const Snapshot *snap, const RRect *rect)
+{
+    uint16_t *rowColors;
+    int       row, x, width;
+    size_t    offset;
+
+    width = rect->right - rect->left;
+    for (row = rect->top; row < rect->bottom; ++row) {
+        offset = (size_t)(row * MAXWIDTH + rect->left);
+        if (memcmp(s_frameIndex + offset, snap->index + offset, width) == 0 &&
+            memcmp(s_frameShow + offset, snap->show + offset, width) == 0) {
+            continue;
+        }
+
+        rowColors = s_rowColors[row];
+        for (x = 0; x < width; ++x) {
+            if (s_frameShow[offset + x] == SHOW_VISUAL) {
+                --rowColors[s_frameIndex[offset + x]];
+                --s_colors[s_frameIndex[offset + x]];
+            }
+            if (snap->show[offset + x] == SHOW_VISUAL) {
+                ++rowColors[snap->index[offset + x]];
+                ++s_colors[snap->index[offset + x]];
+            }
+        }
+
+        memcpy(s_frameIndex + offset, snap->index + offset, width);
+        memcpy(s_frameShow + offset, snap->show + offset, width);
+    }
+}
+
+// Convert again the rows showing colors changed in the CLUT, or the whole
+// frame if they are enough. Return the number of pixels converted.
+static uint Recolor(const uint32_t *clut)
+{
+    uint8_t changed[PAL_CLUT_SIZE];
+    uint    numChanged = 0;
+    uint    pixels     = 0;
+    uint    recolored  = 0;
+    uint    i;
+    RRect   rect;
+    int     row;
+    bool    shown;
+
+    for (i = 0; i < PAL_CLUT_SIZE; ++i) {
+        if (clut[i] != s_frameClut[i]) {
+            s_frameClut[i] = clut[i];
+            if (s_colors[i] != 0) {
+                changed[numChanged++] = (uint8_t)i;
+                pixels += s_colors[i];
+            }
+        }
+    }
+    if (numChanged == 0) {
+        return 0;
+    }
+
+    rect.left  = 0;
+    rect.right = MAXWIDTH;
+
+    if (pixels * RECOLORALL >= MAXWIDTH * MAXHEIGHT) {
+        rect.top    = 0;
+        rect.bottom = MAXHEIGHT;
+        ConvertRect(&rect);
+        return MAXWIDTH * MAXHEIGHT;
+    }
+
+    // Convert the runs of rows showing any of the changed colors.
+    rect.top = -1;
+    for (row = 0; row <= MAXHEIGHT; ++row) {
+        shown = false;
+        for (i = 0; row < MAXHEIGHT && i < numChanged && !shown; ++i) {
+            shown = s_rowColors[row][changed[i]] != 0;
+        }
+
+        if (shown && rect.top < 0) {
+            rect.top = (int16_t)row;
+        } else if (!shown && rect.top >= 0) {
+            rect.bottom = (int16_t)row;
+            ConvertRect(&rect);
+            recolored += (uint)(row - rect.top) * MAXWIDTH;
+            rect.top = -1;
+        }
+    }
+    return recolored;
+}
+
+// Convert a rectangle of the frame, and note it for the backend.
+static void ConvertRect(const RRect *rect)
+{
+    int    row;
+    int    x, run;
+    size_t offset;
+
+    for (row = rect->top; row < rect->bottom; ++row) {
+        offset = (size_t)(row * MAXWIDTH);
+
+        // Convert runs of pixels that show the same map.
+        for (x = rect->left; x < rect->right; x = run) {
+            run = x + 1;
+            while (run < rect->right &&
+                   s_frameShow[offset + run] == s_frameShow[offset + x]) {
+                ++run;
+            }
+
+            ConvertPixels(s_pixels + offset + x,
+                          s_frameIndex + offset + x,
+                          (uint)(run - x),
+                          (s_frameShow[offset + x] == SHOW_PRIORITY)
+                            ? s_priClut
+                            : s_frameClut);
+        }
+    }
+
+    LockMutex(&s_convertedMutex);
+    AddDirtyRect(&s_converted, rect);
+    UnlockMutex(&s_convertedMutex);
+}
+
+static uint RectArea(const RRect *rect)
+{
+    return (uint)(rect->bottom - rect->top) * (uint)(rect->right - rect->left);
+}
+
+static void UnionDirty(const RRect *a, const RRect *b, RRect *dst)
+{
+    dst->top    = min(a->top, b->top);
+    dst->left   = min(a->left, b->left);
+    dst->bottom = max(a->bottom, b->bottom);
+    dst->right  = max(a->right, b->right);
+}
+
+static void AddDirtyRect(DirtyList *list, const RRect *newRect)
+{
+    RRect rect = *newRect;
+    RRect both;
+    uint  growth;
+    uint  bestGrowth;
+    uint  best;
+    uint  i;
+
+    // Merge with any rectangle close enough, and start over with the union,
+    // which may now be close to others.
+    i = 0;
+    while (i < list->count) {
+        UnionDirty(&list->rects[i], &rect, &both);
+        if (RectArea(&both) <=
+            RectArea(&list->rects[i]) + RectArea(&rect) + MERGESLACK) {
+            rect           = both;
+            list->rects[i] = list->rects[--list->count];
+            i              = 0;
+        } else {
+            ++i;
+        }
+    }
+
+    // Out of room: merge with the rectangle that grows the least.
+    if (list->count == MAXDIRTY) {
+        best       = 0;
+        bestGrowth = (uint)-1;
+        for (i = 0; i < list->count; ++i) {
+            UnionDirty(&list->rects[i], &rect, &both);
+            growth = RectArea(&both) - RectArea(&list->rects[i]);
+            if (growth < bestGrowth) {
+                bestGrowth = growth;
+                best       = i;
+            }
+        }
+
+        UnionDirty(&list->rects[best], &rect, &rect);
+        list->rects[best] = list->rects[--list->count];
+    }
+
+    list->rects[list->count++] = rect;
+}
+
+static void InitPriClut(void)
+{
+    static const uint32_t c_colors[16] = {
+        RGBA32(0, 0, 0),       RGBA32(0, 0, 160),     RGBA32(0, 160, 0),
+        RGBA32(0, 160, 160),   RGBA32(160, 0, 0),     RGBA32(160, 0, 160),
+        RGBA32(160, 80, 0),    RGBA32(160, 160, 160), RGBA32(80, 80, 80),
+        RGBA32(80, 80, 255),   RGBA32(80, 255, 0),    RGBA32(80, 255, 255),
+        RGBA32(255, 80, 80),   RGBA32(255, 80, 255),  RGBA32(255, 255, 80),
+        RGBA32(255, 255, 255),
+    };
     uint i;
 
+    // The priority is the high nibble.
     for (i = 0; i < PAL_CLUT_SIZE; ++i) {
-        int intensity = (int)pal->palIntensity[i];
-        s_clut[i].r =
-          (uint8_t)(((int)pal->gun[i].r * intensity) / MAX_INTENSITY);
-        s_clut[i].g =
-          (uint8_t)(((int)pal->gun[i].g * intensity) / MAX_INTENSITY);
-        s_clut[i].b =
-          (uint8_t)(((int)pal->gun[i].b * intensity) / MAX_INTENSITY);
+        s_priClut[i] = c_colors[i >> 4];
     }
 }
 
-bool DisplayCursor(bool show)
+// The frame starts out as the visual map, all of color 0, as the snapshots.
+static void InitFrame(void)
 {
-#ifndef NOT_IMPL
-#error Not finished
-#endif
-    return true;
+    int row;
+
+    memset(s_pixels, 0, sizeof(s_pixels));
+    memset(s_frameIndex, 0, sizeof(s_frameIndex));
+    memset(s_frameShow, SHOW_VISUAL, sizeof(s_frameShow));
+    memset(s_frameClut, 0, sizeof(s_frameClut));
+    memset(s_colors, 0, sizeof(s_colors));
+    for (row = 0; row < MAXHEIGHT; ++row) {
+        memset(s_rowColors[row], 0, sizeof(s_rowColors[row]));
+        s_rowColors[row][0] = MAXWIDTH;
+    }
+    s_colors[0] = MAXWIDTH * MAXHEIGHT;
+}
+
+static void InitScaled(void)
+{
+    uint intensity, value;
+
+    for (intensity = 0; intensity <= MAX_INTENSITY; ++intensity) {
+        for (value = 0; value < 256; ++value) {
+            s_scaled[intensity][value] =
+              (uint8_t)(value * intensity / MAX_INTENSITY);
+        }
+    }
+    s_scaledReady = true;
 }
@@ -0,0 +1,174 @@
+#include "sci/Driver/Display/Display.h"
+#if defined(__WINDOWS__)
+#include <GL/gl.h>
+#elif defined(__IOS__)
+#include <OpenGLES/ES1/gl.h>
+#endif
+
+static uint32_t s_upload[MAXWIDTH * MAXHEIGHT];
+
+#if defined(__WINDOWS__)
+HDC   g_hDcWnd = NULL;
+HGLRC g_hWgl   = NULL;
+#endif
+
+static GLuint        s_texture       = 0;
+static const GLfloat s_texVertices[] = {
+    0.f, 0.f,
+    0.f, 1.f,
+    1.f, 0.f,
+    1.f, 1.f
+};
+static const GLfloat s_vertices[] = {
+    -1.f,  1.f,
+    -1.f, -1.f,
+     1.f,  1.f,
+     1.f, -1.f
+};
+
+static void Present(void);
+static void UploadRect(const RRect *rect);
+
+void InitDisplayBackend(void)
+{
+#if defined(__WINDOWS__)
+    g_hWgl = wglCreateContext(g_hDcWnd);
+    wglMakeCurrent(g_hDcWnd, g_hWgl);
+#elif defined(__IOS__)
+    SetGLContext(true);
+#endif
+
+    glClearColor(0.0, 0.0, 0.0, 1.0);
+    glViewport(0, 0, DISPLAYWIDTH, DISPLAYHEIGHT);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+
+    glGenTextures(1, &s_texture);
+    glBindTexture(GL_TEXTURE_2D, s_texture);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+#if defined(__IOS__)
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+#endif
+
+    // Allocate the texture once: presents only update the dirty parts of it.
+    glTexImage2D(GL_TEXTURE_2D,
+                 0,
+                 GL_RGBA,
+                 MAXWIDTH,
+                 MAXHEIGHT,
+                 0,
+                 GL_RGBA,
+                 GL_UNSIGNED_BYTE,
+                 GetDisplayPixels());
+}
+
+void EndDisplayBackend(void)
+{
+#if defined(__IOS__)
+    glDeleteTextures(1, &s_texture);
+    SetGLContext(false);
+#endif
+#ifndef NOT_IMPL
+#error Not finished
+#endif
+}
+
+// The render thread presents the framebuffer before it converts the next
+// snapshot into it.
+void PresentDisplay(void)
+{
+    Present();
+}
+
+bool DisplayCursor(bool show)
+{
+#ifndef NOT_IMPL
+#error Not finished
+#endif
+    return true;
+}
+
+static void Present(void)
+{
+    RRect dirty[MAXDIRTY];
+    uint  numDirty;
+    uint  i;
+
+    numDirty = TakeDirtyRects(dirty);
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+#if defined(__IOS__)
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+#endif
+    glEnable(GL_TEXTURE_2D);
+#if defined(__WINDOWS__)
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY_EXT);
+#elif defined(__IOS__)
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+#endif
+    glEnableClientState(GL_VERTEX_ARRAY);
+
+    glBindTexture(GL_TEXTURE_2D, s_texture);
+    for (i = 0; i < numDirty; ++i) {
+        UploadRect(&dirty[i]);
+    }
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+    // vertex
+    glVertexPointer(2, GL_FLOAT, 0, s_vertices);
+
+    // texCoods
+    glTexCoordPointer(2, GL_FLOAT, 0, s_texVertices);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+#if defined(__WINDOWS__)
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY_EXT);
+#elif defined(__IOS__)
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+#endif
+    glDisable(GL_TEXTURE_2D);
+
+#if defined(__WINDOWS__)
+    SwapBuffers(g_hDcWnd);
+#elif defined(__IOS__)
+    SwapBuffers();
+#endif
+}
+
+static void UploadRect(const RRect *rect)
+{
+    const uint32_t *frame  = GetDisplayPixels();
+    const uint32_t *pixels;
+    int             width  = rect->right - rect->left;
+    int             height = rect->bottom - rect->top;
+    int             y;
+
+    // Whole rows are contiguous in the framebuffer; otherwise pack the
+    // rectangle first, as GL ES has no unpack row length.
+    if (width == MAXWIDTH) {
+        pixels = frame + (rect->top * MAXWIDTH);
+    } else {
+        for (y = 0; y < height; ++y) {
+            memcpy(s_upload + (y * width),
+                   frame + ((rect->top + y) * MAXWIDTH) + rect->left,
+                   width * sizeof(uint32_t));
+        }
+        pixels = s_upload;
+    }
+
+    glTexSubImage2D(GL_TEXTURE_2D,
+                    0,
+                    rect->left,
+                    rect->top,
+                    width,
+                    height,
+                    GL_RGBA,
+                    GL_UNSIGNED_BYTE,
+                    pixels);
+}
@@ -0,0 +1,112 @@
+#include "sci/Driver/Display/Headless.h"
+#include "sci/Driver/Display/Display.h"
+#include "sci/Logger/Log.h"
+
+static FrameProc s_frameProc  = NULL;
+static void     *s_frameArg   = NULL;
+static uint      s_frameCount = 0;
+static uint      s_dumpEvery  = 0;
+static char      s_dumpDir[PATH_MAX];
+
+void InitDisplayBackend(void)
+{
+    const char *every;
+    const char *dir;
+
+    s_frameCount = 0;
+
+    every = getenv("SCI_DUMP_FRAMES");
+    if (every != NULL && atoi(every) > 0) {
+        dir = getenv("SCI_DUMP_DIR");
+        SetFrameDump((dir != NULL) ? dir : ".", (uint)atoi(every));
+    }
+}
+
+void EndDisplayBackend(void)
+{
+    s_frameProc = NULL;
+    s_frameArg  = NULL;
+    s_dumpEvery = 0;
+}
+
+void PresentDisplay(void)
+{
+    RRect dirty[MAXDIRTY];
+    char  fileName[PATH_MAX + 32];
+
+    // The framebuffer is the display: nothing to upload.
+    TakeDirtyRects(dirty);
+    s_frameCount++;
+
+    if (s_frameProc != NULL) {
+        s_frameProc(GetDisplayPixels(), s_frameCount, s_frameArg);
+    }
+
+    if (s_dumpEvery != 0 && (s_frameCount % s_dumpEvery) == 0) {
+        sprintf(fileName, "%s/FRAME%06u.PPM", s_dumpDir, s_frameCount);
+        if (!WriteFramePPM(fileName)) {
+            LogWarning("Can't write %s, no longer dumping frames", fileName);
+            s_dumpEvery = 0;
+        }
+    }
+}
+
+bool DisplayCursor(bool show)
+{
+    // There is no pointer to show.
+    return true;
+}
+
+void SetFrameProc(FrameProc proc, void *arg)
+{
+    s_frameProc = proc;
+    s_frameArg  = arg;
+}
+
+void SetFrameDump(const char *dir, uint every)
+{
+    if (dir != NULL && strlen(dir) < sizeof(s_dumpDir)) {
+        strcpy(s_dumpDir, dir);
+        s_dumpEvery = every;
+    } else {
+        s_dumpEvery = 0;
+    }
+}
+
+uint GetFrameCount(void)
+{
+    return s_frameCount;
+}
+
+bool WriteFramePPM(const char *fileName)
+{
+    const uint32_t *pixels = GetDisplayPixels();
+    uint8_t         row[MAXWIDTH * 3];
+    FILE           *file;
+    uint            x, y;
+    bool            ok;
+
+    file = fopen(fileName, "wb");
+    if (file == NULL) {
+        return false;
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", MAXWIDTH, MAXHEIGHT);
+    for (y = 0; y < MAXHEIGHT; ++y) {
+        for (x = 0; x < MAXWIDTH; ++x) {
+            row[(x * 3) + 0] = (uint8_t)pixels[x];
+            row[(x * 3) + 1] = (uint8_t)(pixels[x] >> 8);
+            row[(x * 3) + 2] = (uint8_t)(pixels[x] >> 16);
+        }
+        if (fwrite(row, sizeof(row), 1, file) != 1) {
+            break;
+        }
+        pixels += MAXWIDTH;
+    }
+
+    ok = (y == MAXHEIGHT);
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    return ok;
+}
@@ -1,5 +1,7 @@
 #include "sci/Kernel/Animate.h"
+#include "sci/Kernel/CastGrid.h"
 #include "sci/Kernel/Cels.h"
+#include "sci/Kernel/Compose.h"
 #include "sci/Kernel/Dialog.h"
 #include "sci/Kernel/Globals.h"
 #include "sci/Kernel/Graphics.h"
@@ -8,13 +10,14 @@
 #include "sci/Kernel/Selector.h"
 #include "sci/PMachine/Object.h"
 #include "sci/PMachine/PMachine.h"
+#include "sci/Utils/ErrMsg.h"
+#include "sci/Utils/Sort.h"
 
 #define PLENTYROOM 1 // only applies to this module
 #define SORTONZTOO   // only applies to this module
 #define NOSAVEBITS -1
 
 typedef struct AniObj {
-    Node      link;
     uint      v;
     uint      l;
     uint      c;
@@ -24,18 +27,76 @@ typedef struct AniObj {
     RRect     r;
 } AniObj;
 
-#define LIST_INVALID_NODE ((Node *)-1)
-
-#define IsListInitialized(list) ((list)->head != LIST_INVALID_NODE)
-#define UnInitList(list)        FirstNode(list) = LIST_INVALID_NODE
-
-static List s_lastCast = { LIST_INVALID_NODE };
+// An actor of the cast being drawn.
+typedef struct CastEntry {
+    Obj      *id;
+    View     *view;
+    int       y;
+    uintptr_t z;
+    bool      show;
+} CastEntry;
+
+// The view last drawn for an actor.
+typedef struct ActorView {
+    Obj  *actor;
+    uint  viewNum;
+    View *view;
+} ActorView;
+
+// Number of actors whose views are kept, 1 << ACTORBITS, in sets of
+// ACTORWAYS slots.
+#define ACTORBITS  8
+#define ACTORVIEWS (1 << ACTORBITS)
+#define ACTORWAYS  4
+
+// First slot of the set of an actor. Objects of a class are laid out at a
+// fixed stride, so the whole address is mixed before it picks a set.
+#define ActorSet(actor)                                                        \
+    ((uint)(((uint64_t)(uintptr_t)(actor) * 0x9e3779b97f4a7c15ull) >>         \
+            (64 - ACTORBITS)) &                                                \
+     ~(uint)(ACTORWAYS - 1))
+
+// The records of the actors drawn by the last Animate, for ReAnimate. The
+// array is kept from one frame to the next, and grown as the cast does.
+static AniObj *s_lastCast      = NULL;
+static uint    s_lastCastSize  = 0;
+static uint    s_lastCastMax   = 0;
+static bool    s_lastCastValid = false;
+
+static ActorView    s_actorViews[ACTORVIEWS];
+static uint         s_nextWay = 0; // slot replaced in a full set
+static AnimateStats s_aniStats;
+
+// The cast array is kept from one frame to the next, and grown as the cast
+// does. It is followed by the scratch space of the sort.
+static CastEntry *s_castArray = NULL;
+static uint       s_castMax   = 0;
+static bool       s_castInUse = false;
+
+// Return an array for a cast of 'size' actors.
+static CastEntry *GetCastArray(uint size);
+
+// Add a record to the last cast.
+static AniObj *AddLastCast(void);
+
+// Return the view of an actor, looking it up on the load list only if it is
+// not the one last drawn for the actor.
+static View *GetActorView(Obj *him);
+
+// Queue an actor to be drawn by the compose threads.
+static void DrawBands(Obj *him, View *view, const RRect *rns);
+
+// Release an array returned by GetCastArray.
+static void ReleaseCastArray(CastEntry *cast);
 
 // Sort cast array by y property.
-static void SortCast(Obj *cast[], int casty[], uint size);
+static void SortCast(CastEntry cast[], uint size);
+
+// Order of two actors in the sorted cast.
+static int CompareCast(const void *a, const void *b);
 
 // Redo all "stopped" actors.
-static void ReDoStopped(Obj *cast[], bool castShow[], uint size);
+static void ReDoStopped(CastEntry cast[], uint size);
 
 void Animate(List *cast, bool doit)
 {
@@ -48,9 +109,9 @@ void Animate(List *cast, bool doit)
     uint       i, castSize;
     uint       signal, loopNum, celNum;
     uint       showAll = g_picNotValid;
-    Obj       *castID[200];
-    int        castY[200];
-    bool       castShow[200];
+    uint       handles;
+    bool       bands = GetComposeThreads() > 1;
+    CastEntry *castArray;
 
     if (cast == NULL) {
         // No castList -- just show picture (if necessary).
@@ -62,6 +123,9 @@ void Animate(List *cast, bool doit)
         return;
     }
 
+    // The actors look for each other in a grid of the cast built afresh.
+    ForgetCastGrid();
+
     // Invoke doit: method for each member of the cast unless they are
     // identified as a static view.
     if (doit) {
@@ -83,31 +147,41 @@ void Animate(List *cast, bool doit)
 
     // Dispose the old castList (if any) and get a new one.
     DisposeLastCast();
-    InitList(&s_lastCast);
+    s_lastCastValid = true;
+
+    ++s_aniStats.frames;
+    handles = GetResHandleCount();
 
     //
     // The screen is clean except for stopped actors.
     // Validate LOOP/CEL and update nowSeen for ALL actors in the cast.
-    // Set castID array for all subsequent access to the cast.
+    // Set castArray for all subsequent access to the cast.
     //
+    castSize = 0;
+    for (it = FirstNode(cast); it != NULL; it = NextNode(it)) {
+        ++castSize;
+    }
+    castArray = GetCastArray(castSize);
+
     castSize = 0;
     for (it = FirstNode(cast); it != NULL; it = NextNode(it)) {
         him = (Obj *)GetKey(it);
 
-        // Save their object IDs in castID array.
-        castID[castSize] = him;
+        // Save their object IDs, and y and z positions.
+        castArray[castSize].id = him;
+        castArray[castSize].y  = IndexedProp(him, actY);
+        castArray[castSize].z  = IndexedProp(him, actZ);
 
-        // Save their y positions in castY array.
-        castY[castSize] = IndexedProp(him, actY);
+        // This handle will be valid for a while.
+        view                     = GetActorView(him);
+        castArray[castSize].view = view;
 
         // Zero out every show (no matter what sort does).
-        castShow[castSize] = 0;
+        castArray[castSize].show = false;
 
         ++castSize;
 
         signal = (uint)IndexedProp(him, actSignal);
-        // This handle will be valid for a while.
-        view = (View *)ResLoad(RES_VIEW, IndexedProp(him, actView));
 
         // Check valid loop and cel.
         loopNum = (uint)IndexedProp(him, actLoop);
@@ -160,39 +234,41 @@ void Animate(List *cast, bool doit)
     }
 
     // Sort the actor list by y coord.
-    SortCast(castID, castY, castSize);
+    SortCast(castArray, castSize);
 
     // If showAll is true we must save a "clean" underbits of all stopped
     // actors. Any newly stopped actors are treated equally.
     if (showAll != 0) {
-        ReDoStopped(castID, castShow, castSize);
+        ReDoStopped(castArray, castSize);
     }
 
     // Draw nonSTOPPED nonHIDDEN cast from front to back of sorted list
     // (forward).
     for (i = 0; i < castSize; ++i) {
-        him    = castID[i];
+        him    = castArray[i].id;
+        view   = castArray[i].view;
         signal = (uint)IndexedProp(him, actSignal);
 
-        // This handle will be valid for a while.
-        view = (View *)ResLoad(RES_VIEW, IndexedProp(him, actView));
-
         // All stopped actors have already been drawn.
         // A HIDE actor is not drawn.
         // A VIEWADDED is not drawn.
         if ((signal & (VIEWADDED | NOUPDATE | HIDE)) == 0) {
             RectFromNative(IndexedPropAddr(him, actNS), &rns);
-            IndexedProp(him, actUB) =
-              (uintptr_t)SaveBits(&rns, PMAP | VMAP | CMAP);
-
-            DrawCel(view,
-                    (uint)IndexedProp(him, actLoop),
-                    (uint)IndexedProp(him, actCel),
-                    &rns,
-                    (uint)IndexedProp(him, actPri),
-                    (RPalette *)GetProperty(him, s_palette));
+            if (bands) {
+                DrawBands(him, view, &rns);
+            } else {
+                IndexedProp(him, actUB) =
+                  (uintptr_t)SaveFrameBits(&rns, PMAP | VMAP | CMAP);
+
+                DrawCel(view,
+                        (uint)IndexedProp(him, actLoop),
+                        (uint)IndexedProp(him, actCel),
+                        &rns,
+                        (uint)IndexedProp(him, actPri),
+                        (RPalette *)GetProperty(him, s_palette));
+            }
 
-            castShow[i] = true;
+            castArray[i].show = true;
 
             // This actor was drawn so we must unHIDE him.
             if ((signal & HIDDEN) != 0 && (signal & HIDE) == 0) {
@@ -202,17 +278,18 @@ void Animate(List *cast, bool doit)
             }
 
             // Add an entry to ReAnimate list.
-            dup      = (AniObj *)malloc(sizeof(AniObj));
+            dup      = AddLastCast();
             dup->v   = (uint)IndexedProp(him, actView);
             dup->l   = (uint)IndexedProp(him, actLoop);
             dup->c   = (uint)IndexedProp(him, actCel);
             dup->p   = (uint)IndexedProp(him, actPri);
             dup->pal = (RPalette *)GetProperty(him, s_palette);
             RCopyRect(&rns, &dup->r);
-            AddToEnd(&s_lastCast, ToNode(dup));
         }
     }
 
+    FlushCompose();
+
     // Do we show the screen here.
     if (g_picNotValid != 0) {
         ShowPic(g_showMap, g_showPicStyle);
@@ -221,12 +298,12 @@ void Animate(List *cast, bool doit)
 
     // Now once more through the list to show the bits we have drawn.
     for (i = 0; i < castSize; ++i) {
-        him    = castID[i];
+        him    = castArray[i].id;
         signal = (uint)IndexedProp(him, actSignal);
 
         // "stopped" actors don't need showing, unless a newStop has been done.
         // Hidden actors don't need it either.
-        if ((castShow[i]) || ((signal & HIDDEN) == 0 &&
+        if ((castArray[i].show) || ((signal & HIDDEN) == 0 &&
                               ((signal & NOUPDATE) == 0 || showAll != 0))) {
             RectFromNative(IndexedPropAddr(him, actLS), &rls);
             RectFromNative(IndexedPropAddr(him, actNS), &rns);
@@ -256,12 +333,15 @@ void Animate(List *cast, bool doit)
         IndexedProp(him, actSignal) = signal;
     }
 
+    // Present the whole cycle at once.
+    FlushBits();
+
     //
     // Now after all our hard work we are going to erase the entire list,
     // except for NOUPDATE actors.
     //
     for (i = castSize - 1; (int)i >= 0; --i) {
-        him = castID[i];
+        him = castArray[i].id;
 
         //
         // Erase him from background.
@@ -279,6 +359,9 @@ void Animate(List *cast, bool doit)
         }
     }
 
+    ReleaseCastArray(castArray);
+    s_aniStats.allocs += GetResHandleCount() - handles;
+
     // Restore current port.
     RSetPort(oldPort);
 }
@@ -289,7 +372,7 @@ void ReAnimate(const RRect *badRect)
     AniObj    *dupPtr;
     View      *view;
     RRect      bRect;
-    Node      *dup;
+    uint       i;
 
     // Bad rect may be in Local Coords of another window (port),
     // we must make them local to this port.
@@ -303,13 +386,13 @@ void ReAnimate(const RRect *badRect)
     RGlobalToLocal((RPoint *)&(bRect.bottom));
 
     // This is valid only if we have a s_lastCast.
-    if (IsListInitialized(&s_lastCast)) {
-        for (dup = FirstNode(&s_lastCast); dup != NULL; dup = NextNode(dup)) {
-            dupPtr = FromNode(dup, AniObj);
+    if (s_lastCastValid) {
+        for (i = 0; i < s_lastCastSize; ++i) {
+            dupPtr = &s_lastCast[i];
 
             view = (View *)ResLoad(RES_VIEW, dupPtr->v);
 
-            dupPtr->u = SaveBits(&dupPtr->r, VMAP | PMAP);
+            dupPtr->u = SaveFrameBits(&dupPtr->r, VMAP | PMAP);
             DrawCel(
               view, dupPtr->l, dupPtr->c, &dupPtr->r, dupPtr->p, dupPtr->pal);
         }
@@ -318,8 +401,8 @@ void ReAnimate(const RRect *badRect)
         ShowBits(&bRect, g_showMap);
 
         // Now erase them again.
-        for (dup = LastNode(&s_lastCast); dup != NULL; dup = PrevNode(dup)) {
-            dupPtr = FromNode(dup, AniObj);
+        for (i = s_lastCastSize; i != 0; --i) {
+            dupPtr = &s_lastCast[i - 1];
             RestoreBits(dupPtr->u);
         }
     } else {
@@ -339,8 +422,7 @@ void AddToPic(List *cast)
     View      *view;
     uint       i, castSize, signal, priority;
     int16_t    top;
-    Obj       *castID[200];
-    int        castY[200];
+    CastEntry *castArray;
 
     if (cast == NULL) {
         return;
@@ -349,25 +431,30 @@ void AddToPic(List *cast)
     RGetPort(&oldPort);
     RSetPort(&g_picWind->port);
 
-    // Set castID array for all subsequent access to the cast.
+    // Set castArray for all subsequent access to the cast.
     castSize = 0;
     for (it = FirstNode(cast); it != NULL; it = NextNode(it)) {
-        him = (Obj *)GetKey(it);
+        ++castSize;
+    }
+    castArray = GetCastArray(castSize);
 
-        // Save their object IDs in castID array.
-        castID[castSize] = him;
+    castSize = 0;
+    for (it = FirstNode(cast); it != NULL; it = NextNode(it)) {
+        him = (Obj *)GetKey(it);
 
-        // Save their y positions in castY array.
-        castY[castSize] = (int)GetProperty(him, s_y);
+        // Save their object IDs, and y and z positions.
+        castArray[castSize].id = him;
+        castArray[castSize].y  = (int)GetProperty(him, s_y);
+        castArray[castSize].z  = GetProperty(him, s_z);
         ++castSize;
     }
 
     // Sort the actor list by y coord.
-    SortCast(castID, castY, castSize);
+    SortCast(castArray, castSize);
 
     // Now draw the objects from back to front.
     for (i = 0; i < castSize; ++i) {
-        him = castID[i];
+        him = castArray[i].id;
 
         signal = (uint)GetProperty(him, s_signal);
 
@@ -383,7 +470,7 @@ void AddToPic(List *cast)
 
         // Get a priority.
         if (INVALIDPRI == (priority = GetProperty(him, s_priority))) {
-            priority = CoordPri(castY[i]);
+            priority = CoordPri(castArray[i].y);
         }
 
         DrawCel(view,
@@ -411,61 +498,165 @@ void AddToPic(List *cast)
             RFillRect(&r, CMAP, 0, 0, 15);
         }
     }
+
+    ReleaseCastArray(castArray);
 }
 
 void DisposeLastCast(void)
 {
-    Node *dup;
+    s_lastCastSize  = 0;
+    s_lastCastValid = false;
+}
 
-    if (!IsListInitialized(&s_lastCast)) {
-        return;
-    }
+void DropActorViews(Handle view)
+{
+    uint i;
 
-    while ((dup = FirstNode(&s_lastCast)) != NULL) {
-        DeleteNode(&s_lastCast, dup);
-        free(FromNode(dup, AniObj));
+    for (i = 0; i < ACTORVIEWS; ++i) {
+        if ((Handle)s_actorViews[i].view == view) {
+            s_actorViews[i].actor = NULL;
+            s_actorViews[i].view  = NULL;
+        }
     }
+}
 
-    UnInitList(&s_lastCast);
+void GetAnimateStats(AnimateStats *stats)
+{
+    *stats = s_aniStats;
 }
 
-static void SortCast(Obj *cast[], int casty[], uint size)
+static CastEntry *GetCastArray(uint size)
 {
-    bool swapped = true;
-    int  i, j;
-    Obj *tmp;
-    int  tmpint;
-
-    for (j = ((int)size - 1); j > 0; --j) {
-        swapped = false;
-        for (i = 0; i < j; ++i) {
-            // Base it on y position.
-            if ((casty[i + 1] < casty[i]) ||
-#ifdef SORTONZTOO
-                (casty[i + 1] == casty[i] &&
-                 GetProperty(cast[i + 1], s_z) < GetProperty(cast[i], s_z))
-#endif
-            ) {
-                tmp         = cast[i];
-                cast[i]     = cast[i + 1];
-                cast[i + 1] = tmp;
+    CastEntry *cast;
+    uint       entries = size + size / 2 + 1; // with the scratch space
+
+    // An actor's delete method may animate another cast while this one is
+    // still being drawn.
+    if (s_castInUse) {
+        cast = (CastEntry *)malloc(entries * sizeof(CastEntry));
+        if (cast == NULL) {
+            Panic(E_NO_MEMORY);
+        }
+        ++s_aniStats.allocs;
+        return cast;
+    }
 
-                // Exchange y positions also.
-                tmpint       = casty[i];
-                casty[i]     = casty[i + 1];
-                casty[i + 1] = tmpint;
+    if (entries > s_castMax) {
+        s_castMax   = max(entries, 2 * s_castMax);
+        s_castArray = (CastEntry *)realloc(s_castArray,
+                                           s_castMax * sizeof(CastEntry));
+        if (s_castArray == NULL) {
+            Panic(E_NO_MEMORY);
+        }
+        ++s_aniStats.allocs;
+    }
 
-                swapped = true;
-            }
+    s_castInUse = true;
+    return s_castArray;
+}
+
+static void ReleaseCastArray(CastEntry *cast)
+{
+    if (cast == s_castArray) {
+        s_castInUse = false;
+    } else {
+        free(cast);
+    }
+}
+
+static AniObj *AddLastCast(void)
+{
+    if (s_lastCastSize == s_lastCastMax) {
+        s_lastCastMax = s_lastCastMax != 0 ? 2 * s_lastCastMax : 32;
+        s_lastCast =
+          (AniObj *)realloc(s_lastCast, s_lastCastMax * sizeof(AniObj));
+        if (s_lastCast == NULL) {
+            Panic(E_NO_MEMORY);
         }
+        ++s_aniStats.allocs;
+    }
+    return &s_lastCast[s_lastCastSize++];
+}
 
-        if (!swapped) {
+static View *GetActorView(Obj *him)
+{
+    ActorView *set     = &s_actorViews[ActorSet(him)];
+    ActorView *entry   = NULL;
+    uint       viewNum = (uint)IndexedProp(him, actView);
+    uint       i;
+
+    for (i = 0; i < ACTORWAYS; ++i) {
+        if (set[i].actor == him) {
+            entry = &set[i];
             break;
         }
+        if (set[i].actor == NULL && entry == NULL) {
+            entry = &set[i];
+        }
+    }
+    if (entry == NULL) {
+        entry = &set[s_nextWay++ & (ACTORWAYS - 1)];
+    }
+
+    if (entry->actor != him || entry->viewNum != viewNum ||
+        entry->view == NULL) {
+        entry->actor   = him;
+        entry->viewNum = viewNum;
+        entry->view    = (View *)ResLoad(RES_VIEW, viewNum);
+        ++s_aniStats.viewLoads;
     }
+    return entry->view;
+}
+
+static void DrawBands(Obj *him, View *view, const RRect *rns)
+{
+    CelDraw draw;
+    Handle  underBits;
+
+    underBits               = ReserveFrameBits(rns, PMAP | VMAP | CMAP);
+    IndexedProp(him, actUB) = (uintptr_t)underBits;
+
+    if (PrepareCel(view,
+                   (uint)IndexedProp(him, actLoop),
+                   (uint)IndexedProp(him, actCel),
+                   rns,
+                   (uint)IndexedProp(him, actPri),
+                   &draw)) {
+        ComposeCel(underBits, &draw);
+        return;
+    }
+
+    // A cel drawn from its data is drawn over the actors queued before it.
+    FlushCompose();
+    SaveBitsRows(underBits, 0, MAXHEIGHT);
+    DrawPreparedCel(&draw);
+}
+
+// Actors keep their order in the cast when they compare equal, as they did
+// when this was a bubble sort.
+static void SortCast(CastEntry cast[], uint size)
+{
+    StableSort(cast, size, sizeof(CastEntry), CompareCast, cast + size);
+}
+
+static int CompareCast(const void *a, const void *b)
+{
+    const CastEntry *castA = (const CastEntry *)a;
+    const CastEntry *castB = (const CastEntry *)b;
+
+    // Base it on y position.
+    if (castA->y != castB->y) {
+        return castA->y < castB->y ? -1 : 1;
+    }
+#ifdef SORTONZTOO
+    if (castA->z != castB->z) {
+        return castA->z < castB->z ? -1 : 1;
+    }
+#endif
+    return 0;
 }
 
-static void ReDoStopped(Obj *cast[], bool castShow[], uint size)
+static void ReDoStopped(CastEntry cast[], uint size)
 {
     Obj    *him;
     Handle  underBits;
@@ -479,7 +670,7 @@ static void ReDoStopped(Obj *cast[], bool castShow[], uint size)
 
     // To ReDo stopped actors, we must TOSS all backgrounds in reverse.
     for (i = size - 1; (int)i >= 0; --i) {
-        him    = cast[i];
+        him    = cast[i].id;
         signal = (uint)IndexedProp(him, actSignal);
         if ((signal & NOUPDATE) != 0) {
             if ((signal & HIDDEN) == 0) {
@@ -491,7 +682,7 @@ static void ReDoStopped(Obj *cast[], bool castShow[], uint size)
                     }
                 } else {
                     RestoreBits(underBits);
-                    castShow[i] = true;
+                    cast[i].show = true;
                 }
 
                 IndexedProp(him, actUB) = 0;
@@ -520,10 +711,10 @@ static void ReDoStopped(Obj *cast[], bool castShow[], uint size)
     // The screen is absolutely clean at this point.
     // Draw in ANY actors with a view added property and condition signal.
     for (i = 0; i < size; ++i) {
-        him    = cast[i];
+        him    = cast[i].id;
         signal = (uint)IndexedProp(him, actSignal);
         if ((signal & VIEWADDED) != 0) {
-            view = (View *)ResLoad(RES_VIEW, IndexedProp(him, actView));
+            view = cast[i].view;
             RectFromNative(IndexedPropAddr(him, actNS), &r);
             DrawCel(view,
                     (uint)IndexedProp(him, actLoop),
@@ -532,7 +723,7 @@ static void ReDoStopped(Obj *cast[], bool castShow[], uint size)
                     (uint)IndexedProp(him, actPri),
                     (RPalette *)GetProperty(him, s_palette));
 
-            castShow[i] = true;
+            cast[i].show = true;
 
             signal &= (~(NOUPDATE | STOPUPD | STARTUPD | FORCEUPD));
 
@@ -560,7 +751,7 @@ static void ReDoStopped(Obj *cast[], bool castShow[], uint size)
 
     // Now save a clean copy of underbits for NOUPDATE / nonHIDDEN actors.
     for (i = 0; i < size; ++i) {
-        him    = cast[i];
+        him    = cast[i].id;
         signal = (uint)IndexedProp(him, actSignal);
         if ((signal & NOUPDATE) != 0) {
             // Make HIDE/SHOW decision first.
@@ -590,10 +781,10 @@ static void ReDoStopped(Obj *cast[], bool castShow[], uint size)
 
     // Now redraw them at nowSeen from head to tail of list.
     for (i = 0; i < size; i++) {
-        him    = cast[i];
+        him    = cast[i].id;
         signal = (uint)IndexedProp(him, actSignal);
         if ((signal & NOUPDATE) != 0 && (signal & HIDE) == 0) {
-            view = (View *)ResLoad(RES_VIEW, IndexedProp(him, actView));
+            view = cast[i].view;
 
             //
             // Get nowSeen into local and draw it.
@@ -607,7 +798,7 @@ static void ReDoStopped(Obj *cast[], bool castShow[], uint size)
                     (uint)IndexedProp(him, actPri),
                     (RPalette *)GetProperty(him, s_palette));
 
-            castShow[i] = true;
+            cast[i].show = true;
 
             // If ignrAct bit is not set we draw a control box.
             if ((signal & ignrAct) == 0) {
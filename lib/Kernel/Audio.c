@@ -1,5 +1,6 @@
 #include "sci/Kernel/Audio.h"
 #include "sci/Kernel/ResName.h"
+#include "sci/Kernel/ResSource.h"
 #include "sci/Kernel/Resource.h"
 #include "sci/Driver/Audio/LPcmDriver.h"
 #include "sci/Logger/Log.h"
@@ -0,0 +1,1094 @@
+#include "sci/Kernel/Avoid.h"
+#include "sci/Driver/Display/Convert.h"
+#include "sci/Kernel/Kernel.h"
+#include "sci/Kernel/Selector.h"
+#include "sci/Utils/ErrMsg.h"
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) ||            \
+  defined(_M_IX86)
+#define AVOID_X86
+#include <immintrin.h>
+#endif
+
+// Let the compiler emit the instructions of a level in one function only.
+#if defined(__GNUC__)
+#define TARGET(isa) __attribute__((target(isa)))
+#else
+#define TARGET(isa)
+#endif
+
+#define NAVCACHE 4 // sets of polygons whose graphs are kept
+
+// Where a point is for a polygon.
+#define OUTSIDE 0
+#define ONEDGE  1
+#define INSIDE  2
+
+// The edges of the polygons, one per lane. The coordinates are integers, so
+// the products of the segment tests are exact in doubles.
+typedef struct EdgeSet {
+    double *x1, *y1, *x2, *y2;
+    uint    count;
+} EdgeSet;
+
+typedef struct Poly {
+    uint first; // first of its points
+    uint count;
+    uint type;
+    uint firstEdge;
+    uint numEdges;
+    int  left, top, right, bottom; // bounds of its points
+} Poly;
+
+// A set of polygons and the graph of their corners.
+typedef struct Nav {
+    uint32_t hash;
+    int32_t *key; // the polygons, as read from their objects
+    uint     keySize;
+    uint     lastUse;
+
+    Poly *polys;
+    uint  numPolys;
+
+    // The points of the polygons, and the points before and after each one.
+    int  *px, *py;
+    uint *prev, *next;
+    uint  numPoints;
+
+    EdgeSet edges;
+
+    // The corners where a path may bend, and those each one sees.
+    uint   *nodePoint;
+    uint    numNodes;
+    uint   *adjStart;
+    uint   *adjNode;
+    double *adjLen;
+} Nav;
+
+typedef struct HeapItem {
+    double cost;
+    uint   node;
+} HeapItem;
+
+typedef uint (*CrossEdgesProc)(const EdgeSet *edges,
+                               uint           first,
+                               uint           last,
+                               const double  *seg,
+                               uint          *touched);
+
+static uint CrossEdgesScalar(const EdgeSet *edges,
+                             uint           first,
+                             uint           last,
+                             const double  *seg,
+                             uint          *touched);
+#if defined(AVOID_X86)
+static uint CrossEdgesSSE2(const EdgeSet *edges,
+                           uint           first,
+                           uint           last,
+                           const double  *seg,
+                           uint          *touched);
+static uint CrossEdgesAVX2(const EdgeSet *edges,
+                           uint           first,
+                           uint           last,
+                           const double  *seg,
+                           uint          *touched);
+#endif
+
+static const CrossEdgesProc s_crossEdges[NISALEVELS] = {
+    CrossEdgesScalar,
+#if defined(AVOID_X86)
+    CrossEdgesSSE2,
+    CrossEdgesAVX2,
+#else
+    NULL,
+    NULL,
+#endif
+};
+
+// Bits set in each mask of four lanes.
+static const uint8_t s_bitCount[16] = {
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+};
+
+static uint s_isa = NISALEVELS; // not chosen yet
+
+static Nav *s_navs[NAVCACHE];
+static uint s_clock = 0;
+
+static int32_t *s_polyKey    = NULL;
+static uint     s_maxPolyKey = 0;
+
+// The state of a search, for the corners and the goal.
+static double   *s_cost     = NULL;
+static int      *s_from     = NULL;
+static bool     *s_closed   = NULL;
+static uint      s_maxNodes = 0;
+static HeapItem *s_heap    = NULL;
+static uint      s_numHeap = 0;
+static uint      s_maxHeap = 0;
+
+static AvoidStats s_stats;
+
+static Nav  *GetNav(List *polygons);
+static uint  ReadPolygons(List *polygons);
+static void  KeyRoom(uint size);
+static Nav  *BuildNav(void);
+static void  JoinCorners(Nav *nav);
+static void  FreeNav(Nav *nav);
+static void *Alloc(size_t size);
+static int   WhereIn(const int *px,
+                     const int *py,
+                     uint       count,
+                     int64_t    x,
+                     int64_t    y);
+static int   Blocker(const Nav *nav, int64_t x, int64_t y, bool *onEdge);
+static bool  FreePoint(const Nav *nav, int *x, int *y, uint *type);
+static void  NearestOn(const Nav *nav, uint index, int *x, int *y);
+static bool  Bends(const Nav *nav, uint point, int x, int y);
+static bool  Clear(const Nav *nav, int ax, int ay, int bx, int by, bool edged);
+static uint  CrossEdges(const Nav *nav,
+                        int        ax,
+                        int        ay,
+                        int        bx,
+                        int        by,
+                        bool       any,
+                        uint      *touched);
+static int   Search(const Nav *nav,
+                    int        sx,
+                    int        sy,
+                    bool       sEdged,
+                    int        gx,
+                    int        gy,
+                    bool       gEdged);
+static void  Relax(uint node, int from, double cost, double estimate);
+static uint  PopNode(void);
+
+#define Orient(ax, ay, bx, by, cx, cy)                                         \
+    ((int64_t)((bx) - (ax)) * ((cy) - (ay)) -                                  \
+     (int64_t)((by) - (ay)) * ((cx) - (ax)))
+
+#define Dist(ax, ay, bx, by)                                                   \
+    sqrt((double)((int64_t)((bx) - (ax)) * ((bx) - (ax)) +                     \
+                  (int64_t)((by) - (ay)) * ((by) - (ay))))
+
+bool SetAvoidIsa(uint isa)
+{
+    if (isa > GetBestIsa() || s_crossEdges[isa] == NULL) {
+        return false;
+    }
+
+    s_isa = isa;
+    return true;
+}
+
+uint GetAvoidIsa(void)
+{
+    uint isa;
+
+    if (s_isa == NISALEVELS) {
+        // Use the best level there are kernels for.
+        for (isa = GetBestIsa(); s_crossEdges[isa] == NULL; --isa) {
+        }
+        s_isa = isa;
+    }
+    return s_isa;
+}
+
+uintptr_t *AvoidPath(int x1, int y1, int x2, int y2, List *polygons)
+{
+    Nav       *nav;
+    uintptr_t *path;
+    uint       startType, goalType, count, corners, i, j;
+    int        sx = x1, sy = y1, gx = x2, gy = y2;
+    int        route, node;
+    bool       sEdged, gEdged;
+
+    ++s_stats.queries;
+    nav = GetNav(polygons);
+
+    // Room for the start, the corners, the goal and the end.
+    path = (uintptr_t *)Alloc((nav->numNodes + 6) * 2 * sizeof(uintptr_t));
+    path[0] = (uintptr_t)x1;
+    path[1] = (uintptr_t)y1;
+    count   = 1;
+
+    // From a start or to a goal where the actor can't be, the path goes by
+    // the nearest point of the polygon in the way.
+    if (FreePoint(nav, &sx, &sy, &startType) &&
+        FreePoint(nav, &gx, &gy, &goalType)) {
+        Blocker(nav, 2 * (int64_t)sx, 2 * (int64_t)sy, &sEdged);
+        Blocker(nav, 2 * (int64_t)gx, 2 * (int64_t)gy, &gEdged);
+
+        if ((sx == gx && sy == gy) ||
+            Clear(nav, sx, sy, gx, gy, sEdged && gEdged)) {
+            route = -1;
+        } else {
+            route = Search(nav, sx, sy, sEdged, gx, gy, gEdged);
+        }
+
+        path[2 * count]     = (uintptr_t)sx;
+        path[2 * count + 1] = (uintptr_t)sy;
+        ++count;
+
+        if (route != -2) {
+            // The corners, which the search leads to from the goal back.
+            corners = 0;
+            for (node = route; node >= 0; node = s_from[node]) {
+                ++corners;
+            }
+            i = count + corners;
+            for (node = route; node >= 0; node = s_from[node]) {
+                --i;
+                path[2 * i]     = (uintptr_t)nav->px[nav->nodePoint[node]];
+                path[2 * i + 1] = (uintptr_t)nav->py[nav->nodePoint[node]];
+            }
+            count += corners;
+
+            path[2 * count]     = (uintptr_t)gx;
+            path[2 * count + 1] = (uintptr_t)gy;
+            ++count;
+            if (goalType == PTotalAccess) {
+                path[2 * count]     = (uintptr_t)x2;
+                path[2 * count + 1] = (uintptr_t)y2;
+                ++count;
+            }
+        }
+    }
+
+    // Leave out the points repeated.
+    for (i = j = 1; i < count; ++i) {
+        if (path[2 * i] != path[2 * j - 2] ||
+            path[2 * i + 1] != path[2 * j - 1]) {
+            path[2 * j]     = path[2 * i];
+            path[2 * j + 1] = path[2 * i + 1];
+            ++j;
+        }
+    }
+
+    path[2 * j]     = PATHEND;
+    path[2 * j + 1] = PATHEND;
+    return path;
+}
+
+bool InPolygon(int x, int y, Obj *polygon)
+{
+    const uintptr_t *points = (const uintptr_t *)GetProperty(polygon, s_points);
+    uint             count  = (uint)GetProperty(polygon, s_size);
+    int             *px, *py;
+    uint             i;
+    int              where;
+
+    if (points == NULL || count == 0) {
+        return false;
+    }
+
+    px = (int *)Alloc(2 * count * sizeof(int));
+    py = px + count;
+    for (i = 0; i < count; ++i) {
+        px[i] = (int16_t)points[2 * i];
+        py[i] = (int16_t)points[2 * i + 1];
+    }
+    where = WhereIn(px, py, count, 2 * (int64_t)x, 2 * (int64_t)y);
+    free(px);
+
+    return where != OUTSIDE;
+}
+
+uint Intersections(int x1, int y1, int x2, int y2, List *polygons)
+{
+    uint touched;
+
+    return CrossEdges(GetNav(polygons), x1, y1, x2, y2, false, &touched);
+}
+
+void ForgetPolygons(void)
+{
+    uint i;
+
+    for (i = 0; i < NAVCACHE; ++i) {
+        if (s_navs[i] != NULL) {
+            FreeNav(s_navs[i]);
+            s_navs[i] = NULL;
+        }
+    }
+}
+
+void GetAvoidStats(AvoidStats *stats)
+{
+    *stats = s_stats;
+}
+
+// Return the graph of the polygons of a list, from the cache if the polygons
+// are the same as those of a graph built before.
+static Nav *GetNav(List *polygons)
+{
+    Nav     *nav;
+    uint     size, i, oldest;
+    uint32_t hash;
+
+    size = ReadPolygons(polygons);
+    hash = 2166136261u;
+    for (i = 0; i < size; ++i) {
+        hash = (hash ^ (uint32_t)s_polyKey[i]) * 16777619u;
+    }
+
+    oldest = 0;
+    for (i = 0; i < NAVCACHE; ++i) {
+        nav = s_navs[i];
+        if (nav == NULL) {
+            oldest = i;
+            break;
+        }
+        if (nav->hash == hash && nav->keySize == size &&
+            memcmp(nav->key, s_polyKey, size * sizeof(int32_t)) == 0) {
+            nav->lastUse = ++s_clock;
+            return nav;
+        }
+        if (nav->lastUse < s_navs[oldest]->lastUse) {
+            oldest = i;
+        }
+    }
+
+    if (s_navs[oldest] != NULL) {
+        FreeNav(s_navs[oldest]);
+    }
+    nav          = BuildNav();
+    nav->hash    = hash;
+    nav->lastUse = ++s_clock;
+    s_navs[oldest] = nav;
+    return nav;
+}
+
+// Read the polygons of a list into s_polyKey: their number, then the type and
+// number of points of each, and its points. Return the words read.
+static uint ReadPolygons(List *polygons)
+{
+    Node            *node;
+    Obj             *polygon;
+    const uintptr_t *points;
+    uint             size, count, i;
+
+    KeyRoom(1);
+    s_polyKey[0] = 0;
+    size     = 1;
+    if (polygons == NULL) {
+        return size;
+    }
+
+    for (node = FirstNode(polygons); node != NULL; node = NextNode(node)) {
+        polygon = (Obj *)((KNode *)node)->nVal;
+        points  = (const uintptr_t *)GetProperty(polygon, s_points);
+        count   = points != NULL ? (uint)GetProperty(polygon, s_size) : 0;
+
+        KeyRoom(size + 2 + 2 * count);
+        s_polyKey[size++] = (int32_t)GetProperty(polygon, s_type);
+        s_polyKey[size++] = (int32_t)count;
+        for (i = 0; i < 2 * count; ++i) {
+            s_polyKey[size++] = (int16_t)points[i];
+        }
+        ++s_polyKey[0];
+    }
+    return size;
+}
+
+static void KeyRoom(uint size)
+{
+    if (size > s_maxPolyKey) {
+        s_maxPolyKey = max(max(size, 2 * s_maxPolyKey), 64);
+        s_polyKey =
+          (int32_t *)realloc(s_polyKey, s_maxPolyKey * sizeof(int32_t));
+        if (s_polyKey == NULL) {
+            Panic(E_NO_MEMORY);
+        }
+    }
+}
+
+// Make the graph of the polygons in s_polyKey.
+static Nav *BuildNav(void)
+{
+    Nav           *nav;
+    Poly          *poly;
+    const int32_t *key;
+    uint           size, numPolys, numPoints, numEdges, first, count;
+    uint           i, j, k, e;
+
+    ++s_stats.builds;
+
+    // Polygons of less than two points have no edges to avoid.
+    size      = 1;
+    numPolys  = 0;
+    numPoints = 0;
+    numEdges  = 0;
+    for (i = 0; i < (uint)s_polyKey[0]; ++i) {
+        count = (uint)s_polyKey[size + 1];
+        if (count >= 2) {
+            ++numPolys;
+            numPoints += count;
+            numEdges += count == 2 ? 1 : count;
+        }
+        size += 2 + 2 * count;
+    }
+
+    nav = (Nav *)Alloc(sizeof(Nav));
+    memset(nav, 0, sizeof(Nav));
+    nav->keySize = size;
+    nav->key     = (int32_t *)Alloc(size * sizeof(int32_t));
+    memcpy(nav->key, s_polyKey, size * sizeof(int32_t));
+
+    nav->polys     = (Poly *)Alloc(max(numPolys, 1) * sizeof(Poly));
+    nav->px        = (int *)Alloc(max(numPoints, 1) * sizeof(int));
+    nav->py        = (int *)Alloc(max(numPoints, 1) * sizeof(int));
+    nav->prev      = (uint *)Alloc(max(numPoints, 1) * sizeof(uint));
+    nav->next      = (uint *)Alloc(max(numPoints, 1) * sizeof(uint));
+    nav->edges.x1  = (double *)Alloc(max(numEdges, 1) * 4 * sizeof(double));
+    nav->edges.y1  = nav->edges.x1 + numEdges;
+    nav->edges.x2  = nav->edges.y1 + numEdges;
+    nav->edges.y2  = nav->edges.x2 + numEdges;
+    nav->nodePoint = (uint *)Alloc(max(numPoints, 1) * sizeof(uint));
+
+    key = nav->key + 1;
+    for (i = 0; i < (uint)nav->key[0]; ++i, key += 2 + 2 * key[1]) {
+        count = (uint)key[1];
+        if (count < 2) {
+            continue;
+        }
+
+        first       = nav->numPoints;
+        poly        = &nav->polys[nav->numPolys++];
+        poly->first = first;
+        poly->count = count;
+        poly->type  = (uint)key[0];
+        for (j = 0; j < count; ++j) {
+            k            = first + j;
+            nav->px[k]   = key[2 + 2 * j];
+            nav->py[k]   = key[3 + 2 * j];
+            nav->prev[k] = first + (j + count - 1) % count;
+            nav->next[k] = first + (j + 1) % count;
+
+            poly->left   = j == 0 ? nav->px[k] : min(poly->left, nav->px[k]);
+            poly->right  = j == 0 ? nav->px[k] : max(poly->right, nav->px[k]);
+            poly->top    = j == 0 ? nav->py[k] : min(poly->top, nav->py[k]);
+            poly->bottom = j == 0 ? nav->py[k] : max(poly->bottom, nav->py[k]);
+        }
+        nav->numPoints += count;
+
+        // A polygon of two points is a wall, with a single edge.
+        poly->firstEdge = nav->edges.count;
+        poly->numEdges  = count == 2 ? 1 : count;
+        for (j = 0; j < poly->numEdges; ++j) {
+            k                = first + j;
+            e                = nav->edges.count++;
+            nav->edges.x1[e] = nav->px[k];
+            nav->edges.y1[e] = nav->py[k];
+            nav->edges.x2[e] = nav->px[nav->next[k]];
+            nav->edges.y2[e] = nav->py[nav->next[k]];
+        }
+    }
+
+    JoinCorners(nav);
+    return nav;
+}
+
+// Find the corners where a path may bend, and join those that see each other.
+static void JoinCorners(Nav *nav)
+{
+    const Poly *poly;
+    uint       *pairs = NULL;
+    uint        numPairs = 0, maxPairs = 0;
+    uint        p, q, u, v, i, k;
+    int64_t     area, turn;
+
+    // A path bends around the corners of a polygon that stick out into the
+    // free space: the convex corners of a polygon barring the way, the
+    // concave ones of a polygon keeping the actor in. Straight corners are
+    // kept too, as segments passing through a corner are left to the paths
+    // that bend there.
+    for (i = 0; i < nav->numPolys; ++i) {
+        poly = &nav->polys[i];
+        area = 0;
+        for (p = poly->first; p < poly->first + poly->count; ++p) {
+            area += Orient(0, 0, nav->px[p], nav->py[p], nav->px[nav->next[p]],
+                           nav->py[nav->next[p]]);
+        }
+        if (poly->type == PContainedAccess) {
+            area = -area;
+        }
+
+        for (p = poly->first; p < poly->first + poly->count; ++p) {
+            turn = Orient(nav->px[nav->prev[p]], nav->py[nav->prev[p]],
+                          nav->px[p], nav->py[p], nav->px[nav->next[p]],
+                          nav->py[nav->next[p]]);
+            if ((area > 0 && turn < 0) || (area < 0 && turn > 0)) {
+                continue;
+            }
+            if (Blocker(nav, 2 * (int64_t)nav->px[p], 2 * (int64_t)nav->py[p],
+                        NULL) >= 0) {
+                continue;
+            }
+            nav->nodePoint[nav->numNodes++] = p;
+        }
+    }
+
+    // Join the corners that see each other, each of them bending the path.
+    for (u = 0; u < nav->numNodes; ++u) {
+        p = nav->nodePoint[u];
+        for (v = u + 1; v < nav->numNodes; ++v) {
+            q = nav->nodePoint[v];
+            if (!Bends(nav, p, nav->px[q], nav->py[q]) ||
+                !Bends(nav, q, nav->px[p], nav->py[p]) ||
+                !Clear(nav, nav->px[p], nav->py[p], nav->px[q], nav->py[q],
+                       true)) {
+                continue;
+            }
+
+            if (numPairs == maxPairs) {
+                maxPairs = max(2 * maxPairs, 64);
+                pairs    = (uint *)realloc(pairs, maxPairs * 2 * sizeof(uint));
+                if (pairs == NULL) {
+                    Panic(E_NO_MEMORY);
+                }
+            }
+            pairs[2 * numPairs]     = u;
+            pairs[2 * numPairs + 1] = v;
+            ++numPairs;
+        }
+    }
+
+    // Each pair both ways, grouped by corner.
+    nav->adjStart = (uint *)Alloc((nav->numNodes + 1) * sizeof(uint));
+    nav->adjNode  = (uint *)Alloc(max(2 * numPairs, 1) * sizeof(uint));
+    nav->adjLen   = (double *)Alloc(max(2 * numPairs, 1) * sizeof(double));
+    memset(nav->adjStart, 0, (nav->numNodes + 1) * sizeof(uint));
+    for (k = 0; k < numPairs; ++k) {
+        ++nav->adjStart[pairs[2 * k] + 1];
+        ++nav->adjStart[pairs[2 * k + 1] + 1];
+    }
+    for (u = 0; u < nav->numNodes; ++u) {
+        nav->adjStart[u + 1] += nav->adjStart[u];
+    }
+    for (k = 0; k < numPairs; ++k) {
+        u = pairs[2 * k];
+        v = pairs[2 * k + 1];
+        p = nav->nodePoint[u];
+        q = nav->nodePoint[v];
+
+        i               = nav->adjStart[u]++;
+        nav->adjNode[i] = v;
+        nav->adjLen[i]  = Dist(nav->px[p], nav->py[p], nav->px[q], nav->py[q]);
+        i               = nav->adjStart[v]++;
+        nav->adjNode[i] = u;
+        nav->adjLen[i]  = nav->adjLen[nav->adjStart[u] - 1];
+    }
+    for (u = nav->numNodes; u > 0; --u) {
+        nav->adjStart[u] = nav->adjStart[u - 1];
+    }
+    nav->adjStart[0] = 0;
+
+    free(pairs);
+}
+
+static void FreeNav(Nav *nav)
+{
+    free(nav->key);
+    free(nav->polys);
+    free(nav->px);
+    free(nav->py);
+    free(nav->prev);
+    free(nav->next);
+    free(nav->edges.x1);
+    free(nav->nodePoint);
+    free(nav->adjStart);
+    free(nav->adjNode);
+    free(nav->adjLen);
+    free(nav);
+}
+
+static void *Alloc(size_t size)
+{
+    void *block = malloc(size);
+
+    if (block == NULL) {
+        Panic(E_NO_MEMORY);
+    }
+    return block;
+}
+
+// Return where a point is for a polygon, its coordinates and the point's
+// doubled, so that midpoints are points too.
+static int WhereIn(const int *px,
+                   const int *py,
+                   uint       count,
+                   int64_t    x,
+                   int64_t    y)
+{
+    int64_t x1, y1, x2, y2, side;
+    uint    i, j;
+    bool    inside = false;
+
+    for (i = 0, j = count - 1; i < count; j = i++) {
+        x1   = 2 * (int64_t)px[j];
+        y1   = 2 * (int64_t)py[j];
+        x2   = 2 * (int64_t)px[i];
+        y2   = 2 * (int64_t)py[i];
+        side = (y - y1) * (x2 - x1) - (x - x1) * (y2 - y1);
+
+        if (side == 0 && min(x1, x2) <= x && x <= max(x1, x2) &&
+            min(y1, y2) <= y && y <= max(y1, y2)) {
+            return ONEDGE;
+        }
+
+        // Count the edges crossed by a ray to the right of the point.
+        if ((y1 > y) != (y2 > y) && (side > 0) == (y2 > y1)) {
+            inside = !inside;
+        }
+    }
+    return inside ? INSIDE : OUTSIDE;
+}
+
+// Return the polygon keeping an actor from a point, doubled, or -1 if it may
+// be there. Set *onEdge if the point is on the edge of a polygon.
+static int Blocker(const Nav *nav, int64_t x, int64_t y, bool *onEdge)
+{
+    const Poly *poly;
+    int         outside = -1;
+    bool        contained = false;
+    uint        i;
+    int         where;
+
+    if (onEdge != NULL) {
+        *onEdge = false;
+    }
+
+    for (i = 0; i < nav->numPolys; ++i) {
+        poly  = &nav->polys[i];
+        where = WhereIn(nav->px + poly->first, nav->py + poly->first,
+                        poly->count, x, y);
+        if (where == ONEDGE && onEdge != NULL) {
+            *onEdge = true;
+        }
+
+        if (poly->type != PContainedAccess) {
+            if (where == INSIDE) {
+                return (int)i;
+            }
+        } else if (where != OUTSIDE) {
+            contained = true;
+        } else if (outside < 0) {
+            outside = (int)i;
+        }
+    }
+    return contained ? -1 : outside;
+}
+
+// Move a point where the actor can't be to the nearest point of the polygon
+// keeping it out, until it is somewhere the actor may be. Set *type to the
+// type of the first polygon moving it, or to -1. Return FALSE if there is
+// nowhere to go.
+static bool FreePoint(const Nav *nav, int *x, int *y, uint *type)
+{
+    uint tries;
+    int  poly;
+
+    *type = (uint)-1;
+    for (tries = 0; tries <= nav->numPolys; ++tries) {
+        poly = Blocker(nav, 2 * (int64_t)*x, 2 * (int64_t)*y, NULL);
+        if (poly < 0) {
+            return true;
+        }
+        if (tries == 0) {
+            *type = nav->polys[poly].type;
+        }
+        NearestOn(nav, (uint)poly, x, y);
+    }
+    return false;
+}
+
+// Move a point to the nearest corner of a polygon, or to a nearer point of
+// its edges unless, once rounded, that point is on the side of the edges the
+// actor is kept from.
+static void NearestOn(const Nav *nav, uint index, int *x, int *y)
+{
+    const Poly *poly    = &nav->polys[index];
+    const int  *px      = nav->px + poly->first;
+    const int  *py      = nav->py + poly->first;
+    int         barred  = poly->type == PContainedAccess ? OUTSIDE : INSIDE;
+    int         bestX   = px[0], bestY = py[0], nx, ny;
+    double      best    = HUGE_VAL, ex, ey, t, dist;
+    uint        i, j;
+
+    for (i = 0; i < poly->count; ++i) {
+        dist = Dist(*x, *y, px[i], py[i]);
+        if (dist < best) {
+            best  = dist;
+            bestX = px[i];
+            bestY = py[i];
+        }
+    }
+
+    for (i = 0, j = poly->count - 1; i < poly->count; j = i++) {
+        ex = px[i] - px[j];
+        ey = py[i] - py[j];
+        if (ex == 0.0 && ey == 0.0) {
+            continue;
+        }
+
+        t  = ((*x - px[j]) * ex + (*y - py[j]) * ey) / (ex * ex + ey * ey);
+        t  = min(max(t, 0.0), 1.0);
+        nx = (int)floor(px[j] + t * ex + 0.5);
+        ny = (int)floor(py[j] + t * ey + 0.5);
+
+        dist = Dist(*x, *y, nx, ny);
+        if (dist < best &&
+            WhereIn(px, py, poly->count, 2 * (int64_t)nx, 2 * (int64_t)ny) !=
+              barred) {
+            best  = dist;
+            bestX = nx;
+            bestY = ny;
+        }
+    }
+
+    *x = bestX;
+    *y = bestY;
+}
+
+// Return TRUE if a path from or to a point may bend at a corner: the edges at
+// the corner are on the same side of the line through the point.
+static bool Bends(const Nav *nav, uint point, int x, int y)
+{
+    uint    prev = nav->prev[point], next = nav->next[point];
+    int64_t before, after;
+
+    before = Orient(x, y, nav->px[point], nav->py[point], nav->px[prev],
+                    nav->py[prev]);
+    after  = Orient(x, y, nav->px[point], nav->py[point], nav->px[next],
+                    nav->py[next]);
+
+    return !((before < 0 && after > 0) || (before > 0 && after < 0));
+}
+
+// Return TRUE if an actor may go straight from a to b: the segment crosses no
+// edge and passes through no corner, so that all of it but its ends is on the
+// same side of every edge. Unless one of its ends is off the edges ('edged'
+// being FALSE), that side is told by its middle.
+static bool Clear(const Nav *nav, int ax, int ay, int bx, int by, bool edged)
+{
+    uint touched;
+
+    ++s_stats.segments;
+    if (CrossEdges(nav, ax, ay, bx, by, true, &touched) != 0 || touched != 0) {
+        return false;
+    }
+
+    return !edged || Blocker(nav, (int64_t)ax + bx, (int64_t)ay + by, NULL) < 0;
+}
+
+// Count the edges crossed by the segment from a to b, and in *touched those
+// whose first point it passes through, or stop at the first one if 'any' is
+// set. Only the polygons whose bounds meet the segment's are looked at, the
+// edges of those next to each other in the list at once.
+static uint CrossEdges(const Nav *nav,
+                       int        ax,
+                       int        ay,
+                       int        bx,
+                       int        by,
+                       bool       any,
+                       uint      *touched)
+{
+    CrossEdgesProc crossEdges = s_crossEdges[GetAvoidIsa()];
+    const Poly    *poly = NULL;
+    double         seg[4];
+    uint           crossed = 0, first = 0, last = 0, more, i;
+
+    seg[0]   = ax;
+    seg[1]   = ay;
+    seg[2]   = bx;
+    seg[3]   = by;
+    *touched = 0;
+    for (i = 0; i <= nav->numPolys; ++i) {
+        if (i < nav->numPolys) {
+            poly = &nav->polys[i];
+            if (poly->left > max(ax, bx) || poly->right < min(ax, bx) ||
+                poly->top > max(ay, by) || poly->bottom < min(ay, by)) {
+                continue;
+            }
+            if (poly->firstEdge == last) {
+                last += poly->numEdges;
+                continue;
+            }
+        }
+
+        if (first < last) {
+            crossed += crossEdges(&nav->edges, first, last, seg, &more);
+            *touched += more;
+            if (any && (crossed != 0 || *touched != 0)) {
+                break;
+            }
+        }
+        if (i < nav->numPolys) {
+            first = poly->firstEdge;
+            last  = first + poly->numEdges;
+        }
+    }
+    return crossed;
+}
+
+// Look for the shortest path from s to g through the corners. Return the
+// last corner of the path, -1 if it goes straight, or -2 if there is none.
+// s_from[] then leads back from that corner to the first one.
+static int Search(const Nav *nav,
+                  int        sx,
+                  int        sy,
+                  bool       sEdged,
+                  int        gx,
+                  int        gy,
+                  bool       gEdged)
+{
+    uint   goal = nav->numNodes;
+    uint   u, v, p, k;
+    double cost;
+
+    // Room for the corners and the goal, and a heap item per way to them.
+    if (goal + 1 > s_maxNodes) {
+        s_maxNodes = max(goal + 1, 2 * s_maxNodes);
+        s_cost     = (double *)realloc(s_cost, s_maxNodes * sizeof(double));
+        s_from     = (int *)realloc(s_from, s_maxNodes * sizeof(int));
+        s_closed   = (bool *)realloc(s_closed, s_maxNodes * sizeof(bool));
+        if (s_cost == NULL || s_from == NULL || s_closed == NULL) {
+            Panic(E_NO_MEMORY);
+        }
+    }
+    if (2 * goal + nav->adjStart[goal] + 1 > s_maxHeap) {
+        s_maxHeap = max(2 * goal + nav->adjStart[goal] + 1, 2 * s_maxHeap);
+        s_heap    = (HeapItem *)realloc(s_heap, s_maxHeap * sizeof(HeapItem));
+        if (s_heap == NULL) {
+            Panic(E_NO_MEMORY);
+        }
+    }
+
+    for (u = 0; u <= goal; ++u) {
+        s_cost[u]   = HUGE_VAL;
+        s_from[u]   = -1;
+        s_closed[u] = false;
+    }
+    s_numHeap = 0;
+
+    // The start joins the corners it sees.
+    for (u = 0; u < goal; ++u) {
+        p = nav->nodePoint[u];
+        if (Bends(nav, p, sx, sy) &&
+            Clear(nav, sx, sy, nav->px[p], nav->py[p], sEdged)) {
+            Relax(u, -1, Dist(sx, sy, nav->px[p], nav->py[p]),
+                  Dist(nav->px[p], nav->py[p], gx, gy));
+        }
+    }
+
+    while (s_numHeap > 0) {
+        u = PopNode();
+        if (u == goal) {
+            return s_from[goal];
+        }
+        if (s_closed[u]) {
+            continue;
+        }
+        s_closed[u] = true;
+        ++s_stats.expanded;
+
+        // The goal joins the corners it sees as they are reached.
+        p = nav->nodePoint[u];
+        if (Bends(nav, p, gx, gy) &&
+            Clear(nav, nav->px[p], nav->py[p], gx, gy, gEdged)) {
+            Relax(goal, (int)u,
+                  s_cost[u] + Dist(nav->px[p], nav->py[p], gx, gy), 0.0);
+        }
+
+        for (k = nav->adjStart[u]; k < nav->adjStart[u + 1]; ++k) {
+            v = nav->adjNode[k];
+            if (!s_closed[v]) {
+                cost = s_cost[u] + nav->adjLen[k];
+                p    = nav->nodePoint[v];
+                Relax(v, (int)u, cost, Dist(nav->px[p], nav->py[p], gx, gy));
+            }
+        }
+    }
+    return -2;
+}
+
+// Reach a node at a cost, if that is cheaper than before.
+static void Relax(uint node, int from, double cost, double estimate)
+{
+    HeapItem item;
+    uint     i, parent;
+
+    if (cost >= s_cost[node]) {
+        return;
+    }
+    s_cost[node] = cost;
+    s_from[node] = from;
+
+    item.cost = cost + estimate;
+    item.node = node;
+    for (i = s_numHeap++; i > 0; i = parent) {
+        parent = (i - 1) / 2;
+        if (s_heap[parent].cost <= item.cost) {
+            break;
+        }
+        s_heap[i] = s_heap[parent];
+    }
+    s_heap[i] = item;
+}
+
+static uint PopNode(void)
+{
+    HeapItem last;
+    uint     node = s_heap[0].node;
+    uint     i, child;
+
+    last = s_heap[--s_numHeap];
+    for (i = 0; (child = 2 * i + 1) < s_numHeap; i = child) {
+        if (child + 1 < s_numHeap &&
+            s_heap[child + 1].cost < s_heap[child].cost) {
+            ++child;
+        }
+        if (last.cost <= s_heap[child].cost) {
+            break;
+        }
+        s_heap[i] = s_heap[child];
+    }
+    s_heap[i] = last;
+    return node;
+}
+
+// Count the edges from 'first' to 'last' - 1 crossed by the segment seg,
+// from (seg[0],seg[1]) to (seg[2],seg[3]), and in *touched those whose first
+// point is inside it. With p and q the ends of an edge, relative to the start
+// of the segment, and d its direction:
+//   o1, o2  sides of p and q of the segment,
+//   o3, o4  sides of the ends of the segment of the edge,
+//   t       how far along the segment p is, times its squared length.
+static uint CrossEdgesScalar(const EdgeSet *edges,
+                             uint           first,
+                             uint           last,
+                             const double  *seg,
+                             uint          *touched)
+{
+    double dx = seg[2] - seg[0], dy = seg[3] - seg[1];
+    double len2 = dx * dx + dy * dy;
+    double px, py, qx, qy, ex, ey, o1, o2, o3, o4, t;
+    uint   crossed = 0, i;
+
+    *touched = 0;
+    for (i = first; i < last; ++i) {
+        px = edges->x1[i] - seg[0];
+        py = edges->y1[i] - seg[1];
+        qx = edges->x2[i] - seg[0];
+        qy = edges->y2[i] - seg[1];
+        o1 = dx * py - dy * px;
+        o2 = dx * qy - dy * qx;
+        ex = qx - px;
+        ey = qy - py;
+        o3 = ey * px - ex * py;
+        o4 = o3 + ex * dy - ey * dx;
+        t  = dx * px + dy * py;
+
+        crossed += o1 * o2 < 0.0 && o3 * o4 < 0.0;
+        *touched += o1 == 0.0 && t > 0.0 && t < len2;
+    }
+    return crossed;
+}
+
+#if defined(AVOID_X86)
+
+TARGET("sse2")
+static uint CrossEdgesSSE2(const EdgeSet *edges,
+                           uint           first,
+                           uint           last,
+                           const double  *seg,
+                           uint          *touched)
+{
+    __m128d ax = _mm_set1_pd(seg[0]), ay = _mm_set1_pd(seg[1]);
+    __m128d dx = _mm_set1_pd(seg[2] - seg[0]);
+    __m128d dy = _mm_set1_pd(seg[3] - seg[1]);
+    __m128d len2 =
+      _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+    __m128d zero = _mm_setzero_pd();
+    __m128d px, py, qx, qy, ex, ey, o1, o2, o3, o4, t, crossing, touching;
+    uint    crossed = 0, inside = 0, rest, i;
+
+    for (i = first; i + 2 <= last; i += 2) {
+        px = _mm_sub_pd(_mm_loadu_pd(edges->x1 + i), ax);
+        py = _mm_sub_pd(_mm_loadu_pd(edges->y1 + i), ay);
+        qx = _mm_sub_pd(_mm_loadu_pd(edges->x2 + i), ax);
+        qy = _mm_sub_pd(_mm_loadu_pd(edges->y2 + i), ay);
+        o1 = _mm_sub_pd(_mm_mul_pd(dx, py), _mm_mul_pd(dy, px));
+        o2 = _mm_sub_pd(_mm_mul_pd(dx, qy), _mm_mul_pd(dy, qx));
+        ex = _mm_sub_pd(qx, px);
+        ey = _mm_sub_pd(qy, py);
+        o3 = _mm_sub_pd(_mm_mul_pd(ey, px), _mm_mul_pd(ex, py));
+        o4 = _mm_add_pd(
+          o3, _mm_sub_pd(_mm_mul_pd(ex, dy), _mm_mul_pd(ey, dx)));
+        t = _mm_add_pd(_mm_mul_pd(dx, px), _mm_mul_pd(dy, py));
+
+        crossing = _mm_and_pd(_mm_cmplt_pd(_mm_mul_pd(o1, o2), zero),
+                              _mm_cmplt_pd(_mm_mul_pd(o3, o4), zero));
+        touching = _mm_and_pd(
+          _mm_cmpeq_pd(o1, zero),
+          _mm_and_pd(_mm_cmpgt_pd(t, zero), _mm_cmplt_pd(t, len2)));
+        crossed += s_bitCount[_mm_movemask_pd(crossing)];
+        inside += s_bitCount[_mm_movemask_pd(touching)];
+    }
+
+    crossed += CrossEdgesScalar(edges, i, last, seg, &rest);
+    *touched = inside + rest;
+    return crossed;
+}
+
+TARGET("avx2")
+static uint CrossEdgesAVX2(const EdgeSet *edges,
+                           uint           first,
+                           uint           last,
+                           const double  *seg,
+                           uint          *touched)
+{
+    __m256d ax = _mm256_set1_pd(seg[0]), ay = _mm256_set1_pd(seg[1]);
+    __m256d dx = _mm256_set1_pd(seg[2] - seg[0]);
+    __m256d dy = _mm256_set1_pd(seg[3] - seg[1]);
+    __m256d len2 =
+      _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+    __m256d zero = _mm256_setzero_pd();
+    __m256d px, py, qx, qy, ex, ey, o1, o2, o3, o4, t, crossing, touching;
+    uint    crossed = 0, inside = 0, rest, i;
+
+    for (i = first; i + 4 <= last; i += 4) {
+        px = _mm256_sub_pd(_mm256_loadu_pd(edges->x1 + i), ax);
+        py = _mm256_sub_pd(_mm256_loadu_pd(edges->y1 + i), ay);
+        qx = _mm256_sub_pd(_mm256_loadu_pd(edges->x2 + i), ax);
+        qy = _mm256_sub_pd(_mm256_loadu_pd(edges->y2 + i), ay);
+        o1 = _mm256_sub_pd(_mm256_mul_pd(dx, py), _mm256_mul_pd(dy, px));
+        o2 = _mm256_sub_pd(_mm256_mul_pd(dx, qy), _mm256_mul_pd(dy, qx));
+        ex = _mm256_sub_pd(qx, px);
+        ey = _mm256_sub_pd(qy, py);
+        o3 = _mm256_sub_pd(_mm256_mul_pd(ey, px), _mm256_mul_pd(ex, py));
+        o4 = _mm256_add_pd(
+          o3, _mm256_sub_pd(_mm256_mul_pd(ex, dy), _mm256_mul_pd(ey, dx)));
+        t = _mm256_add_pd(_mm256_mul_pd(dx, px), _mm256_mul_pd(dy, py));
+
+        crossing = _mm256_and_pd(
+          _mm256_cmp_pd(_mm256_mul_pd(o1, o2), zero, _CMP_LT_OQ),
+          _mm256_cmp_pd(_mm256_mul_pd(o3, o4), zero, _CMP_LT_OQ));
+        touching = _mm256_and_pd(
+          _mm256_cmp_pd(o1, zero, _CMP_EQ_OQ),
+          _mm256_and_pd(_mm256_cmp_pd(t, zero, _CMP_GT_OQ),
+                        _mm256_cmp_pd(t, len2, _CMP_LT_OQ)));
+        crossed += s_bitCount[_mm256_movemask_pd(crossing)];
+        inside += s_bitCount[_mm256_movemask_pd(touching)];
+    }
+
+    // The tail's instructions aren't VEX encoded.
+    _mm256_zeroupper();
+    crossed += CrossEdgesSSE2(edges, i, last, seg, &rest);
+    *touched = inside + rest;
+    return crossed;
+}
+
+#endif
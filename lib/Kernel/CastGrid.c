@@ -0,0 +1,345 @@
+#include "sci/Kernel/CastGrid.h"
+#include "sci/Kernel/Animate.h"
+#include "sci/Kernel/Kernel.h"
+#include "sci/Kernel/Selector.h"
+#include "sci/Kernel/Window.h"
+#include "sci/Utils/ErrMsg.h"
+
+#define GRIDCELLS (GRIDCOLS * GRIDROWS)
+#define LOOSEMIN  8 // actors out of their cells always allowed
+
+#define ColOf(x) ((uint)min(max((x), 0), MAXWIDTH - 1) / GRIDCELL)
+#define RowOf(y) ((uint)min(max((y), 0), MAXHEIGHT - 1) / GRIDCELL)
+
+// The cells a rectangle is in.
+typedef struct GridCells {
+    uint8_t left, top, right, bottom;
+} GridCells;
+
+// An actor of the cast, in list order.
+typedef struct GridEntry {
+    Obj      *actor;
+    int       same;  // next entry of the same actor, or -1
+    GridCells cells; // cells it was put in
+    bool      loose; // moved out of them since
+} GridEntry;
+
+static const List *s_cast  = NULL;
+static bool        s_valid = false;
+
+static GridEntry *s_entries    = NULL;
+static uint       s_numEntries = 0;
+static uint       s_maxEntries = 0;
+
+// The entries in each cell, in list order.
+static uint  s_cellStart[GRIDCELLS + 1];
+static uint *s_cellItems = NULL;
+static uint  s_maxItems  = 0;
+
+// The entries moved out of their cells.
+static uint *s_loose    = NULL;
+static uint  s_numLoose = 0;
+
+// First entry of each actor, by hashing, or -1.
+static int *s_slots    = NULL;
+static uint s_numSlots = 0;
+
+static CastGridStats s_stats;
+
+static void BuildGrid(const List *cast);
+static void Reserve(uint count);
+static void CellsOf(const RRect *rect, GridCells *cells);
+static int *FindSlot(const Obj *actor);
+static Obj *WalkCast(const List *cast, Obj *him, const RRect *rect);
+static bool Moved(const GridEntry *entry);
+static bool Hits(Obj *actor, Obj *him, const RRect *rect);
+
+Obj *FindBaseHit(List *cast, Obj *him, const RRect *rect)
+{
+    GridCells cells;
+    uint      best, row, col, cell, k, i;
+    bool      rebuilt;
+
+    if (!s_valid || s_cast != cast) {
+        BuildGrid(cast);
+    }
+    ++s_stats.queries;
+
+    if (s_numEntries < GRIDMIN) {
+        return WalkCast(cast, him, rect);
+    }
+
+    // The entries of a cell being in list order, the first hit of each cell
+    // is the only one that can come first. The rectangle of an actor may
+    // have been set without telling the grid, so the grid is built again
+    // when an actor looked at is no longer in the cells it was put in.
+    CellsOf(rect, &cells);
+    rebuilt = false;
+again:
+    best = s_numEntries;
+    for (row = cells.top; row <= cells.bottom; ++row) {
+        for (col = cells.left; col <= cells.right; ++col) {
+            cell = row * GRIDCOLS + col;
+            for (k = s_cellStart[cell]; k < s_cellStart[cell + 1]; ++k) {
+                i = s_cellItems[k];
+                if (i >= best) {
+                    break;
+                }
+                if (s_entries[i].loose) {
+                    continue;
+                }
+                if (!rebuilt && Moved(&s_entries[i])) {
+                    BuildGrid(cast);
+                    rebuilt = true;
+                    goto again;
+                }
+                if (Hits(s_entries[i].actor, him, rect)) {
+                    best = i;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (k = 0; k < s_numLoose; ++k) {
+        i = s_loose[k];
+        if (i < best && Hits(s_entries[i].actor, him, rect)) {
+            best = i;
+        }
+    }
+
+    return best < s_numEntries ? s_entries[best].actor : NULL;
+}
+
+void NoteActorBase(Obj *actor)
+{
+    GridEntry *entry;
+    GridCells  cells;
+    RRect      r;
+    int        i;
+
+    if (!s_valid || s_numEntries < GRIDMIN) {
+        return;
+    }
+
+    i = *FindSlot(actor);
+    if (i < 0) {
+        return;
+    }
+
+    CellsOf(RectFromNative(IndexedPropAddr(actor, actBR), &r), &cells);
+    for (; i >= 0; i = entry->same) {
+        entry = &s_entries[i];
+        if (!entry->loose &&
+            memcmp(&entry->cells, &cells, sizeof(cells)) != 0) {
+            entry->loose          = true;
+            s_loose[s_numLoose++] = (uint)i;
+        }
+    }
+
+    // Sort them again once the queries spend more time on the loose actors
+    // than a build would.
+    if (s_numLoose > max(LOOSEMIN, s_numEntries / 4)) {
+        s_valid = false;
+    }
+}
+
+void NoteActorProp(Obj *obj, uint var)
+{
+    // The base rectangle is the four properties from actBR on.
+    if (var - g_objOfs[actBR] < 4) {
+        NoteActorBase(obj);
+    }
+}
+
+void CastListChanged(const List *list)
+{
+    if (list == s_cast) {
+        s_valid = false;
+    }
+}
+
+void ForgetCastGrid(void)
+{
+    s_valid = false;
+}
+
+void GetCastGridStats(CastGridStats *stats)
+{
+    *stats = s_stats;
+}
+
+static void BuildGrid(const List *cast)
+{
+    uint       fill[GRIDCELLS];
+    GridEntry *entry;
+    Node      *node;
+    RRect      r;
+    uint       count, total, row, col, cell, i;
+    int       *slot;
+
+    count = 0;
+    for (node = FirstNode(cast); node != NULL; node = NextNode(node)) {
+        ++count;
+    }
+
+    s_cast       = cast;
+    s_numEntries = count;
+    s_numLoose   = 0;
+    s_valid      = true;
+    if (count < GRIDMIN) {
+        return;
+    }
+
+    ++s_stats.builds;
+    Reserve(count);
+    memset(s_slots, 0xff, s_numSlots * sizeof(int));
+    memset(s_cellStart, 0, sizeof(s_cellStart));
+
+    // Read the rectangles, and count the entries of each cell.
+    i = 0;
+    for (node = FirstNode(cast); node != NULL; node = NextNode(node), ++i) {
+        entry        = &s_entries[i];
+        entry->actor = (Obj *)((KNode *)node)->nVal;
+        entry->same  = -1;
+        entry->loose = false;
+        CellsOf(RectFromNative(IndexedPropAddr(entry->actor, actBR), &r),
+                &entry->cells);
+
+        slot = FindSlot(entry->actor);
+        if (*slot < 0) {
+            *slot = (int)i;
+        } else {
+            // The actor is in the cast more than once.
+            while (s_entries[*slot].same >= 0) {
+                slot = &s_entries[*slot].same;
+            }
+            s_entries[*slot].same = (int)i;
+        }
+
+        for (row = entry->cells.top; row <= entry->cells.bottom; ++row) {
+            for (col = entry->cells.left; col <= entry->cells.right; ++col) {
+                ++s_cellStart[row * GRIDCOLS + col + 1];
+            }
+        }
+    }
+
+    for (cell = 0; cell < GRIDCELLS; ++cell) {
+        s_cellStart[cell + 1] += s_cellStart[cell];
+    }
+    total = s_cellStart[GRIDCELLS];
+    if (total > s_maxItems) {
+        s_maxItems  = max(total, 2 * s_maxItems);
+        s_cellItems = (uint *)realloc(s_cellItems, s_maxItems * sizeof(uint));
+        if (s_cellItems == NULL) {
+            Panic(E_NO_MEMORY);
+        }
+    }
+
+    // Put the entries in their cells, in list order.
+    memcpy(fill, s_cellStart, sizeof(fill));
+    for (i = 0; i < count; ++i) {
+        entry = &s_entries[i];
+        for (row = entry->cells.top; row <= entry->cells.bottom; ++row) {
+            for (col = entry->cells.left; col <= entry->cells.right; ++col) {
+                s_cellItems[fill[row * GRIDCOLS + col]++] = i;
+            }
+        }
+    }
+}
+
+// Make room for the entries of a cast of 'count' actors.
+static void Reserve(uint count)
+{
+    if (s_slots != NULL && count <= s_maxEntries) {
+        return;
+    }
+
+    s_maxEntries = max(max(count, 2 * s_maxEntries), 16);
+    s_entries =
+      (GridEntry *)realloc(s_entries, s_maxEntries * sizeof(GridEntry));
+    s_loose = (uint *)realloc(s_loose, s_maxEntries * sizeof(uint));
+
+    // At most half the slots in use.
+    if (s_numSlots == 0) {
+        s_numSlots = 64;
+    }
+    while (s_numSlots < 2 * s_maxEntries) {
+        s_numSlots *= 2;
+    }
+    s_slots = (int *)realloc(s_slots, s_numSlots * sizeof(int));
+
+    if (s_entries == NULL || s_loose == NULL || s_slots == NULL) {
+        Panic(E_NO_MEMORY);
+    }
+}
+
+// Two rectangles meet when each one's left is before the other's right, and
+// each one's top before the other's bottom, whether the rectangles are empty
+// or not. Then the spans from each one's left to its right - 1, in either
+// order, overlap, and so do the cells of those spans.
+static void CellsOf(const RRect *rect, GridCells *cells)
+{
+    int right  = rect->right - 1;
+    int bottom = rect->bottom - 1;
+
+    cells->left   = (uint8_t)ColOf(min((int)rect->left, right));
+    cells->right  = (uint8_t)ColOf(max((int)rect->left, right));
+    cells->top    = (uint8_t)RowOf(min((int)rect->top, bottom));
+    cells->bottom = (uint8_t)RowOf(max((int)rect->top, bottom));
+}
+
+// Return the slot of an actor, or the empty slot where it goes.
+static int *FindSlot(const Obj *actor)
+{
+    uint i = (uint)(((uintptr_t)actor >> 3) * 2654435761u) & (s_numSlots - 1);
+
+    while (s_slots[i] >= 0 && s_entries[s_slots[i]].actor != actor) {
+        i = (i + 1) & (s_numSlots - 1);
+    }
+    return &s_slots[i];
+}
+
+// Return the first actor of the cast that 'rect' hits, walking the list.
+static Obj *WalkCast(const List *cast, Obj *him, const RRect *rect)
+{
+    Node *node;
+    Obj  *actor;
+
+    for (node = FirstNode(cast); node != NULL; node = NextNode(node)) {
+        actor = (Obj *)((KNode *)node)->nVal;
+        if (Hits(actor, him, rect)) {
+            return actor;
+        }
+    }
+    return NULL;
+}
+
+// Return TRUE if the base rectangle of an entry's actor is no longer in the
+// cells the entry was put in.
+static bool Moved(const GridEntry *entry)
+{
+    GridCells cells;
+    RRect     r;
+
+    CellsOf(RectFromNative(IndexedPropAddr(entry->actor, actBR), &r), &cells);
+    return memcmp(&entry->cells, &cells, sizeof(cells)) != 0;
+}
+
+// Return TRUE if an actor can be hit, and its base rectangle meets 'rect'.
+static bool Hits(Obj *actor, Obj *him, const RRect *rect)
+{
+    RRect r;
+
+    ++s_stats.tested;
+
+    // Can't hit myself, nor actors stopped, hidden or ignoring actors.
+    if (actor == him ||
+        (IndexedProp(actor, actSignal) & (NOUPDATE | ignrAct | HIDDEN)) != 0) {
+        return false;
+    }
+
+    RectFromNative(IndexedPropAddr(actor, actBR), &r);
+    return rect->left < r.right && rect->right > r.left &&
+           rect->top < r.bottom && rect->bottom > r.top;
+}
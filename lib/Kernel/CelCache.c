@@ -0,0 +1,271 @@
+#include "sci/Kernel/CelCache.h"
+#include "sci/Kernel/Resource.h"
+
+#define REPEATC 0x80
+#define REPSKIP 0x40
+
+// Number of hash chains, a power of two.
+#define CELHASH 64
+
+#define HashCel(cel, mirror)                                                   \
+    ((((uintptr_t)(cel) >> 2) ^ (uintptr_t)(mirror)) & (CELHASH - 1))
+
+static CelBits *s_celHash[CELHASH];
+static List     s_celList    = LIST_INITIALIZER; // most recently used first
+static uint     s_cacheBytes = 0;
+static bool     s_held       = false;
+
+static CelBits *DecodeCel(View           *view,
+                          Cel            *cel,
+                          bool            mirror,
+                          const RPalette *pal);
+static void     DecodeRows(Cel            *cel,
+                           bool            mirror,
+                           const RPalette *pal,
+                           uint8_t        *pixels,
+                           uint8_t        *opaque);
+static bool     MakeRoom(uint size);
+static void     DropCel(CelBits *bits);
+
+const CelBits *GetCachedCel(View           *view,
+                            Cel            *cel,
+                            bool            mirror,
+                            const RPalette *pal)
+{
+    CelBits *bits;
+
+    for (bits = s_celHash[HashCel(cel, mirror)]; bits != NULL;
+         bits = bits->next) {
+        if (bits->cel == cel && bits->mirror == mirror) {
+            break;
+        }
+    }
+
+    if (bits != NULL) {
+        // The colors were remapped for an earlier system palette.
+        if (bits->remap != (pal != NULL) ||
+            (pal != NULL &&
+             memcmp(bits->mapTo, pal->mapTo, sizeof(bits->mapTo)) != 0)) {
+            if (s_held) {
+                return NULL;
+            }
+            DropCel(bits);
+            bits = NULL;
+        }
+    }
+
+    if (bits == NULL) {
+        return DecodeCel(view, cel, mirror, pal);
+    }
+
+    MoveToFront(&s_celList, ToNode(bits));
+    return bits;
+}
+
+void DropCachedCels(Handle view)
+{
+    Node    *node, *next;
+    CelBits *bits;
+
+    for (node = FirstNode(&s_celList); node != NULL; node = next) {
+        next = NextNode(node);
+        bits = FromNode(node, CelBits);
+        if ((Handle)bits->view == view) {
+            DropCel(bits);
+        }
+    }
+}
+
+void HoldCachedCels(bool hold)
+{
+    s_held = hold;
+}
+
+void FlushCelCache(void)
+{
+    while (!EmptyList(&s_celList)) {
+        DropCel(FromNode(FirstNode(&s_celList), CelBits));
+    }
+}
+
+static CelBits *DecodeCel(View           *view,
+                          Cel            *cel,
+                          bool            mirror,
+                          const RPalette *pal)
+{
+    CelBits *bits;
+    uint8_t *pixels;
+    uint8_t *opaque;
+    uint8_t *row;
+    uint     width  = (uint)cel->xDim;
+    uint     height = (uint)cel->yDim;
+    uint     numSpans;
+    uint     size;
+    uint     x, y;
+    CelSpan *span;
+
+    pixels = (uint8_t *)malloc(2 * width * height + 1);
+    if (pixels == NULL) {
+        return NULL;
+    }
+    opaque = pixels + width * height;
+    DecodeRows(cel, mirror, pal, pixels, opaque);
+
+    // Count the spans, each starting at an opaque pixel after a clear one.
+    numSpans = 0;
+    for (y = 0; y < height; ++y) {
+        row = opaque + y * width;
+        for (x = 0; x < width; ++x) {
+            if (row[x] && (x == 0 || !row[x - 1])) {
+                ++numSpans;
+            }
+        }
+    }
+
+    size = sizeof(CelBits) + (height + 1) * sizeof(uint16_t) +
+           numSpans * sizeof(CelSpan) + width * height;
+    bits = NULL;
+    if (numSpans <= 0xffff && MakeRoom(size)) {
+        bits = (CelBits *)GetResHandle(size);
+    }
+    if (bits == NULL) {
+        free(pixels);
+        return NULL;
+    }
+
+    bits->view   = view;
+    bits->cel    = cel;
+    bits->mirror = mirror;
+    bits->remap  = pal != NULL;
+    if (pal != NULL) {
+        memcpy(bits->mapTo, pal->mapTo, sizeof(bits->mapTo));
+    }
+    bits->size   = size;
+    bits->width  = width;
+    bits->height = height;
+    bits->rows   = (uint16_t *)(bits + 1);
+    bits->spans  = (CelSpan *)(bits->rows + height + 1);
+    bits->pixels = (uint8_t *)(bits->spans + numSpans);
+    memcpy(bits->pixels, pixels, width * height);
+
+    span = bits->spans;
+    for (y = 0; y < height; ++y) {
+        bits->rows[y] = (uint16_t)(span - bits->spans);
+        row           = opaque + y * width;
+        for (x = 0; x < width; ++x) {
+            if (!row[x]) {
+                continue;
+            }
+            span->start = (uint16_t)x;
+            while (x < width && row[x]) {
+                ++x;
+            }
+            span->count = (uint16_t)(x - span->start);
+            ++span;
+        }
+    }
+    bits->rows[height] = (uint16_t)numSpans;
+    free(pixels);
+
+    bits->next                      = s_celHash[HashCel(cel, mirror)];
+    s_celHash[HashCel(cel, mirror)] = bits;
+    AddToFront(&s_celList, ToNode(bits));
+    s_cacheBytes += size;
+    return bits;
+}
+
+// Decode the RLE rows of the cel as drawing them did: a repeated color is
+// drawn whatever it is, while a unique byte is skipped if it is the skip
+// color.
+static void DecodeRows(Cel            *cel,
+                       bool            mirror,
+                       const RPalette *pal,
+                       uint8_t        *pixels,
+                       uint8_t        *opaque)
+{
+    uint8_t *data = cel->data;
+    uint8_t  dbyte, color;
+    uint     width = (uint)cel->xDim;
+    uint     num, x, y;
+    bool     flip;
+
+    // The data may still have been left mirrored in place.
+    flip = mirror != (cel->compressType != 0);
+
+    memset(opaque, 0, width * (uint)cel->yDim);
+
+    for (y = 0; y < (uint)cel->yDim; ++y) {
+        for (x = 0; x < width;) {
+            dbyte = *data++;
+            num   = (uint)(dbyte & ~(REPEATC | REPSKIP));
+
+            if ((dbyte & REPEATC) != 0) {
+                if ((dbyte & REPSKIP) != 0) {
+                    x += num;
+                    continue;
+                }
+                color = *data++;
+                if (pal != NULL) {
+                    color = pal->mapTo[color];
+                }
+                for (; num != 0 && x < width; --num, ++x) {
+                    pixels[x] = color;
+                    opaque[x] = 1;
+                }
+                x += num;
+            } else {
+                for (; num != 0; --num, ++x) {
+                    color = *data++;
+                    if (x < width && color != cel->skipColor) {
+                        pixels[x] = pal != NULL ? pal->mapTo[color] : color;
+                        opaque[x] = 1;
+                    }
+                }
+            }
+        }
+
+        if (flip) {
+            for (x = 0; x < width / 2; ++x) {
+                color                 = pixels[x];
+                pixels[x]             = pixels[width - 1 - x];
+                pixels[width - 1 - x] = color;
+                color                 = opaque[x];
+                opaque[x]             = opaque[width - 1 - x];
+                opaque[width - 1 - x] = color;
+            }
+        }
+
+        pixels += width;
+        opaque += width;
+    }
+}
+
+// Drop the least recently used cels until 'size' more bytes fit the budget.
+static bool MakeRoom(uint size)
+{
+    if (size > CELCACHEBYTES) {
+        return false;
+    }
+    if (s_held && s_cacheBytes + size > CELCACHEBYTES) {
+        return false;
+    }
+
+    while (s_cacheBytes + size > CELCACHEBYTES) {
+        DropCel(FromNode(LastNode(&s_celList), CelBits));
+    }
+    return true;
+}
+
+static void DropCel(CelBits *bits)
+{
+    CelBits **link;
+
+    for (link = &s_celHash[HashCel(bits->cel, bits->mirror)]; *link != bits;
+         link = &(*link)->next) {
+    }
+    *link = bits->next;
+
+    DeleteNode(&s_celList, ToNode(bits));
+    s_cacheBytes -= bits->size;
+    DisposeResHandle((Handle)bits);
+}
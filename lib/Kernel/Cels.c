@@ -1,6 +1,9 @@
 #include "sci/Kernel/Cels.h"
+#include "sci/Kernel/CelCache.h"
 #include "sci/Kernel/Graphics.h"
+#include "sci/Kernel/MapSummary.h"
 #include "sci/Kernel/Palette.h"
+#include "sci/Kernel/Spans.h"
 #include "sci/Kernel/Window.h"
 
 // Maximum "normal" priority.
@@ -55,6 +58,19 @@ void DrawCel(View        *view,
              const RRect *r,
              uint         priority,
              RPalette    *pal)
+{
+    CelDraw draw;
+
+    PrepareCel(view, loopNum, celNum, r, priority, &draw);
+    DrawPreparedCel(&draw);
+}
+
+bool PrepareCel(View        *view,
+                uint         loopNum,
+                uint         celNum,
+                const RRect *r,
+                uint         priority,
+                CelDraw     *draw)
 {
     Cel    *cel;
     RPoint *pt = (RPoint *)&(r->top);
@@ -65,7 +81,84 @@ void DrawCel(View        *view,
         RSetPalette(s_palPtr, PAL_MATCH);
     }
 
-    DrawCelZ(pt->h, pt->v, cel, s_palPtr, priority);
+    draw->bits = NULL;
+    if ((s_viewFlags & COLOR256) != 0) {
+        draw->bits = GetCachedCel(view, cel, s_mirrored, s_palPtr);
+    }
+
+    draw->cel       = cel;
+    draw->pal       = s_palPtr;
+    draw->mirrored  = s_mirrored;
+    draw->viewFlags = s_viewFlags;
+    draw->x         = pt->h;
+    draw->y         = pt->v;
+    draw->priority  = priority;
+    if (draw->bits == NULL) {
+        return false;
+    }
+
+    DrawSetup(pt->h, pt->v, cel, priority, &draw->priComp, &draw->priStore);
+    if (s_absPri == INVALIDPRI) {
+        draw->priStore = 0;
+        draw->priMask  = 0xff;
+    } else {
+        draw->priMask = 0x0f;
+    }
+    draw->penX = s_hOff;
+    draw->penY = s_penY;
+    draw->clip = g_theRect;
+    return true;
+}
+
+void DrawPreparedCel(const CelDraw *draw)
+{
+    if (draw->bits != NULL) {
+        DrawCelBand(draw, draw->clip.top, draw->clip.bottom);
+        return;
+    }
+
+    s_mirrored  = draw->mirrored;
+    s_viewFlags = draw->viewFlags;
+    DrawCelZ(draw->x, draw->y, draw->cel, draw->pal, draw->priority);
+}
+
+void DrawCelBand(const CelDraw *draw, int top, int bottom)
+{
+    const CelBits *bits = draw->bits;
+    const CelSpan *span;
+    const CelSpan *spanEnd;
+    const uint8_t *pixels;
+    int            left, right;
+    int            row, start, end, base;
+
+    // Clip to the port and the band, in cel coordinates.
+    top    = max(max(top, (int)draw->clip.top) - draw->penY, 0);
+    bottom = min(min(bottom, (int)draw->clip.bottom) - draw->penY,
+                 (int)bits->height);
+    left   = (int)draw->clip.left - draw->penX;
+    right  = (int)draw->clip.right - draw->penX;
+
+    NoteMapRows(MapsStored(draw->priMask, draw->priStore),
+                draw->penY + top,
+                draw->penY + bottom);
+
+    for (row = top; row < bottom; ++row) {
+        base    = (int)g_baseTable[draw->penY + row] + draw->penX;
+        pixels  = bits->pixels + (uint)row * bits->width;
+        span    = bits->spans + bits->rows[row];
+        spanEnd = bits->spans + bits->rows[row + 1];
+
+        for (; span < spanEnd; ++span) {
+            start = max((int)span->start, left);
+            end   = min((int)span->start + (int)span->count, right);
+
+            if (start < end) {
+                BlitCelSpan(g_vHndl + base + start, g_pcHndl + base + start,
+                            pixels + start, (uint)(end - start),
+                            draw->priComp, draw->priMask, draw->priStore);
+            }
+        }
+    }
 }
 
 void DrawBitMap(int       x,
@@ -198,7 +291,14 @@ bool RIsItSkip(View *view, uint loopNum, uint celNum, int vOffset, int hOffset)
     Cel    *cel;
     uint8_t color;
 
-    cel   = GetCelPointer(view, loopNum, celNum);
+    cel = GetCelPointer(view, loopNum, celNum);
+
+    // Drawing a cel leaves its data mirrored in place only when it is not
+    // cached, so look up the mirrored column when the data is not as drawn.
+    // SkipLine() reports the pixel before the offset, hence the + 1.
+    if (s_mirrored != (cel->compressType != 0)) {
+        hOffset = cel->xDim - hOffset + 1;
+    }
     color = SkipLine(cel, vOffset, hOffset);
     return (color == cel->skipColor);
 }
@@ -236,13 +336,6 @@ static void DrawSetup(int      x,
     s_skip = cel->skipColor;
     s_endX = cel->xDim;
     s_endY = cel->yDim;
-
-    if ((s_viewFlags & COLOR256) != 0) {
-        Expand256(cel);
-    } else {
-        assert(0);
-        Expand16(cel);
-    }
 }
 
 static void Expand256(Cel *cel)
@@ -359,9 +452,11 @@ static void DrawCelZ(int x, int y, Cel *cel, RPalette *pal, uint priority)
     DrawSetup(x, y, cel, priority, &priComp, &priStore);
 
     if ((s_viewFlags & COLOR256) != 0) {
+        Expand256(cel);
         DrawCel256(cel, priComp, priStore);
     } else {
         assert(0);
+        Expand16(cel);
         // DrawCel16(cel);
     }
 }
@@ -373,6 +468,7 @@ static void DrawCel256(Cel *cel, uint8_t priComp, uint8_t priStore)
     uint8_t  priMask;
     uint     base;
     int      runX, penX;
+    int      top = s_penY;
 
     // DrawSetup256
     if (s_absPri == INVALIDPRI) {
@@ -477,6 +573,8 @@ static void DrawCel256(Cel *cel, uint8_t priComp, uint8_t priStore)
             data = EatLine(data, runX);
         }
     }
+
+    NoteMapRows(MapsStored(priMask, priStore), top, s_penY);
 }
 
 static uint8_t *EatLine(uint8_t *data, int lineWidth)
@@ -0,0 +1,173 @@
+#include "sci/Kernel/ColorMatch.h"
+#include "sci/Kernel/Graphics.h"
+
+#define COLORSHIFT   (8 - COLORBITS)
+#define COLORSPAN    (1 << COLORSHIFT) // values of a gun in a bucket
+#define COLORBUCKETS (COLORSIDE * COLORSIDE * COLORSIDE)
+
+#define BucketOf(r, g, b)                                                      \
+    ((((uint)(r) >> COLORSHIFT) * COLORSIDE + ((uint)(g) >> COLORSHIFT)) *     \
+       COLORSIDE +                                                             \
+     ((uint)(b) >> COLORSHIFT))
+
+// Chains of the entries of each bucket, -1 ending them, and the bucket each
+// entry is in, or -1.
+static int16_t s_heads[COLORBUCKETS];
+static int16_t s_next[PAL_CLUT_SIZE];
+static int16_t s_bucket[PAL_CLUT_SIZE];
+static bool    s_ready = false;
+
+// Range of the entries changed since the index was last used.
+static uint s_dirtyFirst = 0;
+static uint s_dirtyLast  = PAL_CLUT_SIZE;
+
+static ColorMatchStats s_stats;
+
+static void UpdateIndex(void);
+static void MoveEntry(uint i, int bucket);
+static uint SliceDistance(uint value, uint slice);
+
+uint MatchSysColor(uint8_t redV, uint8_t greenV, uint8_t blueV, uint least)
+{
+    const Guns *guns = g_sysPalette.gun;
+    uint        near[3][COLORSIDE];
+    int         cell[3], r, g, b, ring, step;
+    uint        k, bound, sum;
+    int         i, leastIndex = -1;
+
+    UpdateIndex();
+    ++s_stats.matches;
+
+    // The least distance of each gun to the values of each slice of buckets.
+    for (k = 0; k < COLORSIDE; ++k) {
+        near[0][k] = SliceDistance(redV, k);
+        near[1][k] = SliceDistance(greenV, k);
+        near[2][k] = SliceDistance(blueV, k);
+    }
+    cell[0] = redV >> COLORSHIFT;
+    cell[1] = greenV >> COLORSHIFT;
+    cell[2] = blueV >> COLORSHIFT;
+
+    for (ring = 0; ring < COLORSIDE; ++ring) {
+        // Every bucket further out is at least as far as the nearest face of
+        // the cube of buckets searched so far.
+        bound = (uint)-1;
+        for (k = 0; k < 3; ++k) {
+            if (cell[k] - ring > 0) {
+                bound = min(bound, near[k][cell[k] - ring - 1]);
+            }
+            if (cell[k] + ring < COLORSIDE - 1) {
+                bound = min(bound, near[k][cell[k] + ring + 1]);
+            }
+        }
+
+        // Search the buckets at this distance from the color's that could
+        // hold an entry as close as the closest found.
+        for (r = max(cell[0] - ring, 0); r <= min(cell[0] + ring, COLORSIDE - 1);
+             ++r) {
+            for (g = max(cell[1] - ring, 0);
+                 g <= min(cell[1] + ring, COLORSIDE - 1);
+                 ++g) {
+                step = abs(r - cell[0]) == ring || abs(g - cell[1]) == ring
+                         ? 1
+                         : 2 * ring;
+                for (b = cell[2] - ring; b <= cell[2] + ring; b += step) {
+                    if ((uint)b >= COLORSIDE ||
+                        near[0][r] + near[1][g] + near[2][b] > least) {
+                        continue;
+                    }
+                    ++s_stats.buckets;
+
+                    i = s_heads[(r * COLORSIDE + g) * COLORSIDE + b];
+                    for (; i >= 0; i = s_next[i]) {
+                        sum = (uint)(abs((int)guns[i].r - (int)redV) +
+                                     abs((int)guns[i].g - (int)greenV) +
+                                     abs((int)guns[i].b - (int)blueV));
+                        if (sum < least || (sum == least && i > leastIndex)) {
+                            least      = sum;
+                            leastIndex = i;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (bound > least) {
+            break;
+        }
+    }
+
+    return leastIndex >= 0 ? (uint)leastIndex : PAL_CLUT_SIZE;
+}
+
+void SysColorsChanged(uint first, uint last)
+{
+    last = min(last, PAL_CLUT_SIZE);
+    if (first < last) {
+        s_dirtyFirst = min(s_dirtyFirst, first);
+        s_dirtyLast  = max(s_dirtyLast, last);
+    }
+}
+
+void GetColorMatchStats(ColorMatchStats *stats)
+{
+    *stats = s_stats;
+}
+
+// Move the changed entries to their buckets.
+static void UpdateIndex(void)
+{
+    const Guns *gun;
+    uint        i;
+
+    if (!s_ready) {
+        memset(s_heads, 0xff, sizeof(s_heads));
+        memset(s_bucket, 0xff, sizeof(s_bucket));
+        s_ready = true;
+    }
+
+    for (i = s_dirtyFirst; i < s_dirtyLast; ++i) {
+        gun = &g_sysPalette.gun[i];
+        MoveEntry(i,
+                  (gun->flags & PAL_IN_USE) != 0
+                    ? (int)BucketOf(gun->r, gun->g, gun->b)
+                    : -1);
+    }
+    s_dirtyFirst = PAL_CLUT_SIZE;
+    s_dirtyLast  = 0;
+}
+
+static void MoveEntry(uint i, int bucket)
+{
+    int16_t *link;
+
+    if (s_bucket[i] == bucket) {
+        return;
+    }
+    ++s_stats.moves;
+
+    if (s_bucket[i] >= 0) {
+        for (link = &s_heads[s_bucket[i]]; *link != (int16_t)i;
+             link = &s_next[*link]) {
+        }
+        *link = s_next[i];
+    }
+
+    s_bucket[i] = (int16_t)bucket;
+    if (bucket >= 0) {
+        s_next[i]       = s_heads[bucket];
+        s_heads[bucket] = (int16_t)i;
+    }
+}
+
+// Distance of a gun value to the values of a slice of buckets.
+static uint SliceDistance(uint value, uint slice)
+{
+    uint low  = slice * COLORSPAN;
+    uint high = low + COLORSPAN - 1;
+
+    if (value < low) {
+        return low - value;
+    }
+    return value > high ? value - high : 0;
+}
@@ -0,0 +1,203 @@
+#include "sci/Kernel/Compose.h"
+#include "sci/Kernel/Graphics.h"
+#include "sci/Utils/ErrMsg.h"
+#include "sci/Utils/Thread.h"
+
+typedef struct ComposeItem {
+    Handle  underBits;
+    CelDraw draw;
+} ComposeItem;
+
+static Mutex   s_mutex;
+static CondVar s_workCond; // a batch was queued
+static CondVar s_doneCond; // the threads are done with the batch
+static Thread  s_threads[MAXCOMPOSETHREADS - 1];
+static uint    s_numThreads = 0;
+static bool    s_quit       = false;
+static uint    s_batch      = 0; // number of the batch being drawn
+static uint    s_pending    = 0; // threads still drawing it
+
+// The queued cels, kept from one batch to the next, and the rows of the
+// maps they cover.
+static ComposeItem *s_items    = NULL;
+static uint         s_numItems = 0;
+static uint         s_maxItems = 0;
+static int          s_top      = MAXHEIGHT;
+static int          s_bottom   = 0;
+
+static void DrawBand(uint band);
+static void ComposeThread(void *arg);
+
+void SetComposeThreads(uint count)
+{
+    uint i;
+
+    FlushCompose();
+    EndCompose();
+
+    count = min(max(count, 1), MAXCOMPOSETHREADS);
+    if (count == 1) {
+        return;
+    }
+
+    CreateMutex(&s_mutex, false);
+    CreateCondVar(&s_workCond);
+    CreateCondVar(&s_doneCond);
+    s_quit  = false;
+    s_batch = 0;
+
+    for (i = 1; i < count; i++) {
+        if (!StartThread(&s_threads[s_numThreads],
+                         ComposeThread,
+                         (void *)(uintptr_t)i)) {
+            break;
+        }
+        s_numThreads++;
+    }
+
+    if (s_numThreads == 0) {
+        DestroyCondVar(&s_doneCond);
+        DestroyCondVar(&s_workCond);
+        DestroyMutex(&s_mutex);
+    }
+}
+
+uint GetComposeThreads(void)
+{
+    return s_numThreads + 1;
+}
+
+void ComposeCel(Handle underBits, const CelDraw *draw)
+{
+    const RRect *rect = (const RRect *)underBits;
+    ComposeItem *item;
+    int          top, bottom;
+
+    if (s_numItems == s_maxItems) {
+        s_maxItems = s_maxItems != 0 ? 2 * s_maxItems : 64;
+        s_items =
+          (ComposeItem *)realloc(s_items, s_maxItems * sizeof(ComposeItem));
+        if (s_items == NULL) {
+            Panic(E_NO_MEMORY);
+        }
+    }
+
+    // The cels of the batch must not be dropped before they are drawn.
+    if (s_numItems == 0) {
+        HoldCachedCels(true);
+    }
+
+    item            = &s_items[s_numItems++];
+    item->underBits = underBits;
+    item->draw      = *draw;
+
+    if (rect != NULL) {
+        s_top    = min(s_top, (int)rect->top);
+        s_bottom = max(s_bottom, (int)rect->bottom);
+    }
+    top    = max(draw->penY, (int)draw->clip.top);
+    bottom = min(draw->penY + (int)draw->bits->height, (int)draw->clip.bottom);
+    if (top < bottom) {
+        s_top    = min(s_top, top);
+        s_bottom = max(s_bottom, bottom);
+    }
+}
+
+void FlushCompose(void)
+{
+    if (s_numItems == 0) {
+        return;
+    }
+
+    if (s_numThreads != 0) {
+        LockMutex(&s_mutex);
+        s_batch++;
+        s_pending = s_numThreads;
+        BroadcastCondVar(&s_workCond);
+        UnlockMutex(&s_mutex);
+    }
+
+    DrawBand(0);
+
+    if (s_numThreads != 0) {
+        LockMutex(&s_mutex);
+        while (s_pending != 0) {
+            WaitCondVar(&s_doneCond, &s_mutex);
+        }
+        UnlockMutex(&s_mutex);
+    }
+
+    s_numItems = 0;
+    s_top      = MAXHEIGHT;
+    s_bottom   = 0;
+    HoldCachedCels(false);
+}
+
+void EndCompose(void)
+{
+    uint i;
+
+    if (s_numThreads == 0) {
+        return;
+    }
+
+    LockMutex(&s_mutex);
+    s_quit = true;
+    BroadcastCondVar(&s_workCond);
+    UnlockMutex(&s_mutex);
+
+    for (i = 0; i < s_numThreads; i++) {
+        JoinThread(&s_threads[i]);
+    }
+    s_numThreads = 0;
+
+    DestroyCondVar(&s_doneCond);
+    DestroyCondVar(&s_workCond);
+    DestroyMutex(&s_mutex);
+}
+
+// Save and draw the rows of the queued cels that are in a band, in the order
+// they were queued.
+static void DrawBand(uint band)
+{
+    uint bands = s_numThreads + 1;
+    int  rows  = max(s_bottom - s_top, 0);
+    int  top   = s_top + (int)(band * (uint)rows / bands);
+    int  bottom;
+    uint i;
+
+    bottom = s_top + (int)((band + 1) * (uint)rows / bands);
+    if (top >= bottom) {
+        return;
+    }
+
+    for (i = 0; i < s_numItems; ++i) {
+        SaveBitsRows(s_items[i].underBits, top, bottom);
+        DrawCelBand(&s_items[i].draw, top, bottom);
+    }
+}
+
+static void ComposeThread(void *arg)
+{
+    uint band  = (uint)(uintptr_t)arg;
+    uint batch = 0;
+
+    LockMutex(&s_mutex);
+    while (!s_quit) {
+        if (s_batch == batch) {
+            WaitCondVar(&s_workCond, &s_mutex);
+            continue;
+        }
+
+        batch = s_batch;
+        UnlockMutex(&s_mutex);
+
+        DrawBand(band);
+
+        LockMutex(&s_mutex);
+        if (--s_pending == 0) {
+            SignalCondVar(&s_doneCond);
+        }
+    }
+    UnlockMutex(&s_mutex);
+}
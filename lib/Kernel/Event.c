@@ -1,4 +1,5 @@
 #include "sci/Kernel/Event.h"
+#include "sci/Kernel/Graphics.h"
 #include "sci/Kernel/Mouse.h"
 #include "sci/Kernel/Selector.h"
 #include "sci/Driver/Input/Input.h"
@@ -62,6 +63,8 @@ bool RGetNextEvent(ushort mask, REventRecord *event)
     bool          ret = false;
     REventRecord *found;
 
+    // Whatever was drawn before asking for input must be seen.
+    FlushBits();
     PollInputEvent();
 
     LockMutex(&s_mutex);
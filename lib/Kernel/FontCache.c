@@ -0,0 +1,190 @@
+#include "sci/Kernel/FontCache.h"
+#include "sci/Kernel/Resource.h"
+#include "sci/Utils/ErrMsg.h"
+
+static Handle     s_fonts[MAXFONTS];
+static FontAtlas *s_lastAtlas = NULL;
+static uint       s_useCount  = 0;
+
+static FontAtlas *DecodeFont(Handle font, uint fontNum);
+static uint       MakeRoom(void);
+static void       DropAtlas(uint i);
+
+const FontAtlas *GetFontAtlas(uint fontNum)
+{
+    FontAtlas *atlas;
+    Handle     font;
+    uint       i;
+
+    // Text is mostly measured and drawn in one font at a time.
+    if (s_lastAtlas != NULL && s_lastAtlas->fontNum == fontNum) {
+        return s_lastAtlas;
+    }
+
+    for (i = 0; i < MAXFONTS; ++i) {
+        atlas = (FontAtlas *)s_fonts[i];
+        if (atlas != NULL && atlas->fontNum == fontNum) {
+            break;
+        }
+    }
+
+    if (i == MAXFONTS) {
+        font = ResLoad(RES_FONT, fontNum);
+        if (font == NULL) {
+            return NULL;
+        }
+
+        atlas = DecodeFont(font, fontNum);
+        if (atlas == NULL) {
+            Panic(E_NO_MEMORY);
+        }
+    }
+
+    atlas->lastUse = ++s_useCount;
+    s_lastAtlas    = atlas;
+    return atlas;
+}
+
+void DropFontAtlas(Handle font)
+{
+    uint i;
+
+    for (i = 0; i < MAXFONTS; ++i) {
+        if (s_fonts[i] != NULL && ((FontAtlas *)s_fonts[i])->font == font) {
+            DropAtlas(i);
+        }
+    }
+}
+
+void FlushFontCache(void)
+{
+    uint i;
+
+    for (i = 0; i < MAXFONTS; ++i) {
+        if (s_fonts[i] != NULL) {
+            DropAtlas(i);
+        }
+    }
+}
+
+// The character records are read as drawing them did, including those of
+// the codes above the font's last character, but never past the resource.
+static FontAtlas *DecodeFont(Handle font, uint fontNum)
+{
+    FontAtlas     *atlas;
+    const uint8_t *bytes = (const uint8_t *)font;
+    const uint8_t *rec;
+    const Font    *header = (const Font *)font;
+    uint8_t       *masks;
+    uint           size   = ResHandleSize(font);
+    uint           offs[256];
+    uint           total, rowBytes, dots;
+    uint           lowChar, highChar;
+    uint           c, y, d;
+
+    if (size < offsetof(Font, charRecs)) {
+        return NULL;
+    }
+    lowChar  = min(header->lowChar, 256);
+    highChar = min(header->highChar, 256);
+
+    // Find the records, and the size of the masks of the font's characters.
+    total = 0;
+    for (c = 0; c < 256; ++c) {
+        offs[c] = 0;
+        if (offsetof(Font, charRecs) + (c + 1) * sizeof(uint16_t) <= size &&
+            (uint)header->charRecs[c] + 2 <= size) {
+            offs[c] = header->charRecs[c];
+        }
+        if (offs[c] == 0 || c < lowChar || c >= highChar) {
+            continue;
+        }
+
+        rec      = bytes + offs[c];
+        dots     = max(rec[0], 1);
+        rowBytes = (dots + 7) / 8;
+        if (offs[c] + 2 + rec[1] * rowBytes <= size) {
+            total += rec[1] * dots;
+        }
+    }
+
+    c = MakeRoom();
+    s_fonts[c] = GetResHandle((sizeof(FontAtlas) + total + 7) & ~(size_t)7);
+    atlas = (FontAtlas *)s_fonts[c];
+    if (atlas == NULL) {
+        return NULL;
+    }
+
+    atlas->font      = font;
+    atlas->fontNum   = fontNum;
+    atlas->lowChar   = lowChar;
+    atlas->highChar  = highChar;
+    atlas->pointSize = header->pointSize;
+
+    masks = (uint8_t *)(atlas + 1);
+    for (c = 0; c < 256; ++c) {
+        atlas->widths[c]  = 0;
+        atlas->heights[c] = 0;
+        atlas->dots[c]    = 0;
+        atlas->glyphs[c]  = 0;
+        if (offs[c] == 0) {
+            continue;
+        }
+
+        rec               = bytes + offs[c];
+        atlas->widths[c]  = rec[0];
+        atlas->heights[c] = rec[1];
+        if (c < lowChar || c >= highChar) {
+            continue;
+        }
+
+        // Even an empty character had the first dot of its rows drawn.
+        dots     = max(rec[0], 1);
+        rowBytes = (dots + 7) / 8;
+        if (rec[1] == 0 || offs[c] + 2 + rec[1] * rowBytes > size) {
+            continue;
+        }
+
+        atlas->dots[c]   = (uint8_t)dots;
+        atlas->glyphs[c] = (uint32_t)(masks - (uint8_t *)atlas);
+        for (y = 0; y < rec[1]; ++y) {
+            for (d = 0; d < dots; ++d) {
+                *masks++ = (rec[2 + y * rowBytes + d / 8] & (0x80 >> (d & 7)))
+                             ? 0xff
+                             : 0x00;
+            }
+        }
+    }
+    return atlas;
+}
+
+// Return a free slot, dropping the least recently used atlas if there is
+// none.
+static uint MakeRoom(void)
+{
+    uint i, oldest = 0;
+
+    for (i = 0; i < MAXFONTS; ++i) {
+        if (s_fonts[i] == NULL) {
+            return i;
+        }
+        if (((FontAtlas *)s_fonts[i])->lastUse <
+            ((FontAtlas *)s_fonts[oldest])->lastUse) {
+            oldest = i;
+        }
+    }
+
+    DropAtlas(oldest);
+    return oldest;
+}
+
+static void DropAtlas(uint i)
+{
+    FontAtlas *atlas = (FontAtlas *)s_fonts[i];
+
+    if (atlas == s_lastAtlas) {
+        s_lastAtlas = NULL;
+    }
+    s_fonts[i] = NULL;
+    DisposeResHandle((Handle)atlas);
+}
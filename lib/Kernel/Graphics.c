@@ -1,8 +1,14 @@
 #include "sci/Kernel/Graphics.h"
 #include "sci/Kernel/Animate.h"
+#include "sci/Kernel/CelCache.h"
 #include "sci/Kernel/Cels.h"
+#include "sci/Kernel/Compose.h"
+#include "sci/Kernel/FontCache.h"
+#include "sci/Kernel/MapSummary.h"
+#include "sci/Kernel/PicCache.h"
 #include "sci/Kernel/Picture.h"
 #include "sci/Kernel/Resource.h"
+#include "sci/Kernel/Spans.h"
 #include "sci/Kernel/Window.h"
 #include "sci/Driver/Display/Display.h"
 #include "sci/PMachine/PMachine.h"
@@ -30,6 +36,40 @@
 // Bytes per scanline.
 #define VROWBYTES MAXWIDTH
 
+// Byte lanes of a word, for scanning maps a word at a time.
+#define BYTES_ONES  0x0101010101010101ULL
+#define BYTES_HIGHS 0x8080808080808080ULL
+
+// Is any byte of the word zero?
+#define HasZeroByte(word) ((((word) - BYTES_ONES) & ~(word) & BYTES_HIGHS) != 0)
+
+// Is a dot of the fill guide map unfilled?
+#define GuideClear(dot)                                                        \
+    ((((dot) ^ (uint8_t)s_guideXor) & (uint8_t)s_guideMask) == 0)
+
+// A line for Fill to scan, above (dir -1) or below (dir 1) a filled span.
+typedef struct FillSpan {
+    int16_t y;
+    int16_t left;
+    int16_t right;
+    int16_t dir;
+} FillSpan;
+
+// Bytes of the arena of frame underbits.
+#define FRAMEBITSBYTES (256 * 1024)
+
+// Marks a live entry of the arena.
+#define FRAMEBITSMAGIC 0x55424954
+
+// End of the chain of arena entries.
+#define NOFRAMEBITS ((uint)-1)
+
+// Header of an entry of the arena; the saved bits follow.
+typedef struct FrameBits {
+    uint32_t magic;
+    uint32_t prev; // offset of the entry below, or NOFRAMEBITS
+} FrameBits;
+
 static void SetColor(void);
 static void ClearColor(void);
 static void SetPriority(void);
@@ -197,6 +237,10 @@ static int s_endX = 0;
 // Active vMaps.
 static uint s_mapSet = 0;
 
+// Bits of the priority/control map to plot, and their values.
+static uint8_t s_pcMask = 0;
+static uint8_t s_pcBits = 0;
+
 static uint s_brushSize = 0;
 
 static bool s_oldCode = false;
@@ -230,6 +274,24 @@ RGrafPort *g_rThePort = NULL;
 // Normalized rectangle.
 RRect g_theRect = { 0 };
 
+// Fill's guide map, with the mask of its bits, xored, that are set in dots
+// already filled.
+static const uint8_t *s_guideMap  = NULL;
+static uint64_t       s_guideXor  = 0;
+static uint64_t       s_guideMask = 0;
+
+// Fill's stack of lines to scan.
+static FillSpan *s_fillStack     = NULL;
+static uint      s_fillStackSize = 0;
+static uint      s_fillDepth     = 0;
+
+// Arena of the underbits saved for a frame only. Entries are released in
+// about the reverse order they were saved, so the arena is a stack from which
+// the released entries at the top are popped.
+static uint8_t *s_frameBits = NULL;
+static uint     s_frameTop  = 0;
+static uint     s_frameLast = NOFRAMEBITS;
+
 static void InitGraph(void);
 static void EndGraph(void);
 static void ClearScreen(void);
@@ -243,30 +305,11 @@ static void DrawVLine(void);
 static void DrawDLine(void);
 static void DrawBrush(int x, int y, uint brush, uint spray);
 static void Fill(int x, int y);
-static void DoFill(int xScan,
-                   int leftSide,
-                   int rightSide,
-                   int prevLeftSide,
-                   int prevRightSide,
-                   int yScan,
-                   int direction);
-static void FillUp(int xScan,
-                   int leftSide,
-                   int rightSide,
-                   int oldLeftSide,
-                   int oldRightSide,
-                   int yScan,
-                   int direction);
-static void FillDown(int xScan,
-                     int leftSide,
-                     int rightSide,
-                     int oldLeftSide,
-                     int oldRightSide,
-                     int yScan,
-                     int direction);
+static void PushFillSpan(int y, int left, int right, int dir);
 static bool CheckDot(int penX, uint lineBase);
 static int CheckRight(int left, uint lineBase);
 static int CheckLeft(int right, uint lineBase);
+static int SkipRight(int left, int right, uint lineBase);
 static uint8_t *GetSegment(uint mapSet);
 static void SetMaps(void);
 static uint SetBase(void);
@@ -276,17 +319,28 @@ static void FillLines(uint base, int left, int right);
 static uint SizeRect(const RRect *rect);
 static void SOffsetRect(RRect *rect, const RGrafPort *port);
 static void GetTheRect(const RRect *rect);
+static Handle DoSaveBits(const RRect *rect, uint mapSet, bool frame);
+static Handle AllocFrameBits(uint bytes);
+static bool IsFrameBits(Handle hndl);
+static void FreeFrameBits(Handle hndl);
 static void StdChar(char cCode);
 static void ClearChar(char cCode);
 
 bool CInitGraph(void)
 {
+    const char *threads;
+
     // Initialize the display driver.
     InitDisplay();
 
     // Call resolution specific initialization.
     InitGraph();
 
+    threads = getenv("SCI_DRAW_THREADS");
+    if (threads != NULL && atoi(threads) > 1) {
+        SetComposeThreads((uint)atoi(threads));
+    }
+
     // Create default port.
     g_rThePort = &s_defPort;
     ROpenPort(g_rThePort);
@@ -295,6 +349,10 @@ bool CInitGraph(void)
 
 void CEndGraph(void)
 {
+    EndCompose();
+    FlushPicCache();
+    FlushCelCache();
+    FlushFontCache();
     EndGraph();
     EndDisplay();
 }
@@ -324,9 +382,18 @@ void ShowBits(const RRect *rect, uint mapSet)
             mapSet);
 }
 
-void DrawPic(Handle hndl, bool clear, uint mirror)
+void FlushBits(void)
+{
+    FlushDisplay();
+}
+
+void DrawPic(Handle hndl, uint num, bool clear, uint mirror)
 {
     g_picNotValid = 1;
+    if (LoadCachedPic(num, clear, (mirror & HMIRROR) != 0)) {
+        return;
+    }
+
     if (clear) {
         // Force 0 priority
         s_picOverlayMask = 0;
@@ -348,6 +415,7 @@ void DrawPic(Handle hndl, bool clear, uint mirror)
     s_cColor = PENOFF;
 
     DispatchGrf();
+    StoreCachedPic();
 
     s_mirrorX = false;
 }
@@ -444,44 +512,37 @@ uint GetFont(void)
 
 void RSetFont(uint fontNum)
 {
-    Font *font;
+    const FontAtlas *atlas;
 
-    font = (Font *)ResLoad(RES_FONT, fontNum);
-    if (font != NULL) {
-        g_rThePort->fontSize = font->pointSize;
+    atlas = GetFontAtlas(fontNum);
+    if (atlas != NULL) {
+        g_rThePort->fontSize = atlas->pointSize;
         g_rThePort->fontNum  = fontNum;
     }
 }
 
 uint RTextWidth(const char *text, int first, uint count)
 {
-    Font *font;
-    uint  i;
-    uint  width = 0;
+    const FontAtlas *atlas;
+    uint             i;
+    uint             width = 0;
 
-    font = (Font *)ResLoad(RES_FONT, g_rThePort->fontNum);
+    atlas = GetFontAtlas(g_rThePort->fontNum);
     text += first;
     for (i = 0; i < count; ++i) {
-        char cCode = text[i];
-        width += *((uint8_t *)font + font->charRecs[(uint8_t)cCode]);
+        width += GlyphWide(atlas, text[i]);
     }
     return width;
 }
 
 uint RCharWidth(char cCode)
 {
-    Font *font;
-
-    font = (Font *)ResLoad(RES_FONT, g_rThePort->fontNum);
-    return ((uint8_t *)font + font->charRecs[(uint8_t)cCode])[0];
+    return GlyphWide(GetFontAtlas(g_rThePort->fontNum), cCode);
 }
 
 uint CharHeight(char cCode)
 {
-    Font *font;
-
-    font = (Font *)ResLoad(RES_FONT, g_rThePort->fontNum);
-    return ((uint8_t *)font + font->charRecs[(uint8_t)cCode])[1];
+    return GlyphHigh(GetFontAtlas(g_rThePort->fontNum), cCode);
 }
 
 void RDrawChar(char cCode)
@@ -508,70 +569,40 @@ void ShowChar(char cCode)
 // Draw the character.
 static void StdChar(char cCode)
 {
-    uint16_t theChar;
-    uint8_t  color;
-    uint     style;
-    Font    *font;
-    uint     base;
+    const FontAtlas *atlas;
+    const uint8_t   *masks;
+    uint8_t          dimMasks[256];
+    uint8_t          color;
+    uint             dots, cHigh, d;
+    uint             base;
 
-    theChar = (uint16_t)(uint8_t)cCode;
-    color   = g_rThePort->fgColor;
-    style   = g_rThePort->txFace;
+    atlas = GetFontAtlas(g_rThePort->fontNum);
+    masks = GlyphMasks(atlas, cCode);
+    if (masks == NULL) {
+        return;
+    }
+
+    color = g_rThePort->fgColor;
+    dots  = atlas->dots[(uint8_t)cCode];
 
     s_penY = g_rThePort->pnLoc.v + g_rThePort->origin.v;
     s_penX = g_rThePort->pnLoc.h + g_rThePort->origin.h;
     base   = (uint)g_baseTable[s_penY] + (uint)s_penX;
 
-    font = (Font *)ResLoad(RES_FONT, g_rThePort->fontNum);
-    if (font->lowChar <= theChar && theChar < font->highChar) {
-        uint8_t  cWide, cHigh, cDots, dimMask, pattern;
-        uint8_t *data;
-        uint8_t *charRecs = (uint8_t *)font + font->charRecs[(uint8_t)cCode];
-
-        cWide = *charRecs++;
-        cHigh = *charRecs++;
-
-        while (cHigh != 0) {
-            dimMask = 0xff;
-            if ((style & DIM) != 0) {
-                dimMask &= 0x55;
-                if ((s_penY & 1) != 0) {
-                    dimMask = ~dimMask;
-                }
-            }
-
-            pattern = *charRecs++;
-            pattern &= dimMask;
-
-            cDots = 0;
-            data  = &g_vHndl[base];
-            while (true) {
-                if ((int8_t)pattern < 0) {
-                    *data = color;
-                }
-                pattern <<=
-                  1; // we shift dots out the left and plot left to right.
-                data++;
-                cDots++;
-                if (cDots >= cWide) {
-                    break;
-                }
-
-                // Check for byte reload.
-                if ((cDots & 7) == 0) // 8 bits used?
-                {
-                    pattern = *charRecs++;
-                    pattern &= dimMask;
-                }
+    for (cHigh = GlyphHigh(atlas, cCode); cHigh != 0; --cHigh) {
+        if ((g_rThePort->txFace & DIM) != 0) {
+            // Every other dot, alternating with the lines.
+            for (d = 0; d < dots; ++d) {
+                dimMasks[d] = ((d ^ (uint)s_penY) & 1) != 0 ? masks[d] : 0;
             }
-
-            // Line of pattern done.
-            base += VROWBYTES;
-
-            // See if we have more lines to do.
-            s_penY++;
-            cHigh--;
+            FillMasked(&g_vHndl[base], dimMasks, color, dots);
+        } else {
+            FillMasked(&g_vHndl[base], masks, color, dots);
         }
+
+        masks += dots;
+        base += VROWBYTES;
+        s_penY++;
     }
 }
 
@@ -651,6 +682,8 @@ void RFillRect(const RRect *rect,
         }
     }
 
+    NoteMapRows(mapSet, g_theRect.top, g_theRect.bottom);
+
     if ((mapSet & (PMAP | CMAP)) == (PMAP | CMAP)) {
         uint8_t pcColor = (color2 << 4) | color3;
 
@@ -712,12 +745,6 @@ void REraseRect(RRect *rect)
 
 uint OnControl(uint mapSet, const RRect *rect)
 {
-    uint8_t *vMap;
-    uint     base;
-    uint     inter;
-    int      hRun, vRun, i, j;
-    uint     mask, bit;
-
     // Get rect into local.
     memcpy(&g_theRect, rect, sizeof(RRect));
 
@@ -729,55 +756,41 @@ uint OnControl(uint mapSet, const RRect *rect)
     // Make it global.
     SOffsetRect(&g_theRect, g_rThePort);
 
-    // Determine vertical run-count.
-    vRun = g_theRect.bottom - g_theRect.top;
-    // Determine horizontal run-count.
-    hRun = g_theRect.right - g_theRect.left;
+    // Priority pixels are in the high nibble, control pixels in the low one.
+    return SummarizeMap(mapSet, &g_theRect);
+}
 
-    // Set up base address of first line.
-    base = g_baseTable[g_theRect.top];
-    base += (uint)g_theRect.left;
+Handle SaveBits(const RRect *rect, uint mapSet)
+{
+    Handle hndl;
 
-    // Calculate interline advance value.
-    inter = (uint)(VROWBYTES - hRun);
+    hndl = DoSaveBits(rect, mapSet, false);
+    SaveBitsRows(hndl, 0, MAXHEIGHT);
+    return hndl;
+}
 
-    // Do all the lines.
-    mask = 0;
-    vMap = &g_pcHndl[base];
-    for (i = 0; i < vRun; ++i) {
-        // Priority pixel is in high nibble.
-        if ((mapSet & PMAP) != 0) {
-            for (j = 0; j < hRun; ++j) {
-                bit = *vMap >> 4;
-                mask |= 1U << bit;
-                ++vMap;
-            }
-        }
-        // Control pixel is in low nibble.
-        else {
-            for (j = 0; j < hRun; ++j) {
-                bit = *vMap & ODDON;
-                mask |= 1U << bit;
-                ++vMap;
-            }
-        }
+Handle SaveFrameBits(const RRect *rect, uint mapSet)
+{
+    Handle hndl;
 
-        // Advance to next line.
-        vMap += inter;
-    }
-    return mask;
+    hndl = DoSaveBits(rect, mapSet, true);
+    SaveBitsRows(hndl, 0, MAXHEIGHT);
+    return hndl;
 }
 
-Handle SaveBits(const RRect *rect, uint mapSet)
+Handle ReserveFrameBits(const RRect *rect, uint mapSet)
+{
+    return DoSaveBits(rect, mapSet, true);
+}
+
+// Allocate the saved bits of a rectangle and fill in their header. The bits
+// themselves are copied by SaveBitsRows().
+static Handle DoSaveBits(const RRect *rect, uint mapSet, bool frame)
 {
     uint     size;
     uint     bytes;
     Handle   hndl;
     uint8_t *bits;
-    uint8_t *vMap;
-    uint     base;
-    uint     inter;
-    int      hRun, vRun, i;
 
     // Address the rectangle.
     GetTheRect(rect);
@@ -813,9 +826,16 @@ Handle SaveBits(const RRect *rect, uint mapSet)
         Panic(E_SAVEBITS);
     }
 
-    hndl = ResLoad(RES_MEM, bytes);
+    // Bits that don't fit the arena are saved as those of a longer life.
+    hndl = NULL;
+    if (frame) {
+        hndl = AllocFrameBits(bytes);
+    }
     if (hndl == NULL) {
-        Panic(E_SAVEBITS);
+        hndl = ResLoad(RES_MEM, bytes);
+        if (hndl == NULL) {
+            Panic(E_SAVEBITS);
+        }
     }
     bits = (uint8_t *)hndl;
 
@@ -824,36 +844,56 @@ Handle SaveBits(const RRect *rect, uint mapSet)
     bits += sizeof(RRect);
 
     *((uint16_t *)bits) = (uint16_t)mapSet;
-    bits += sizeof(uint16_t);
 
-    vRun = g_theRect.bottom - g_theRect.top;
-    hRun = g_theRect.right - g_theRect.left;
+    return hndl;
+}
 
-    base = g_baseTable[g_theRect.top];
-    base += (uint)g_theRect.left;
+void SaveBitsRows(Handle hndl, int top, int bottom)
+{
+    const RRect *rect;
+    uint         mapSet;
+    uint8_t     *bits;
+    uint8_t     *vMap;
+    uint         base;
+    int          hRun, vRun, i;
 
-    // Inter-line advance (difference in width and run-count).
-    inter = (uint)(VROWBYTES - hRun);
+    if (hndl == NULL) {
+        return;
+    }
+
+    rect   = (const RRect *)hndl;
+    mapSet = *(uint16_t *)((uint8_t *)hndl + sizeof(RRect));
+    bits   = (uint8_t *)hndl + sizeof(RRect) + sizeof(uint16_t);
+
+    vRun = rect->bottom - rect->top;
+    hRun = rect->right - rect->left;
+
+    top    = max(top, (int)rect->top);
+    bottom = min(bottom, (int)rect->bottom);
+    if (top >= bottom) {
+        return;
+    }
+
+    base = g_baseTable[top];
+    base += (uint)rect->left;
+    bits += (uint)((top - rect->top) * hRun);
 
     if ((mapSet & VMAP) != 0) {
         vMap = &g_vHndl[base];
-        for (i = 0; i < vRun; ++i) {
-            memcpy(bits, vMap, (uint)hRun);
-            bits += (uint)hRun;
-            vMap += (uint)hRun + inter;
+        for (i = top; i < bottom; ++i) {
+            memcpy(bits + (uint)((i - top) * hRun), vMap, (uint)hRun);
+            vMap += VROWBYTES;
         }
+        bits += (uint)(vRun * hRun);
     }
 
     if ((mapSet & (PMAP | CMAP)) != 0) {
         vMap = &g_pcHndl[base];
-        for (i = 0; i < vRun; ++i) {
-            memcpy(bits, vMap, (uint)hRun);
-            bits += (uint)hRun;
-            vMap += (uint)hRun + inter;
+        for (i = top; i < bottom; ++i) {
+            memcpy(bits + (uint)((i - top) * hRun), vMap, (uint)hRun);
+            vMap += VROWBYTES;
         }
     }
-
-    return hndl;
 }
 
 void RestoreBits(Handle hndl)
@@ -865,12 +905,14 @@ void RestoreBits(Handle hndl)
     uint     base;
     uint     inter;
     int      hRun, vRun, i;
+    bool     frame;
 
     if (hndl == NULL) {
         return;
     }
 
-    if (FindResEntry(RES_MEM, (size_t)hndl) == NULL) {
+    frame = IsFrameBits(hndl);
+    if (!frame && FindResEntry(RES_MEM, (size_t)hndl) == NULL) {
         return;
     }
 
@@ -901,13 +943,20 @@ void RestoreBits(Handle hndl)
     if ((mapSet & (PMAP | CMAP)) != 0) {
         vMap = &g_pcHndl[base];
         for (i = 0; i < vRun; ++i) {
+            NoteMapRows(MapsDiffer(vMap, bits, (uint)hRun),
+                        rect->top + i,
+                        rect->top + i + 1);
             memcpy(vMap, bits, (uint)hRun);
             bits += (uint)hRun;
             vMap += (uint)hRun + inter;
         }
     }
 
-    ResUnLoad(RES_MEM, (size_t)hndl);
+    if (frame) {
+        FreeFrameBits(hndl);
+    } else {
+        ResUnLoad(RES_MEM, (size_t)hndl);
+    }
 }
 
 void UnloadBits(Handle hndl)
@@ -916,6 +965,11 @@ void UnloadBits(Handle hndl)
         return;
     }
 
+    if (IsFrameBits(hndl)) {
+        FreeFrameBits(hndl);
+        return;
+    }
+
     if (*((uint16_t *)((uint8_t *)hndl + 12)) == 0x4321) {
         // Not implemented in this version!
         assert(0);
@@ -924,6 +978,67 @@ void UnloadBits(Handle hndl)
     ResUnLoad(RES_MEM, (size_t)hndl);
 }
 
+void ResetFrameBits(void)
+{
+    s_frameTop  = 0;
+    s_frameLast = NOFRAMEBITS;
+}
+
+static Handle AllocFrameBits(uint bytes)
+{
+    FrameBits *entry;
+    uint       size;
+
+    if (s_frameBits == NULL) {
+        s_frameBits = (uint8_t *)malloc(FRAMEBITSBYTES);
+        if (s_frameBits == NULL) {
+            return NULL;
+        }
+    }
+
+    // Keep the entries aligned as the headers.
+    size = (sizeof(FrameBits) + bytes + 7) & ~7U;
+    if (size > FRAMEBITSBYTES - s_frameTop) {
+        return NULL;
+    }
+
+    entry        = (FrameBits *)(s_frameBits + s_frameTop);
+    entry->magic = FRAMEBITSMAGIC;
+    entry->prev  = s_frameLast;
+    s_frameLast  = s_frameTop;
+    s_frameTop += size;
+    return entry + 1;
+}
+
+static bool IsFrameBits(Handle hndl)
+{
+    uint8_t *bits = (uint8_t *)hndl;
+
+    if (s_frameBits == NULL || bits < s_frameBits + sizeof(FrameBits) ||
+        bits >= s_frameBits + s_frameTop ||
+        (uint)(bits - s_frameBits) % 8 != 0) {
+        return false;
+    }
+    return ((FrameBits *)bits - 1)->magic == FRAMEBITSMAGIC;
+}
+
+static void FreeFrameBits(Handle hndl)
+{
+    FrameBits *entry;
+
+    ((FrameBits *)hndl - 1)->magic = 0;
+
+    // Pop the released entries at the top.
+    while (s_frameLast != NOFRAMEBITS) {
+        entry = (FrameBits *)(s_frameBits + s_frameLast);
+        if (entry->magic == FRAMEBITSMAGIC) {
+            break;
+        }
+        s_frameTop  = s_frameLast;
+        s_frameLast = entry->prev;
+    }
+}
+
 void PenColor(uint8_t color)
 {
     g_rThePort->fgColor = color;
@@ -1027,6 +1142,7 @@ static void InitGraph(void)
     // Clear all vMaps to default colors.
     memset(g_vHndl, 0, mapSize);
     memset(g_pcHndl, 0, mapSize);
+    InitMapSummary();
 }
 
 // Free allocated virtual bitmap's memory.
@@ -1034,6 +1150,12 @@ static void EndGraph(void)
 {
     free(g_vHndl);
     free(g_pcHndl);
+    free(s_fillStack);
+    s_fillStack     = NULL;
+    s_fillStackSize = 0;
+    free(s_frameBits);
+    s_frameBits = NULL;
+    ResetFrameBits();
 }
 
 // Return segment of a virtual bitmap.
@@ -1050,6 +1172,8 @@ static uint8_t *GetSegment(uint mapSet)
 static void SetMaps(void)
 {
     s_mapSet = 0;
+    s_pcMask = 0;
+    s_pcBits = 0;
 
     if (s_vColor != PENOFF) {
         s_mapSet |= VMAP;
@@ -1057,10 +1181,14 @@ static void SetMaps(void)
 
     if (s_pColor != PENOFF) {
         s_mapSet |= PMAP;
+        s_pcMask |= EVENON;
+        s_pcBits |= s_pColor; // 0-F in hi nibble only
     }
 
     if (s_cColor != PENOFF) {
         s_mapSet |= CMAP;
+        s_pcMask |= ODDON;
+        s_pcBits |= s_cColor; // 0-F in low nibble
     }
 }
 
@@ -1081,14 +1209,12 @@ static void FastDot(uint base)
         g_vHndl[base] = s_vColor; // color 0-256 in byte
     }
 
-    if ((s_mapSet & PMAP) != 0) {
-        g_pcHndl[base] &= EVENOFF;
-        g_pcHndl[base] |= s_pColor; // 0-F in hi nibble only
-    }
-
-    if ((s_mapSet & CMAP) != 0) {
-        g_pcHndl[base] &= ODDOFF;
-        g_pcHndl[base] |= s_cColor; // 0-F in low nibble
+    // Priority and control share a byte: plot both nibbles at once.
+    if (s_pcMask != 0) {
+        g_pcHndl[base] = (uint8_t)((g_pcHndl[base] & ~s_pcMask) | s_pcBits);
+        NoteMapRows(s_mapSet,
+                    (int)(base / VROWBYTES),
+                    (int)(base / VROWBYTES) + 1);
     }
 }
 
@@ -1101,7 +1227,6 @@ static void DoDot(uint base)
 static void FillLines(uint base, int left, int right)
 {
     uint length;
-    uint i, n;
 
     if (left > right) {
         return;
@@ -1109,39 +1234,35 @@ static void FillLines(uint base, int left, int right)
 
     length = (uint)(right - left);
     base += (uint)left;
-    n = base + length;
 
     if ((s_mapSet & VMAP) != 0) {
-        for (i = base; i < n; ++i) {
-            g_vHndl[i] = s_vColor;
-        }
+        FillBytes(g_vHndl + base, s_vColor, length);
     }
 
+    NoteMapRows(
+      s_mapSet, (int)(base / VROWBYTES), (int)(base / VROWBYTES) + 1);
+
     // Try for a straight store to shared priority/control map.
-    if ((s_mapSet & (PMAP | CMAP)) == (PMAP | CMAP)) {
-        for (i = base; i < n; ++i) {
-            g_pcHndl[i] = s_pColor | s_vColor;
-        }
-    } else if ((s_mapSet & PMAP) != 0) {
-        for (i = base; i < n; ++i) {
-            g_pcHndl[i] &= EVENOFF;
-            g_pcHndl[i] |= s_pColor;
-        }
-    } else if ((s_mapSet & CMAP) != 0) {
-        for (i = base; i < n; ++i) {
-            g_pcHndl[i] &= ODDOFF;
-            g_pcHndl[i] |= s_cColor;
-        }
+    if (s_pcMask == (EVENON | ODDON)) {
+        FillBytes(g_pcHndl + base, s_pcBits, length);
+    } else if (s_pcMask != 0) {
+        FillBits(g_pcHndl + base, s_pcMask, s_pcBits, length);
     }
 }
 
-// Fill area enclosing seed point in port's pen color
-// Uses stack hungry recursive (logic limited) scan technique
+// Fill area enclosing seed point in port's pen color.
+// Uses an iterative scan line technique with an explicit stack of spans to
+// scan, so large fills don't use up the C stack.
 // seed point (penX/Y) determines background color.
-// Fill is limited by boundaries contained in theRect.
+// Fill is limited by boundaries contained in theRect. As before, the line of
+// the seed is filled even if it is outside of theRect, and lines are only
+// added above while they are not above theRect, and below while they are not
+// below it.
 static void Fill(int x, int y)
 {
-    uint base;
+    FillSpan span;
+    uint     base;
+    int      left, right;
 
     if (s_mirrorX) {
         x = -(x - MAXWIDTH + 1);
@@ -1168,19 +1289,31 @@ static void Fill(int x, int y)
         return;
     }
 
-    // Abort any attempt to fill in background color of guide map.
+    // Abort any attempt to fill in background color of guide map. The guide
+    // map is the first of the visual, priority and control maps plotted in;
+    // its unfilled dots are white, or have a clear nibble.
     if ((s_mapSet & VMAP) != 0) {
         if (s_vColor == vWHITE) {
             return;
         }
+        s_guideMap  = g_vHndl;
+        s_guideXor  = ~(uint64_t)0;
+        s_guideMask = ~(uint64_t)0;
     } else if ((s_mapSet & PMAP) != 0) {
         if (s_pColor == 0) {
             return;
         }
+        s_guideMap  = g_pcHndl;
+        s_guideXor  = 0;
+        s_guideMask = EVENON * BYTES_ONES;
     } else {
-        if (s_cColor == 0) {
+        // A control with a clear nibble would never fill the dots.
+        if ((s_cColor & ODDON) == 0) {
             return;
         }
+        s_guideMap  = g_pcHndl;
+        s_guideXor  = 0;
+        s_guideMask = ODDON * BYTES_ONES;
     }
 
     // If seed point is filled we abort.
@@ -1189,154 +1322,67 @@ static void Fill(int x, int y)
         return;
     }
 
-#define UP   -1
-#define DN   1
-#define DONE 0
-
-    // Put DONE in the first frame of the fill stack.
-    DoFill(s_penX, s_penX, s_penX, s_penX, s_penX, s_penY, DONE);
-}
-
-static void DoFill(int xScan,
-                   int leftSide,
-                   int rightSide,
-                   int prevLeftSide,
-                   int prevRightSide,
-                   int yScan,
-                   int direction)
-{
-    int  oldLeftSide, oldRightSide;
-    int  penY;
-    uint base;
+    right = CheckRight(s_penX, base);
+    left  = CheckLeft(s_penX, base) + 1;
+    FillLines(base, left, right);
 
-    oldRightSide = rightSide;
-    oldLeftSide  = leftSide;
-
-    base      = SetBase();
-    rightSide = CheckRight(s_penX, base);    // returns right end of scan
-    leftSide  = CheckLeft(s_penX, base) + 1; // returns left end of scan
-
-    // Line ends have been found, fill line between end points.
-    FillLines(base, leftSide, rightSide);
-
-    // Now we scan above while xScan < rightSide.
-    penY = s_penY;
-    FillUp(leftSide,
-           leftSide,
-           rightSide,
-           oldLeftSide,
-           oldRightSide,
-           penY,
-           direction);
-
-    // Scan to left on bottom of line.
-    FillDown(leftSide,
-             leftSide,
-             rightSide,
-             oldLeftSide,
-             oldRightSide,
-             penY,
-             direction);
-
-    if (direction == DN) {
-        FillDown(rightSide,
-                 oldLeftSide,
-                 oldRightSide,
-                 prevLeftSide,
-                 prevRightSide,
-                 yScan,
-                 direction);
-    } else if (direction == UP) {
-        FillUp(rightSide,
-               oldLeftSide,
-               oldRightSide,
-               prevLeftSide,
-               prevRightSide,
-               yScan,
-               direction);
-    }
-}
-
-static void FillUp(int xScan,
-                   int leftSide,
-                   int rightSide,
-                   int oldLeftSide,
-                   int oldRightSide,
-                   int yScan,
-                   int direction)
-{
-    uint base;
+    s_fillDepth = 0;
+    PushFillSpan(s_penY - 1, left, right, -1);
+    PushFillSpan(s_penY + 1, left, right, 1);
 
-    // Look above this line for holes.
-    s_penY = yScan - 1;
+    while (s_fillDepth != 0) {
+        span = s_fillStack[--s_fillDepth];
+        base = g_baseTable[span.y];
 
-    // If the next line up is off the top of the port, it's time to start
-    // looking down.
-    if (s_penY < g_theRect.top) {
-        return;
-    }
+        // Fill the spans touching the one the line was added for.
+        for (x = span.left; x < span.right; x = right) {
+            x = SkipRight(x, span.right, base);
+            if (x >= span.right) {
+                break;
+            }
 
-    base = SetBase();
-    do {
-        s_penX = xScan;
+            right = CheckRight(x, base);
+            left  = CheckLeft(x, base) + 1;
+            FillLines(base, left, right);
 
-        while (true) {
-            int x = xScan;
-            if (xScan >= rightSide) {
-                return;
+            // Scan on in the same direction. The other way, the span the line
+            // was added for is already filled; only look past its ends.
+            PushFillSpan(span.y + span.dir, left, right, span.dir);
+            if (left < span.left) {
+                PushFillSpan(span.y - span.dir, left, span.left, -span.dir);
             }
-            xScan++;
-
-            if (!(direction == DN && oldLeftSide < x && x < oldRightSide)) {
-                break;
+            if (right > span.right) {
+                PushFillSpan(span.y - span.dir, span.right, right, -span.dir);
             }
-
-            // We're in between so we swap them.
-            xScan = oldRightSide;
         }
-    } while (!CheckDot(s_penX, base));
-
-    DoFill(xScan, leftSide, rightSide, oldLeftSide, oldRightSide, yScan, UP);
+    }
 }
 
-static void FillDown(int xScan,
-                     int leftSide,
-                     int rightSide,
-                     int oldLeftSide,
-                     int oldRightSide,
-                     int yScan,
-                     int direction)
+// Add a line to be scanned for unfilled dots by Fill, between left and right.
+static void PushFillSpan(int y, int left, int right, int dir)
 {
-    uint base;
-
-    s_penY = yScan + 1;
+    FillSpan *stack;
+    uint      size;
 
-    // If the next line down is off the bottom of the port, it's time to start
-    // returning from the recursion.
-    if (s_penY >= g_theRect.bottom) {
+    if (dir < 0 ? (y < g_theRect.top) : (y >= g_theRect.bottom)) {
         return;
     }
 
-    base = SetBase();
-    do {
-        s_penX = xScan;
-
-        while (true) {
-            int x = xScan;
-            if (xScan >= rightSide) {
-                return;
-            }
-            xScan++;
-
-            if (!(direction == UP && oldLeftSide < x && x < oldRightSide)) {
-                break;
-            }
-
-            xScan = oldRightSide;
+    if (s_fillDepth == s_fillStackSize) {
+        size  = (s_fillStackSize != 0) ? (s_fillStackSize * 2) : 256;
+        stack = (FillSpan *)realloc(s_fillStack, size * sizeof(FillSpan));
+        if (stack == NULL) {
+            Panic(E_NO_MEMORY);
         }
-    } while (!CheckDot(s_penX, base));
+        s_fillStack     = stack;
+        s_fillStackSize = size;
+    }
 
-    DoFill(xScan, leftSide, rightSide, oldLeftSide, oldRightSide, yScan, DN);
+    s_fillStack[s_fillDepth].y     = (int16_t)y;
+    s_fillStack[s_fillDepth].left  = (int16_t)left;
+    s_fillStack[s_fillDepth].right = (int16_t)right;
+    s_fillStack[s_fillDepth].dir   = (int16_t)dir;
+    ++s_fillDepth;
 }
 
 // Check for an unfilled point in Fill.
@@ -1347,48 +1393,29 @@ static bool CheckDot(int penX, uint lineBase)
         return false;
     }
 
-    if ((s_mapSet & VMAP) != 0) {
-        return (g_vHndl[lineBase + penX] == vWHITE);
-    }
-
-    if ((s_mapSet & PMAP) != 0) {
-        return ((g_pcHndl[lineBase + penX] & EVENON) == 0);
-    }
-
-    return ((g_pcHndl[lineBase + penX] & ODDON) == 0);
+    return GuideClear(s_guideMap[lineBase + penX]);
 }
 
 // Scans right from penX/Y returning X of first collision.
 static int CheckRight(int left, uint lineBase)
 {
-    uint8_t *vMap;
-    int      right;
+    const uint8_t *line = s_guideMap + lineBase;
+    int            right;
+    uint64_t       word;
 
-    // Scan full bytes for deviation.
     right = (int)g_theRect.right;
-    lineBase += (uint)left;
-
-    if ((s_mapSet & VMAP) != 0) {
-        vMap = g_vHndl + lineBase;
-        for (; left < right; ++left, ++vMap) {
-            if (*vMap != vWHITE) {
-                break;
-            }
-        }
-    } else {
-        uint8_t mask;
 
-        if ((s_mapSet & PMAP) != 0) {
-            mask = EVENON;
-        } else {
-            mask = ODDON;
+    // Skip whole words of unfilled dots.
+    for (; left + 8 <= right; left += 8) {
+        memcpy(&word, line + left, sizeof(word));
+        if (((word ^ s_guideXor) & s_guideMask) != 0) {
+            break;
         }
+    }
 
-        vMap = g_pcHndl + lineBase;
-        for (; left < right; ++left, ++vMap) {
-            if ((*vMap & mask) != 0) {
-                break;
-            }
+    for (; left < right; ++left) {
+        if (!GuideClear(line[left])) {
+            break;
         }
     }
 
@@ -1398,38 +1425,50 @@ static int CheckRight(int left, uint lineBase)
 // Scans left from penX/Y returning X of first collision.
 static int CheckLeft(int right, uint lineBase)
 {
-    uint8_t *vMap;
-    int      left;
+    const uint8_t *line = s_guideMap + lineBase;
+    int            left;
+    uint64_t       word;
 
-    // Scan full bytes for deviation.
     left = (int)g_theRect.left;
-    lineBase += (uint)right;
 
-    if ((s_mapSet & VMAP) != 0) {
-        vMap = g_vHndl + lineBase;
-        for (; left <= right; --right, --vMap) {
-            if (*vMap != vWHITE) {
-                break;
-            }
+    for (; right - 7 >= left; right -= 8) {
+        memcpy(&word, line + right - 7, sizeof(word));
+        if (((word ^ s_guideXor) & s_guideMask) != 0) {
+            break;
         }
-    } else {
-        uint8_t mask;
+    }
 
-        if ((s_mapSet & PMAP) != 0) {
-            mask = EVENON;
-        } else {
-            mask = ODDON;
+    for (; left <= right; --right) {
+        if (!GuideClear(line[right])) {
+            break;
         }
+    }
 
-        vMap = g_pcHndl + lineBase;
-        for (; left <= right; --right, --vMap) {
-            if ((*vMap & mask) != 0) {
-                break;
-            }
+    return right;
+}
+
+// Scans right from left to right returning X of the first unfilled dot, or
+// right if there is none.
+static int SkipRight(int left, int right, uint lineBase)
+{
+    const uint8_t *line = s_guideMap + lineBase;
+    uint64_t       word;
+
+    // Skip whole words without an unfilled dot.
+    for (; left + 8 <= right; left += 8) {
+        memcpy(&word, line + left, sizeof(word));
+        if (HasZeroByte((word ^ s_guideXor) & s_guideMask)) {
+            break;
         }
     }
 
-    return right;
+    for (; left < right; ++left) {
+        if (GuideClear(line[left])) {
+            break;
+        }
+    }
+
+    return left;
 }
 
 // Erase all VMAPS to background color.
@@ -1705,6 +1744,7 @@ static void DoBitMap(void)
     }
     priority &= s_picOverlayMask;
 
+    NotePicBitMap();
     DrawBitMap(s_lineStartX, s_lineStartY, s_mirrorX, cel, priority, s_palPtr);
 }
 
@@ -1717,6 +1757,7 @@ static void SetCLUTPalette(void)
     // Advance picPtr past embedded palette data;
     s_picPtr += PAL_FILE_SIZE;
 
+    NotePicPalette(s_palPtr);
     RSetPalette(s_palPtr, PAL_REPLACE);
 }
 
@@ -1729,6 +1770,7 @@ static void SetPriTable(void)
     y = ((int16_t *)s_picPtr)[1];
     s_picPtr += sizeof(uint16_t) * 2;
 
+    NotePicPriTable(x, y);
     PriTable(x, y);
 }
 
@@ -1738,6 +1780,7 @@ static void SetPriBands(void)
     uint16_t *priPtr = (uint16_t *)s_picPtr;
     s_picPtr += 14;
 
+    NotePicPriBands(priPtr);
     PriBands(priPtr);
 }
 
@@ -1879,19 +1922,15 @@ static void DrawVLine(void)
             g_vHndl[base] = s_vColor;
         }
 
-        if ((s_mapSet & PMAP) != 0) {
-            g_pcHndl[base] &= EVENOFF;
-            g_pcHndl[base] |= s_pColor;
-        }
-
-        if ((s_mapSet & CMAP) != 0) {
-            g_pcHndl[base] &= ODDOFF;
-            g_pcHndl[base] |= s_cColor;
+        if (s_pcMask != 0) {
+            g_pcHndl[base] =
+              (uint8_t)((g_pcHndl[base] & ~s_pcMask) | s_pcBits);
         }
 
         // Move to next line down.
         base += VROWBYTES;
     }
+    NoteMapRows(s_mapSet, top, bottom + 1);
 }
 
 // Determine X/Y vector (direction of change) and pseudo fractional delta.
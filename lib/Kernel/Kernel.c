@@ -1,5 +1,7 @@
 #include "sci/Kernel/Kernel.h"
 #include "sci/Kernel/Animate.h"
+#include "sci/Kernel/Avoid.h"
+#include "sci/Kernel/CastGrid.h"
 #include "sci/Kernel/Cels.h"
 #include "sci/Kernel/Dialog.h"
 #include "sci/Kernel/Event.h"
@@ -7,7 +9,9 @@
 #include "sci/Kernel/Graphics.h"
 #include "sci/Kernel/Menu.h"
 #include "sci/Kernel/Mouse.h"
+#include "sci/Kernel/Parse.h"
 #include "sci/Kernel/Picture.h"
+#include "sci/Kernel/Prefetch.h"
 #include "sci/Kernel/Resource.h"
 #include "sci/Kernel/SaveGame.h"
 #include "sci/Kernel/Selector.h"
@@ -18,6 +22,7 @@
 #include "sci/Utils/FileIO.h"
 #include "sci/Utils/Format.h"
 #include "sci/Utils/Path.h"
+#include "sci/Utils/Sort.h"
 #include "sci/Utils/Timer.h"
 #include "sci/Utils/Trig.h"
 #include <time.h>
@@ -56,6 +61,14 @@
 // Function code for PriCoord operation.
 #define PTopOfBand 1
 
+// Function codes for Memory operations.
+#define MNeedPtr    1
+#define MNewPtr     2
+#define MDisposePtr 3
+#define MCopy       4
+#define MReadWord   5
+#define MWriteWord  6
+
 // SortNode used in Sort
 typedef struct SortNode {
     Obj     *sortObject;
@@ -64,10 +77,24 @@ typedef struct SortNode {
 
 #define ret(val) *acc = ((uintptr_t)(val))
 
+// Load is only a hint that the resource will soon be needed: it is loaded in
+// the background, and claimed by ResLoad() when it is used.
 void KLoad(argList)
 {
-    Handle h = ResLoad((int)arg(1), (uint)arg(2));
-    ret(h);
+    LoadLink *scan;
+
+    if ((int)arg(1) == RES_MEM) {
+        ret(ResLoad((int)arg(1), (uint)arg(2)));
+        return;
+    }
+
+    scan = FindResEntry((int)arg(1), (size_t)arg(2));
+    if (scan != NULL) {
+        ret(scan->data);
+    } else {
+        ResLoadAsync((int)arg(1), (size_t)arg(2));
+        ret(0);
+    }
 }
 
 void KUnLoad(argList)
@@ -165,11 +192,11 @@ void KDrawPic(argList)
     if (!RFrontWindow(g_picWind)) {
         RBeginUpdate(g_picWind);
         // g_showPicStyle contains mirroring bits.
-        DrawPic(ResLoad(RES_PIC, arg(1)), clear, g_showPicStyle);
+        DrawPic(ResLoad(RES_PIC, arg(1)), (uint)arg(1), clear, g_showPicStyle);
 
         REndUpdate(g_picWind);
     } else {
-        DrawPic(ResLoad(RES_PIC, arg(1)), clear, g_showPicStyle);
+        DrawPic(ResLoad(RES_PIC, arg(1)), (uint)arg(1), clear, g_showPicStyle);
         g_picNotValid = 1;
     }
 
@@ -633,25 +660,67 @@ void KMapKeyToDir(argList)
     ret(sciEvent);
 }
 
+// Parse the input into the sentence matched by Said(), and return TRUE if it
+// makes one. Otherwise the event is claimed, and the game told of the word
+// it doesn't know, or of the sentence it doesn't understand.
 void KParse(argList)
 {
-#ifndef NOT_IMPL
-#error Not finished
-#endif
+    char        badWord[MAXWORDLEN + 1];
+    const char *input = (const char *)arg(1);
+    Obj        *event = (Obj *)arg(2);
+    int         result;
+
+    result = ParseInput(input, badWord);
+
+    IndexedProp(event, evClaimed) = result != PARSE_OK;
+    if (result == PARSE_BADWORD) {
+        InvokeMethod(g_theGameObj,
+                     s_wordFail,
+                     2,
+                     (uintptr_t)badWord,
+                     (uintptr_t)input);
+    } else if (result == PARSE_BADORDER) {
+        InvokeMethod(g_theGameObj, s_syntaxFail, 1, (uintptr_t)input);
+    }
+    ret(result == PARSE_OK);
 }
 
+// Return TRUE if the sentence matches the said spec, claiming the sentence
+// unless the spec lets it go on. The claim is the parser's: no event is kept
+// from Parse(), as it may be disposed of before the next Said().
 void KSaid(argList)
 {
-#ifndef NOT_IMPL
-#error Not finished
-#endif
+    int result;
+
+    if (SentenceClaimed()) {
+        ret(false);
+        return;
+    }
+
+    result = MatchSaid((const byte *)arg(1));
+    if (result == SAID_MATCH) {
+        ClaimSentence();
+    }
+    ret(result != SAID_NOMATCH);
 }
 
+// Use the synonyms of the scripts of the regions and room in the elements of
+// the object.
 void KSetSynonyms(argList)
 {
-#ifndef NOT_IMPL
-#error Not finished
-#endif
+    List   *elements;
+    Node   *node;
+    Script *script;
+
+    ClearSynonyms();
+    elements = (List *)GetProperty((Obj *)arg(1), s_elements);
+    for (node = FirstNode(elements); node != NULL; node = NextNode(node)) {
+        script = ScriptPtr(
+          (uint)GetProperty((Obj *)((KNode *)node)->nVal, s_number));
+        if (script != NULL && script->synonyms != NULL) {
+            AddSynonyms((const SegHeader *)script->synonyms);
+        }
+    }
 }
 
 void KNewList(argList)
@@ -669,6 +738,7 @@ void KDisposeList(argList)
     Node *kNode;
 
     list = (List *)arg(1);
+    CastListChanged(list);
 
     while (!EmptyList(list)) {
         kNode = FirstNode(list);
@@ -729,6 +799,7 @@ void KAddAfter(argList)
     if (argCount == 4) {
         SetKey((Node *)arg(3), (intptr_t)arg(4));
     }
+    CastListChanged((List *)arg(1));
     ret(node);
 }
 
@@ -738,6 +809,7 @@ void KAddToFront(argList)
     if (argCount == 3) {
         SetKey((Node *)arg(2), (intptr_t)arg(3));
     }
+    CastListChanged((List *)arg(1));
     ret(node);
 }
 
@@ -747,6 +819,7 @@ void KAddToEnd(argList)
     if (argCount == 3) {
         SetKey((Node *)arg(2), (intptr_t)arg(3));
     }
+    CastListChanged((List *)arg(1));
     ret(node);
 }
 
@@ -762,6 +835,7 @@ void KDeleteKey(argList)
 
     theNode = DeleteKey((List *)arg(1), (intptr_t)arg(2));
     if (theNode != NULL) {
+        CastListChanged((List *)arg(1));
         free(theNode);
     }
     ret(theNode != NULL);
@@ -873,6 +947,8 @@ void KWait(argList)
 
     ticks = (uint)arg(1);
 
+    FlushBits();
+
 #if 0
     if (ticks != 0)
     {
@@ -1101,11 +1177,19 @@ void KOnControl(argList)
     RSetPort(oldPort);
 }
 
+// AvoidPath(x, y, polygon) returns TRUE if the point is in the polygon.
+// AvoidPath(x1, y1, x2, y2, polygonList[, opt]) returns a path from the first
+// point to the second around the polygons of the list, which the caller
+// disposes of with Memory(MDisposePtr). The path found is always the
+// shortest, so the optimization level 'opt' is ignored.
 void KAvoidPath(argList)
 {
-#ifndef NOT_IMPL
-#error Not finished
-#endif
+    if (argCount == 3) {
+        ret(InPolygon((int)arg(1), (int)arg(2), (Obj *)arg(3)));
+    } else {
+        ret(AvoidPath((int)arg(1), (int)arg(2), (int)arg(3), (int)arg(4),
+                      (List *)arg(5)));
+    }
 }
 
 void KSetDebug(argList)
@@ -1225,18 +1309,50 @@ void KMemorySegment(argList)
 #endif
 }
 
+// Return the number of edges of the polygons of a list crossed by the segment
+// from (x1,y1) to (x2,y2).
 void KIntersections(argList)
 {
-#ifndef NOT_IMPL
-#error Not finished
-#endif
+    ret(Intersections(
+      (int)arg(1), (int)arg(2), (int)arg(3), (int)arg(4), (List *)arg(5)));
 }
 
+// Memory(MNeedPtr, size) and Memory(MNewPtr, size) allocate a block, the
+// first failing with an error and the second returning NULL. The blocks, and
+// those the kernel hands to the scripts (such as the paths of AvoidPath()),
+// are disposed of with Memory(MDisposePtr, ptr). A word is a variable of the
+// scripts, as wide as a pointer.
 void KMemory(argList)
 {
-#ifndef NOT_IMPL
-#error Not finished
-#endif
+    void *ptr;
+
+    switch ((int)arg(1)) {
+        case MNeedPtr:
+        case MNewPtr:
+            ptr = malloc((size_t)arg(2));
+            if (ptr == NULL && arg(1) == MNeedPtr) {
+                Panic(E_NO_MEMORY);
+            }
+            ret(ptr);
+            break;
+
+        case MDisposePtr:
+            free((void *)arg(2));
+            break;
+
+        case MCopy:
+            memmove((void *)arg(2), (const void *)arg(3), (size_t)arg(4));
+            ret(arg(2));
+            break;
+
+        case MReadWord:
+            ret(*(uintptr_t *)arg(2));
+            break;
+
+        case MWriteWord:
+            *(uintptr_t *)arg(2) = arg(3);
+            break;
+    }
 }
 
 void KListOps(argList)
@@ -1340,23 +1456,12 @@ void KFileIO(argList)
     }
 }
 
-// A simple bubble sort.
-static void bsort(SortNode *theList, uint size)
+static int CompareSortNodes(const void *a, const void *b)
 {
-    int      i, j;
-    SortNode tmp;
+    intptr_t keyA = ((const SortNode *)a)->sortKey;
+    intptr_t keyB = ((const SortNode *)b)->sortKey;
 
-    size--;
-    for (i = 0; i < (int)size; i++) {
-        for (j = (int)size; j > i; j--) {
-            if (theList[j].sortKey < theList[j - 1].sortKey) {
-                // Swap.
-                tmp            = theList[j];
-                theList[j]     = theList[j - 1];
-                theList[j - 1] = tmp;
-            }
-        }
-    }
+    return keyA < keyB ? -1 : keyA > keyB ? 1 : 0;
 }
 
 void KSort(argList)
@@ -1374,19 +1479,27 @@ void KSort(argList)
     retList = (Obj *)arg(2);
     size    = (uint)GetProperty((Obj *)arg(1), s_size);
     if (size != 0) {
-        sortArray = (SortNode *)malloc(size * sizeof(SortNode));
+        // With room for the scratch space of the sort.
+        sortArray = (SortNode *)malloc((size + size / 2) * sizeof(SortNode));
+        if (sortArray == NULL) {
+            Panic(E_NO_MEMORY);
+        }
 
         // Set the keys for each SortNode based on passed scoring function.
-        for (it = FirstNode(theList), i = 0; it != NULL;
+        // The list may hold more elements than the collection's size says.
+        for (it = FirstNode(theList), i = 0; it != NULL && i < size;
              i++, it = NextNode(it)) {
             him = (Obj *)(FromNode(it, KNode)->nVal);
             sortArray[i].sortObject = him;
             sortArray[i].sortKey =
               (intptr_t)InvokeMethod(him, s_perform, 1, arg(3));
         }
+        size = i;
 
-        // The actual sort.
-        bsort(sortArray, size);
+        // The actual sort, which keeps equal keys in their order as the
+        // bubble sort it replaces did.
+        StableSort(
+          sortArray, size, sizeof(SortNode), CompareSortNodes, sortArray + size);
 
         retKList = (List *)malloc(sizeof(List));
         InitList(retKList);
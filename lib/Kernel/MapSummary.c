@@ -0,0 +1,126 @@
+#include "sci/Kernel/MapSummary.h"
+#include "sci/Kernel/Graphics.h"
+
+// The maps summarized: the control map in the low nibble, the priority map in
+// the high one.
+#define SUMCONTROL  0
+#define SUMPRIORITY 1
+
+#define Nibble(pixel, map)                                                     \
+    ((map) == SUMPRIORITY ? (uint)(pixel) >> 4 : (uint)(pixel) & 0x0f)
+
+static uint16_t s_blocks[2][MAXHEIGHT][SUMBLOCKS];
+static uint16_t s_rows[2][MAXHEIGHT];
+static uint8_t  s_changed[2][MAXHEIGHT];
+
+static MapSummaryStats s_stats;
+
+static void SummarizeRow(uint map, int row);
+static uint ScanPixels(uint map, const uint8_t *pixels, int count);
+
+void InitMapSummary(void)
+{
+    NoteMapRows(PMAP | CMAP, 0, MAXHEIGHT);
+}
+
+void NoteMapRows(uint mapSet, int top, int bottom)
+{
+    top    = max(top, 0);
+    bottom = min(bottom, MAXHEIGHT);
+    if (top >= bottom) {
+        return;
+    }
+
+    if ((mapSet & CMAP) != 0) {
+        memset(&s_changed[SUMCONTROL][top], 1, (size_t)(bottom - top));
+    }
+    if ((mapSet & PMAP) != 0) {
+        memset(&s_changed[SUMPRIORITY][top], 1, (size_t)(bottom - top));
+    }
+}
+
+uint MapsDiffer(const uint8_t *pcMap, const uint8_t *bits, uint count)
+{
+    uint differ = 0;
+    uint i;
+
+    for (i = 0; i < count; ++i) {
+        differ |= pcMap[i] ^ bits[i];
+    }
+
+    return ((differ & 0xf0) != 0 ? PMAP : 0) |
+           ((differ & 0x0f) != 0 ? CMAP : 0);
+}
+
+uint SummarizeMap(uint mapSet, const RRect *rect)
+{
+    const uint16_t *blocks;
+    const uint8_t  *pixels;
+    uint            map = (mapSet & PMAP) != 0 ? SUMPRIORITY : SUMCONTROL;
+    uint            mask = 0;
+    int             first, last, row, b;
+
+    ++s_stats.queries;
+
+    // The blocks wholly inside the rectangle.
+    first = (rect->left + SUMBLOCK - 1) / SUMBLOCK;
+    last  = rect->right / SUMBLOCK;
+
+    for (row = rect->top; row < rect->bottom; ++row) {
+        if (s_changed[map][row]) {
+            SummarizeRow(map, row);
+        }
+
+        // Nothing more to find in this row.
+        if ((s_rows[map][row] & ~mask) == 0) {
+            continue;
+        }
+
+        pixels = g_pcHndl + g_baseTable[row];
+        if (first >= last) {
+            mask |= ScanPixels(map, pixels + rect->left, rect->right - rect->left);
+            continue;
+        }
+
+        mask |= ScanPixels(map, pixels + rect->left, first * SUMBLOCK - rect->left);
+        blocks = s_blocks[map][row];
+        for (b = first; b < last; ++b) {
+            mask |= blocks[b];
+        }
+        mask |= ScanPixels(
+          map, pixels + last * SUMBLOCK, rect->right - last * SUMBLOCK);
+    }
+    return mask;
+}
+
+void GetMapSummaryStats(MapSummaryStats *stats)
+{
+    *stats = s_stats;
+}
+
+static void SummarizeRow(uint map, int row)
+{
+    const uint8_t *pixels = g_pcHndl + g_baseTable[row];
+    uint16_t      *blocks = s_blocks[map][row];
+    uint           rowMask = 0;
+    int            b;
+
+    for (b = 0; b < SUMBLOCKS; ++b) {
+        blocks[b] = (uint16_t)ScanPixels(map, pixels + b * SUMBLOCK, SUMBLOCK);
+        rowMask |= blocks[b];
+    }
+    s_rows[map][row]    = (uint16_t)rowMask;
+    s_changed[map][row] = 0;
+    ++s_stats.rows;
+}
+
+static uint ScanPixels(uint map, const uint8_t *pixels, int count)
+{
+    uint mask = 0;
+    int  i;
+
+    for (i = 0; i < count; ++i) {
+        mask |= 1U << Nibble(pixels[i], map);
+    }
+    return mask;
+}
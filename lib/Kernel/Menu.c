@@ -558,6 +558,7 @@ static uint MouseSelect(void)
     // Start with none selected.
     item = menu = 0;
     do {
+        FlushBits();
         PollInputEvent();
         RGetMouse(&mp);
         if (RPtInRect(&mp, &s_theMenuBar->bar)) {
@@ -7,6 +7,8 @@
 #if defined(__IOS__)
 #include "sci/Utils/Timer.h"
 #include <mach/mach_time.h>
+#elif defined(__LINUX__)
+#include <time.h>
 #endif
 
 #ifdef PlaySound
@@ -2373,6 +2375,26 @@ static void CALLBACK TimerCallback(UINT      uTimerID,
     SoundServer();
 }
 
+#elif defined(__LINUX__)
+
+void *TimerThread(void *argument)
+{
+    struct timespec next;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (true) {
+        next.tv_nsec += 15625000;
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            ++next.tv_sec;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &next);
+        SoundServer();
+    }
+    return NULL;
+}
+
 #else
 
 void *TimerThread(void *argument)
@@ -1,5 +1,6 @@
 #include "sci/Kernel/Motion.h"
 #include "sci/Kernel/Animate.h"
+#include "sci/Kernel/CastGrid.h"
 #include "sci/Kernel/Cels.h"
 #include "sci/Kernel/Graphics.h"
 #include "sci/Kernel/Picture.h"
@@ -30,6 +31,7 @@ void KBaseSetter(argList)
     IndexedProp(actor, actBRBottom) = (uintptr_t)theY;
     IndexedProp(actor, actBR) =
       (uintptr_t)(theY - (int)IndexedProp(actor, actYStep));
+    NoteActorBase(actor);
 }
 
 void KDirLoop(argList)
@@ -248,15 +250,16 @@ void KCantBeHere(argList)
 {
     Obj       *him  = (Obj *)arg(1);
     List      *cast = (List *)arg(2);
-    Node      *node;
-    Obj       *me;
-    RRect      r, chkR;
+    RRect      r;
     RGrafPort *oldPort;
 
     RGetPort(&oldPort);
     RSetPort(&g_picWind->port);
     RectFromNative(IndexedPropAddr(him, actBR), &r);
 
+    // Whatever set my rectangle, the others will look for it where it is.
+    NoteActorBase(him);
+
     //
     // (s_illegalBits) are the bits that the object cannot be on.
     // Anding this with the bits the object is on tells us which
@@ -269,35 +272,9 @@ void KCantBeHere(argList)
         // Controls were legal, do I care about other actors?
         // If I am hidden or ignoring actors my position is legal 8.
         if ((IndexedProp(him, actSignal) & (ignrAct | HIDDEN)) == 0) {
-            // Default to no hits.
-            *acc = 0;
-            // Now the last thing we care about is our rectangles.
-            for (node = FirstNode(cast); node != NULL; node = NextNode(node)) {
-                me = (Obj *)((KNode *)node)->nVal;
-
-                // Can't hit myself.
-                if (him == me) {
-                    continue;
-                }
-
-                // Can't hit if I'm as below.
-                if ((IndexedProp(me, actSignal) &
-                     (NOUPDATE | ignrAct | HIDDEN)) != 0) {
-                    continue;
-                }
-
-                // Check method from actor.
-
-                // If our rectangles intersect we are done.
-                RectFromNative(IndexedPropAddr(me, actBR), &chkR);
-                if (r.left >= chkR.right || r.right <= chkR.left ||
-                    r.top >= chkR.bottom || r.bottom <= chkR.top) {
-                    continue;
-                } else {
-                    *acc = (uintptr_t)me;
-                    break;
-                }
-            }
+            // Now the last thing we care about is our rectangles: the first
+            // actor of the cast whose rectangle meets ours, if any.
+            *acc = (uintptr_t)FindBaseHit(cast, him, &r);
         }
     }
 
@@ -1,4 +1,5 @@
 #include "sci/Kernel/Palette.h"
+#include "sci/Kernel/ColorMatch.h"
 #include "sci/Kernel/Graphics.h"
 #include "sci/Kernel/Picture.h"
 #include "sci/Kernel/Resource.h"
@@ -20,6 +21,9 @@ static void InsertPalette(RPalette *srcPal, RPalette *dstPal, int mode);
 // Given R/G/B values, returns the index of this color.
 static uint Match(const Guns *theGun, const RPalette *pal, int leastDist);
 
+// Note a change to entries first to last - 1 of a palette.
+static void GunsChanged(const RPalette *pal, uint first, uint last);
+
 static void ResetPaletteFlags(RPalette *pal,
                               uint      first,
                               uint      last,
@@ -46,6 +50,7 @@ void InitPalette(void)
     g_sysPalette.gun[255].g     = 255;
     g_sysPalette.gun[255].b     = 255;
     g_sysPalette.gun[255].flags = PAL_IN_USE;
+    SysColorsChanged(0, PAL_CLUT_SIZE);
 
     SetResPalette(999, PAL_REPLACE);
 }
@@ -130,6 +135,7 @@ static void InsertPalette(RPalette *srcPal, RPalette *dstPal, int mode)
         if (mode == PAL_REPLACE) {
             dstPal->valid  = valid;
             dstPal->gun[i] = srcPal->gun[i];
+            GunsChanged(dstPal, (uint)i, (uint)i + 1);
             continue;
         }
 
@@ -137,6 +143,7 @@ static void InsertPalette(RPalette *srcPal, RPalette *dstPal, int mode)
         if ((dstPal->gun[i].flags & PAL_IN_USE) == 0) {
             dstPal->valid  = valid;
             dstPal->gun[i] = srcPal->gun[i];
+            GunsChanged(dstPal, (uint)i, (uint)i + 1);
             continue;
         }
 
@@ -152,6 +159,7 @@ static void InsertPalette(RPalette *srcPal, RPalette *dstPal, int mode)
 
                 dstPal->valid       = valid;
                 dstPal->gun[iMatch] = srcPal->gun[i];
+                GunsChanged(dstPal, iMatch, iMatch + 1);
                 break;
             }
         }
@@ -166,10 +174,20 @@ static void InsertPalette(RPalette *srcPal, RPalette *dstPal, int mode)
 
 static uint Match(const Guns *theGun, const RPalette *pal, int leastDist)
 {
+    if (pal == &g_sysPalette) {
+        return MatchSysColor(theGun->r, theGun->g, theGun->b, (uint)leastDist);
+    }
     return FastMatch(
       pal, theGun->r, theGun->g, theGun->b, PAL_CLUT_SIZE, (uint)leastDist);
 }
 
+static void GunsChanged(const RPalette *pal, uint first, uint last)
+{
+    if (pal == &g_sysPalette) {
+        SysColorsChanged(first, last);
+    }
+}
+
 static void ResetPaletteFlags(RPalette *pal,
                               uint      first,
                               uint      last,
@@ -184,6 +202,7 @@ static void ResetPaletteFlags(RPalette *pal,
         //
         pal->gun[i].flags &= ~flags;
     }
+    GunsChanged(pal, first, last);
 }
 
 static void SetPaletteFlags(RPalette *pal, uint first, uint last, uint8_t flags)
@@ -193,6 +212,7 @@ static void SetPaletteFlags(RPalette *pal, uint first, uint last, uint8_t flags)
     for (i = first; i < last; i++) {
         pal->gun[i].flags |= flags;
     }
+    GunsChanged(pal, first, last);
 }
 
 void KPalette(argList)
@@ -287,6 +307,8 @@ void KPalette(argList)
                         }
                         g_sysPalette.gun[index] = aGun;
                     }
+                    SysColorsChanged((uint)max((int)start, 0),
+                                     (uint)arg(count + 1));
                 }
             }
             // Actually set the palette.
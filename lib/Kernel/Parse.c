@@ -0,0 +1,1025 @@
+#include "sci/Kernel/Parse.h"
+#include "sci/Kernel/ResSource.h"
+#include "sci/Kernel/Resource.h"
+#include "sci/Utils/ErrMsg.h"
+#include "sci/Utils/Sort.h"
+
+#define LETTERS     26  // entries of the index of the words
+#define MAXINPUT    20  // words of an input
+#define MAXMEANINGS 4   // meanings kept of a word
+#define MAXMODS     4   // words modifying a phrase
+#define MAXNESTING  16  // of the groupings of a spec
+#define MAXSPEC     256 // bytes of a spec outside the said specs of a script
+
+#define VERBS (WC_INDICATIVE | WC_IMPERATIVE)
+#define NOUNS (WC_NOUN | WC_PRONOUN | WC_NUMBER)
+
+// Phrases of a sentence.
+#define VERB     0
+#define DIRECT   1
+#define INDIRECT 2
+#define NPHRASES 3
+
+// Nodes of the matchers, each followed by the nodes under it.
+#define SN_SPEC 0 // the phrases of a spec
+#define SN_PART 1 // a phrase, then its expression if it has one
+#define SN_ALT  2 // its terms, either of which
+#define SN_TERM 3 // a word or expression, then its modifiers
+#define SN_WORD 4 // a group
+
+// What the phrase of a spec asks of the sentence.
+#define PART_NONE  0 // nothing there
+#define PART_ANY   1 // anything
+#define PART_MATCH 2 // a match of the expression
+
+// Flags of a spec.
+#define SPEC_PARTIAL 1
+#define SPEC_BAD     2
+
+typedef struct Meaning {
+    uint16_t classes;
+    uint16_t group;
+} Meaning;
+
+// The words that start with the letters on the way to a node.
+typedef struct TrieNode {
+    uint32_t kids;     // first child, the children in the order of letters
+    uint32_t meanings; // first meaning of the word ending here
+    uint8_t  numKids;
+    uint8_t  numMeanings;
+    uint8_t  letter;
+} TrieNode;
+
+// A word of the vocabulary, while the trie is built.
+typedef struct VocabWord {
+    uint    text; // in s_text
+    Meaning meaning;
+} VocabWord;
+
+typedef struct Suffix {
+    char     from[8]; // ending of the word typed
+    char     to[8];   // ending of the word in the vocabulary
+    uint8_t  fromLen;
+    uint8_t  toLen;
+    uint16_t classes; // of the word typed
+    uint16_t mask;    // one of which the word in the vocabulary must have
+} Suffix;
+
+typedef struct Token {
+    uint16_t classes; // of all its meanings
+    uint8_t  numMeanings;
+    Meaning  meanings[MAXMEANINGS];
+} Token;
+
+typedef struct Phrase {
+    int      head; // group, or -1
+    uint     numMods;
+    uint16_t mods[MAXMODS];
+} Phrase;
+
+typedef struct Synonym {
+    uint16_t from;
+    uint16_t to;
+} Synonym;
+
+typedef struct SaidNode {
+    uint8_t  type;
+    uint8_t  opt;  // may be left out
+    uint16_t word; // group of a word, mode of a part, flags of a spec
+    uint32_t size; // nodes of the subtree, this one included
+} SaidNode;
+
+// The matchers of the said specs of a script.
+typedef struct SaidTable {
+    uint32_t *specs; // first node of the spec at each offset, + 1, or 0
+    SaidNode *nodes;
+} SaidTable;
+
+static bool      s_vocabRead = false;
+static TrieNode *s_trie      = NULL;
+static Meaning  *s_meanings  = NULL;
+static Suffix   *s_suffixes  = NULL;
+static uint      s_numTrie   = 0;
+static uint      s_numSuffix = 0;
+
+// The vocabulary while it is read.
+static VocabWord *s_words    = NULL;
+static char      *s_text     = NULL;
+static uint       s_numWords = 0;
+static uint       s_maxWords = 0;
+static uint       s_textSize = 0;
+static uint       s_maxText  = 0;
+
+static Synonym *s_synonyms   = NULL;
+static uint     s_numSynonym = 0;
+static uint     s_maxSynonym = 0;
+
+static Phrase s_sentence[NPHRASES];
+static bool   s_haveSentence = false;
+static bool   s_claimed      = false;
+
+// The matchers being compiled, and the spec they are compiled from.
+static SaidNode   *s_nodes    = NULL;
+static uint        s_numNodes = 0;
+static uint        s_maxNodes = 0;
+static const byte *s_spec     = NULL;
+static const byte *s_specEnd  = NULL;
+static uint        s_nesting  = 0;
+static bool        s_specBad  = false;
+
+static ParseStats s_stats;
+
+static void            ReadVocabulary(void);
+static void            ReadWords(const uint8_t *data, uint size);
+static void            AddWord(const char *text, uint len, uint info);
+static int             CompareWords(const void *a, const void *b);
+static void            BuildTrie(uint index, uint lo, uint hi, uint depth);
+static void            ReadSuffixes(const uint8_t *data, uint size);
+static uint            ReadEnding(const uint8_t *data,
+                                  uint           size,
+                                  uint           pos,
+                                  char          *ending,
+                                  uint8_t       *len);
+static const TrieNode *FindWord(const char *word, uint len);
+static bool            LookUp(const char *word, uint len, Token *token);
+static bool            MakeSentence(const Token *tokens, uint count);
+static bool            NounFollows(const Token *tokens, uint i, uint count);
+static bool            AddMod(Phrase *phrase, int group);
+static int             GroupAs(const Token *token, uint classes);
+static uint            SynonymOf(uint group);
+static const SaidNode *FindSpec(const byte *spec);
+static SaidTable      *CompileSpecs(const byte *specs, uint size);
+static const byte     *CompileSpec(const byte *spec, const byte *end);
+static void            CompileParts(uint *numParts, bool opt);
+static void            CompilePart(bool opt);
+static void            CompileExpr(void);
+static void            CompileTerm(void);
+static void            CompileBase(bool opt);
+static uint            AddNode(uint type);
+static uint            Peek(uint ahead);
+static bool            StartsExpr(void);
+static void            Expect(uint op);
+static int             MatchSpec(const SaidNode *spec);
+static bool            MatchNode(const SaidNode *node,
+                                 int             head,
+                                 const Phrase   *phrase);
+
+int ParseInput(const char *input, char *badWord)
+{
+    Token       tokens[MAXINPUT];
+    char        word[MAXWORDLEN + 1];
+    const char *p;
+    uint        count, len;
+
+    if (!s_vocabRead) {
+        ReadVocabulary();
+    }
+    ++s_stats.inputs;
+    s_haveSentence = false;
+    s_claimed      = false;
+
+    count = 0;
+    for (p = input; *p != '\0';) {
+        if (!isalnum((uchar)*p) && *p != '\'' && *p != '-') {
+            ++p;
+            continue;
+        }
+
+        len = 0;
+        for (; isalnum((uchar)*p) || *p == '\'' || *p == '-'; ++p) {
+            if (len < MAXWORDLEN) {
+                word[len++] = (char)tolower((uchar)*p);
+            }
+        }
+        word[len] = '\0';
+
+        if (count == MAXINPUT) {
+            return PARSE_BADORDER;
+        }
+        if (!LookUp(word, len, &tokens[count])) {
+            strcpy(badWord, word);
+            return PARSE_BADWORD;
+        }
+        ++count;
+    }
+
+    if (count == 0) {
+        return PARSE_NOWORDS;
+    }
+    if (!MakeSentence(tokens, count)) {
+        return PARSE_BADORDER;
+    }
+    s_haveSentence = true;
+    return PARSE_OK;
+}
+
+int MatchSaid(const byte *spec)
+{
+    if (!s_haveSentence) {
+        return SAID_NOMATCH;
+    }
+    ++s_stats.matches;
+    return MatchSpec(FindSpec(spec));
+}
+
+bool SentenceClaimed(void)
+{
+    return !s_haveSentence || s_claimed;
+}
+
+void ClaimSentence(void)
+{
+    s_claimed = true;
+}
+
+void ForgetSentence(void)
+{
+    s_haveSentence = false;
+    s_claimed      = false;
+}
+
+void ClearSynonyms(void)
+{
+    s_numSynonym = 0;
+}
+
+void AddSynonyms(const SegHeader *seg)
+{
+    const uint16_t *pairs = (const uint16_t *)(seg + 1);
+    uint            count = (seg->size - sizeof(SegHeader)) / sizeof(Synonym);
+    uint            i, j;
+
+    if (s_numSynonym + count > s_maxSynonym) {
+        s_maxSynonym = max(s_numSynonym + count, 2 * s_maxSynonym);
+        s_synonyms =
+          (Synonym *)realloc(s_synonyms, s_maxSynonym * sizeof(Synonym));
+        if (s_synonyms == NULL) {
+            Panic(E_NO_MEMORY);
+        }
+    }
+
+    // Keep them sorted by the group replaced, the first added first.
+    for (i = 0; i < count; ++i, pairs += 2) {
+        for (j = s_numSynonym; j > 0 && s_synonyms[j - 1].from > pairs[0];
+             --j) {
+            s_synonyms[j] = s_synonyms[j - 1];
+        }
+        s_synonyms[j].from = pairs[0];
+        s_synonyms[j].to   = pairs[1];
+        ++s_numSynonym;
+    }
+}
+
+void ForgetVocabulary(void)
+{
+    free(s_trie);
+    free(s_meanings);
+    free(s_suffixes);
+    s_trie         = NULL;
+    s_meanings     = NULL;
+    s_suffixes     = NULL;
+    s_numTrie      = 0;
+    s_numSuffix    = 0;
+    s_vocabRead    = false;
+    s_haveSentence = false;
+}
+
+void GetParseStats(ParseStats *stats)
+{
+    *stats = s_stats;
+}
+
+static void ReadVocabulary(void)
+{
+    uint64_t       loc[NRESSOURCES];
+    const uint8_t *data;
+
+    ForgetVocabulary();
+
+    data = (const uint8_t *)ResLoad(RES_VOCAB, WORDS_VOCAB);
+    if (data != NULL) {
+        ReadWords(data, ResHandleSize(data));
+        ResUnLoad(RES_VOCAB, WORDS_VOCAB);
+    }
+
+    if (FindResSources(RES_VOCAB, SUFFIX_VOCAB, loc) != 0) {
+        data = (const uint8_t *)ResLoad(RES_VOCAB, SUFFIX_VOCAB);
+        if (data != NULL) {
+            ReadSuffixes(data, ResHandleSize(data));
+            ResUnLoad(RES_VOCAB, SUFFIX_VOCAB);
+        }
+    }
+
+    s_vocabRead = true;
+}
+
+// The words follow an index of where each letter starts. Each one is the
+// number of letters it has in common with the one before, its other letters,
+// the last with its high bit set, then its classes and group in 24 bits.
+static void ReadWords(const uint8_t *data, uint size)
+{
+    char    text[MAXWORDLEN + 1];
+    uint    pos, len, info, i;
+    uint8_t c;
+
+    s_numWords = 0;
+    s_textSize = 0;
+    len        = 0;
+    for (pos = LETTERS * sizeof(uint16_t); pos < size;) {
+        len = min(data[pos], len);
+        ++pos;
+        do {
+            c = pos < size ? data[pos++] : 0x80;
+            if (len < MAXWORDLEN) {
+                text[len++] = (char)tolower(c & 0x7f);
+            }
+        } while (c < 0x80);
+        if (pos + 3 > size) {
+            break;
+        }
+
+        info = (uint)data[pos] << 16 | (uint)data[pos + 1] << 8 | data[pos + 2];
+        AddWord(text, len, info);
+        pos += 3;
+    }
+
+    // The words are mostly in order already, so sorting them is quick. Those
+    // spelled alike keep the order of the vocabulary. The trie, with room for
+    // a node per letter, is room enough for the scratch of the sort.
+    s_meanings = (Meaning *)malloc(max(s_numWords, 1) * sizeof(Meaning));
+    s_trie     = (TrieNode *)malloc((s_textSize + 1) * sizeof(TrieNode));
+    if (s_meanings == NULL || s_trie == NULL) {
+        Panic(E_NO_MEMORY);
+    }
+    StableSort(s_words, s_numWords, sizeof(VocabWord), CompareWords, s_trie);
+
+    for (i = 0; i < s_numWords; ++i) {
+        s_meanings[i] = s_words[i].meaning;
+    }
+    memset(&s_trie[0], 0, sizeof(TrieNode));
+    s_numTrie = 1;
+    BuildTrie(0, 0, s_numWords, 0);
+
+    free(s_words);
+    free(s_text);
+    s_words    = NULL;
+    s_text     = NULL;
+    s_maxWords = 0;
+    s_maxText  = 0;
+}
+
+static void AddWord(const char *text, uint len, uint info)
+{
+    VocabWord *word;
+
+    if (s_numWords == s_maxWords) {
+        s_maxWords = max(2 * s_maxWords, 256);
+        s_words = (VocabWord *)realloc(s_words, s_maxWords * sizeof(VocabWord));
+    }
+    if (s_textSize + len + 1 > s_maxText) {
+        s_maxText = max(2 * s_maxText, 4096);
+        s_text    = (char *)realloc(s_text, s_maxText);
+    }
+    if (s_words == NULL || s_text == NULL) {
+        Panic(E_NO_MEMORY);
+    }
+
+    word                  = &s_words[s_numWords++];
+    word->text            = s_textSize;
+    word->meaning.classes = (uint16_t)(info >> 12);
+    word->meaning.group   = (uint16_t)(info & 0xfff);
+    memcpy(s_text + s_textSize, text, len);
+    s_text[s_textSize + len] = '\0';
+    s_textSize += len + 1;
+}
+
+static int CompareWords(const void *a, const void *b)
+{
+    return strcmp(s_text + ((const VocabWord *)a)->text,
+                  s_text + ((const VocabWord *)b)->text);
+}
+
+#define LetterOf(i, depth) ((uint8_t)s_text[s_words[i].text + (depth)])
+
+// Make node 'index' the one of the sorted words from 'lo' to 'hi' - 1, which
+// have their first 'depth' letters in common. The children of each node are
+// put next to each other.
+static void BuildTrie(uint index, uint lo, uint hi, uint depth)
+{
+    uint    first, kid, i, j;
+    uint8_t letter;
+
+    // The words ending here come first.
+    for (i = lo; i < hi && LetterOf(i, depth) == '\0'; ++i) {
+    }
+    s_trie[index].meanings    = lo;
+    s_trie[index].numMeanings = (uint8_t)min(i - lo, 255);
+
+    first = s_numTrie;
+    for (j = i; j < hi; ++s_numTrie) {
+        letter = LetterOf(j, depth);
+        while (j < hi && LetterOf(j, depth) == letter) {
+            ++j;
+        }
+    }
+    s_trie[index].kids    = first;
+    s_trie[index].numKids = (uint8_t)(s_numTrie - first);
+
+    for (kid = first; i < hi; ++kid, i = j) {
+        letter = LetterOf(i, depth);
+        for (j = i + 1; j < hi && LetterOf(j, depth) == letter; ++j) {
+        }
+        s_trie[kid].letter = letter;
+        BuildTrie(kid, i, j, depth + 1);
+    }
+}
+
+// Each suffix is '*' and the ending of the words typed, the class they then
+// have, '*' and the ending of the words in the vocabulary, and the classes
+// one of which those must have. The endings end with 0, and the classes are
+// in 16 bits, high byte first.
+static void ReadSuffixes(const uint8_t *data, uint size)
+{
+    Suffix suffix;
+    uint   pos;
+
+    s_suffixes = (Suffix *)malloc((size / 8 + 1) * sizeof(Suffix));
+    if (s_suffixes == NULL) {
+        Panic(E_NO_MEMORY);
+    }
+
+    pos = 0;
+    while (pos + 1 < size && data[pos] == '*' && data[pos + 1] != 0xff) {
+        pos = ReadEnding(data, size, pos + 1, suffix.from, &suffix.fromLen);
+        if (pos + 3 > size || data[pos + 2] != '*') {
+            break;
+        }
+        suffix.classes = (uint16_t)(data[pos] << 8 | data[pos + 1]);
+
+        pos = ReadEnding(data, size, pos + 3, suffix.to, &suffix.toLen);
+        if (pos + 2 > size) {
+            break;
+        }
+        suffix.mask = (uint16_t)(data[pos] << 8 | data[pos + 1]);
+        pos += 2;
+
+        if (suffix.fromLen < sizeof(suffix.from) &&
+            suffix.toLen < sizeof(suffix.to)) {
+            s_suffixes[s_numSuffix++] = suffix;
+        }
+    }
+}
+
+// Read the ending at 'pos', and return where it ends. An ending too long for
+// 'ending' is returned as long as it is.
+static uint ReadEnding(const uint8_t *data,
+                       uint           size,
+                       uint           pos,
+                       char          *ending,
+                       uint8_t       *len)
+{
+    uint n;
+
+    for (n = 0; pos < size && data[pos] != '\0'; ++n, ++pos) {
+        if (n < 7) {
+            ending[n] = (char)tolower(data[pos]);
+        }
+    }
+    ending[min(n, 7)] = '\0';
+    *len              = (uint8_t)min(n, 255);
+    return pos + 1;
+}
+
+static const TrieNode *FindWord(const char *word, uint len)
+{
+    const TrieNode *node = s_trie;
+    const TrieNode *kid;
+    const TrieNode *end;
+    uint            i;
+
+    if (s_numTrie == 0) {
+        return NULL;
+    }
+
+    for (i = 0; i < len; ++i) {
+        kid = &s_trie[node->kids];
+        end = kid + node->numKids;
+        while (kid < end && kid->letter < (uint8_t)word[i]) {
+            ++kid;
+        }
+        if (kid == end || kid->letter != (uint8_t)word[i]) {
+            return NULL;
+        }
+        node = kid;
+    }
+    return node->numMeanings != 0 ? node : NULL;
+}
+
+// Find the meanings of a word: as it is in the vocabulary, as a number, or as
+// a word of the vocabulary with another ending.
+static bool LookUp(const char *word, uint len, Token *token)
+{
+    const TrieNode *node;
+    const Suffix   *suffix;
+    Meaning         meaning;
+    char            stem[MAXWORDLEN + 1];
+    uint            stemLen, i;
+
+    ++s_stats.words;
+    token->classes     = 0;
+    token->numMeanings = 0;
+
+    node = FindWord(word, len);
+    if (node != NULL) {
+        for (i = 0; i < node->numMeanings && i < MAXMEANINGS; ++i) {
+            token->meanings[i] = s_meanings[node->meanings + i];
+            token->classes |= token->meanings[i].classes;
+        }
+        token->numMeanings = (uint8_t)i;
+        return true;
+    }
+
+    i = 0;
+    while (i < len && isdigit((uchar)word[i])) {
+        ++i;
+    }
+    if (i == len) {
+        token->classes             = WC_NUMBER;
+        token->numMeanings         = 1;
+        token->meanings[0].classes = WC_NUMBER;
+        token->meanings[0].group   = NUMBERGROUP;
+        return true;
+    }
+
+    for (suffix = s_suffixes; suffix < s_suffixes + s_numSuffix; ++suffix) {
+        if (len <= suffix->fromLen) {
+            continue;
+        }
+        stemLen = len - suffix->fromLen;
+        if (memcmp(word + stemLen, suffix->from, suffix->fromLen) != 0 ||
+            stemLen + suffix->toLen > MAXWORDLEN) {
+            continue;
+        }
+        memcpy(stem, word, stemLen);
+        memcpy(stem + stemLen, suffix->to, suffix->toLen);
+        stemLen += suffix->toLen;
+
+        node = FindWord(stem, stemLen);
+        if (node == NULL) {
+            continue;
+        }
+        for (i = 0; i < node->numMeanings && token->numMeanings < MAXMEANINGS;
+             ++i) {
+            meaning = s_meanings[node->meanings + i];
+            if ((meaning.classes & suffix->mask) != 0) {
+                meaning.classes = suffix->classes;
+                token->meanings[token->numMeanings++] = meaning;
+                token->classes |= suffix->classes;
+            }
+        }
+    }
+    return token->numMeanings != 0;
+}
+
+// Put the words in the phrases of the sentence. The verb comes first, its
+// adverbs anywhere. Then come the direct and indirect objects, each a noun
+// after its adjectives and prepositions. A preposition right after the verb,
+// or left at the end, tells how of the verb, as in "look in the box" and
+// "put the key down".
+static bool MakeSentence(const Token *tokens, uint count)
+{
+    uint    pending[MAXMODS];
+    uint    numPending = 0;
+    uint    next       = DIRECT;
+    uint    classes, i, k;
+    Phrase *object;
+
+    for (i = 0; i < NPHRASES; ++i) {
+        s_sentence[i].head    = -1;
+        s_sentence[i].numMods = 0;
+    }
+
+    for (i = 0; i < count; ++i) {
+        classes = tokens[i].classes;
+        if ((classes & ~WC_ARTICLE) == 0) {
+            continue;
+        }
+
+        if ((classes & VERBS) != 0 && s_sentence[VERB].head < 0 &&
+            next == DIRECT && numPending == 0) {
+            s_sentence[VERB].head = GroupAs(&tokens[i], VERBS);
+        } else if ((classes & WC_ADVERB) != 0 && (classes & NOUNS) == 0) {
+            if (!AddMod(&s_sentence[VERB], GroupAs(&tokens[i], WC_ADVERB))) {
+                return false;
+            }
+        } else if ((classes & WC_PREP) != 0 && (classes & NOUNS) == 0 &&
+                   s_sentence[VERB].head >= 0 && next == DIRECT &&
+                   numPending == 0) {
+            if (!AddMod(&s_sentence[VERB], GroupAs(&tokens[i], WC_PREP))) {
+                return false;
+            }
+        } else if ((classes & NOUNS) != 0 &&
+                   ((classes & (WC_ADJECTIVE | WC_NUMBER)) == 0 ||
+                    !NounFollows(tokens, i + 1, count))) {
+            if (next == NPHRASES) {
+                return false;
+            }
+            object       = &s_sentence[next++];
+            object->head = GroupAs(&tokens[i], NOUNS);
+            for (k = 0; k < numPending; ++k) {
+                AddMod(object,
+                       GroupAs(&tokens[pending[k]],
+                               WC_ADJECTIVE | WC_NUMBER | WC_PREP));
+            }
+            numPending = 0;
+        } else if ((classes & (WC_ADJECTIVE | WC_NUMBER | WC_PREP)) != 0) {
+            if (numPending == MAXMODS) {
+                return false;
+            }
+            pending[numPending++] = i;
+        } else {
+            return false;
+        }
+    }
+
+    for (k = 0; k < numPending; ++k) {
+        if ((tokens[pending[k]].classes & WC_PREP) == 0 ||
+            !AddMod(&s_sentence[VERB], GroupAs(&tokens[pending[k]], WC_PREP))) {
+            return false;
+        }
+    }
+
+    return s_sentence[VERB].head >= 0 || s_sentence[DIRECT].head >= 0;
+}
+
+// Return TRUE if the words from 'i' on are adjectives of a noun.
+static bool NounFollows(const Token *tokens, uint i, uint count)
+{
+    for (; i < count; ++i) {
+        if ((tokens[i].classes & (WC_NOUN | WC_PRONOUN)) != 0) {
+            return true;
+        }
+        if ((tokens[i].classes & (WC_ARTICLE | WC_ADJECTIVE | WC_NUMBER)) ==
+            0) {
+            return false;
+        }
+    }
+    return false;
+}
+
+static bool AddMod(Phrase *phrase, int group)
+{
+    if (phrase->numMods == MAXMODS) {
+        return false;
+    }
+    phrase->mods[phrase->numMods++] = (uint16_t)group;
+    return true;
+}
+
+// Return the group of the first meaning of a word in one of 'classes', or of
+// its first meaning.
+static int GroupAs(const Token *token, uint classes)
+{
+    uint i;
+
+    for (i = 0; i < token->numMeanings; ++i) {
+        if ((token->meanings[i].classes & classes) != 0) {
+            return (int)SynonymOf(token->meanings[i].group);
+        }
+    }
+    return (int)SynonymOf(token->meanings[0].group);
+}
+
+static uint SynonymOf(uint group)
+{
+    uint lo = 0, hi = s_numSynonym, mid;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (s_synonyms[mid].from < group) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < s_numSynonym && s_synonyms[lo].from == group
+             ? s_synonyms[lo].to
+             : group;
+}
+
+// Return the matcher of a spec, compiling the said specs of its script if
+// need be.
+static const SaidNode *FindSpec(const byte *spec)
+{
+    Script    *script;
+    SaidTable *table;
+    uint32_t   first;
+
+    script = FindSaidScript(spec);
+    if (script != NULL) {
+        if (script->saids == NULL) {
+            script->saids = CompileSpecs(script->saidSpecs, script->saidSize);
+        }
+        table = (SaidTable *)script->saids;
+        first = table->specs[spec - script->saidSpecs];
+        if (first != 0) {
+            return &table->nodes[first - 1];
+        }
+    }
+
+    // A spec from elsewhere is compiled each time.
+    s_numNodes = 0;
+    CompileSpec(spec,
+                script != NULL ? script->saidSpecs + script->saidSize
+                               : spec + MAXSPEC);
+    return s_nodes;
+}
+
+static SaidTable *CompileSpecs(const byte *specs, uint size)
+{
+    SaidTable  *table;
+    uint32_t   *first;
+    const byte *spec;
+
+    first = (uint32_t *)calloc(max(size, 1), sizeof(uint32_t));
+    if (first == NULL) {
+        Panic(E_NO_MEMORY);
+    }
+
+    s_numNodes = 0;
+    for (spec = specs; spec < specs + size;) {
+        first[spec - specs] = s_numNodes + 1;
+        spec                = CompileSpec(spec, specs + size);
+    }
+
+    table = (SaidTable *)malloc(sizeof(SaidTable) + size * sizeof(uint32_t) +
+                                s_numNodes * sizeof(SaidNode));
+    if (table == NULL) {
+        Panic(E_NO_MEMORY);
+    }
+    table->specs = (uint32_t *)(table + 1);
+    table->nodes = (SaidNode *)(table->specs + size);
+    memcpy(table->specs, first, size * sizeof(uint32_t));
+    memcpy(table->nodes, s_nodes, s_numNodes * sizeof(SaidNode));
+    free(first);
+    return table;
+}
+
+// Compile the spec at 'spec' after the nodes compiled so far, and return
+// where it ends. A spec is the verb, then each object after a slash, and '>'
+// if the sentence may go on. Brackets make the objects in them optional.
+static const byte *CompileSpec(const byte *spec, const byte *end)
+{
+    uint node, numParts;
+
+    ++s_stats.compiles;
+    s_spec    = spec;
+    s_specEnd = end;
+    s_nesting = 0;
+    s_specBad = false;
+
+    node = AddNode(SN_SPEC);
+    CompilePart(false);
+    numParts = 1;
+    CompileParts(&numParts, false);
+    for (; numParts < NPHRASES; ++numParts) {
+        s_nodes[AddNode(SN_PART)].word = PART_NONE;
+    }
+
+    if (Peek(0) == SAID_GT) {
+        s_nodes[node].word |= SPEC_PARTIAL;
+        ++s_spec;
+    }
+    if (s_specBad || Peek(0) != SAID_END) {
+        s_nodes[node].word |= SPEC_BAD;
+    }
+    s_nodes[node].size = s_numNodes - node;
+
+    // Go on to the next spec, the groups being two bytes.
+    while (Peek(0) != SAID_END) {
+        s_spec += Peek(0) < SAID_COMMA ? 2 : 1;
+    }
+    return min(s_spec + 1, s_specEnd);
+}
+
+// Compile the objects after a slash, in brackets if 'opt'.
+static void CompileParts(uint *numParts, bool opt)
+{
+    while (!s_specBad) {
+        if (Peek(0) == SAID_SLASH) {
+            ++s_spec;
+            if (*numParts == NPHRASES) {
+                s_specBad = true;
+                return;
+            }
+            CompilePart(opt);
+            ++*numParts;
+        } else if (Peek(0) == SAID_OPTOPEN && Peek(1) == SAID_SLASH &&
+                   s_nesting < MAXNESTING) {
+            ++s_spec;
+            ++s_nesting;
+            CompileParts(numParts, true);
+            --s_nesting;
+            Expect(SAID_OPTCLOSE);
+        } else {
+            return;
+        }
+    }
+}
+
+// A phrase without an expression may be anything.
+static void CompilePart(bool opt)
+{
+    uint part = AddNode(SN_PART);
+
+    s_nodes[part].opt = opt;
+    if (StartsExpr()) {
+        s_nodes[part].word = PART_MATCH;
+        CompileExpr();
+    } else {
+        s_nodes[part].word = PART_ANY;
+    }
+    s_nodes[part].size = s_numNodes - part;
+}
+
+// Terms separated by commas.
+static void CompileExpr(void)
+{
+    uint alt = AddNode(SN_ALT);
+
+    CompileTerm();
+    while (!s_specBad && Peek(0) == SAID_COMMA) {
+        ++s_spec;
+        CompileTerm();
+    }
+    s_nodes[alt].size = s_numNodes - alt;
+}
+
+// A word or expression, then the words modifying it, each after '<', those
+// in brackets optional.
+static void CompileTerm(void)
+{
+    uint term = AddNode(SN_TERM);
+
+    CompileBase(false);
+    while (!s_specBad) {
+        if (Peek(0) == SAID_LT) {
+            ++s_spec;
+            CompileBase(false);
+        } else if (Peek(0) == SAID_OPTOPEN && Peek(1) == SAID_LT) {
+            ++s_spec;
+            while (!s_specBad && Peek(0) == SAID_LT) {
+                ++s_spec;
+                CompileBase(true);
+            }
+            Expect(SAID_OPTCLOSE);
+        } else {
+            break;
+        }
+    }
+    s_nodes[term].size = s_numNodes - term;
+}
+
+// A group, or an expression in parentheses or brackets.
+static void CompileBase(bool opt)
+{
+    uint op = Peek(0), node;
+
+    if (op < SAID_COMMA && s_spec + 2 <= s_specEnd) {
+        node               = AddNode(SN_WORD);
+        s_nodes[node].word = (uint16_t)(op << 8 | Peek(1));
+        s_nodes[node].opt  = opt;
+        s_spec += 2;
+    } else if ((op == SAID_OPEN || op == SAID_OPTOPEN) &&
+               s_nesting < MAXNESTING) {
+        ++s_spec;
+        ++s_nesting;
+        node = s_numNodes;
+        CompileExpr();
+        s_nodes[node].opt = opt || op == SAID_OPTOPEN;
+        --s_nesting;
+        Expect(op == SAID_OPEN ? SAID_CLOSE : SAID_OPTCLOSE);
+    } else {
+        s_specBad = true;
+    }
+}
+
+static uint AddNode(uint type)
+{
+    SaidNode *node;
+
+    if (s_numNodes == s_maxNodes) {
+        s_maxNodes = max(2 * s_maxNodes, 256);
+        s_nodes = (SaidNode *)realloc(s_nodes, s_maxNodes * sizeof(SaidNode));
+        if (s_nodes == NULL) {
+            Panic(E_NO_MEMORY);
+        }
+    }
+
+    node       = &s_nodes[s_numNodes];
+    node->type = (uint8_t)type;
+    node->opt  = false;
+    node->word = 0;
+    node->size = 1;
+    return s_numNodes++;
+}
+
+static uint Peek(uint ahead)
+{
+    return s_spec + ahead < s_specEnd ? (uint8_t)s_spec[ahead] : SAID_END;
+}
+
+static bool StartsExpr(void)
+{
+    uint op = Peek(0);
+
+    return op < SAID_COMMA || op == SAID_OPEN ||
+           (op == SAID_OPTOPEN && Peek(1) != SAID_SLASH && Peek(1) != SAID_LT);
+}
+
+static void Expect(uint op)
+{
+    if (Peek(0) == op) {
+        ++s_spec;
+    } else {
+        s_specBad = true;
+    }
+}
+
+static int MatchSpec(const SaidNode *spec)
+{
+    const SaidNode *part;
+    const Phrase   *phrase;
+    bool            empty;
+    uint            i;
+
+    if ((spec->word & SPEC_BAD) != 0) {
+        return SAID_NOMATCH;
+    }
+
+    part = spec + 1;
+    for (i = 0; i < NPHRASES; ++i, part += part->size) {
+        phrase = &s_sentence[i];
+        empty  = phrase->head < 0 && phrase->numMods == 0;
+        if (part->word == PART_NONE) {
+            if (!empty && (spec->word & SPEC_PARTIAL) == 0) {
+                return SAID_NOMATCH;
+            }
+        } else if (part->word == PART_MATCH && !(part->opt && empty) &&
+                   !MatchNode(part + 1, phrase->head, phrase)) {
+            return SAID_NOMATCH;
+        }
+    }
+    return (spec->word & SPEC_PARTIAL) != 0 ? SAID_PARTIAL : SAID_MATCH;
+}
+
+// Return TRUE if a node matches the word 'head' of a phrase, with the words
+// modifying it, or a modifier when 'phrase' is NULL.
+static bool MatchNode(const SaidNode *node, int head, const Phrase *phrase)
+{
+    const SaidNode *end = node + node->size;
+    const SaidNode *kid;
+    uint            i;
+
+    switch (node->type) {
+        case SN_WORD:
+            return head == (int)node->word || (node->opt && head < 0);
+
+        case SN_ALT:
+            if (node->opt && head < 0) {
+                return true;
+            }
+            for (kid = node + 1; kid < end; kid += kid->size) {
+                if (MatchNode(kid, head, phrase)) {
+                    return true;
+                }
+            }
+            return false;
+
+        case SN_TERM:
+            kid = node + 1;
+            if (!MatchNode(kid, head, phrase)) {
+                return false;
+            }
+            for (kid += kid->size; kid < end; kid += kid->size) {
+                if (kid->opt) {
+                    continue;
+                }
+                if (phrase == NULL) {
+                    return false;
+                }
+                for (i = 0; i < phrase->numMods; ++i) {
+                    if (MatchNode(kid, phrase->mods[i], NULL)) {
+                        break;
+                    }
+                }
+                if (i == phrase->numMods) {
+                    return false;
+                }
+            }
+            return true;
+
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,318 @@
+#include "sci/Kernel/PicCache.h"
+#include "sci/Kernel/Graphics.h"
+#include "sci/Kernel/MapSummary.h"
+#include "sci/Kernel/Picture.h"
+#include "sci/Kernel/Resource.h"
+
+#define MAXPICS  16
+
+#define PRI_NONE  0
+#define PRI_TABLE 1
+#define PRI_BANDS 2
+
+// Number of priority bands read by PriBands().
+#define PRIBANDS 14
+
+typedef struct PicKey {
+    uint     num;
+    bool     clear;
+    bool     mirror;
+    RRect    rect;
+    uint64_t under; // hash of the maps an overlay was drawn on
+} PicKey;
+
+// The visual rows of the rectangle, then its priority/control rows, follow
+// the entry in its handle.
+typedef struct PicEntry {
+    PicKey   key;
+    uint     size;
+    uint     lastUse;
+    uint     priOp;
+    uint16_t priData[PRIBANDS];
+    bool     hasPal;
+    RPalette pal;
+} PicEntry;
+
+static Handle s_pics[MAXPICS];
+static uint   s_cacheBytes = 0;
+static uint   s_useCount   = 0;
+
+// The picture being drawn.
+static PicKey   s_key;
+static bool     s_recording = false;
+static bool     s_cacheable = false;
+static uint     s_priOp     = PRI_NONE;
+static uint16_t s_priData[PRIBANDS];
+static bool     s_hasPal = false;
+static RPalette s_pal;
+
+static PicEntry *FindPic(const PicKey *key);
+static bool      MakeRoom(uint size);
+static void      DropPic(uint i);
+static void      CopyMaps(uint8_t *bits, const RRect *rect, bool save);
+static uint64_t  HashMaps(const RRect *rect);
+
+bool LoadCachedPic(uint num, bool clear, bool mirror)
+{
+    RRect     rect;
+    PicEntry *entry;
+
+    // Clip as the picture drawing does.
+    rect = g_rThePort->portRect;
+    rect.top += g_rThePort->origin.v;
+    rect.bottom += g_rThePort->origin.v;
+    rect.left += g_rThePort->origin.h;
+    rect.right += g_rThePort->origin.h;
+
+    // Zero the padding too, as keys are compared with memcmp.
+    memset(&s_key, 0, sizeof(s_key));
+    s_key.num    = num;
+    s_key.clear  = clear;
+    s_key.mirror = mirror;
+    if (!RSectRect(&rect, GetBounds(), &s_key.rect)) {
+        s_recording = false;
+        return false;
+    }
+    if (!clear) {
+        s_key.under = HashMaps(&s_key.rect);
+    }
+
+    entry = FindPic(&s_key);
+    if (entry == NULL) {
+        s_recording = true;
+        s_cacheable = true;
+        s_priOp     = PRI_NONE;
+        s_hasPal    = false;
+        return false;
+    }
+
+    s_recording    = false;
+    entry->lastUse = ++s_useCount;
+    CopyMaps((uint8_t *)(entry + 1), &entry->key.rect, false);
+    NoteMapRows(PMAP | CMAP, entry->key.rect.top, entry->key.rect.bottom);
+
+    // Replay what the picture did besides drawing.
+    if (entry->hasPal) {
+        RSetPalette(&entry->pal, PAL_REPLACE);
+    }
+    if (entry->priOp == PRI_TABLE) {
+        PriTable((int16_t)entry->priData[0], (int16_t)entry->priData[1]);
+    } else if (entry->priOp == PRI_BANDS) {
+        PriBands(entry->priData);
+    }
+    return true;
+}
+
+void StoreCachedPic(void)
+{
+    PicEntry *entry;
+    uint      size;
+    uint      i;
+    RRect    *rect = &s_key.rect;
+
+    if (!s_recording) {
+        return;
+    }
+    s_recording = false;
+
+    if (!s_cacheable) {
+        return;
+    }
+
+    size = sizeof(PicEntry) +
+           (2 * (uint)(rect->bottom - rect->top) *
+            (uint)(rect->right - rect->left));
+    if (!MakeRoom(size)) {
+        return;
+    }
+
+    for (i = 0; s_pics[i] != NULL; ++i) {
+    }
+
+    entry = (PicEntry *)GetResHandle(size);
+    if (entry == NULL) {
+        return;
+    }
+
+    entry->key     = s_key;
+    entry->size    = size;
+    entry->lastUse = ++s_useCount;
+    entry->priOp   = s_priOp;
+    memcpy(entry->priData, s_priData, sizeof(s_priData));
+    entry->hasPal = s_hasPal;
+    if (s_hasPal) {
+        memcpy(&entry->pal, &s_pal, PAL_FILE_SIZE);
+    }
+    CopyMaps((uint8_t *)(entry + 1), rect, true);
+
+    s_pics[i] = (Handle)entry;
+    s_cacheBytes += size;
+}
+
+void NotePicPalette(const RPalette *pal)
+{
+    if (!s_recording) {
+        return;
+    }
+
+    // Replaying a single palette is enough; pictures setting more are rare.
+    if (s_hasPal) {
+        s_cacheable = false;
+        return;
+    }
+
+    memcpy(&s_pal, pal, PAL_FILE_SIZE);
+    s_hasPal = true;
+}
+
+void NotePicPriTable(int x, int y)
+{
+    if (!s_recording) {
+        return;
+    }
+
+    // Both ways of setting the priority bands set all of them, so only the
+    // last one counts.
+    s_priOp      = PRI_TABLE;
+    s_priData[0] = (uint16_t)x;
+    s_priData[1] = (uint16_t)y;
+}
+
+void NotePicPriBands(const uint16_t *priPtr)
+{
+    if (!s_recording) {
+        return;
+    }
+
+    s_priOp = PRI_BANDS;
+    memcpy(s_priData, priPtr, sizeof(s_priData));
+}
+
+void NotePicBitMap(void)
+{
+    if (s_recording && !s_hasPal) {
+        s_cacheable = false;
+    }
+}
+
+void FlushPicCache(void)
+{
+    uint i;
+
+    for (i = 0; i < MAXPICS; ++i) {
+        if (s_pics[i] != NULL) {
+            DropPic(i);
+        }
+    }
+    s_recording = false;
+}
+
+static PicEntry *FindPic(const PicKey *key)
+{
+    PicEntry *entry;
+    uint      i;
+
+    for (i = 0; i < MAXPICS; ++i) {
+        entry = (PicEntry *)s_pics[i];
+        if (entry != NULL && memcmp(&entry->key, key, sizeof(PicKey)) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Drop the least recently used pictures until there is a free slot and 'size'
+// more bytes fit the budget.
+static bool MakeRoom(uint size)
+{
+    uint i, n, oldest;
+    uint used;
+
+    if (size > PICCACHEBYTES) {
+        return false;
+    }
+
+    while (true) {
+        used   = 0;
+        oldest = MAXPICS;
+        for (i = 0; i < MAXPICS; ++i) {
+            if (s_pics[i] == NULL) {
+                continue;
+            }
+            ++used;
+            n = ((PicEntry *)s_pics[i])->lastUse;
+            if (oldest == MAXPICS ||
+                n < ((PicEntry *)s_pics[oldest])->lastUse) {
+                oldest = i;
+            }
+        }
+
+        if (used < MAXPICS && s_cacheBytes + size <= PICCACHEBYTES) {
+            return true;
+        }
+        DropPic(oldest);
+    }
+}
+
+static void DropPic(uint i)
+{
+    PicEntry *entry = (PicEntry *)s_pics[i];
+
+    s_cacheBytes -= entry->size;
+    s_pics[i] = NULL;
+    DisposeResHandle((Handle)entry);
+}
+
+// Copy the rectangle of both maps to (save) or from the bits.
+static void CopyMaps(uint8_t *bits, const RRect *rect, bool save)
+{
+    uint8_t *maps[2];
+    uint8_t *row;
+    uint     width = (uint)(rect->right - rect->left);
+    int      y;
+    uint     m;
+
+    maps[0] = g_vHndl;
+    maps[1] = g_pcHndl;
+
+    for (m = 0; m < 2; ++m) {
+        for (y = rect->top; y < rect->bottom; ++y) {
+            row = maps[m] + g_baseTable[y] + rect->left;
+            if (save) {
+                memcpy(bits, row, width);
+            } else {
+                memcpy(row, bits, width);
+            }
+            bits += width;
+        }
+    }
+}
+
+static uint64_t HashMaps(const RRect *rect)
+{
+    const uint8_t *maps[2];
+    const uint8_t *row;
+    uint64_t       hash = 0x84222325cbf29ce4ULL;
+    uint64_t       word;
+    uint           width = (uint)(rect->right - rect->left);
+    uint           x, n;
+    int            y;
+    uint           m;
+
+    maps[0] = g_vHndl;
+    maps[1] = g_pcHndl;
+
+    for (m = 0; m < 2; ++m) {
+        for (y = rect->top; y < rect->bottom; ++y) {
+            row = maps[m] + g_baseTable[y] + rect->left;
+            for (x = 0; x < width; x += 8) {
+                n    = min(8, width - x);
+                word = 0;
+                memcpy(&word, row + x, n);
+                hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+                hash ^= hash >> 29;
+            }
+        }
+    }
+    return hash;
+}
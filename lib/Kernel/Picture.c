@@ -179,6 +179,7 @@ void ShowPic(uint mapSet, uint style)
             break;
     }
 
+    FlushBits();
     RShowCursor();
 
     RSetPort(oldPort);
@@ -278,6 +279,7 @@ static void HWipe(int wipeDir, uint mapSet, bool black)
         }
         ROffsetRect(&r, wipeDir, 0);
 
+        FlushBits();
         SyncEnd(ticks);
     }
 }
@@ -303,6 +305,7 @@ static void VWipe(int wipeDir, uint mapSet, bool black)
         }
         ROffsetRect(&r, wipeDir, 0);
 
+        FlushBits();
         SyncEnd(ticks);
     }
 }
@@ -360,6 +363,7 @@ static void Iris(int dir, uint mapSet, bool black)
         }
 
         i += dir;
+        FlushBits();
         SyncEnd(ticks);
     }
 }
@@ -407,6 +411,7 @@ static void Dissolve(uint mapSet, bool black)
             }
         }
 
+        FlushBits();
         SyncEnd(ticks);
     }
 
@@ -461,6 +466,7 @@ static void Shutter(int hDir, int vDir, uint mapSet, bool black)
         ROffsetRect(&r1, -hDir, -vDir);
         ROffsetRect(&r2, hDir, vDir);
 
+        FlushBits();
         SyncEnd(ticks);
     }
 }
@@ -0,0 +1,409 @@
+#include "sci/Kernel/Prefetch.h"
+#include "sci/Kernel/Globals.h"
+#include "sci/Kernel/Resource.h"
+#include "sci/Kernel/VolLoad.h"
+#include "sci/PMachine/PMachine.h"
+#include "sci/Utils/FileIO.h"
+#include "sci/Utils/List.h"
+#include "sci/Utils/Thread.h"
+
+#define PROFILENAME  "ROOMPROF.DAT"
+#define PROFILEMAGIC 0x31465052 // "RPF1"
+#define MAXROOMRES   64
+
+// Upper bound on the data of finished loads waiting to be claimed. Beyond
+// it, the oldest unclaimed loads are dropped.
+#define MAXREADYBYTES (2 * 1024 * 1024)
+
+// Request states.
+#define REQ_QUEUED  0
+#define REQ_LOADING 1
+#define REQ_DONE    2
+
+typedef struct ResRequest {
+    Node   link;
+    int    resType;
+    size_t resNum;
+    int    state;
+    bool   wanted; // ResLoad() is waiting for it
+    Handle data;
+} ResRequest;
+
+typedef struct ResKey {
+    uint16_t resType;
+    uint16_t resNum;
+} ResKey;
+
+typedef struct RoomProfile {
+    Node   link;
+    uint   room;
+    uint   count;
+    ResKey res[MAXROOMRES];
+} RoomProfile;
+
+static bool    s_prefetchOn = false;
+static Mutex   s_mutex;
+static CondVar s_workCond; // a request was queued
+static CondVar s_doneCond; // a request was done
+static Thread  s_threads[PREFETCHTHREADS];
+static uint    s_numThreads = 0;
+static bool    s_quit       = false;
+static List    s_requests   = LIST_INITIALIZER;
+static size_t  s_readyBytes = 0;
+
+static List         s_profiles = LIST_INITIALIZER;
+static RoomProfile *s_room     = NULL;
+static bool         s_dirty    = false;
+
+static ResRequest  *FindRequest(int resType, size_t resNum);
+static void         FreeRequest(ResRequest *req);
+static void         TrimReady(void);
+static void         PrefetchThread(void *arg);
+static RoomProfile *FindProfile(uint room, bool create);
+static void         ReadProfiles(void);
+static void         WriteProfiles(void);
+
+void InitPrefetch(void)
+{
+    uint i;
+
+    if (s_prefetchOn) {
+        return;
+    }
+
+    CreateMutex(&s_mutex, false);
+    CreateCondVar(&s_workCond);
+    CreateCondVar(&s_doneCond);
+
+    for (i = 0; i < PREFETCHTHREADS; i++) {
+        if (!StartThread(&s_threads[s_numThreads], PrefetchThread, NULL)) {
+            break;
+        }
+        s_numThreads++;
+    }
+
+    ReadProfiles();
+
+    s_prefetchOn = true;
+    atexit(EndPrefetch);
+}
+
+void EndPrefetch(void)
+{
+    ResRequest *req;
+    uint        i;
+
+    if (!s_prefetchOn) {
+        return;
+    }
+
+    LockMutex(&s_mutex);
+    s_quit = true;
+    BroadcastCondVar(&s_workCond);
+    UnlockMutex(&s_mutex);
+
+    for (i = 0; i < s_numThreads; i++) {
+        JoinThread(&s_threads[i]);
+    }
+    s_numThreads = 0;
+
+    while (!EmptyList(&s_requests)) {
+        req = FromNode(FirstNode(&s_requests), ResRequest);
+        FreeRequest(req);
+    }
+
+    DestroyCondVar(&s_doneCond);
+    DestroyCondVar(&s_workCond);
+    DestroyMutex(&s_mutex);
+
+    WriteProfiles();
+    s_prefetchOn = false;
+}
+
+void ResLoadAsync(int resType, size_t resNum)
+{
+    ResRequest *req;
+
+    if (!s_prefetchOn || s_numThreads == 0 || resType == RES_MEM ||
+        FindResEntry(resType, resNum) != NULL) {
+        return;
+    }
+
+    LockMutex(&s_mutex);
+    if (FindRequest(resType, resNum) == NULL) {
+        req = (ResRequest *)malloc(sizeof(ResRequest));
+        if (req != NULL) {
+            req->resType = resType;
+            req->resNum  = resNum;
+            req->state   = REQ_QUEUED;
+            req->wanted  = false;
+            req->data    = NULL;
+            AddToEnd(&s_requests, ToNode(req));
+            SignalCondVar(&s_workCond);
+        }
+    }
+    UnlockMutex(&s_mutex);
+}
+
+bool ResLoadDone(int resType, size_t resNum)
+{
+    ResRequest *req;
+    bool        done = true;
+
+    if (!s_prefetchOn) {
+        return true;
+    }
+
+    LockMutex(&s_mutex);
+    req = FindRequest(resType, resNum);
+    if (req != NULL) {
+        done = (req->state == REQ_DONE);
+    }
+    UnlockMutex(&s_mutex);
+    return done;
+}
+
+Handle TakePrefetched(int resType, size_t resNum)
+{
+    ResRequest *req;
+    Handle      data;
+
+    if (!s_prefetchOn) {
+        return NULL;
+    }
+
+    LockMutex(&s_mutex);
+    req = FindRequest(resType, resNum);
+    if (req == NULL) {
+        UnlockMutex(&s_mutex);
+        return NULL;
+    }
+
+    // Not started yet: the caller may as well load it itself.
+    if (req->state == REQ_QUEUED) {
+        FreeRequest(req);
+        UnlockMutex(&s_mutex);
+        return NULL;
+    }
+
+    req->wanted = true;
+    while (req->state != REQ_DONE) {
+        WaitCondVar(&s_doneCond, &s_mutex);
+    }
+
+    data = req->data;
+    if (data != NULL) {
+        s_readyBytes -= ResHandleSize(data);
+        req->data = NULL;
+    }
+    FreeRequest(req);
+    UnlockMutex(&s_mutex);
+    return data;
+}
+
+void NoteRoomLoad(int resType, size_t resNum)
+{
+    uint room;
+    uint i;
+
+    if (!s_prefetchOn || !g_gameStarted || resType == RES_MEM) {
+        return;
+    }
+
+    room = (uint)GetGlobalVariable(g_curRoomNum);
+    if (s_room == NULL || s_room->room != room) {
+        s_room = FindProfile(room, true);
+        if (s_room == NULL) {
+            return;
+        }
+
+        // Entering the room: warm up what it loaded last time.
+        for (i = 0; i < s_room->count; i++) {
+            ResLoadAsync((int)s_room->res[i].resType,
+                         (size_t)s_room->res[i].resNum);
+        }
+    }
+
+    for (i = 0; i < s_room->count; i++) {
+        if ((int)s_room->res[i].resType == resType &&
+            (size_t)s_room->res[i].resNum == resNum) {
+            return;
+        }
+    }
+
+    if (s_room->count < MAXROOMRES) {
+        s_room->res[s_room->count].resType = (uint16_t)resType;
+        s_room->res[s_room->count].resNum  = (uint16_t)resNum;
+        s_room->count++;
+        s_dirty = true;
+    }
+}
+
+// Must be called with the mutex held.
+static ResRequest *FindRequest(int resType, size_t resNum)
+{
+    Node       *node;
+    ResRequest *req;
+
+    for (node = FirstNode(&s_requests); node != NULL; node = NextNode(node)) {
+        req = FromNode(node, ResRequest);
+        if (req->resType == resType && req->resNum == resNum) {
+            return req;
+        }
+    }
+    return NULL;
+}
+
+// Must be called with the mutex held.
+static void FreeRequest(ResRequest *req)
+{
+    if (req->data != NULL) {
+        s_readyBytes -= ResHandleSize(req->data);
+        DisposeResHandle(req->data);
+    }
+
+    DeleteNode(&s_requests, ToNode(req));
+    free(req);
+}
+
+// Must be called with the mutex held.
+static void TrimReady(void)
+{
+    Node       *node;
+    Node       *next;
+    ResRequest *req;
+
+    for (node = FirstNode(&s_requests);
+         node != NULL && s_readyBytes > MAXREADYBYTES;
+         node = next) {
+        next = NextNode(node);
+        req  = FromNode(node, ResRequest);
+        if (req->state == REQ_DONE && !req->wanted) {
+            FreeRequest(req);
+        }
+    }
+}
+
+static void PrefetchThread(void *arg)
+{
+    Node       *node;
+    ResRequest *req;
+    Handle      data;
+
+    LockMutex(&s_mutex);
+    while (!s_quit) {
+        req = NULL;
+        for (node = FirstNode(&s_requests); node != NULL;
+             node = NextNode(node)) {
+            if (FromNode(node, ResRequest)->state == REQ_QUEUED) {
+                req = FromNode(node, ResRequest);
+                break;
+            }
+        }
+
+        if (req == NULL) {
+            WaitCondVar(&s_workCond, &s_mutex);
+            continue;
+        }
+
+        req->state = REQ_LOADING;
+        UnlockMutex(&s_mutex);
+
+        data = DoLoadDetached(req->resType, req->resNum);
+
+        LockMutex(&s_mutex);
+        req->data  = data;
+        req->state = REQ_DONE;
+        if (data != NULL) {
+            s_readyBytes += ResHandleSize(data);
+            TrimReady();
+        }
+        BroadcastCondVar(&s_doneCond);
+    }
+    UnlockMutex(&s_mutex);
+}
+
+static RoomProfile *FindProfile(uint room, bool create)
+{
+    Node        *node;
+    RoomProfile *profile;
+
+    for (node = FirstNode(&s_profiles); node != NULL; node = NextNode(node)) {
+        profile = FromNode(node, RoomProfile);
+        if (profile->room == room) {
+            return profile;
+        }
+    }
+
+    if (!create) {
+        return NULL;
+    }
+
+    profile = (RoomProfile *)malloc(sizeof(RoomProfile));
+    if (profile != NULL) {
+        profile->room  = room;
+        profile->count = 0;
+        AddToEnd(&s_profiles, ToNode(profile));
+    }
+    return profile;
+}
+
+// The profile file holds a magic number followed by, for each room, the
+// room number, the resource count and the resources (type and number), all
+// as 16-bit values.
+static void ReadProfiles(void)
+{
+    RoomProfile *profile;
+    uint32_t     magic = 0;
+    uint16_t     header[2];
+    int          fd;
+
+    fd = fileopen(PROFILENAME, O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+
+    if (read(fd, &magic, sizeof(magic)) == sizeof(magic) &&
+        magic == PROFILEMAGIC) {
+        while (read(fd, header, sizeof(header)) == sizeof(header) &&
+               header[1] <= MAXROOMRES) {
+            profile = FindProfile(header[0], true);
+            if (profile == NULL ||
+                read(fd, profile->res, header[1] * sizeof(ResKey)) !=
+                  (int)(header[1] * sizeof(ResKey))) {
+                break;
+            }
+            profile->count = header[1];
+        }
+    }
+    close(fd);
+}
+
+static void WriteProfiles(void)
+{
+    Node        *node;
+    RoomProfile *profile;
+    uint32_t     magic = PROFILEMAGIC;
+    uint16_t     header[2];
+    int          fd;
+
+    if (!s_dirty) {
+        return;
+    }
+
+    fd = fileopen(PROFILENAME, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd == -1) {
+        return;
+    }
+
+    write(fd, &magic, sizeof(magic));
+    for (node = FirstNode(&s_profiles); node != NULL; node = NextNode(node)) {
+        profile   = FromNode(node, RoomProfile);
+        header[0] = (uint16_t)profile->room;
+        header[1] = (uint16_t)profile->count;
+        write(fd, header, sizeof(header));
+        write(fd, profile->res, profile->count * sizeof(ResKey));
+    }
+    close(fd);
+    s_dirty = false;
+}
@@ -0,0 +1,185 @@
+#include "sci/Kernel/ResArchive.h"
+#include "sci/Kernel/ResSource.h"
+#include "sci/Kernel/Resource.h"
+#include "sci/Utils/FileIO.h"
+#include "sci/Utils/Lz.h"
+#include "sci/Utils/Path.h"
+#if !defined(__WINDOWS__)
+#include <sys/mman.h>
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+static const uint8_t   *s_arcData    = NULL;
+static size_t           s_arcSize    = 0;
+static const ArcHeader *s_arcHeader  = NULL;
+static const ArcEntry  *s_arcEntries = NULL;
+
+static Handle LoadArchived(int resType, size_t resNum, uint64_t loc);
+
+static const ResArchive s_archive = { ARCNAME, LoadArchived };
+
+bool OpenResArchive(const char *fileName)
+{
+    char            path[PATH_MAX];
+    const ArcEntry *entry;
+    uint8_t        *data;
+    size_t          size;
+    uint            i;
+    int             fd;
+
+    CloseResArchive();
+
+    DosToLocalPath(path, fileName, true);
+    fd = open(path, O_RDONLY | O_BINARY);
+    if (fd == -1) {
+        return false;
+    }
+
+    size = (size_t)filelength(fd);
+    if (size < sizeof(ArcHeader)) {
+        close(fd);
+        return false;
+    }
+
+    // The whole archive is mapped: payloads are decoded (or copied) straight
+    // from the mapping.
+#if !defined(__WINDOWS__)
+    data = (uint8_t *)mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == (uint8_t *)MAP_FAILED) {
+        return false;
+    }
+#else
+    data = (uint8_t *)malloc(size);
+    if (data == NULL || read(fd, data, (uint)size) != (int)size) {
+        free(data);
+        close(fd);
+        return false;
+    }
+    close(fd);
+#endif
+
+    s_arcData    = data;
+    s_arcSize    = size;
+    s_arcHeader  = (const ArcHeader *)data;
+    s_arcEntries = (const ArcEntry *)(s_arcHeader + 1);
+
+    if (s_arcHeader->magic != ARCMAGIC || s_arcHeader->numBuckets == 0 ||
+        (s_arcHeader->numBuckets & (s_arcHeader->numBuckets - 1)) != 0 ||
+        sizeof(ArcHeader) + s_arcHeader->numBuckets * sizeof(ArcEntry) >
+          size) {
+        CloseResArchive();
+        return false;
+    }
+
+    for (i = 0; i < s_arcHeader->numBuckets; i++) {
+        entry = &s_arcEntries[i];
+        if (entry->resType != 0 &&
+            entry->offset + entry->packedSize <= (uint64_t)size) {
+            AddResIndex(SRC_ARCHIVE, entry->resType, entry->resNum, i);
+        }
+    }
+
+    SetResArchive(&s_archive);
+    return true;
+}
+
+void CloseResArchive(void)
+{
+    if (s_arcData == NULL) {
+        return;
+    }
+
+    SetResArchive(NULL);
+    ClearResIndex(SRC_ARCHIVE);
+
+#if !defined(__WINDOWS__)
+    munmap((void *)s_arcData, s_arcSize);
+#else
+    free((void *)s_arcData);
+#endif
+
+    s_arcData    = NULL;
+    s_arcSize    = 0;
+    s_arcHeader  = NULL;
+    s_arcEntries = NULL;
+}
+
+const ArcEntry *FindArcEntry(int resType, size_t resNum)
+{
+    const ArcEntry *entry;
+    uint            mask;
+    uint            i, n;
+
+    if (s_arcHeader == NULL) {
+        return NULL;
+    }
+
+    mask = s_arcHeader->numBuckets - 1;
+    i    = ARCHASH(resType, resNum) & mask;
+    for (n = 0; n <= mask; n++, i = (i + 1) & mask) {
+        entry = &s_arcEntries[i];
+        if (entry->resType == 0) {
+            break;
+        }
+        if ((int)entry->resType == resType && (size_t)entry->resNum == resNum) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+Handle LoadArcEntry(const ArcEntry *entry)
+{
+    const uint8_t *payload = s_arcData + entry->offset;
+    Handle         handle;
+    bool           ok = false;
+
+    handle = GetResHandle(entry->length);
+    if (handle == NULL) {
+        return NULL;
+    }
+
+    switch (entry->compression) {
+        case ARC_STORED:
+            if (entry->packedSize == entry->length) {
+                memcpy(handle, payload, entry->length);
+                ok = true;
+            }
+            break;
+
+        case ARC_LZ:
+            ok = LzDecompress(
+              handle, entry->length, payload, entry->packedSize);
+            break;
+    }
+
+    if (!ok || ArcChecksum(handle, entry->length) != entry->checksum) {
+        DisposeResHandle(handle);
+        return NULL;
+    }
+    return handle;
+}
+
+uint32_t ArcChecksum(const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint32_t       hash  = 2166136261U;
+    size_t         i;
+
+    for (i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619U;
+    }
+    return hash;
+}
+
+static Handle LoadArchived(int resType, size_t resNum, uint64_t loc)
+{
+    if (s_arcHeader == NULL || loc >= s_arcHeader->numBuckets) {
+        return NULL;
+    }
+    return LoadArcEntry(&s_arcEntries[loc]);
+}
@@ -0,0 +1,294 @@
+#include "sci/Kernel/ResCache.h"
+#include "sci/Kernel/Resource.h"
+#include "sci/Utils/FileIO.h"
+#include "sci/Utils/List.h"
+#include "sci/Utils/Path.h"
+#include "sci/Utils/Thread.h"
+#if !defined(__WINDOWS__)
+#include <sys/mman.h>
+#endif
+
+#define CACHEDIR   "C:RESCACHE" // with the saved games
+#define CACHEMAGIC 0x31435253 // "SRC1"
+#define MAXVOLUMES 64
+
+// Upper bound on the data waiting to be written. Resources stored while the
+// writer is behind are simply not cached this time.
+#define MAXPENDINGBYTES (4 * 1024 * 1024)
+
+typedef struct CacheHeader {
+    uint32_t magic;
+    uint32_t checksum; // map and volumes checksum
+    uint32_t length;   // of the resource data that follows
+} CacheHeader;
+
+typedef struct CacheJob {
+    Node    link;
+    int     resType;
+    size_t  resNum;
+    uint    length;
+    uint8_t data[1];
+} CacheJob;
+
+bool g_resCacheEnabled = true;
+
+static bool     s_cacheOpen = false;
+static uint32_t s_checksum  = 0;
+
+static Mutex   s_mutex;
+static CondVar s_cond;
+static Thread  s_writer;
+static List    s_jobs         = LIST_INITIALIZER;
+static size_t  s_pendingBytes = 0;
+static bool    s_quit         = false;
+static bool    s_atExitSet    = false;
+
+static uint32_t Checksum(uint32_t hash, const void *data, size_t size);
+static uint32_t VolumesChecksum(uint32_t hash, const char *volName);
+static void     MakeCachePath(char *name, int resType, size_t resNum);
+static void     CacheWriter(void *arg);
+static void     WriteEntry(const CacheJob *job);
+
+void InitResCache(const void *resMap, size_t mapSize, const char *volName)
+{
+    char dir[PATH_MAX];
+
+    if (!g_resCacheEnabled || s_cacheOpen) {
+        return;
+    }
+
+    s_checksum = Checksum(2166136261U, resMap, mapSize);
+    s_checksum = VolumesChecksum(s_checksum, volName);
+
+    DosToLocalPath(dir, CACHEDIR, false);
+#if defined(__WINDOWS__)
+    _mkdir(dir);
+#else
+    mkdir(dir, 0777);
+#endif
+
+    CreateMutex(&s_mutex, false);
+    CreateCondVar(&s_cond);
+    s_quit = false;
+    if (!StartThread(&s_writer, CacheWriter, NULL)) {
+        DestroyCondVar(&s_cond);
+        DestroyMutex(&s_mutex);
+        return;
+    }
+
+    s_cacheOpen = true;
+    if (!s_atExitSet) {
+        atexit(EndResCache);
+        s_atExitSet = true;
+    }
+}
+
+void EndResCache(void)
+{
+    if (!s_cacheOpen) {
+        return;
+    }
+
+    LockMutex(&s_mutex);
+    s_quit = true;
+    SignalCondVar(&s_cond);
+    UnlockMutex(&s_mutex);
+
+    JoinThread(&s_writer);
+    DestroyCondVar(&s_cond);
+    DestroyMutex(&s_mutex);
+    s_cacheOpen = false;
+}
+
+Handle ResCacheLoad(int resType, size_t resNum)
+{
+    char        name[PATH_MAX];
+    CacheHeader header;
+    Handle      handle = NULL;
+    long        size;
+    int         fd;
+
+    if (!s_cacheOpen) {
+        return NULL;
+    }
+
+    MakeCachePath(name, resType, resNum);
+    fd = fileopen(name, O_RDONLY);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    size = filelength(fd);
+    if (size < (long)sizeof(CacheHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+#if !defined(__WINDOWS__)
+    {
+        const uint8_t *map;
+
+        map = (const uint8_t *)mmap(
+          NULL, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map == (const uint8_t *)MAP_FAILED) {
+            return NULL;
+        }
+
+        memcpy(&header, map, sizeof(CacheHeader));
+        if (header.magic == CACHEMAGIC && header.checksum == s_checksum &&
+            header.length == (size_t)size - sizeof(CacheHeader)) {
+            handle = GetResHandle(header.length);
+            if (handle != NULL) {
+                memcpy(handle, map + sizeof(CacheHeader), header.length);
+            }
+        }
+        munmap((void *)map, (size_t)size);
+    }
+#else
+    if (read(fd, &header, sizeof(CacheHeader)) == sizeof(CacheHeader) &&
+        header.magic == CACHEMAGIC && header.checksum == s_checksum &&
+        header.length == (size_t)size - sizeof(CacheHeader)) {
+        handle = GetResHandle(header.length);
+        if (handle != NULL &&
+            read(fd, handle, header.length) != (int)header.length) {
+            DisposeResHandle(handle);
+            handle = NULL;
+        }
+    }
+    close(fd);
+#endif
+    return handle;
+}
+
+void ResCacheStore(int resType, size_t resNum, Handle data)
+{
+    CacheJob *job;
+    uint      length;
+
+    if (!s_cacheOpen || data == NULL) {
+        return;
+    }
+
+    length = ResHandleSize(data);
+
+    LockMutex(&s_mutex);
+    if (s_pendingBytes + length <= MAXPENDINGBYTES) {
+        job = (CacheJob *)malloc(sizeof(CacheJob) + length);
+        if (job != NULL) {
+            job->resType = resType;
+            job->resNum  = resNum;
+            job->length  = length;
+            memcpy(job->data, data, length);
+
+            s_pendingBytes += length;
+            AddToEnd(&s_jobs, ToNode(job));
+            SignalCondVar(&s_cond);
+        }
+    }
+    UnlockMutex(&s_mutex);
+}
+
+// FNV-1a.
+static uint32_t Checksum(uint32_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+
+    while (size-- != 0) {
+        hash = (hash ^ *bytes++) * 16777619U;
+    }
+    return hash;
+}
+
+static uint32_t VolumesChecksum(uint32_t hash, const char *volName)
+{
+    char        fileName[64];
+    char        path[PATH_MAX];
+    struct stat info;
+    uint32_t    stamp[3];
+    uint        volNum;
+
+    for (volNum = 0; volNum < MAXVOLUMES; volNum++) {
+        sprintf(fileName, "%s.%03u", volName, volNum);
+        DosToLocalPath(path, fileName, true);
+        if (stat(path, &info) == 0) {
+            stamp[0] = volNum;
+            stamp[1] = (uint32_t)info.st_size;
+            stamp[2] = (uint32_t)info.st_mtime;
+            hash     = Checksum(hash, stamp, sizeof(stamp));
+        }
+    }
+    return hash;
+}
+
+static void MakeCachePath(char *name, int resType, size_t resNum)
+{
+    sprintf(name, "%s\\%02X%05u.RES", CACHEDIR, (uint)resType, (uint)resNum);
+}
+
+static void CacheWriter(void *arg)
+{
+    CacheJob *job;
+
+    LockMutex(&s_mutex);
+    forever() {
+        while (EmptyList(&s_jobs) && !s_quit) {
+            WaitCondVar(&s_cond, &s_mutex);
+        }
+
+        if (EmptyList(&s_jobs)) {
+            break;
+        }
+
+        job = FromNode(FirstNode(&s_jobs), CacheJob);
+        DeleteNode(&s_jobs, ToNode(job));
+        UnlockMutex(&s_mutex);
+
+        WriteEntry(job);
+
+        LockMutex(&s_mutex);
+        s_pendingBytes -= job->length;
+        free(job);
+    }
+    UnlockMutex(&s_mutex);
+}
+
+static void WriteEntry(const CacheJob *job)
+{
+    char        name[PATH_MAX];
+    char        tmpName[PATH_MAX + 4];
+    char        path[PATH_MAX];
+    char        tmpPath[PATH_MAX];
+    CacheHeader header;
+    bool        ok;
+    int         fd;
+
+    // Write to a temporary file and rename it, so that a reader (or the next
+    // run, should we be killed midway) never sees a partial entry.
+    MakeCachePath(name, job->resType, job->resNum);
+    sprintf(tmpName, "%s.TMP", name);
+    DosToLocalPath(path, name, false);
+    DosToLocalPath(tmpPath, tmpName, false);
+
+    fd = fileopen(tmpName, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd == -1) {
+        return;
+    }
+
+    header.magic    = CACHEMAGIC;
+    header.checksum = s_checksum;
+    header.length   = job->length;
+
+    ok = (write(fd, &header, sizeof(CacheHeader)) == sizeof(CacheHeader) &&
+          write(fd, job->data, job->length) == (int)job->length);
+    close(fd);
+
+    if (ok) {
+        unlink(path);
+        ok = (rename(tmpPath, path) == 0);
+    }
+
+    if (!ok) {
+        unlink(tmpPath);
+    }
+}
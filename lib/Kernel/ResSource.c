@@ -0,0 +1,427 @@
+#include "sci/Kernel/ResSource.h"
+#include "sci/Kernel/ResName.h"
+#include "sci/Kernel/Resource.h"
+#include "sci/Utils/FileIO.h"
+#include "sci/Utils/Mutex.h"
+#include "sci/Utils/Path.h"
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+#define MINBUCKETS 1024
+
+#define RESKEY(resType, resNum)                                                \
+    (((uint32_t)(resType) << 16) | (uint32_t)(uint16_t)(resNum))
+
+// An entry of the index holds the location of the resource in every source
+// that has it, so that removing it from one source uncovers the next.
+// Entries are never deleted: one that no source has any more is just empty.
+typedef struct IndexEntry {
+    uint32_t key; // zero for an unused bucket
+    uint8_t  sources;
+    uint64_t loc[NRESSOURCES];
+} IndexEntry;
+
+static IndexEntry *s_index     = NULL;
+static uint        s_buckets   = 0;
+static uint        s_used      = 0;
+static bool        s_indexInit = false;
+static Mutex       s_indexMutex;
+
+static const ResArchive *s_archive = NULL;
+
+#if defined(__linux__)
+static int s_watchFd = -1;
+#endif
+
+static IndexEntry *FindBucket(IndexEntry *index, uint buckets, uint32_t key);
+static bool        GrowIndex(void);
+static void        LockIndex(void);
+static int         PatchFileType(const char *name, size_t *resNum);
+static int         PatchFileName(const char *name, size_t *resNum);
+static bool        SameName(const char *name1, const char *name2, size_t len);
+static void        WatchPatchDir(void);
+
+void AddResIndex(int source, int resType, size_t resNum, uint64_t loc)
+{
+    IndexEntry *entry;
+    uint32_t    key = RESKEY(resType, resNum);
+
+    LockIndex();
+    if ((s_used + 1) * 2 > s_buckets && !GrowIndex()) {
+        UnlockMutex(&s_indexMutex);
+        return;
+    }
+
+    entry = FindBucket(s_index, s_buckets, key);
+    if (entry->key == 0) {
+        entry->key = key;
+        s_used++;
+    }
+
+    entry->sources |= (uint8_t)(1 << source);
+    entry->loc[source] = loc;
+    UnlockMutex(&s_indexMutex);
+}
+
+void RemoveResIndex(int source, int resType, size_t resNum)
+{
+    IndexEntry *entry;
+
+    LockIndex();
+    if (s_index != NULL) {
+        entry = FindBucket(s_index, s_buckets, RESKEY(resType, resNum));
+        if (entry->key != 0) {
+            if (source == SRC_OVERRIDE &&
+                (entry->sources & (1 << SRC_OVERRIDE)) != 0) {
+                DisposeResHandle((Handle)(uintptr_t)entry->loc[source]);
+            }
+            entry->sources &= (uint8_t)~(1 << source);
+        }
+    }
+    UnlockMutex(&s_indexMutex);
+}
+
+void ClearResIndex(int source)
+{
+    uint i;
+
+    LockIndex();
+    for (i = 0; i < s_buckets; i++) {
+        if ((s_index[i].sources & (1 << source)) != 0) {
+            if (source == SRC_OVERRIDE) {
+                DisposeResHandle((Handle)(uintptr_t)s_index[i].loc[source]);
+            }
+            s_index[i].sources &= (uint8_t)~(1 << source);
+        }
+    }
+    UnlockMutex(&s_indexMutex);
+}
+
+uint FindResSources(int resType, size_t resNum, uint64_t loc[NRESSOURCES])
+{
+    IndexEntry *entry;
+    uint        sources = 0;
+
+    LockIndex();
+    if (s_index != NULL) {
+        entry   = FindBucket(s_index, s_buckets, RESKEY(resType, resNum));
+        sources = entry->sources;
+        memcpy(loc, entry->loc, sizeof(entry->loc));
+    }
+    UnlockMutex(&s_indexMutex);
+    return sources;
+}
+
+bool FindResInSource(int source, int resType, size_t resNum, uint64_t *loc)
+{
+    IndexEntry *entry;
+    bool        found = false;
+
+    LockIndex();
+    if (s_index != NULL) {
+        entry = FindBucket(s_index, s_buckets, RESKEY(resType, resNum));
+        if ((entry->sources & (1 << source)) != 0) {
+            if (loc != NULL) {
+                *loc = entry->loc[source];
+            }
+            found = true;
+        }
+    }
+    UnlockMutex(&s_indexMutex);
+    return found;
+}
+
+void ForEachResIndex(int source,
+                     void (*proc)(int resType, size_t resNum, void *arg),
+                     void *arg)
+{
+    uint i;
+
+    LockIndex();
+    for (i = 0; i < s_buckets; i++) {
+        if ((s_index[i].sources & (1 << source)) != 0) {
+            proc((int)(s_index[i].key >> 16),
+                 (size_t)(s_index[i].key & 0xffff),
+                 arg);
+        }
+    }
+    UnlockMutex(&s_indexMutex);
+}
+
+bool FindPatchEntry(int resType, size_t resNum)
+{
+    return FindResInSource(SRC_PATCH, resType, resNum, NULL);
+}
+
+void InitPatches(void)
+{
+    DirEntry fileInfo;
+    size_t   resNum;
+    int      resType;
+
+    ClearResIndex(SRC_PATCH);
+
+    // One pass over the directory, sorting the files out by name.
+    if (firstfile("*", 0, &fileInfo)) {
+        do {
+            if ((fileInfo.atr & F_SUBDIR) == 0) {
+                resType = PatchFileType(fileInfo.name, &resNum);
+                if (resType != -1) {
+                    AddResIndex(SRC_PATCH, resType, resNum, 0);
+                }
+            }
+        } while (nextfile(&fileInfo));
+    }
+
+    WatchPatchDir();
+}
+
+void PollPatchDir(void)
+{
+#if defined(__linux__)
+    char                        buf[4096];
+    const struct inotify_event *event;
+    ssize_t                     len;
+    size_t                      resNum;
+    int                         resType;
+    char                       *ptr;
+
+    if (s_watchFd == -1) {
+        return;
+    }
+
+    while ((len = read(s_watchFd, buf, sizeof(buf))) > 0) {
+        for (ptr = buf; ptr < buf + len;
+             ptr += sizeof(struct inotify_event) + event->len) {
+            event = (const struct inotify_event *)ptr;
+
+            // The queue overflowed: start over.
+            if ((event->mask & IN_Q_OVERFLOW) != 0) {
+                InitPatches();
+                return;
+            }
+
+            if (event->len == 0 || (event->mask & IN_ISDIR) != 0) {
+                continue;
+            }
+
+            resType = PatchFileType(event->name, &resNum);
+            if (resType == -1) {
+                continue;
+            }
+
+            if ((event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0) {
+                RemoveResIndex(SRC_PATCH, resType, resNum);
+            } else {
+                AddResIndex(SRC_PATCH, resType, resNum, 0);
+            }
+        }
+    }
+#endif
+}
+
+bool SetResOverride(int resType, size_t resNum, const void *data, uint size)
+{
+    Handle copy;
+
+    copy = GetResHandle(size);
+    if (copy == NULL) {
+        return false;
+    }
+
+    memcpy(copy, data, size);
+    RemoveResIndex(SRC_OVERRIDE, resType, resNum);
+    AddResIndex(SRC_OVERRIDE, resType, resNum, (uint64_t)(uintptr_t)copy);
+    if (!FindResInSource(SRC_OVERRIDE, resType, resNum, NULL)) {
+        DisposeResHandle(copy);
+        return false;
+    }
+    return true;
+}
+
+void ClearResOverride(int resType, size_t resNum)
+{
+    RemoveResIndex(SRC_OVERRIDE, resType, resNum);
+}
+
+Handle LoadResOverride(int resType, size_t resNum)
+{
+    IndexEntry *entry;
+    Handle      data;
+    Handle      copy = NULL;
+
+    // Copy with the index held, so that the override can't go away meanwhile.
+    LockIndex();
+    if (s_index != NULL) {
+        entry = FindBucket(s_index, s_buckets, RESKEY(resType, resNum));
+        if ((entry->sources & (1 << SRC_OVERRIDE)) != 0) {
+            data = (Handle)(uintptr_t)entry->loc[SRC_OVERRIDE];
+            copy = GetResHandle(ResHandleSize(data));
+            if (copy != NULL) {
+                memcpy(copy, data, ResHandleSize(data));
+            }
+        }
+    }
+    UnlockMutex(&s_indexMutex);
+    return copy;
+}
+
+void SetResArchive(const ResArchive *archive)
+{
+    s_archive = archive;
+}
+
+const ResArchive *GetResArchive(void)
+{
+    return s_archive;
+}
+
+static IndexEntry *FindBucket(IndexEntry *index, uint buckets, uint32_t key)
+{
+    uint i = (key * 2654435761U) & (buckets - 1);
+
+    while (index[i].key != 0 && index[i].key != key) {
+        i = (i + 1) & (buckets - 1);
+    }
+    return &index[i];
+}
+
+// Must be called with the index locked.
+static bool GrowIndex(void)
+{
+    IndexEntry *index;
+    uint        buckets;
+    uint        i;
+
+    buckets = (s_buckets != 0) ? s_buckets * 2 : MINBUCKETS;
+    index   = (IndexEntry *)calloc(buckets, sizeof(IndexEntry));
+    if (index == NULL) {
+        return false;
+    }
+
+    for (i = 0; i < s_buckets; i++) {
+        if (s_index[i].key != 0) {
+            *FindBucket(index, buckets, s_index[i].key) = s_index[i];
+        }
+    }
+
+    free(s_index);
+    s_index   = index;
+    s_buckets = buckets;
+    return true;
+}
+
+static void LockIndex(void)
+{
+    if (!s_indexInit) {
+        CreateMutex(&s_indexMutex, false);
+        s_indexInit = true;
+    }
+    LockMutex(&s_indexMutex);
+}
+
+// Return the type of resource patched by the file, or -1 if it isn't a patch
+// file.
+static int PatchFileType(const char *name, size_t *resNum)
+{
+    int resType = PatchFileName(name, resNum);
+
+#if defined(__WINDOWS__) || defined(__IOS__)
+    // Sound patches are numbered from 1000.
+    if (resType == RES_SOUND) {
+        if (*resNum < 1000) {
+            return -1;
+        }
+        *resNum -= 1000;
+    }
+#endif
+    return resType;
+}
+
+static int PatchFileName(const char *name, size_t *resNum)
+{
+    const char *ext;
+    const char *mask;
+    int         resType;
+
+    if (g_newResName) {
+        // <number>.<extension>
+        if (!isdigit(name[0])) {
+            return -1;
+        }
+
+        ext = strchr(name, '.');
+        if (ext == NULL) {
+            return -1;
+        }
+
+        for (resType = RES_BASE; resType < (RES_BASE + NRESTYPES); ++resType) {
+            mask = g_resTypes[resType - RES_BASE].defaultMask;
+            if (mask != NULL && strlen(ext + 1) == strlen(mask + 2) &&
+                SameName(ext + 1, mask + 2, strlen(mask + 2))) {
+                *resNum = (size_t)atoi(name);
+                return resType;
+            }
+        }
+    } else {
+        // <type name>.<number>
+        ext = strchr(name, '.');
+        if (ext == NULL || !isdigit(ext[1])) {
+            return -1;
+        }
+
+        for (resType = RES_BASE; resType < (RES_BASE + NRESTYPES); ++resType) {
+            mask = g_resTypes[resType - RES_BASE].name;
+            if (strlen(mask) == (size_t)(ext - name) &&
+                SameName(name, mask, (size_t)(ext - name))) {
+                *resNum = (size_t)atoi(ext + 1);
+                return resType;
+            }
+        }
+    }
+    return -1;
+}
+
+// Return TRUE if the first 'len' characters of the names are the same,
+// whatever their case, as for the file names of DOS and Windows.
+static bool SameName(const char *name1, const char *name2, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; ++i) {
+        if (tolower((uchar)name1[i]) != tolower((uchar)name2[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void WatchPatchDir(void)
+{
+#if defined(__linux__)
+    char path[PATH_MAX];
+
+    if (s_watchFd != -1) {
+        return;
+    }
+
+    s_watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (s_watchFd == -1) {
+        return;
+    }
+
+    DosToLocalPath(path, "", true);
+    if (path[0] == '\0') {
+        strcpy(path, ".");
+    }
+
+    if (inotify_add_watch(s_watchFd,
+                          path,
+                          IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+                            IN_MOVED_FROM | IN_MOVED_TO) == -1) {
+        close(s_watchFd);
+        s_watchFd = -1;
+    }
+#endif
+}
@@ -1,18 +1,19 @@
 #include "sci/Kernel/Resource.h"
+#include "sci/Kernel/Animate.h"
+#include "sci/Kernel/CelCache.h"
+#include "sci/Kernel/FontCache.h"
+#include "sci/Kernel/Prefetch.h"
 #include "sci/Kernel/ResName.h"
 #include "sci/Kernel/VolLoad.h"
 #include "sci/Utils/FileIO.h"
+#include "sci/Utils/Thread.h"
 
 #define NIL NullNode(LoadLink)
 
-typedef struct ResPatchEntry {
-    uint8_t  resType;
-    uint16_t resNum;
-} ResPatchEntry;
-
 List g_loadList = LIST_INITIALIZER;
 
-static Handle s_patches = NULL;
+// The prefetch threads allocate handles too, so each thread counts its own.
+static THREAD_LOCAL uint s_handleCount = 0;
 
 Handle ResLoad(int resType, size_t resNum)
 {
@@ -47,8 +48,15 @@ Handle ResLoad(int resType, size_t resNum)
             return NULL;
         }
 
+        NoteRoomLoad(resType, resNum);
+
+        // Use (or wait for) a background load of the resource if there is
+        // one, rather than loading it a second time.
         scan->locked = false;
-        scan->data   = DoLoad(resType, resNum);
+        scan->data   = TakePrefetched(resType, resNum);
+        if (scan->data == NULL) {
+            scan->data = DoLoad(resType, resNum);
+        }
     }
 
     scan->type = (uint8_t)resType;
@@ -60,13 +68,18 @@ Handle ResLoad(int resType, size_t resNum)
 void ResUnLoad(int resType, size_t resNum)
 {
     LoadLink *scan;
-    LoadLink *tmp;
 
     if (resNum != ALL_IDS) {
         scan = FindResEntry(resType, resNum);
         if (scan != NULL) {
             // Free the data from standard memory.
             if (scan->data != NULL) {
+                if (resType == RES_VIEW) {
+                    DropCachedCels(scan->data);
+                    DropActorViews(scan->data);
+                } else if (resType == RES_FONT) {
+                    DropFontAtlas(scan->data);
+                }
                 DisposeResHandle(scan->data);
             }
 
@@ -75,11 +88,16 @@ void ResUnLoad(int resType, size_t resNum)
             free((Handle)scan);
         }
     } else {
-        for (scan = FromNode(FirstNode(&g_loadList), LoadLink); scan != NIL;
-             scan = tmp) {
-            tmp = FromNode(NextNode(ToNode(scan)), LoadLink);
+        // Unloading a view or font drops what was made from it, so the walk
+        // starts again from the head after each unload rather than keeping a
+        // pointer to the next entry.
+        scan = FromNode(FirstNode(&g_loadList), LoadLink);
+        while (scan != NIL) {
             if (scan->type == resType) {
                 ResUnLoad(resType, scan->num);
+                scan = FromNode(FirstNode(&g_loadList), LoadLink);
+            } else {
+                scan = FromNode(NextNode(ToNode(scan)), LoadLink);
             }
         }
     }
@@ -128,9 +146,15 @@ Handle GetResHandle(uint size)
     }
 
     *handle = size;
+    ++s_handleCount;
     return handle + 1;
 }
 
+uint GetResHandleCount(void)
+{
+    return s_handleCount;
+}
+
 void DisposeResHandle(Handle handle)
 {
     if (handle != NULL) {
@@ -157,79 +181,3 @@ Handle LoadHandle(const char *fileName)
 
     return theHandle;
 }
-
-bool FindPatchEntry(int resType, size_t resNum)
-{
-    if (NULL != s_patches) {
-        ResPatchEntry *entry;
-        for (entry = (ResPatchEntry *)s_patches; entry->resType != 0; ++entry) {
-            if ((int)entry->resType == resType &&
-                (size_t)entry->resNum == resNum) {
-                return true;
-            }
-        }
-    }
-    return false;
-}
-
-void InitPatches(void)
-{
-    int            npatches = 0;
-    int            resType;
-    char           fileName[64];
-    ResPatchEntry *entry;
-    DirEntry       fileInfo;
-
-    for (resType = RES_BASE; resType < (RES_BASE + NRESTYPES); ++resType) {
-        ResNameMakeWildCard(fileName, resType);
-        if (firstfile(fileName, 0, &fileInfo)) {
-            do {
-                if ((fileInfo.atr & F_SUBDIR) == 0 &&
-                    isdigit(fileInfo.name[0])) {
-                    npatches++;
-                }
-            } while (nextfile(&fileInfo));
-        }
-    }
-
-    if (0 == npatches) {
-        return;
-    }
-
-    s_patches = ResLoad(RES_MEM, (npatches + 1) * sizeof(ResPatchEntry));
-    entry     = (ResPatchEntry *)s_patches;
-
-    for (resType = RES_BASE; resType < (RES_BASE + NRESTYPES); ++resType) {
-        ResNameMakeWildCard(fileName, resType);
-        if (firstfile(fileName, 0, &fileInfo)) {
-            do {
-                if ((fileInfo.atr & F_SUBDIR) == 0 &&
-                    isdigit(fileInfo.name[0])) {
-                    size_t         resNum;
-                    ResPatchEntry *tEntry;
-
-                    resNum = (size_t)atoi(fileInfo.name);
-
-                    // If the entry already exists, do not include it.
-                    for (tEntry = (ResPatchEntry *)s_patches; tEntry != entry;
-                         ++tEntry) {
-                        if ((int)tEntry->resType == resType &&
-                            (size_t)tEntry->resNum == resNum) {
-                            --npatches;
-                            break;
-                        }
-                    }
-
-                    if (tEntry == entry) {
-                        entry->resType = (uint8_t)resType;
-                        entry->resNum  = (uint16_t)resNum;
-                        ++entry;
-                    }
-                }
-            } while (nextfile(&fileInfo));
-        }
-    }
-
-    entry->resType = 0;
-    // ReallocateHandle(patches, (npatches + 1) * sizeof(ResPatchEntry));
-}
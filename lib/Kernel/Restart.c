@@ -1,9 +1,15 @@
 #include "sci/Kernel/Restart.h"
 #include "sci/Kernel/Animate.h"
+#include "sci/Kernel/CelCache.h"
+#include "sci/Kernel/FontCache.h"
 #include "sci/Kernel/Menu.h"
 #include "sci/Kernel/Midi.h"
+#include "sci/Kernel/Parse.h"
+#include "sci/Kernel/PicCache.h"
+#include "sci/Kernel/ResSource.h"
 #include "sci/Kernel/Resource.h"
 #include "sci/Kernel/Sound.h"
+#include "sci/Kernel/Text.h"
 #include "sci/PMachine/PMachine.h"
 
 #define ret(val) *acc = ((uintptr_t)(val))
@@ -23,6 +29,12 @@ void KRestartGame(argList)
     DisposeLastCast();
 
     // Free all memory.
+    FlushPicCache();
+    FlushCelCache();
+    FlushFontCache();
+    FlushTextLayouts();
+    ForgetSentence();
+    ResetFrameBits();
     ResUnLoad(RES_MEM, ALL_IDS);
 
     // Regenerate the 'patchable resources' table.
@@ -0,0 +1,541 @@
+#include "sci/Kernel/Spans.h"
+#include "sci/Driver/Display/Convert.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) ||            \
+  defined(_M_IX86)
+#define SPANS_X86
+#include <immintrin.h>
+#endif
+
+// Let the compiler emit the instructions of a level in one function only.
+#if defined(__GNUC__)
+#define TARGET(isa) __attribute__((target(isa)))
+#else
+#define TARGET(isa)
+#endif
+
+typedef void (*FillBytesProc)(uint8_t *dst, uint8_t value, uint count);
+typedef void (*FillBitsProc)(uint8_t *dst,
+                             uint8_t  mask,
+                             uint8_t  value,
+                             uint     count);
+typedef void (*BlitCelSpanProc)(uint8_t       *vis,
+                                uint8_t       *pc,
+                                const uint8_t *pixels,
+                                uint           count,
+                                uint8_t        priComp,
+                                uint8_t        priMask,
+                                uint8_t        priStore);
+typedef void (*FillMaskedProc)(uint8_t       *dst,
+                               const uint8_t *masks,
+                               uint8_t        value,
+                               uint           count);
+
+static void FillBytesScalar(uint8_t *dst, uint8_t value, uint count);
+static void FillBitsScalar(uint8_t *dst,
+                           uint8_t  mask,
+                           uint8_t  value,
+                           uint     count);
+static void BlitCelSpanScalar(uint8_t       *vis,
+                              uint8_t       *pc,
+                              const uint8_t *pixels,
+                              uint           count,
+                              uint8_t        priComp,
+                              uint8_t        priMask,
+                              uint8_t        priStore);
+static void FillMaskedScalar(uint8_t       *dst,
+                             const uint8_t *masks,
+                             uint8_t        value,
+                             uint           count);
+#if defined(SPANS_X86)
+static void FillBytesSSE2(uint8_t *dst, uint8_t value, uint count);
+static void FillBitsSSE2(uint8_t *dst, uint8_t mask, uint8_t value, uint count);
+static void BlitCelSpanSSE2(uint8_t       *vis,
+                            uint8_t       *pc,
+                            const uint8_t *pixels,
+                            uint           count,
+                            uint8_t        priComp,
+                            uint8_t        priMask,
+                            uint8_t        priStore);
+static void FillMaskedSSE2(uint8_t       *dst,
+                           const uint8_t *masks,
+                           uint8_t        value,
+                           uint           count);
+static void FillBytesAVX2(uint8_t *dst, uint8_t value, uint count);
+static void FillBitsAVX2(uint8_t *dst, uint8_t mask, uint8_t value, uint count);
+static void BlitCelSpanAVX2(uint8_t       *vis,
+                            uint8_t       *pc,
+                            const uint8_t *pixels,
+                            uint           count,
+                            uint8_t        priComp,
+                            uint8_t        priMask,
+                            uint8_t        priStore);
+static void FillMaskedAVX2(uint8_t       *dst,
+                           const uint8_t *masks,
+                           uint8_t        value,
+                           uint           count);
+#endif
+
+static const FillBytesProc s_fillBytes[NISALEVELS] = {
+    FillBytesScalar,
+#if defined(SPANS_X86)
+    FillBytesSSE2,
+    FillBytesAVX2,
+#else
+    NULL,
+    NULL,
+#endif
+};
+
+static const FillBitsProc s_fillBits[NISALEVELS] = {
+    FillBitsScalar,
+#if defined(SPANS_X86)
+    FillBitsSSE2,
+    FillBitsAVX2,
+#else
+    NULL,
+    NULL,
+#endif
+};
+
+static const BlitCelSpanProc s_blitCelSpan[NISALEVELS] = {
+    BlitCelSpanScalar,
+#if defined(SPANS_X86)
+    BlitCelSpanSSE2,
+    BlitCelSpanAVX2,
+#else
+    NULL,
+    NULL,
+#endif
+};
+
+static const FillMaskedProc s_fillMasked[NISALEVELS] = {
+    FillMaskedScalar,
+#if defined(SPANS_X86)
+    FillMaskedSSE2,
+    FillMaskedAVX2,
+#else
+    NULL,
+    NULL,
+#endif
+};
+
+static uint s_isa = NISALEVELS; // not chosen yet
+
+bool SetSpanIsa(uint isa)
+{
+    if (isa > GetBestIsa() || s_fillBytes[isa] == NULL) {
+        return false;
+    }
+
+    s_isa = isa;
+    return true;
+}
+
+uint GetSpanIsa(void)
+{
+    uint isa;
+
+    if (s_isa == NISALEVELS) {
+        // Use the best level there are kernels for.
+        for (isa = GetBestIsa(); s_fillBytes[isa] == NULL; --isa) {
+        }
+        s_isa = isa;
+    }
+    return s_isa;
+}
+
+void FillBytes(uint8_t *dst, uint8_t value, uint count)
+{
+    s_fillBytes[GetSpanIsa()](dst, value, count);
+}
+
+void FillBits(uint8_t *dst, uint8_t mask, uint8_t value, uint count)
+{
+    s_fillBits[GetSpanIsa()](dst, mask, value, count);
+}
+
+void BlitCelSpan(uint8_t       *vis,
+                 uint8_t       *pc,
+                 const uint8_t *pixels,
+                 uint           count,
+                 uint8_t        priComp,
+                 uint8_t        priMask,
+                 uint8_t        priStore)
+{
+    s_blitCelSpan[GetSpanIsa()](vis, pc, pixels, count, priComp, priMask,
+                                priStore);
+}
+
+void FillMasked(uint8_t *dst, const uint8_t *masks, uint8_t value, uint count)
+{
+    s_fillMasked[GetSpanIsa()](dst, masks, value, count);
+}
+
+static void FillBytesScalar(uint8_t *dst, uint8_t value, uint count)
+{
+    uint i;
+
+    for (i = 0; i < count; ++i) {
+        dst[i] = value;
+    }
+}
+
+static void FillBitsScalar(uint8_t *dst,
+                           uint8_t  mask,
+                           uint8_t  value,
+                           uint     count)
+{
+    uint i;
+
+    for (i = 0; i < count; ++i) {
+        dst[i] = (uint8_t)((dst[i] & ~mask) | value);
+    }
+}
+
+static void BlitCelSpanScalar(uint8_t       *vis,
+                              uint8_t       *pc,
+                              const uint8_t *pixels,
+                              uint           count,
+                              uint8_t        priComp,
+                              uint8_t        priMask,
+                              uint8_t        priStore)
+{
+    uint i;
+
+    for (i = 0; i < count; ++i) {
+        if (priComp >= pc[i]) {
+            pc[i]  = (uint8_t)((pc[i] & priMask) | priStore);
+            vis[i] = pixels[i];
+        }
+    }
+}
+
+static void FillMaskedScalar(uint8_t       *dst,
+                             const uint8_t *masks,
+                             uint8_t        value,
+                             uint           count)
+{
+    uint i;
+
+    for (i = 0; i < count; ++i) {
+        dst[i] = (uint8_t)((dst[i] & ~masks[i]) | (value & masks[i]));
+    }
+}
+
+#if defined(SPANS_X86)
+
+TARGET("sse2")
+static void FillBytesSSE2(uint8_t *dst, uint8_t value, uint count)
+{
+    __m128i values = _mm_set1_epi8((char)value);
+    uint    i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        _mm_storeu_si128((__m128i *)(dst + i), values);
+    }
+
+    FillBytesScalar(dst + i, value, count - i);
+}
+
+TARGET("sse2")
+static void FillBitsSSE2(uint8_t *dst, uint8_t mask, uint8_t value, uint count)
+{
+    __m128i keep   = _mm_set1_epi8((char)~mask);
+    __m128i values = _mm_set1_epi8((char)value);
+    __m128i bytes;
+    uint    i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        bytes = _mm_loadu_si128((const __m128i *)(dst + i));
+        bytes = _mm_or_si128(_mm_and_si128(bytes, keep), values);
+        _mm_storeu_si128((__m128i *)(dst + i), bytes);
+    }
+
+    FillBitsScalar(dst + i, mask, value, count - i);
+}
+
+// The pixels drawn are those whose priority/control byte is at most priComp,
+// unsigned: the maximum of the two is then priComp. The stores write back the
+// bytes not drawn unchanged.
+TARGET("sse2")
+static void BlitCelSpanSSE2(uint8_t       *vis,
+                            uint8_t       *pc,
+                            const uint8_t *pixels,
+                            uint           count,
+                            uint8_t        priComp,
+                            uint8_t        priMask,
+                            uint8_t        priStore)
+{
+    __m128i comp  = _mm_set1_epi8((char)priComp);
+    __m128i keep  = _mm_set1_epi8((char)priMask);
+    __m128i store = _mm_set1_epi8((char)priStore);
+    __m128i pri, draw, bytes;
+    uint    i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        pri  = _mm_loadu_si128((const __m128i *)(pc + i));
+        draw = _mm_cmpeq_epi8(_mm_max_epu8(pri, comp), comp);
+
+        bytes = _mm_or_si128(_mm_and_si128(pri, keep), store);
+        bytes = _mm_or_si128(_mm_and_si128(draw, bytes),
+                             _mm_andnot_si128(draw, pri));
+        _mm_storeu_si128((__m128i *)(pc + i), bytes);
+
+        bytes = _mm_loadu_si128((const __m128i *)(vis + i));
+        bytes = _mm_or_si128(
+          _mm_and_si128(draw, _mm_loadu_si128((const __m128i *)(pixels + i))),
+          _mm_andnot_si128(draw, bytes));
+        _mm_storeu_si128((__m128i *)(vis + i), bytes);
+    }
+
+    // Most spans of sprites are short, so do half a register before the
+    // scalar tail.
+    if (i + 8 <= count) {
+        pri  = _mm_loadl_epi64((const __m128i *)(pc + i));
+        draw = _mm_cmpeq_epi8(_mm_max_epu8(pri, comp), comp);
+
+        bytes = _mm_or_si128(_mm_and_si128(pri, keep), store);
+        bytes = _mm_or_si128(_mm_and_si128(draw, bytes),
+                             _mm_andnot_si128(draw, pri));
+        _mm_storel_epi64((__m128i *)(pc + i), bytes);
+
+        bytes = _mm_loadl_epi64((const __m128i *)(vis + i));
+        bytes = _mm_or_si128(
+          _mm_and_si128(draw, _mm_loadl_epi64((const __m128i *)(pixels + i))),
+          _mm_andnot_si128(draw, bytes));
+        _mm_storel_epi64((__m128i *)(vis + i), bytes);
+        i += 8;
+    }
+
+    BlitCelSpanScalar(vis + i, pc + i, pixels + i, count - i, priComp, priMask,
+                      priStore);
+}
+
+// Setting a byte twice leaves it as setting it once, so the bytes left over
+// from the wider writes are set by a last write that ends with the span, and
+// a span of 4 to 16 bytes by two writes that overlap. Both sides of an
+// overlap are read before either is written, which also keeps the reads from
+// waiting on the writes.
+TARGET("sse2")
+static void FillMaskedSSE2(uint8_t       *dst,
+                           const uint8_t *masks,
+                           uint8_t        value,
+                           uint           count)
+{
+    __m128i values = _mm_set1_epi8((char)value);
+    __m128i mask, bytes, last;
+    int32_t word, lastWord;
+    uint    i;
+
+    if (count >= 16) {
+        mask = _mm_loadu_si128((const __m128i *)(masks + count - 16));
+        last = _mm_loadu_si128((const __m128i *)(dst + count - 16));
+        last = _mm_or_si128(_mm_andnot_si128(mask, last),
+                            _mm_and_si128(mask, values));
+        for (i = 0; i + 16 < count; i += 16) {
+            mask  = _mm_loadu_si128((const __m128i *)(masks + i));
+            bytes = _mm_loadu_si128((const __m128i *)(dst + i));
+            bytes = _mm_or_si128(_mm_andnot_si128(mask, bytes),
+                                 _mm_and_si128(mask, values));
+            _mm_storeu_si128((__m128i *)(dst + i), bytes);
+        }
+        _mm_storeu_si128((__m128i *)(dst + count - 16), last);
+    } else if (count >= 8) {
+        mask  = _mm_loadl_epi64((const __m128i *)masks);
+        bytes = _mm_loadl_epi64((const __m128i *)dst);
+        bytes = _mm_or_si128(_mm_andnot_si128(mask, bytes),
+                             _mm_and_si128(mask, values));
+        mask  = _mm_loadl_epi64((const __m128i *)(masks + count - 8));
+        last  = _mm_loadl_epi64((const __m128i *)(dst + count - 8));
+        last  = _mm_or_si128(_mm_andnot_si128(mask, last),
+                             _mm_and_si128(mask, values));
+        _mm_storel_epi64((__m128i *)dst, bytes);
+        _mm_storel_epi64((__m128i *)(dst + count - 8), last);
+    } else if (count >= 4) {
+        memcpy(&word, masks, sizeof(word));
+        mask = _mm_cvtsi32_si128(word);
+        memcpy(&word, dst, sizeof(word));
+        bytes = _mm_or_si128(_mm_andnot_si128(mask, _mm_cvtsi32_si128(word)),
+                             _mm_and_si128(mask, values));
+        memcpy(&word, masks + count - 4, sizeof(word));
+        mask = _mm_cvtsi32_si128(word);
+        memcpy(&word, dst + count - 4, sizeof(word));
+        last = _mm_or_si128(_mm_andnot_si128(mask, _mm_cvtsi32_si128(word)),
+                            _mm_and_si128(mask, values));
+        word     = _mm_cvtsi128_si32(bytes);
+        lastWord = _mm_cvtsi128_si32(last);
+        memcpy(dst, &word, sizeof(word));
+        memcpy(dst + count - 4, &lastWord, sizeof(lastWord));
+    } else {
+        FillMaskedScalar(dst, masks, value, count);
+    }
+}
+
+TARGET("avx2")
+static void FillBytesAVX2(uint8_t *dst, uint8_t value, uint count)
+{
+    __m256i values = _mm256_set1_epi8((char)value);
+    uint    i;
+
+    for (i = 0; i + 32 <= count; i += 32) {
+        _mm256_storeu_si256((__m256i *)(dst + i), values);
+    }
+
+    // The SSE2 kernels are not VEX encoded, and run slowly after AVX
+    // instructions unless the upper halves of the registers are cleared.
+    _mm256_zeroupper();
+    FillBytesSSE2(dst + i, value, count - i);
+}
+
+TARGET("avx2")
+static void FillBitsAVX2(uint8_t *dst, uint8_t mask, uint8_t value, uint count)
+{
+    __m256i keep   = _mm256_set1_epi8((char)~mask);
+    __m256i values = _mm256_set1_epi8((char)value);
+    __m256i bytes;
+    uint    i;
+
+    for (i = 0; i + 32 <= count; i += 32) {
+        bytes = _mm256_loadu_si256((const __m256i *)(dst + i));
+        bytes = _mm256_or_si256(_mm256_and_si256(bytes, keep), values);
+        _mm256_storeu_si256((__m256i *)(dst + i), bytes);
+    }
+
+    _mm256_zeroupper();
+    FillBitsSSE2(dst + i, mask, value, count - i);
+}
+
+TARGET("avx2")
+static void BlitCelSpanAVX2(uint8_t       *vis,
+                            uint8_t       *pc,
+                            const uint8_t *pixels,
+                            uint           count,
+                            uint8_t        priComp,
+                            uint8_t        priMask,
+                            uint8_t        priStore)
+{
+    __m256i comp  = _mm256_set1_epi8((char)priComp);
+    __m256i keep  = _mm256_set1_epi8((char)priMask);
+    __m256i store = _mm256_set1_epi8((char)priStore);
+    __m256i pri, draw, bytes;
+    __m128i comp4, keep4, store4;
+    __m128i pri4, draw4, bytes4;
+    uint    i;
+
+    for (i = 0; i + 32 <= count; i += 32) {
+        pri  = _mm256_loadu_si256((const __m256i *)(pc + i));
+        draw = _mm256_cmpeq_epi8(_mm256_max_epu8(pri, comp), comp);
+
+        bytes = _mm256_or_si256(_mm256_and_si256(pri, keep), store);
+        _mm256_storeu_si256((__m256i *)(pc + i),
+                            _mm256_blendv_epi8(pri, bytes, draw));
+
+        bytes = _mm256_loadu_si256((const __m256i *)(vis + i));
+        bytes = _mm256_blendv_epi8(
+          bytes, _mm256_loadu_si256((const __m256i *)(pixels + i)), draw);
+        _mm256_storeu_si256((__m256i *)(vis + i), bytes);
+    }
+
+    // Finish with half and quarter registers here rather than in the SSE2
+    // kernel, whose instructions are slow after AVX ones.
+    comp4  = _mm256_castsi256_si128(comp);
+    keep4  = _mm256_castsi256_si128(keep);
+    store4 = _mm256_castsi256_si128(store);
+
+    if (i + 16 <= count) {
+        pri4  = _mm_loadu_si128((const __m128i *)(pc + i));
+        draw4 = _mm_cmpeq_epi8(_mm_max_epu8(pri4, comp4), comp4);
+
+        bytes4 = _mm_or_si128(_mm_and_si128(pri4, keep4), store4);
+        _mm_storeu_si128((__m128i *)(pc + i),
+                         _mm_blendv_epi8(pri4, bytes4, draw4));
+
+        bytes4 = _mm_loadu_si128((const __m128i *)(vis + i));
+        bytes4 = _mm_blendv_epi8(
+          bytes4, _mm_loadu_si128((const __m128i *)(pixels + i)), draw4);
+        _mm_storeu_si128((__m128i *)(vis + i), bytes4);
+        i += 16;
+    }
+
+    if (i + 8 <= count) {
+        pri4  = _mm_loadl_epi64((const __m128i *)(pc + i));
+        draw4 = _mm_cmpeq_epi8(_mm_max_epu8(pri4, comp4), comp4);
+
+        bytes4 = _mm_or_si128(_mm_and_si128(pri4, keep4), store4);
+        _mm_storel_epi64((__m128i *)(pc + i),
+                         _mm_blendv_epi8(pri4, bytes4, draw4));
+
+        bytes4 = _mm_loadl_epi64((const __m128i *)(vis + i));
+        bytes4 = _mm_blendv_epi8(
+          bytes4, _mm_loadl_epi64((const __m128i *)(pixels + i)), draw4);
+        _mm_storel_epi64((__m128i *)(vis + i), bytes4);
+        i += 8;
+    }
+
+    BlitCelSpanScalar(vis + i, pc + i, pixels + i, count - i, priComp, priMask,
+                      priStore);
+}
+
+TARGET("avx2")
+static void FillMaskedAVX2(uint8_t       *dst,
+                           const uint8_t *masks,
+                           uint8_t        value,
+                           uint           count)
+{
+    __m256i values = _mm256_set1_epi8((char)value);
+    __m256i mask, bytes, last;
+    __m128i values4, mask4, bytes4, last4;
+    int32_t word, lastWord;
+    uint    i;
+
+    values4 = _mm256_castsi256_si128(values);
+
+    if (count >= 32) {
+        mask = _mm256_loadu_si256((const __m256i *)(masks + count - 32));
+        last = _mm256_loadu_si256((const __m256i *)(dst + count - 32));
+        last = _mm256_blendv_epi8(last, values, mask);
+        for (i = 0; i + 32 < count; i += 32) {
+            mask  = _mm256_loadu_si256((const __m256i *)(masks + i));
+            bytes = _mm256_loadu_si256((const __m256i *)(dst + i));
+            _mm256_storeu_si256((__m256i *)(dst + i),
+                                _mm256_blendv_epi8(bytes, values, mask));
+        }
+        _mm256_storeu_si256((__m256i *)(dst + count - 32), last);
+    } else if (count >= 16) {
+        mask4  = _mm_loadu_si128((const __m128i *)masks);
+        bytes4 = _mm_loadu_si128((const __m128i *)dst);
+        bytes4 = _mm_blendv_epi8(bytes4, values4, mask4);
+        mask4  = _mm_loadu_si128((const __m128i *)(masks + count - 16));
+        last4  = _mm_loadu_si128((const __m128i *)(dst + count - 16));
+        last4  = _mm_blendv_epi8(last4, values4, mask4);
+        _mm_storeu_si128((__m128i *)dst, bytes4);
+        _mm_storeu_si128((__m128i *)(dst + count - 16), last4);
+    } else if (count >= 8) {
+        mask4  = _mm_loadl_epi64((const __m128i *)masks);
+        bytes4 = _mm_loadl_epi64((const __m128i *)dst);
+        bytes4 = _mm_blendv_epi8(bytes4, values4, mask4);
+        mask4  = _mm_loadl_epi64((const __m128i *)(masks + count - 8));
+        last4  = _mm_loadl_epi64((const __m128i *)(dst + count - 8));
+        last4  = _mm_blendv_epi8(last4, values4, mask4);
+        _mm_storel_epi64((__m128i *)dst, bytes4);
+        _mm_storel_epi64((__m128i *)(dst + count - 8), last4);
+    } else if (count >= 4) {
+        memcpy(&word, masks, sizeof(word));
+        mask4 = _mm_cvtsi32_si128(word);
+        memcpy(&word, dst, sizeof(word));
+        bytes4 = _mm_blendv_epi8(_mm_cvtsi32_si128(word), values4, mask4);
+        memcpy(&word, masks + count - 4, sizeof(word));
+        mask4 = _mm_cvtsi32_si128(word);
+        memcpy(&word, dst + count - 4, sizeof(word));
+        last4    = _mm_blendv_epi8(_mm_cvtsi32_si128(word), values4, mask4);
+        word     = _mm_cvtsi128_si32(bytes4);
+        lastWord = _mm_cvtsi128_si32(last4);
+        memcpy(dst, &word, sizeof(word));
+        memcpy(dst + count - 4, &lastWord, sizeof(lastWord));
+    } else {
+        FillMaskedScalar(dst, masks, value, count);
+    }
+}
+
+#endif
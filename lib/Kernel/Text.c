@@ -1,6 +1,44 @@
 #include "sci/Kernel/Text.h"
 #include "sci/Kernel/Event.h"
+#include "sci/Kernel/FontCache.h"
 #include "sci/Kernel/Graphics.h"
+#include "sci/Utils/ErrMsg.h"
+#include "sci/Utils/List.h"
+
+// Number of text layouts kept.
+#define MAXLAYOUTS 32
+
+// A line of wrapped text.
+typedef struct TextLine {
+    uint start; // offset of the line in the text
+    uint count;
+    uint width;
+} TextLine;
+
+// The lines some text was wrapped to in a font and width.
+typedef struct TextLayout {
+    Node      link;
+    uint      hash;
+    uint      fontNum;
+    uint      max;
+    uint      length;
+    uint      numLines;
+    uint      longest;
+    TextLine *lines;
+    char     *text;
+} TextLayout;
+
+static List      s_layouts    = LIST_INITIALIZER; // most recently used first
+static uint      s_numLayouts = 0;
+static TextLine *s_lines      = NULL; // lines of the layout being made
+static uint      s_maxLines   = 0;
+
+static const TextLayout *GetLayout(const char *text, uint max);
+static TextLayout       *MakeLayout(const char *text,
+                                    uint        length,
+                                    uint        hash,
+                                    uint        max);
+static void              DropLayout(TextLayout *layout);
 
 // Return count of chars that fit in pixel length.
 static uint GetLongest(char const **str, uint max);
@@ -25,9 +63,8 @@ void ShowString(const char *str)
 void RTextSize(RRect *r, const char *text, int font, int def)
 {
 
-    uint        length, longest, height, oldFont;
-    const char *str;
-    const char *first;
+    const TextLayout *layout;
+    uint              longest, height, oldFont;
 
     if (text == NULL) {
         return;
@@ -56,19 +93,9 @@ void RTextSize(RRect *r, const char *text, int font, int def)
         }
 
         //		do {
-        // Get a local pointer to text.
-        str     = text;
-        height  = 0;
-        longest = 0;
-        while (*str != '\0') {
-            first  = str;
-            length = RTextWidth(first, 0, GetLongest(&str, (uint)r->right));
-            height++;
-            if (length > longest) {
-                longest = length;
-            }
-        }
-        height *= GetPointSize();
+        layout  = GetLayout(text, (uint)r->right);
+        longest = layout->longest;
+        height  = layout->numLines * GetPointSize();
 
         if (def == 0 && r->right > (int16_t)longest) {
             r->right = (int16_t)longest;
@@ -82,14 +109,119 @@ void RTextSize(RRect *r, const char *text, int font, int def)
     RSetFont(oldFont);
 }
 
+void FlushTextLayouts(void)
+{
+    while (!EmptyList(&s_layouts)) {
+        DropLayout(FromNode(FirstNode(&s_layouts), TextLayout));
+    }
+    free(s_lines);
+    s_lines    = NULL;
+    s_maxLines = 0;
+}
+
+// Return the layout of 'text' wrapped to 'max' in the current font, making it
+// if it is not cached. Dialogs size and then draw the same text, often on
+// every cycle.
+static const TextLayout *GetLayout(const char *text, uint max)
+{
+    TextLayout *layout;
+    Node       *node;
+    uint        fontNum = GetFont();
+    uint        hash    = 2166136261u;
+    uint        length;
+
+    for (length = 0; text[length] != '\0'; ++length) {
+        hash = (hash ^ (uint8_t)text[length]) * 16777619u;
+    }
+
+    for (node = FirstNode(&s_layouts); node != NULL; node = NextNode(node)) {
+        layout = FromNode(node, TextLayout);
+        if (layout->hash == hash && layout->fontNum == fontNum &&
+            layout->max == max && layout->length == length &&
+            memcmp(layout->text, text, length) == 0) {
+            MoveToFront(&s_layouts, node);
+            return layout;
+        }
+    }
+
+    return MakeLayout(text, length, hash, max);
+}
+
+static TextLayout *MakeLayout(const char *text,
+                              uint        length,
+                              uint        hash,
+                              uint        max)
+{
+    TextLayout *layout;
+    TextLine   *line;
+    const char *str;
+    uint        numLines, longest;
+
+    str      = text;
+    numLines = 0;
+    longest  = 0;
+    while (*str != '\0') {
+        if (numLines == s_maxLines) {
+            s_maxLines = s_maxLines != 0 ? 2 * s_maxLines : 16;
+            s_lines =
+              (TextLine *)realloc(s_lines, s_maxLines * sizeof(TextLine));
+            if (s_lines == NULL) {
+                Panic(E_NO_MEMORY);
+            }
+        }
+
+        line        = &s_lines[numLines++];
+        line->start = (uint)(str - text);
+        line->count = GetLongest(&str, max);
+        line->width = RTextWidth(text, (int)line->start, line->count);
+        if (line->width > longest) {
+            longest = line->width;
+        }
+    }
+
+    if (s_numLayouts == MAXLAYOUTS) {
+        DropLayout(FromNode(LastNode(&s_layouts), TextLayout));
+    }
+
+    layout = (TextLayout *)malloc(sizeof(TextLayout) +
+                                  numLines * sizeof(TextLine) + length + 1);
+    if (layout == NULL) {
+        Panic(E_NO_MEMORY);
+    }
+
+    layout->hash     = hash;
+    layout->fontNum  = GetFont();
+    layout->max      = max;
+    layout->length   = length;
+    layout->numLines = numLines;
+    layout->longest  = longest;
+    layout->lines    = (TextLine *)(layout + 1);
+    layout->text     = (char *)(layout->lines + numLines);
+    memcpy(layout->lines, s_lines, numLines * sizeof(TextLine));
+    memcpy(layout->text, text, length + 1);
+
+    AddToFront(&s_layouts, ToNode(layout));
+    ++s_numLayouts;
+    return layout;
+}
+
+static void DropLayout(TextLayout *layout)
+{
+    DeleteNode(&s_layouts, ToNode(layout));
+    --s_numLayouts;
+    free(layout);
+}
+
 static uint GetLongest(char const **str, uint max)
 {
-    const char *last;
-    const char *first;
-    char        c;
-    uint        count = 0, lastCount = 0;
+    const FontAtlas *atlas;
+    const char      *last;
+    char             c;
+    uint             count = 0, lastCount = 0;
+    uint             width = 0; // of the 'count' chars so far
 
-    first = last = *str;
+    atlas = GetFontAtlas(GetFont());
+    last  = *str;
 
     // Find a HARD terminator or LAST SPACE that fits on line.
     while (true) {
@@ -98,7 +230,7 @@ static uint GetLongest(char const **str, uint max)
             if (*(*str + 1) == LF) {
                 (*str)++; // so we don't see it later.
             }
-            if (lastCount != 0 && max < RTextWidth(first, 0, count)) {
+            if (lastCount != 0 && max < width) {
                 *str = last;
                 return lastCount;
             } else {
@@ -112,7 +244,7 @@ static uint GetLongest(char const **str, uint max)
             {
                 (*str)++; // so we don't see it later.
             }
-            if (lastCount && max < RTextWidth(first, 0, count)) {
+            if (lastCount && max < width) {
                 *str = last;
                 return lastCount;
             } else {
@@ -122,7 +254,7 @@ static uint GetLongest(char const **str, uint max)
         }
 
         if (c == '\0') {
-            if (lastCount && max < RTextWidth(first, 0, count)) {
+            if (lastCount && max < width) {
                 *str = last;
                 return lastCount;
             } else {
@@ -132,7 +264,7 @@ static uint GetLongest(char const **str, uint max)
 
         if (c == SP) // check word wrap.
         {
-            if (max >= RTextWidth(first, 0, count)) {
+            if (max >= width) {
                 last = *str;
                 ++last; // so we don't see space again.
                 lastCount = count;
@@ -149,10 +281,11 @@ static uint GetLongest(char const **str, uint max)
         // All is still cool.
         ++count;
         (*str)++;
+        width += GlyphWide(atlas, c);
 
         {
             // We may never see a space to break on.
-            if (lastCount == 0 && RTextWidth(first, 0, count) > max) {
+            if (lastCount == 0 && width > max) {
                 last += --count;
                 *str = last;
                 return count;
@@ -167,10 +300,11 @@ void RTextBox(const char  *text,
               uint         mode,
               int          font)
 {
-    const char *first;
-    const char *str;
-    uint        length, height = 0, wide, count, oldFont;
-    int         xPos;
+    const TextLayout *layout;
+    const TextLine   *line;
+    const char       *first;
+    uint              length, height = 0, wide, count, oldFont, i;
+    int               xPos;
 
     // We are printing this text in the font requested.
     oldFont = GetFont();
@@ -181,11 +315,12 @@ void RTextBox(const char  *text,
 
     wide = (uint)(box->right - box->left);
 
-    str = text;
-    while (*str != '\0') {
-        first  = str;
-        count  = GetLongest(&str, wide);
-        length = RTextWidth(first, 0, count);
+    layout = GetLayout(text, wide);
+    for (i = 0; i < layout->numLines; ++i) {
+        line   = &layout->lines[i];
+        first  = text + line->start;
+        count  = line->count;
+        length = line->width;
 
         // Determine justification and draw the line.
         switch (mode) {
@@ -1,5 +1,9 @@
 #include "sci/Kernel/VolLoad.h"
+#include "sci/Kernel/Prefetch.h"
+#include "sci/Kernel/ResArchive.h"
+#include "sci/Kernel/ResCache.h"
 #include "sci/Kernel/ResName.h"
+#include "sci/Kernel/ResSource.h"
 #include "sci/Kernel/Resource.h"
 #include "sci/Utils/Crypt.h"
 #include "sci/Utils/ErrMsg.h"
@@ -10,6 +14,9 @@
 
 #define MAXMASKS 10
 
+// Size of the chunks read from a resource file.
+#define READCHUNK 4096
+
 #define RESID(resType, resNum)                                                 \
     ((uint16_t)((uint16_t)(resNum) | ((uint16_t)(resType) << 11)))
 #define INVALID_RESID ((uint16_t)-1)
@@ -36,30 +43,63 @@ typedef struct ResSegHeader {
     uint16_t compression;
 } ResSegHeader;
 
-static void  *s_resourceMap = NULL;
-static int    s_resVolFd    = -1;
-static ushort s_resVolNum   = 1;
+static int    s_resVolFd  = -1;
+static ushort s_resVolNum = 1;
 
 // Allocate buffer and load resource map into it.
-static void *LoadResMap(const char *mapName);
-static bool  FindDirEntry(ushort   *volNum,
-                          uint32_t *offset,
-                          int       resType,
-                          size_t    resNum);
+static void *LoadResMap(const char *mapName, size_t *mapSize);
+// Add the resources of the resource map to the index.
+static void  IndexResMap(const void *resMap);
+// Load a resource. A detached load doesn't use the shared volume file and
+// returns NULL instead of reporting errors.
+static Handle LoadResource(int resType, size_t resNum, bool detached);
+static bool   LoadFromPatch(Handle *outHandle,
+                            int     resType,
+                            size_t  resNum,
+                            bool    detached);
+static bool   LoadFromVolume(Handle  *outHandle,
+                             int      resType,
+                             size_t   resNum,
+                             uint64_t loc,
+                             bool     detached);
+// Read and decompress resource data, a chunk at a time, straight from the
+// resource file into a new resource handle.
+static Handle ReadResData(int  fd,
+                          uint compression,
+                          uint segmentLength,
+                          uint length);
 
 void InitResource(void)
 {
+    void  *resourceMap;
+    size_t mapSize = 0;
+    bool   archive;
+
     InitList(&g_loadList);
 
-    s_resourceMap = LoadResMap(RESMAPNAME);
-    if (s_resourceMap == NULL) {
+    // The decoders are set up before the prefetch threads use them.
+    InitDecompressors();
+
+    // Resources in the archive take precedence over the volumes, which are
+    // then optional.
+    archive = OpenResArchive(ARCNAME);
+
+    resourceMap = LoadResMap(RESMAPNAME, &mapSize);
+    if (resourceMap != NULL) {
+        InitResCache(resourceMap, mapSize, RESVOLNAME);
+
+        // The map is only needed to build the index.
+        IndexResMap(resourceMap);
+        free(resourceMap);
+    } else if (!archive) {
         Panic(E_CANT_LOAD, RESMAPNAME);
     }
 
     InitPatches();
+    InitPrefetch();
 }
 
-static void *LoadResMap(const char *mapName)
+static void *LoadResMap(const char *mapName, size_t *mapSize)
 {
     int    fd;
     size_t size;
@@ -76,17 +116,103 @@ static void *LoadResMap(const char *mapName)
             }
         }
         close(fd);
+        *mapSize = size;
     }
     return buffer;
 }
 
 Handle DoLoad(int resType, size_t resNum)
 {
-    char         fileName[64];
-    ResSegHeader dataInfo;
-    bool         loadedFromFile = false;
-    int          fd             = -1;
-    Handle       outHandle      = NULL;
+    return LoadResource(resType, resNum, false);
+}
+
+Handle DoLoadDetached(int resType, size_t resNum)
+{
+    return LoadResource(resType, resNum, true);
+}
+
+Handle DoLoadVolume(int resType, size_t resNum)
+{
+    uint64_t loc;
+    Handle   outHandle = NULL;
+
+    if (!FindResInSource(SRC_VOLUME, resType, resNum, &loc) ||
+        !LoadFromVolume(&outHandle, resType, resNum, loc, true)) {
+        return NULL;
+    }
+    return outHandle;
+}
+
+static Handle LoadResource(int resType, size_t resNum, bool detached)
+{
+    char     fileName[64];
+    uint64_t loc[NRESSOURCES];
+    uint     sources;
+    int      source;
+    Handle   outHandle = NULL;
+
+    if (!detached) {
+        PollPatchDir();
+    }
+
+    // Go through the sources that have the resource by priority, as long as
+    // a source turns out not to have it after all (such as a patch file that
+    // was just deleted).
+    sources = FindResSources(resType, resNum, loc);
+    for (source = 0; source < NRESSOURCES; source++) {
+        if ((sources & (1 << source)) == 0) {
+            continue;
+        }
+
+        switch (source) {
+            case SRC_OVERRIDE:
+                outHandle = LoadResOverride(resType, resNum);
+                if (outHandle != NULL) {
+                    return outHandle;
+                }
+                break;
+
+            case SRC_PATCH:
+                if (LoadFromPatch(&outHandle, resType, resNum, detached)) {
+                    return outHandle;
+                }
+                break;
+
+            case SRC_ARCHIVE:
+                if (GetResArchive() != NULL) {
+                    outHandle =
+                      GetResArchive()->load(resType, resNum, loc[source]);
+                    if (outHandle != NULL) {
+                        return outHandle;
+                    }
+                }
+                break;
+
+            case SRC_VOLUME:
+                if (LoadFromVolume(
+                      &outHandle, resType, resNum, loc[source], detached)) {
+                    return outHandle;
+                }
+                break;
+        }
+    }
+
+    if (!detached) {
+        Panic(E_NOT_FOUND, ResNameMake(fileName, resType, resNum));
+    }
+    return NULL;
+}
+
+// Returns FALSE if the patch file isn't there.
+static bool LoadFromPatch(Handle *outHandle,
+                          int     resType,
+                          size_t  resNum,
+                          bool    detached)
+{
+    char    fileName[64];
+    uint8_t typeLen = 0;
+    uint    length;
+    int     fd;
 
 #if defined(__WINDOWS__) || defined(__IOS__)
     if (RES_SOUND == resType) {
@@ -94,161 +220,207 @@ Handle DoLoad(int resType, size_t resNum)
     }
 #endif
 
-    if (FindPatchEntry(resType, resNum)) {
-        ResNameMake(fileName, resType, resNum);
-        fd = ROpenResFile(resType, resNum, fileName);
+    ResNameMake(fileName, resType, resNum);
+    fd = ROpenResFile(resType, resNum, fileName);
+    if (fd == -1) {
+        return false;
     }
 
-    if (fd != -1) {
-        uint8_t typeLen = 0;
-
-        loadedFromFile       = true;
-        dataInfo.compression = 0;
-        dataInfo.length      = (uint16_t)(filelength(fd) - 2);
+    length = (uint)(filelength(fd) - 2);
 
-        read(fd, &typeLen, 1);
-        if (resType != (int)typeLen) {
-            close(fd);
+    read(fd, &typeLen, 1);
+    if (resType != (int)typeLen) {
+        close(fd);
+        if (!detached) {
             Panic(E_RESRC_MISMATCH);
-            return NULL;
         }
+        *outHandle = NULL;
+        return true;
+    }
 
-        read(fd, &typeLen, 1);
-        lseek(fd, (int)typeLen, SEEK_CUR);
-    } else {
-        ushort   volNum = 0;
-        uint32_t offset = 0;
-#if defined(__WINDOWS__) || defined(__IOS__)
-        if (RES_SOUND == resType) {
-            resNum -= 1000;
-        }
-#endif
-        if (!FindDirEntry(&volNum, &offset, resType, resNum)) {
-            Panic(E_NOT_FOUND, ResNameMake(fileName, resType, resNum));
-            return NULL;
-        }
+    read(fd, &typeLen, 1);
+    lseek(fd, (int)typeLen, SEEK_CUR);
+    length -= typeLen;
 
-        // TODO: write the real code, that support different volNums
+    *outHandle = ReadResData(fd, COMP_NONE, 0, length);
+    close(fd);
 
+    if (*outHandle == NULL && !detached) {
+        Panic(E_LOAD_ERROR, ResNameMake(fileName, resType, resNum));
+    }
+    return true;
+}
+
+static bool LoadFromVolume(Handle  *outHandle,
+                           int      resType,
+                           size_t   resNum,
+                           uint64_t loc,
+                           bool     detached)
+{
+    char         fileName[64];
+    ResSegHeader dataInfo;
+    ushort       volNum = (ushort)(loc >> 32);
+    uint32_t     offset = (uint32_t)loc;
+    int          fd;
+
+    // Patch files come first, so a cached copy is current.
+    *outHandle = ResCacheLoad(resType, resNum);
+    if (*outHandle != NULL) {
+        return true;
+    }
+
+    // A detached load can't share the file position of the cached volume, so
+    // it uses a file of its own.
+    if (detached) {
+        sprintf(fileName, "%s.%03u", RESVOLNAME, volNum);
+        fd = fileopen(fileName, O_RDONLY);
+    } else {
         if (s_resVolFd == -1 || s_resVolNum != volNum) {
+            if (s_resVolFd != -1) {
+                close(s_resVolFd);
+            }
             sprintf(fileName, "%s.%03u", RESVOLNAME, volNum);
             s_resVolFd  = fileopen(fileName, O_RDONLY);
             s_resVolNum = volNum;
         }
-
         fd = s_resVolFd;
-        if (fd != -1) {
-            lseek(fd, (int)offset, SEEK_SET);
-            read(fd, &dataInfo, sizeof(ResSegHeader));
-            if (dataInfo.resId != RESID(resType, resNum)) {
-                close(fd);
-                s_resVolFd = -1;
-                return NULL;
-            }
+    }
+
+    if (fd == -1) {
+        return false;
+    }
+
+    lseek(fd, (int)offset, SEEK_SET);
+    read(fd, &dataInfo, sizeof(ResSegHeader));
+    if (dataInfo.resId != RESID(resType, resNum)) {
+        close(fd);
+        if (!detached) {
+            s_resVolFd = -1;
         }
+        *outHandle = NULL;
+        return true;
     }
 
-    if (fd != -1) {
-        uint size = dataInfo.length;
-        outHandle = GetResHandle(size);
+    *outHandle = ReadResData(
+      fd, dataInfo.compression, dataInfo.segmentLength, dataInfo.length);
 
-        read(fd, outHandle, size);
+    if (detached) {
+        close(fd);
+    }
 
-        if (loadedFromFile) {
-            close(fd);
+    if (*outHandle == NULL) {
+        if (!detached) {
+            Panic(E_LOAD_ERROR, ResNameMake(fileName, resType, resNum));
         }
+        return true;
+    }
 
-        // TODO: handle different compression types
-        if (dataInfo.compression == 2) {
-            Handle decompHandle = GetResHandle(dataInfo.length);
-            if (DecompressLZW_1((uint8_t *)decompHandle,
-                                (uint8_t *)outHandle,
-                                dataInfo.length,
-                                dataInfo.segmentLength)) {
-                DisposeResHandle(outHandle);
-                outHandle = decompHandle;
-            } else {
-                assert(0);
-            }
-        } else {
-            assert(dataInfo.compression == 0);
-        }
+    if (dataInfo.compression != COMP_NONE) {
+        ResCacheStore(resType, resNum, *outHandle);
     }
-    return outHandle;
+    return true;
 }
 
-static bool FindDirEntryDos(ushort   *volNum,
-                            uint32_t *offset,
-                            int       resType,
-                            size_t    resNum)
+static Handle ReadResData(int  fd,
+                          uint compression,
+                          uint segmentLength,
+                          uint length)
 {
-    uint16_t           resId;
-    uint               vol;
-    const ResDirEntry *entry;
-    const ResDirEntry *foundEntry = NULL;
-
-    resId = RESID(resType, resNum);
-    vol   = (uint)*volNum;
-
-    for (entry = (ResDirEntry *)s_resourceMap; entry->resId != INVALID_RESID;
-         ++entry) {
-        if (entry->resId == resId) {
-            *offset = entry->offset;
-            if (entry->volNum == vol) {
-                return true;
-            }
+    uint8_t       chunk[READCHUNK];
+    DecompStream *stream;
+    Handle        handle;
+    uint8_t      *out;
+    uint          remaining;
+    int           count;
+
+    // The segment length counts the compressed data and the last two
+    // fields of the segment header.
+    remaining = (compression != COMP_NONE) ? segmentLength - 4 : length;
+
+    stream = OpenDecompressor(compression, length);
+    if (stream == NULL) {
+        return NULL;
+    }
 
-            foundEntry = entry;
+    handle = GetResHandle(length);
+    out    = (uint8_t *)handle;
+
+    while (!DecompressorDone(stream)) {
+        count = 0;
+        if (remaining != 0) {
+            count = read(fd, chunk, min(remaining, sizeof(chunk)));
+            if (count <= 0) {
+                break;
+            }
+            remaining -= (uint)count;
         }
-    }
 
-    if (foundEntry != NULL) {
-        *volNum = (ushort)foundEntry->volNum;
-        return true;
-    }
-    return false;
-}
+        if (!FeedDecompressor(stream, chunk, (uint)count, remaining == 0)) {
+            break;
+        }
 
-static bool FindDirEntryWin(ushort   *volNum,
-                            uint32_t *offset,
-                            int       resType,
-                            size_t    resNum)
-{
-    uint16_t              resId;
-    uint                  vol;
-    const ResDirEntryWin *entry;
-    const ResDirEntryWin *foundEntry = NULL;
-
-    resId = RESID(resType, resNum);
-    vol   = (uint)*volNum;
-
-    for (entry = (ResDirEntryWin *)s_resourceMap; entry->resId != INVALID_RESID;
-         ++entry) {
-        if (entry->resId == resId) {
-            *offset = entry->offset;
-            if (entry->volNum == vol) {
-                return true;
+        do {
+            count = ReadDecompressor(
+              stream, out, length - (uint)(out - (uint8_t *)handle));
+            if (count > 0) {
+                out += count;
             }
+        } while (count > 0 && !DecompressorDone(stream));
 
-            foundEntry = entry;
+        if (count < 0) {
+            break;
         }
     }
 
-    if (foundEntry != NULL) {
-        *volNum = (ushort)foundEntry->volNum;
-        return true;
+    if (!DecompressorDone(stream)) {
+        DisposeResHandle(handle);
+        handle = NULL;
     }
-    return false;
+
+    CloseDecompressor(stream);
+    return handle;
 }
 
-static bool FindDirEntry(ushort   *volNum,
-                         uint32_t *offset,
-                         int       resType,
-                         size_t    resNum)
+static void IndexResMap(const void *resMap)
 {
-    if (((ResDirEntryWin *)s_resourceMap)->volNum != 0) {
-        return FindDirEntryWin(volNum, offset, resType, resNum);
-    } else {
-        return FindDirEntryDos(volNum, offset, resType, resNum);
+    uint64_t loc;
+    uint     resId;
+    uint     volNum;
+    uint32_t offset;
+    bool     winMap;
+    int      resType;
+    size_t   resNum;
+
+    // Where a resource is in more than one volume, the one in volume 0 is
+    // used, or else the last one in the map.
+    winMap = (((const ResDirEntryWin *)resMap)->volNum != 0);
+    forever() {
+        if (winMap) {
+            const ResDirEntryWin *entry = (const ResDirEntryWin *)resMap;
+            resId                       = entry->resId;
+            volNum                      = entry->volNum;
+            offset                      = entry->offset;
+            resMap                      = entry + 1;
+        } else {
+            const ResDirEntry *entry = (const ResDirEntry *)resMap;
+            resId                    = entry->resId;
+            volNum                   = entry->volNum;
+            offset                   = entry->offset;
+            resMap                   = entry + 1;
+        }
+
+        if (resId == INVALID_RESID) {
+            break;
+        }
+
+        resType = RES_BASE + (int)(resId >> 11);
+        resNum  = (size_t)(resId & 0x7ff);
+        if (FindResInSource(SRC_VOLUME, resType, resNum, &loc) &&
+            (loc >> 32) == 0) {
+            continue;
+        }
+
+        AddResIndex(
+          SRC_VOLUME, resType, resNum, ((uint64_t)volNum << 32) | offset);
     }
 }
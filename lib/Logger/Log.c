@@ -164,6 +164,8 @@ void LogMessage(int level, const char *format, ...)
         buffer[len - 1] = '\n';
 #if defined(_CONSOLE) || defined(__BLACKBERRY__)
         fprintf(stderr, "%s: %s", levelStr, buffer);
+#elif defined(__LINUX__)
+        fputs(buffer, stderr);
 #else
         OutputDebugStringA(buffer);
 #endif
@@ -177,6 +179,14 @@ void LogMessage(int level, const char *format, ...)
     va_end(args);
 }
 
+#if defined(__LINUX__)
+// There is no window system to show the message in.
+void MessageBox(const char *title, const char *text)
+{
+    fprintf(stderr, "%s: %s\n", title, text);
+}
+#endif
+
 #if defined(DEBUG) && (MAX_LOG_LEVEL >= LOG_LEVEL_DEBUG)
 
 #include "sci/PMachine/PMachine.h"
@@ -1,5 +1,6 @@
 #include "sci/PMachine/Object.h"
 #include "sci/PMachine/PMachine.h"
+#include "sci/Kernel/CastGrid.h"
 #include "sci/Kernel/FarData.h"
 #include "sci/Kernel/Resource.h"
 #include "sci/Kernel/Selector.h"
@@ -167,7 +168,7 @@ uintptr_t InvokeMethod(Obj *obj, ObjID sel, uint argc, ...)
     Push(sel);
     Push(argc);
     for (i = 0; i < argc; ++i) {
-        Push(va_arg(args, uint16_t));
+        Push(va_arg(args, uintptr_t));
     }
     va_end(args);
 
@@ -242,6 +243,7 @@ void SetProperty(Obj *obj, uint prop, uintptr_t value)
     uintptr_t *var = GetPropAddr(obj, prop);
     if (var != NULL) {
         *var = value;
+        NoteActorProp(obj, (uint)(var - obj->vars));
     }
 }
 
@@ -349,6 +351,7 @@ static void QuickMessage(Obj *obj, uint argc)
             // Not a query -- set the property.
             else {
                 obj->vars[idx] = g_vars.parm[1];
+                NoteActorProp(obj, (uint)idx);
             }
             g_restArgsCount = 0;
         }
@@ -2,6 +2,7 @@
 #include "sci/PMachine/Object.h"
 #include "sci/Driver/Input/Input.h"
 #include "sci/Kernel/Audio.h"
+#include "sci/Kernel/CastGrid.h"
 #include "sci/Kernel/Graphics.h"
 #include "sci/Kernel/Kernel.h"
 #include "sci/Kernel/Menu.h"
@@ -451,6 +452,7 @@ static void KernelCall(uint kernelNum);
 static void DoCall(uint parmCount);
 static void Dispatch(uint scriptNum, uint entryNum, uint parmCount);
 static void LoadEffectiveAddress(uint varType, uint varNum);
+static uintptr_t StoreProp(uint idx, uintptr_t value);
 static Script *GetDispatchAddrInHeap(uint scriptNum, uint entryNum, Obj **obj);
 static Script *GetDispatchAddrInHunk(uint      scriptNum,
                                      uint      entryNum,
@@ -1026,85 +1028,85 @@ void ExecuteCode(void)
             // Store acc to prop
             case OP_aTop_TWO: {
                 LogDebug("aTop %u", *((uint16_t *)g_pc));
-                uint idx                = GetWord();
-                *GetIndexedPropPtr(idx) = g_acc;
+                uint idx = GetWord();
+                StoreProp(idx, g_acc);
             } break;
 
             // Store acc to prop
             case OP_aTop_ONE: {
                 LogDebug("aTop %u", *g_pc);
-                uint idx                = GetByte();
-                *GetIndexedPropPtr(idx) = g_acc;
+                uint idx = GetByte();
+                StoreProp(idx, g_acc);
             } break;
 
             // Store stack to prop
             case OP_sTop_TWO: {
                 LogDebug("sTop %u", *((uint16_t *)g_pc));
-                uint idx                = GetWord();
-                *GetIndexedPropPtr(idx) = Pop();
+                uint idx = GetWord();
+                StoreProp(idx, Pop());
             } break;
 
             // Store stack to prop
             case OP_sTop_ONE: {
                 LogDebug("sTop %u", *g_pc);
-                uint idx                = GetByte();
-                *GetIndexedPropPtr(idx) = Pop();
+                uint idx = GetByte();
+                StoreProp(idx, Pop());
             } break;
 
             // Inc prop
             case OP_ipToa_TWO: {
                 LogDebug("ipToa %u", *((uint16_t *)g_pc));
                 uint idx = GetWord();
-                SetAcc(++(*GetIndexedPropPtr(idx)));
+                SetAcc(StoreProp(idx, *GetIndexedPropPtr(idx) + 1));
             } break;
 
             // Inc prop
             case OP_ipToa_ONE: {
                 LogDebug("ipToa %u", *g_pc);
                 uint idx = GetByte();
-                SetAcc(++(*GetIndexedPropPtr(idx)));
+                SetAcc(StoreProp(idx, *GetIndexedPropPtr(idx) + 1));
             } break;
 
             // Inc prop to stack
             case OP_ipTos_TWO: {
                 LogDebug("ipTos %u", *((uint16_t *)g_pc));
                 uint idx = GetWord();
-                Push(++(*GetIndexedPropPtr(idx)));
+                Push(StoreProp(idx, *GetIndexedPropPtr(idx) + 1));
             } break;
 
             // Inc prop to stack
             case OP_ipTos_ONE: {
                 LogDebug("ipTos %u", *g_pc);
                 uint idx = GetByte();
-                Push(++(*GetIndexedPropPtr(idx)));
+                Push(StoreProp(idx, *GetIndexedPropPtr(idx) + 1));
             } break;
 
             // Dec prop
             case OP_dpToa_TWO: {
                 LogDebug("dpToa %u", *((uint16_t *)g_pc));
                 uint idx = GetWord();
-                SetAcc(--(*GetIndexedPropPtr(idx)));
+                SetAcc(StoreProp(idx, *GetIndexedPropPtr(idx) - 1));
             } break;
 
             // Dec prop
             case OP_dpToa_ONE: {
                 LogDebug("dpToa %u", *g_pc);
                 uint idx = GetByte();
-                SetAcc(--(*GetIndexedPropPtr(idx)));
+                SetAcc(StoreProp(idx, *GetIndexedPropPtr(idx) - 1));
             } break;
 
             // Dec prop to stack
             case OP_dpTos_TWO: {
                 LogDebug("dpTos %u", *((uint16_t *)g_pc));
                 uint idx = GetWord();
-                Push(--(*GetIndexedPropPtr(idx)));
+                Push(StoreProp(idx, *GetIndexedPropPtr(idx) - 1));
             } break;
 
             // Dec prop to stack
             case OP_dpTos_ONE: {
                 LogDebug("dpTos %u", *g_pc);
                 uint idx = GetByte();
-                Push(--(*GetIndexedPropPtr(idx)));
+                Push(StoreProp(idx, *GetIndexedPropPtr(idx) - 1));
             } break;
 
             // Load offset
@@ -1986,6 +1988,15 @@ static void LoadEffectiveAddress(uint varType, uint varNum)
     SetAcc((uintptr_t)(var + varNum));
 }
 
+// Store to the property at byte offset 'idx' of the current object, telling
+// the cast grid when a script moves the base rectangle of an actor.
+static uintptr_t StoreProp(uint idx, uintptr_t value)
+{
+    *GetIndexedPropPtr(idx) = value;
+    NoteActorProp(g_object, idx / sizeof(uint16_t));
+    return value;
+}
+
 static Script *GetDispatchAddrInHeap(uint scriptNum, uint entryNum, Obj **obj)
 {
     Script *script = ScriptPtr(scriptNum);
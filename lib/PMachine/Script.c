@@ -84,6 +84,20 @@ Script *LoadScript(uint num)
     return script;
 }
 
+Script *FindSaidScript(const byte *spec)
+{
+    Script *script;
+
+    for (script = FromNode(FirstNode(&s_scriptList), Script); script != NIL;
+         script = FromNode(NextNode(ToNode(script)), Script)) {
+        if (script->saidSpecs <= spec &&
+            spec < script->saidSpecs + script->saidSize) {
+            return script;
+        }
+    }
+    return NULL;
+}
+
 void DisposeAllScripts(void)
 {
     Script *script;
@@ -119,6 +133,8 @@ static void TossScript(Script *script, bool checkClones)
         PError(PE_LEFT_CLONE, num, 0);
     }
 
+    free(script->saids);
+
     script->num = 9999;
     DeleteNode(&s_scriptList, ToNode(script));
     free(script);
@@ -250,6 +266,10 @@ static void InitHunkRes(Handle hunk, Script *script, bool alloc)
                 if (alloc) {
                     memcpy(heap, seg + 1, seg->size - sizeof(SegHeader));
                 }
+                if (seg->type == SEG_SAIDSPECS) {
+                    script->saidSpecs = heap;
+                    script->saidSize  = seg->size - sizeof(SegHeader);
+                }
 
                 heap += seg->size - sizeof(SegHeader);
                 break;
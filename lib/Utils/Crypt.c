@@ -1,4 +1,24 @@
 #include "sci/Utils/Crypt.h"
+#include "sci/Utils/Mutex.h"
+#include "sci/Utils/Timer.h"
+
+// Initial size of a stream's input buffer.
+#define INBUFSIZE 4096
+
+struct DecompStream {
+    const Decompressor *decomp;
+    uint                compression;
+    uint                length;   // decompressed size
+    uint                produced; // bytes decoded so far
+    bool                last;     // all of the input has been fed
+    bool                ended;    // decoder reached the end of data
+    uint8_t            *buf;
+    size_t              bufSize;
+    uint64_t            bytesIn;
+    uint64_t            nanoseconds;
+    BitStream           in;
+    void               *state;
+};
 
 typedef struct Decrypt3Info {
     struct tokenlist {
@@ -8,75 +28,363 @@ typedef struct Decrypt3Info {
 
     int8_t   stak[0x1014];
     int8_t   lastchar;
-    int16_t  stakptr;
+    uint16_t stakptr;
     uint16_t numbits, bitstring, lastbits, decryptstart;
     int16_t  curtoken, endtoken;
-
-    uint32_t whichbit;
 } Decrypt3Info;
 
-static uint32_t gbits(Decrypt3Info *info, int numbits, uint8_t *data, int dlen)
+static const Decompressor *s_decompressors[MAXCOMPRESSIONS] = { NULL };
+static DecompStats         s_stats[MAXCOMPRESSIONS]          = { { 0 } };
+static bool                s_builtinsRegistered              = false;
+static Mutex               s_statsMutex; // decoders close on several threads
+
+static void InitStored(void *state);
+static int  DecodeStored(void      *state,
+                         BitStream *in,
+                         uint8_t   *dest,
+                         uint       size,
+                         uint      *written);
+static void InitLZW1(void *state);
+static int  DecodeLZW1(void      *state,
+                       BitStream *in,
+                       uint8_t   *dest,
+                       uint       size,
+                       uint      *written);
+
+static const Decompressor s_storedDecompressor = {
+    "stored", 0, InitStored, DecodeStored
+};
+
+const Decompressor g_lzw1Decompressor = {
+    "LZW1", sizeof(Decrypt3Info), InitLZW1, DecodeLZW1
+};
+
+void InitDecompressors(void)
+{
+    if (s_builtinsRegistered) {
+        return;
+    }
+    s_builtinsRegistered = true;
+
+    CreateMutex(&s_statsMutex, false);
+    BuildExplodeTables();
+
+    RegisterDecompressor(COMP_NONE, &s_storedDecompressor);
+    RegisterDecompressor(COMP_HUFFMAN, &g_huffmanDecompressor);
+    RegisterDecompressor(COMP_LZW1, &g_lzw1Decompressor);
+    RegisterDecompressor(COMP_DCL, &g_dclDecompressor);
+    RegisterDecompressor(COMP_DCL_VIEW, &g_dclDecompressor);
+    RegisterDecompressor(COMP_DCL_PIC, &g_dclDecompressor);
+    RegisterDecompressor(COMP_DCL_ANY, &g_dclDecompressor);
+}
+
+uint GetBitsMSB(BitStream *bs, uint numBits)
+{
+    uint    value = 0;
+    uint    avail, take;
+    uint8_t byte;
+
+    if (bs->bitPos + numBits > bs->size * 8) {
+        bs->underflow = true;
+        return 0;
+    }
+
+    while (numBits != 0) {
+        byte  = bs->data[bs->bitPos >> 3];
+        avail = 8 - (uint)(bs->bitPos & 7);
+        take  = min(avail, numBits);
+
+        value = (value << take) | ((byte >> (avail - take)) & ((1U << take) - 1));
+
+        bs->bitPos += take;
+        numBits -= take;
+    }
+    return value;
+}
+
+uint GetBitsLSB(BitStream *bs, uint numBits)
+{
+    uint    value = 0;
+    uint    shift = 0;
+    uint    avail, take;
+    uint8_t byte;
+
+    if (bs->bitPos + numBits > bs->size * 8) {
+        bs->underflow = true;
+        return 0;
+    }
+
+    while (numBits != 0) {
+        byte  = (uint8_t)(bs->data[bs->bitPos >> 3] >> (bs->bitPos & 7));
+        avail = 8 - (uint)(bs->bitPos & 7);
+        take  = min(avail, numBits);
+
+        value |= (uint)(byte & ((1U << take) - 1)) << shift;
+
+        bs->bitPos += take;
+        shift += take;
+        numBits -= take;
+    }
+    return value;
+}
+
+bool RegisterDecompressor(uint compression, const Decompressor *decomp)
+{
+    if (compression >= MAXCOMPRESSIONS) {
+        return false;
+    }
+
+    s_decompressors[compression] = decomp;
+    return true;
+}
+
+const Decompressor *FindDecompressor(uint compression)
+{
+    if (compression >= MAXCOMPRESSIONS) {
+        return NULL;
+    }
+    return s_decompressors[compression];
+}
+
+DecompStream *OpenDecompressor(uint compression, uint length)
+{
+    const Decompressor *decomp;
+    DecompStream       *stream;
+
+    decomp = FindDecompressor(compression);
+    if (decomp == NULL) {
+        return NULL;
+    }
+
+    // The decoder state lives right after the stream.
+    stream = (DecompStream *)calloc(1, sizeof(DecompStream) + decomp->stateSize);
+    if (stream == NULL) {
+        return NULL;
+    }
+
+    stream->buf = (uint8_t *)malloc(INBUFSIZE);
+    if (stream->buf == NULL) {
+        free(stream);
+        return NULL;
+    }
+
+    stream->decomp      = decomp;
+    stream->compression = compression;
+    stream->length      = length;
+    stream->bufSize     = INBUFSIZE;
+    stream->in.data     = stream->buf;
+    stream->state       = stream + 1;
+    decomp->init(stream->state);
+    return stream;
+}
+
+bool FeedDecompressor(DecompStream *stream,
+                      const void   *src,
+                      uint          size,
+                      bool          last)
+{
+    size_t consumed;
+
+    // Drop the whole bytes the decoder is done with.
+    consumed = stream->in.bitPos >> 3;
+    if (consumed != 0) {
+        stream->in.size -= consumed;
+        memmove(stream->buf, stream->buf + consumed, stream->in.size);
+        stream->in.bitPos &= 7;
+    }
+
+    if (stream->in.size + size > stream->bufSize) {
+        uint8_t *buf;
+        size_t   bufSize = stream->bufSize;
+
+        while (stream->in.size + size > bufSize) {
+            bufSize *= 2;
+        }
+
+        buf = (uint8_t *)realloc(stream->buf, bufSize);
+        if (buf == NULL) {
+            return false;
+        }
+
+        stream->buf     = buf;
+        stream->bufSize = bufSize;
+    }
+
+    memcpy(stream->buf + stream->in.size, src, size);
+    stream->in.data = stream->buf;
+    stream->in.size += size;
+    stream->bytesIn += size;
+    stream->last = last;
+    return true;
+}
+
+int ReadDecompressor(DecompStream *stream, void *dest, uint size)
 {
-    int      place; // indicates location within byte
-    uint32_t bitstring;
-    int      i;
+    uint64_t startTime;
+    uint     written = 0;
+    int      res;
 
-    if (numbits == 0) {
-        info->whichbit = 0;
+    if (DecompressorDone(stream)) {
         return 0;
     }
 
-    place     = info->whichbit >> 3;
-    bitstring = 0;
-    for (i = (numbits >> 3) + 1; i >= 0; i--) {
-        if (i + place < dlen)
-            bitstring |= data[place + i] << (8 * (2 - i));
-    }
-//     bitstring = data[place + 2] | (long)(data[place + 1]) << 8 |
-//                 (long)(data[place]) << 16;
-    bitstring >>= 24 - (info->whichbit & 7) - numbits;
-    bitstring &= (0xffffffff >> (32 - numbits));
-    // Okay, so this could be made faster with a table lookup.
-    // It doesn't matter. It's fast enough as it is.
-    info->whichbit += numbits;
-    return bitstring;
+    if (size > stream->length - stream->produced) {
+        size = stream->length - stream->produced;
+    }
+
+    startTime            = GetHighResolutionTime();
+    stream->in.underflow = false;
+    res                  = stream->decomp->decode(
+      stream->state, &stream->in, (uint8_t *)dest, size, &written);
+    stream->nanoseconds += GetHighResolutionTime() - startTime;
+
+    if (res == DECOMP_ERROR) {
+        return -1;
+    }
+
+    stream->produced += written;
+    if (res == DECOMP_END) {
+        stream->ended = true;
+    }
+
+    // Out of input with nothing to show for it: the data is truncated.
+    if (written == 0 && size != 0 && !stream->ended && stream->last) {
+        return -1;
+    }
+    return (int)written;
+}
+
+bool DecompressorDone(const DecompStream *stream)
+{
+    return stream->ended || stream->produced >= stream->length;
+}
+
+void CloseDecompressor(DecompStream *stream)
+{
+    DecompStats *stats;
+
+    if (stream == NULL) {
+        return;
+    }
+
+    LockMutex(&s_statsMutex);
+    stats = &s_stats[stream->compression];
+    stats->bytesIn += stream->bytesIn;
+    stats->bytesOut += stream->produced;
+    stats->nanoseconds += stream->nanoseconds;
+    stats->resources++;
+    UnlockMutex(&s_statsMutex);
+
+    free(stream->buf);
+    free(stream);
+}
+
+bool Decompress(uint        compression,
+                void       *dest,
+                uint        length,
+                const void *src,
+                uint        complength)
+{
+    DecompStream *stream;
+    uint8_t      *out = (uint8_t *)dest;
+    int           res;
+
+    stream = OpenDecompressor(compression, length);
+    if (stream == NULL) {
+        return false;
+    }
+
+    if (!FeedDecompressor(stream, src, complength, true)) {
+        CloseDecompressor(stream);
+        return false;
+    }
+
+    do {
+        res = ReadDecompressor(stream, out, length);
+        if (res > 0) {
+            out += res;
+            length -= (uint)res;
+        }
+    } while (res > 0 && !DecompressorDone(stream));
+
+    CloseDecompressor(stream);
+    return (res >= 0);
 }
 
-static void decryptinit3(Decrypt3Info *info)
+void GetDecompStats(uint compression, DecompStats *stats)
 {
+    if (compression < MAXCOMPRESSIONS && s_builtinsRegistered) {
+        LockMutex(&s_statsMutex);
+        *stats = s_stats[compression];
+        UnlockMutex(&s_statsMutex);
+    } else {
+        memset(stats, 0, sizeof(DecompStats));
+    }
+}
+
+static void InitStored(void *state) {}
+
+static int DecodeStored(void      *state,
+                        BitStream *in,
+                        uint8_t   *dest,
+                        uint       size,
+                        uint      *written)
+{
+    size_t avail = in->size - (in->bitPos >> 3);
+
+    if (avail > size) {
+        avail = size;
+    }
+
+    memcpy(dest, in->data + (in->bitPos >> 3), avail);
+    in->bitPos += avail * 8;
+    *written = (uint)avail;
+    return DECOMP_MORE;
+}
+
+static void InitLZW1(void *state)
+{
+    Decrypt3Info *info = (Decrypt3Info *)state;
+
     memset(info, 0, sizeof(Decrypt3Info));
     info->numbits  = 9;
     info->curtoken = 0x102;
     info->endtoken = 0x1ff;
-    gbits(info, 0, 0, 0);
 }
 
-static int decryptComp3Helper(Decrypt3Info *info,
-                              uint8_t      *dest,
-                              uint8_t      *src,
-                              int           length,
-                              int           complength,
-                              int16_t      *token)
+static int DecodeLZW1(void      *state,
+                      BitStream *in,
+                      uint8_t   *dest,
+                      uint       size,
+                      uint      *written)
 {
-    // while(length != 0) {
-    while (length >= 0) {
+    Decrypt3Info *info = (Decrypt3Info *)state;
+    uint8_t      *end  = dest + size;
+    uint8_t      *out  = dest;
+    size_t        mark;
+    int16_t       token;
+
+    while (out < end) {
         switch (info->decryptstart) {
             case 0:
             case 1:
-                // bitstring = gbits(numbits, src, complength);
-                info->bitstring =
-                  (uint16_t)gbits(info, info->numbits, src, complength);
+                mark            = in->bitPos;
+                info->bitstring = (uint16_t)GetBitsMSB(in, info->numbits);
+                if (in->underflow) { // wait for the rest of the token
+                    in->bitPos = mark;
+                    *written   = (uint)(out - dest);
+                    return DECOMP_MORE;
+                }
                 if (info->bitstring == 0x101) { // found end-of-data signal
                     info->decryptstart = 4;
-                    return 0;
+                    *written           = (uint)(out - dest);
+                    return DECOMP_END;
                 }
                 if (info->decryptstart == 0) { // first char
                     info->decryptstart = 1;
                     info->lastbits     = info->bitstring;
-                    *(dest++) = info->lastchar = (info->bitstring & 0xff);
-                    if (--length != 0)
-                        continue;
-                    return 0;
+                    *(out++) = info->lastchar = (info->bitstring & 0xff);
+                    continue;
                 }
                 if (info->bitstring == 0x100) { // start-over signal
                     info->numbits      = 9;
@@ -85,37 +393,34 @@ static int decryptComp3Helper(Decrypt3Info *info,
                     info->decryptstart = 0;
                     continue;
                 }
-                *token = info->bitstring;
-                if (*token >= info->curtoken) { // index past current point
-                    *token = info->lastbits;
+                token = info->bitstring;
+                if (token >= info->curtoken) { // index past current point
+                    token = info->lastbits;
                     if (info->stakptr >= ARRAYSIZE(info->stak)) {
-                        return -1;
+                        return DECOMP_ERROR;
                     }
                     info->stak[info->stakptr++] = info->lastchar;
                 }
-                while ((*token > 0xff) &&
-                       (*token < 0x1004)) { // follow links back in data
+                while ((token > 0xff) &&
+                       (token < 0x1004)) { // follow links back in data
                     if (info->stakptr >= ARRAYSIZE(info->stak)) {
-                        return -1;
+                        return DECOMP_ERROR;
                     }
-                    info->stak[info->stakptr++] = info->tokens[*token].data;
-                    *token                      = info->tokens[*token].next;
+                    info->stak[info->stakptr++] = info->tokens[token].data;
+                    token                       = info->tokens[token].next;
                 }
                 if (info->stakptr >= ARRAYSIZE(info->stak)) {
-                    return -1;
+                    return DECOMP_ERROR;
                 }
-                info->lastchar = info->stak[info->stakptr++] = *token & 0xff;
+                info->lastchar = info->stak[info->stakptr++] = token & 0xff;
             case 2:
                 while (info->stakptr > 0) { // put stack in buffer
-                    if (info->stakptr >= ARRAYSIZE(info->stak)) {
-                        return -1;
-                    }
-                    *(dest++) = info->stak[--info->stakptr];
-                    length--;
-                    if (length == 0) {
+                    if (out == end) {
                         info->decryptstart = 2;
-                        return 0;
+                        *written           = (uint)(out - dest);
+                        return DECOMP_MORE;
                     }
+                    *(out++) = info->stak[--info->stakptr];
                 }
                 info->decryptstart = 1;
                 if (info->curtoken <= info->endtoken) { // put token into record
@@ -130,21 +435,13 @@ static int decryptComp3Helper(Decrypt3Info *info,
                     }
                 }
                 info->lastbits = info->bitstring;
-                continue; // When are "break" and "continue" synonymous?
+                continue;
             case 4:
-                return 0;
+                *written = (uint)(out - dest);
+                return DECOMP_END;
         }
     }
-    return 0; // [DJ] shut up compiler warning
-}
 
-bool DecompressLZW_1(uint8_t *dest, uint8_t *src, int length, int complength)
-{
-    int           res;
-    int16_t       token;
-    Decrypt3Info *info = (Decrypt3Info *)malloc(sizeof(Decrypt3Info));
-    decryptinit3(info);
-    res = decryptComp3Helper(info, dest, src, length, complength, &token);
-    free(info);
-    return (res == 0);
+    *written = (uint)(out - dest);
+    return DECOMP_MORE;
 }
@@ -1,4 +1,5 @@
 #include "sci/Utils/ErrMsg.h"
+#include "sci/Logger/Log.h"
 #include <stdarg.h>
 
 #define ERRBUFSIZE  400
@@ -0,0 +1,248 @@
+#include "sci/Utils/Crypt.h"
+
+// Decoder for the PKWARE DCL "implode" method (SCI compression types 8 and
+// 18-20).
+//
+// The data begins with two header bytes: whether literals are Huffman coded,
+// and the number of low distance bits (4-6). Then follows a stream of tokens,
+// read least significant bit first: a 0 bit for a literal, a 1 bit for a
+// length/distance pair. A length of 519 marks the end of the data.
+// Huffman codes are stored bit-inverted, as canonical codes of the lengths
+// in the tables below.
+
+#define MAXBITS   13
+#define WINDOW    4096
+#define ENDLENGTH 519
+
+typedef struct HuffTable {
+    uint16_t count[MAXBITS + 1]; // number of codes of each length
+    uint16_t symbol[256];        // symbols ordered by code
+} HuffTable;
+
+typedef struct ExplodeState {
+    int      literals; // -1 until the header has been read
+    uint     dictBits;
+    uint     copyLen;
+    uint     copyDist;
+    uint     winPos;
+    uint     filled;
+    bool     ended;
+    uint8_t  window[WINDOW];
+} ExplodeState;
+
+// Code lengths, as runs: the low nibble is the length and the high nibble
+// one less than the number of symbols having it.
+static const uint8_t s_litLen[] = {
+    11,  124, 8,   7,   28,  7,   188, 13,  76,  4,   10,  8,   12,  10,
+    12,  10,  8,   23,  8,   9,   7,   6,   7,   8,   7,   6,   55,  8,
+    23,  24,  12,  11,  7,   9,   11,  12,  6,   7,   22,  5,   7,   24,
+    6,   11,  9,   6,   7,   22,  7,   11,  38,  7,   9,   8,   25,  11,
+    8,   11,  9,   12,  8,   12,  5,   38,  5,   38,  5,   11,  7,   5,
+    6,   21,  6,   10,  53,  8,   7,   24,  10,  27,  44,  253, 253, 253,
+    252, 252, 252, 13,  12,  45,  12,  45,  12,  61,  12,  45,  44,  173
+};
+static const uint8_t s_lenLen[]  = { 2, 35, 36, 53, 38, 23 };
+static const uint8_t s_distLen[] = { 2, 20, 53, 230, 247, 151, 248 };
+
+// Base and extra bits of each length symbol.
+static const uint16_t s_lenBase[16] = { 3,  2,  4,  5,  6,  7,   8,   9,
+                                        10, 12, 16, 24, 40, 72, 136, 264 };
+static const uint8_t  s_lenExtra[16] = { 0, 0, 0, 0, 0, 0, 0, 0,
+                                         1, 2, 3, 4, 5, 6, 7, 8 };
+
+static HuffTable s_litTable;
+static HuffTable s_lenTable;
+static HuffTable s_distTable;
+static bool      s_tablesBuilt = false;
+
+static void InitExplode(void *state);
+static int  DecodeExplode(void      *state,
+                          BitStream *in,
+                          uint8_t   *dest,
+                          uint       size,
+                          uint      *written);
+
+const Decompressor g_dclDecompressor = {
+    "DCL", sizeof(ExplodeState), InitExplode, DecodeExplode
+};
+
+static void BuildTable(HuffTable *table, const uint8_t *rep, uint n)
+{
+    uint8_t  length[256];
+    uint16_t offs[MAXBITS + 1];
+    uint     symbol = 0;
+    uint     len, count, i;
+
+    for (i = 0; i < n; i++) {
+        len   = rep[i] & 15;
+        count = (rep[i] >> 4) + 1;
+        while (count-- != 0) {
+            length[symbol++] = (uint8_t)len;
+        }
+    }
+
+    memset(table->count, 0, sizeof(table->count));
+    for (i = 0; i < symbol; i++) {
+        table->count[length[i]]++;
+    }
+
+    offs[1] = 0;
+    for (len = 1; len < MAXBITS; len++) {
+        offs[len + 1] = offs[len] + table->count[len];
+    }
+
+    for (i = 0; i < symbol; i++) {
+        if (length[i] != 0) {
+            table->symbol[offs[length[i]]++] = (uint16_t)i;
+        }
+    }
+}
+
+void BuildExplodeTables(void)
+{
+    if (!s_tablesBuilt) {
+        BuildTable(&s_litTable, s_litLen, sizeof(s_litLen));
+        BuildTable(&s_lenTable, s_lenLen, sizeof(s_lenLen));
+        BuildTable(&s_distTable, s_distLen, sizeof(s_distLen));
+        s_tablesBuilt = true;
+    }
+}
+
+static void InitExplode(void *state)
+{
+    ExplodeState *dcl = (ExplodeState *)state;
+
+    memset(dcl, 0, sizeof(ExplodeState));
+    dcl->literals = -1;
+}
+
+// Decode a symbol, or return -1 if the input ran out.
+static int DecodeSymbol(const HuffTable *table, BitStream *in)
+{
+    int  code  = 0;
+    int  first = 0;
+    int  index = 0;
+    int  count;
+    uint len;
+
+    for (len = 1; len <= MAXBITS; len++) {
+        code |= GetBitsLSB(in, 1) ^ 1;
+        if (in->underflow) {
+            return -1;
+        }
+
+        count = table->count[len];
+        if (code < first + count) {
+            return table->symbol[index + (code - first)];
+        }
+
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+static void PutByte(ExplodeState *dcl, uint8_t **out, uint8_t b)
+{
+    dcl->window[dcl->winPos] = b;
+    dcl->winPos              = (dcl->winPos + 1) & (WINDOW - 1);
+    if (dcl->filled < WINDOW) {
+        dcl->filled++;
+    }
+    *((*out)++) = b;
+}
+
+static int DecodeExplode(void      *state,
+                         BitStream *in,
+                         uint8_t   *dest,
+                         uint       size,
+                         uint      *written)
+{
+    ExplodeState *dcl = (ExplodeState *)state;
+    uint8_t      *out = dest;
+    uint8_t      *end = dest + size;
+    size_t        mark;
+    int           sym;
+    uint          len, dist, shift;
+
+    *written = 0;
+    if (dcl->ended) {
+        return DECOMP_END;
+    }
+
+    if (dcl->literals < 0) {
+        mark          = in->bitPos;
+        dcl->literals = (int)GetBitsLSB(in, 8);
+        dcl->dictBits = GetBitsLSB(in, 8);
+        if (in->underflow) {
+            in->bitPos    = mark;
+            dcl->literals = -1;
+            return DECOMP_MORE;
+        }
+        if (dcl->literals > 1 || dcl->dictBits < 4 || dcl->dictBits > 6) {
+            return DECOMP_ERROR;
+        }
+    }
+
+    while (out < end) {
+        // Finish a copy left over from the previous call.
+        if (dcl->copyLen != 0) {
+            while (dcl->copyLen != 0 && out < end) {
+                PutByte(dcl,
+                        &out,
+                        dcl->window[(dcl->winPos - dcl->copyDist) &
+                                    (WINDOW - 1)]);
+                dcl->copyLen--;
+            }
+            continue;
+        }
+
+        mark = in->bitPos;
+        if (GetBitsLSB(in, 1) != 0) {
+            sym = DecodeSymbol(&s_lenTable, in);
+            if (sym < 0) {
+                goto underflow;
+            }
+            len = s_lenBase[sym] + GetBitsLSB(in, s_lenExtra[sym]);
+            if (in->underflow) {
+                goto underflow;
+            }
+            if (len == ENDLENGTH) {
+                dcl->ended = true;
+                break;
+            }
+
+            sym = DecodeSymbol(&s_distTable, in);
+            if (sym < 0) {
+                goto underflow;
+            }
+            shift = (len == 2) ? 2 : dcl->dictBits;
+            dist  = ((uint)sym << shift) + GetBitsLSB(in, shift) + 1;
+            if (in->underflow) {
+                goto underflow;
+            }
+            if (dist > dcl->filled) {
+                return DECOMP_ERROR;
+            }
+
+            dcl->copyLen  = len;
+            dcl->copyDist = dist;
+        } else {
+            sym = dcl->literals ? DecodeSymbol(&s_litTable, in)
+                                : (int)GetBitsLSB(in, 8);
+            if (sym < 0 || in->underflow) {
+                goto underflow;
+            }
+            PutByte(dcl, &out, (uint8_t)sym);
+        }
+    }
+
+    *written = (uint)(out - dest);
+    return dcl->ended ? DECOMP_END : DECOMP_MORE;
+
+underflow: // wait for the rest of the token
+    in->bitPos = mark;
+    *written   = (uint)(out - dest);
+    return DECOMP_MORE;
+}
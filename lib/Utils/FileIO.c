@@ -1,7 +1,11 @@
 #include "sci/Utils/FileIO.h"
 #include "sci/Utils/Path.h"
 #ifndef __WINDOWS__
+#if defined(__APPLE__) || defined(__FreeBSD__)
 #include <copyfile.h>
+#else
+#include <sys/sendfile.h>
+#endif
 #include <dirent.h>
 #endif
 
@@ -16,14 +20,14 @@ int fileopen(const char *name, int mode)
 
     if (mode == O_RDONLY) {
         DosToLocalPath(path, name, true);
-        fd = open(path, mode | O_BINARY);
+        fd = open(path, mode | O_BINARY, 0666);
         if (fd != -1) {
             return fd;
         }
     }
 
     DosToLocalPath(path, name, false);
-    return open(path, mode | O_BINARY);
+    return open(path, mode | O_BINARY, 0666);
 }
 
 char *fgets_no_eol(char *str, int len, int fd)
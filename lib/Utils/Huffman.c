@@ -0,0 +1,135 @@
+#include "sci/Utils/Crypt.h"
+
+// Decoder for the Huffman compression method (SCI compression type 1).
+//
+// The compressed data starts with the node count, the terminator symbol and
+// the node table (two bytes per node). Each node holds a symbol and, in the
+// second byte, the offsets to its children: the high nibble for a 0 bit and
+// the low nibble for a 1 bit. A zero low nibble on a 1 bit means a literal
+// byte follows.
+
+#define MAXNODES 256
+
+typedef struct HuffmanState {
+    bool     haveTree;
+    bool     ended;
+    uint     numNodes;
+    uint     terminator;
+    uint8_t  nodes[MAXNODES * 2];
+} HuffmanState;
+
+static void InitHuffman(void *state);
+static int  DecodeHuffman(void      *state,
+                          BitStream *in,
+                          uint8_t   *dest,
+                          uint       size,
+                          uint      *written);
+
+const Decompressor g_huffmanDecompressor = {
+    "Huffman", sizeof(HuffmanState), InitHuffman, DecodeHuffman
+};
+
+static void InitHuffman(void *state)
+{
+    memset(state, 0, sizeof(HuffmanState));
+}
+
+static bool ReadTree(HuffmanState *huff, BitStream *in)
+{
+    size_t mark = in->bitPos;
+    uint   i;
+
+    huff->numNodes   = GetBitsMSB(in, 8);
+    huff->terminator = GetBitsMSB(in, 8) | 0x100;
+    for (i = 0; i < huff->numNodes * 2 && !in->underflow; i++) {
+        huff->nodes[i] = (uint8_t)GetBitsMSB(in, 8);
+    }
+
+    if (in->underflow) {
+        in->bitPos = mark;
+        return false;
+    }
+
+    huff->haveTree = true;
+    return true;
+}
+
+// Return the next symbol (a byte, or 0x100 | byte for a literal), or -1 if
+// the input ran out (or the data is bad, setting *bad).
+static int NextSymbol(HuffmanState *huff, BitStream *in, bool *bad)
+{
+    uint node = 0;
+    uint next;
+
+    while (huff->nodes[node * 2 + 1] != 0) {
+        if (GetBitsMSB(in, 1) != 0) {
+            next = huff->nodes[node * 2 + 1] & 0x0f;
+            if (next == 0) {
+                next = GetBitsMSB(in, 8);
+                return in->underflow ? -1 : (int)(next | 0x100);
+            }
+        } else {
+            next = huff->nodes[node * 2 + 1] >> 4;
+        }
+
+        if (in->underflow) {
+            return -1;
+        }
+
+        node += next;
+        if (node >= huff->numNodes) {
+            *bad = true;
+            return -1;
+        }
+    }
+    return huff->nodes[node * 2];
+}
+
+static int DecodeHuffman(void      *state,
+                         BitStream *in,
+                         uint8_t   *dest,
+                         uint       size,
+                         uint      *written)
+{
+    HuffmanState *huff = (HuffmanState *)state;
+    uint8_t      *out  = dest;
+    uint8_t      *end  = dest + size;
+    size_t        mark;
+    bool          bad = false;
+    int           sym;
+
+    *written = 0;
+    if (huff->ended) {
+        return DECOMP_END;
+    }
+
+    if (!huff->haveTree) {
+        if (!ReadTree(huff, in)) {
+            return DECOMP_MORE;
+        }
+        if (huff->numNodes == 0) {
+            return DECOMP_ERROR;
+        }
+    }
+
+    while (out < end) {
+        mark = in->bitPos;
+        sym  = NextSymbol(huff, in, &bad);
+        if (bad) {
+            return DECOMP_ERROR;
+        }
+        if (sym < 0) { // wait for the rest of the symbol
+            in->bitPos = mark;
+            break;
+        }
+        if ((uint)sym == huff->terminator) {
+            huff->ended = true;
+            *written    = (uint)(out - dest);
+            return DECOMP_END;
+        }
+        *(out++) = (uint8_t)sym;
+    }
+
+    *written = (uint)(out - dest);
+    return DECOMP_MORE;
+}
@@ -0,0 +1,229 @@
+#include "sci/Utils/Lz.h"
+
+#define HASHBITS  12
+#define MAXOFFSET 0xffff
+
+// The last match must start this far from the end, and the last bytes are
+// always literals, so that a match never reads past the input.
+#define LASTLITERALS 5
+#define MFLIMIT      12
+
+static uint32_t Read32(const uint8_t *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint Hash(uint32_t sequence)
+{
+    return (sequence * 2654435761U) >> (32 - HASHBITS);
+}
+
+static uint8_t *PutLength(uint8_t *op, uint8_t *oend, uint len)
+{
+    while (len >= 255) {
+        if (op >= oend) {
+            return NULL;
+        }
+        *op++ = 255;
+        len -= 255;
+    }
+
+    if (op >= oend) {
+        return NULL;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+// Write a sequence of literals followed by a match (or none if matchLen is
+// zero).
+static uint8_t *PutSequence(uint8_t       *op,
+                            uint8_t       *oend,
+                            const uint8_t *literals,
+                            uint           litLen,
+                            uint           offset,
+                            uint           matchLen)
+{
+    uint8_t *token = op++;
+    uint     code;
+
+    if (op > oend) {
+        return NULL;
+    }
+
+    if (litLen >= 15) {
+        *token = 15 << 4;
+        op     = PutLength(op, oend, litLen - 15);
+        if (op == NULL) {
+            return NULL;
+        }
+    } else {
+        *token = (uint8_t)(litLen << 4);
+    }
+
+    if ((uint)(oend - op) < litLen) {
+        return NULL;
+    }
+    memcpy(op, literals, litLen);
+    op += litLen;
+
+    if (matchLen == 0) {
+        return op;
+    }
+
+    if (oend - op < 2) {
+        return NULL;
+    }
+    *op++ = (uint8_t)offset;
+    *op++ = (uint8_t)(offset >> 8);
+
+    code = matchLen - LZ_MINMATCH;
+    if (code >= 15) {
+        *token |= 15;
+        op = PutLength(op, oend, code - 15);
+    } else {
+        *token |= (uint8_t)code;
+    }
+    return op;
+}
+
+uint LzCompress(void *dest, uint destSize, const void *src, uint size)
+{
+    const uint8_t *ip     = (const uint8_t *)src;
+    const uint8_t *iend   = ip + size;
+    const uint8_t *anchor = ip;
+    const uint8_t *ref;
+    uint8_t       *op   = (uint8_t *)dest;
+    uint8_t       *oend = op + destSize;
+    uint32_t       table[1 << HASHBITS];
+    uint           h, len;
+
+    memset(table, 0, sizeof(table));
+
+    if (size > MFLIMIT) {
+        const uint8_t *mflimit  = iend - MFLIMIT;
+        const uint8_t *matchEnd = iend - LASTLITERALS;
+
+        ip++;
+        while (ip < mflimit) {
+            h        = Hash(Read32(ip));
+            ref      = (const uint8_t *)src + table[h];
+            table[h] = (uint32_t)(ip - (const uint8_t *)src);
+
+            if (ip - ref > MAXOFFSET || ref >= ip || Read32(ref) != Read32(ip)) {
+                ip++;
+                continue;
+            }
+
+            // Extend the match backwards over the pending literals.
+            while (ip > anchor && ref > (const uint8_t *)src &&
+                   ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+
+            len = LZ_MINMATCH;
+            while (ip + len < matchEnd && ip[len] == ref[len]) {
+                len++;
+            }
+
+            op = PutSequence(op,
+                             oend,
+                             anchor,
+                             (uint)(ip - anchor),
+                             (uint)(ip - ref),
+                             len);
+            if (op == NULL) {
+                return 0;
+            }
+
+            ip += len;
+            anchor = ip;
+            if (ip < mflimit) {
+                table[Hash(Read32(ip - 2))] =
+                  (uint32_t)(ip - 2 - (const uint8_t *)src);
+            }
+        }
+    }
+
+    op = PutSequence(op, oend, anchor, (uint)(iend - anchor), 0, 0);
+    if (op == NULL) {
+        return 0;
+    }
+    return (uint)(op - (uint8_t *)dest);
+}
+
+bool LzDecompress(void *dest, uint length, const void *src, uint srcSize)
+{
+    const uint8_t *ip   = (const uint8_t *)src;
+    const uint8_t *iend = ip + srcSize;
+    uint8_t       *op   = (uint8_t *)dest;
+    uint8_t       *oend = op + length;
+    const uint8_t *ref;
+    uint           token, len, offset;
+    uint8_t        b;
+
+    while (ip < iend) {
+        token = *ip++;
+
+        // Literals.
+        len = token >> 4;
+        if (len == 15) {
+            do {
+                if (ip >= iend) {
+                    return false;
+                }
+                b = *ip++;
+                len += b;
+            } while (b == 255);
+        }
+        if ((uint)(iend - ip) < len || (uint)(oend - op) < len) {
+            return false;
+        }
+        memcpy(op, ip, len);
+        ip += len;
+        op += len;
+
+        // The last sequence has no match.
+        if (ip == iend) {
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return false;
+        }
+        offset = ip[0] | ((uint)ip[1] << 8);
+        ip += 2;
+
+        len = (token & 15);
+        if (len == 15) {
+            do {
+                if (ip >= iend) {
+                    return false;
+                }
+                b = *ip++;
+                len += b;
+            } while (b == 255);
+        }
+        len += LZ_MINMATCH;
+
+        if (offset == 0 || offset > (uint)(op - (uint8_t *)dest) ||
+            (uint)(oend - op) < len) {
+            return false;
+        }
+
+        // Copy bytewise when the match overlaps what it is producing.
+        ref = op - offset;
+        if (offset >= len) {
+            memcpy(op, ref, len);
+            op += len;
+        } else {
+            while (len-- != 0) {
+                *op++ = *ref++;
+            }
+        }
+    }
+    return (op == oend);
+}
@@ -0,0 +1,49 @@
+#include "sci/Utils/Sort.h"
+
+// Merge sort: each half is sorted, then the first half is moved to the
+// scratch space and merged back with the second, an element of the second
+// going first only if it is less than that of the first.
+void StableSort(void  *base,
+                size_t num,
+                size_t size,
+                int (*compare)(const void *, const void *),
+                void *scratch)
+{
+    uint8_t *bytes = (uint8_t *)base;
+    uint8_t *left, *leftEnd, *right, *rightEnd, *dst;
+    size_t   half;
+
+    if (num < 2) {
+        return;
+    }
+
+    half = num / 2;
+    StableSort(bytes, half, size, compare, scratch);
+    StableSort(bytes + half * size, num - half, size, compare, scratch);
+
+    // The halves are already in order.
+    if (compare(bytes + (half - 1) * size, bytes + half * size) <= 0) {
+        return;
+    }
+
+    memcpy(scratch, bytes, half * size);
+    left     = (uint8_t *)scratch;
+    leftEnd  = left + half * size;
+    right    = bytes + half * size;
+    rightEnd = bytes + num * size;
+    dst      = bytes;
+
+    while (left < leftEnd && right < rightEnd) {
+        if (compare(right, left) < 0) {
+            memcpy(dst, right, size);
+            right += size;
+        } else {
+            memcpy(dst, left, size);
+            left += size;
+        }
+        dst += size;
+    }
+
+    // What is left of the second half is in place already.
+    memcpy(dst, left, (size_t)(leftEnd - left));
+}
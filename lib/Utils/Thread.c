@@ -0,0 +1,99 @@
+#include "sci/Utils/Thread.h"
+
+typedef struct ThreadStart {
+    ThreadProc proc;
+    void      *arg;
+} ThreadStart;
+
+#if defined(__WINDOWS__)
+static DWORD WINAPI ThreadEntry(LPVOID param)
+#else
+static void *ThreadEntry(void *param)
+#endif
+{
+    ThreadStart start = *(ThreadStart *)param;
+
+    free(param);
+    start.proc(start.arg);
+    return 0;
+}
+
+bool StartThread(Thread *thread, ThreadProc proc, void *arg)
+{
+    ThreadStart *start;
+
+    start = (ThreadStart *)malloc(sizeof(ThreadStart));
+    if (start == NULL) {
+        return false;
+    }
+
+    start->proc = proc;
+    start->arg  = arg;
+
+#if defined(__WINDOWS__)
+    *thread = CreateThread(NULL, 0, ThreadEntry, start, 0, NULL);
+    if (*thread == NULL) {
+        free(start);
+        return false;
+    }
+#else
+    if (pthread_create(thread, NULL, ThreadEntry, start) != 0) {
+        free(start);
+        return false;
+    }
+#endif
+    return true;
+}
+
+void JoinThread(Thread *thread)
+{
+#if defined(__WINDOWS__)
+    WaitForSingleObject(*thread, INFINITE);
+    CloseHandle(*thread);
+#else
+    pthread_join(*thread, NULL);
+#endif
+}
+
+void CreateCondVar(CondVar *cond)
+{
+#if defined(__WINDOWS__)
+    InitializeConditionVariable(cond);
+#else
+    pthread_cond_init(cond, NULL);
+#endif
+}
+
+void DestroyCondVar(CondVar *cond)
+{
+#if !defined(__WINDOWS__)
+    pthread_cond_destroy(cond);
+#endif
+}
+
+void WaitCondVar(CondVar *cond, Mutex *mutex)
+{
+#if defined(__WINDOWS__)
+    SleepConditionVariableCS(cond, mutex, INFINITE);
+#else
+    pthread_cond_wait(cond, mutex);
+#endif
+}
+
+void SignalCondVar(CondVar *cond)
+{
+#if defined(__WINDOWS__)
+    WakeConditionVariable(cond);
+#else
+    pthread_cond_signal(cond);
+#endif
+}
+
+void BroadcastCondVar(CondVar *cond)
+{
+#if defined(__WINDOWS__)
+    WakeAllConditionVariable(cond);
+#else
+    pthread_cond_broadcast(cond);
+#endif
+}
@@ -99,6 +99,11 @@ uint64_t GetHighResolutionTime(void)
     uint64_t time = 0;
     ClockTime(CLOCK_MONOTONIC, NULL, &time);
     return time;
+
+#elif defined(__LINUX__)
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
 #endif
 }
 
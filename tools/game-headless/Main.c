@@ -0,0 +1,135 @@
+#include "sci/Driver/Display/Display.h"
+#include "sci/Driver/Display/Headless.h"
+#include "sci/Kernel/Audio.h"
+#include "sci/Kernel/Dialog.h"
+#include "sci/Kernel/Event.h"
+#include "sci/Kernel/Graphics.h"
+#include "sci/Kernel/Menu.h"
+#include "sci/Kernel/Midi.h"
+#include "sci/Kernel/Palette.h"
+#include "sci/Kernel/Picture.h"
+#include "sci/Kernel/Restart.h"
+#include "sci/Kernel/Sound.h"
+#include "sci/Kernel/Text.h"
+#include "sci/Kernel/VolLoad.h"
+#include "sci/Kernel/Window.h"
+#include "sci/PMachine/PMachine.h"
+#include "sci/Utils/ErrMsg.h"
+#include "sci/Utils/Path.h"
+#include "sci/Utils/Timer.h"
+
+// Runs a game on the headless display, for regression and throughput tests
+// on hosts without a screen. Frames can be dumped to PPM files, and their
+// hashes printed, and the game left after a number of frames.
+
+static const char *s_usage =
+  "usage: game-headless [options]\n"
+  "  -s <dir>  game directory (the current one by default)\n"
+  "  -d <dir>  dump frames to <dir>\n"
+  "  -e <n>    dump every n-th frame (1 by default)\n"
+  "  -f <n>    quit after n frames\n"
+  "  -h        print a hash of every frame\n";
+
+static uint s_maxFrames = 0;
+static bool s_hash      = false;
+
+// Called on the render thread after every present.
+static void WatchFrame(const uint32_t *pixels, uint frame, void *arg)
+{
+    uint32_t hash = 2166136261U;
+    uint     i;
+
+    if (s_hash) {
+        for (i = 0; i < MAXWIDTH * MAXHEIGHT; ++i) {
+            hash = (hash ^ pixels[i]) * 16777619U;
+        }
+        printf("%06u %08x\n", frame, hash);
+        fflush(stdout);
+    }
+
+    if (s_maxFrames != 0 && frame >= s_maxFrames) {
+        exit(EXIT_SUCCESS);
+    }
+}
+
+static void Run(const char *gameDir)
+{
+    g_picRect.top = 0;
+
+    InitPath(gameDir, gameDir);
+
+    InstallSoundServer();
+
+    InitTimer();
+    InitResource();
+    InitScripts();
+
+    CInitGraph();
+
+    InitEvent(16);
+
+    InitPalette();
+
+    InitWindow();
+
+    InitDialog(DoAlert);
+
+    InitAudioDriver();
+    InitSoundDriver();
+
+    // Load offsets to often used object properties.  (In script.c)
+    LoadPropOffsets();
+
+    // Open up a menu port.
+    ROpenPort(&g_menuPortStruc);
+    g_menuPort = &g_menuPortStruc;
+    InitMenu();
+
+    // Open up a picture window.
+    RSetFont(0);
+    g_picWind = RNewWindow(&g_picRect, "", NOBORDER | NOSAVE, 0, 1);
+    RSetPort(&g_picWind->port);
+    InitPicture();
+
+    // We return here on a restart.
+    setjmp(g_restartBuf);
+
+    // Turn control over to the pseudo-machine.
+    PMachine();
+}
+
+int main(int argc, char *argv[])
+{
+    const char *gameDir = ".";
+    const char *dumpDir = NULL;
+    uint        every   = 1;
+    int         i;
+
+    for (i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-h") == 0) {
+            s_hash = true;
+        } else if (i + 1 < argc && strcmp(argv[i], "-s") == 0) {
+            gameDir = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "-d") == 0) {
+            dumpDir = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "-e") == 0 &&
+                   atoi(argv[i + 1]) > 0) {
+            every = (uint)atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-f") == 0 &&
+                   atoi(argv[i + 1]) > 0) {
+            s_maxFrames = (uint)atoi(argv[++i]);
+        } else {
+            fputs(s_usage, stderr);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Set before the display is, for the first frame to be seen.
+    SetFrameProc(WatchFrame, NULL);
+    if (dumpDir != NULL) {
+        SetFrameDump(dumpDir, every);
+    }
+
+    Run(gameDir);
+    return EXIT_SUCCESS;
+}
@@ -112,6 +112,7 @@ static LRESULT CALLBACK WindowProc(HWND   hWnd,
         hdc = BeginPaint(hWnd, &ps);
         if (g_vHndl != NULL) {
             Display(0, 0, MAXHEIGHT, MAXWIDTH, g_vHndl, VMAP);
+            FlushDisplay();
         }
         EndPaint(hWnd, &ps);
         return 0;
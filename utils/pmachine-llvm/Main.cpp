@@ -14,6 +14,7 @@
 #include "llvm/Support/raw_ostream.h"
 
 extern "C" {
+#include "sci/Kernel/ResCache.h"
 #include "sci/Kernel/VolLoad.h"
 #include "sci/Utils/ErrMsg.h"
 }
@@ -72,6 +73,7 @@ int main(int argc, char *argv[]) {
   else
     sci::GetWorld().setDataLayout(DataLayout("p:32:32"));
 
+  g_resCacheEnabled = false;
   SetPanicProc(NULL);
   InitResource();
 
@@ -0,0 +1,2395 @@
+//===- Main.cpp -----------------------------------------------------------===//
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+//===----------------------------------------------------------------------===//
+//
+// Microbenchmarks of the interpreter's hot paths.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+#include "sci/Driver/Display/Convert.h"
+#include "sci/Driver/Display/Display.h"
+#include "sci/Kernel/Animate.h"
+#include "sci/Kernel/Avoid.h"
+#include "sci/Kernel/CastGrid.h"
+#include "sci/Kernel/ColorMatch.h"
+#include "sci/Kernel/Compose.h"
+#include "sci/Kernel/Graphics.h"
+#include "sci/Kernel/MapSummary.h"
+#include "sci/Kernel/Motion.h"
+#include "sci/Kernel/Palette.h"
+#include "sci/Kernel/Parse.h"
+#include "sci/Kernel/PicCache.h"
+#include "sci/Kernel/Picture.h"
+#include "sci/Kernel/ResSource.h"
+#include "sci/Kernel/Resource.h"
+#include "sci/Kernel/Selector.h"
+#include "sci/Kernel/Spans.h"
+#include "sci/Kernel/View.h"
+#include "sci/Kernel/Window.h"
+#include "sci/PMachine/Object.h"
+#include "sci/PMachine/Script.h"
+#include "sci/Utils/Crypt.h"
+#include "sci/Utils/Lz.h"
+#include "sci/Utils/Sort.h"
+#include "sci/Utils/Timer.h"
+}
+
+using namespace llvm;
+
+static cl::OptionCategory BenchCat("Benchmark Options");
+
+static cl::opt<std::string>
+    Filter("filter", cl::desc("Only run the benchmarks whose name contains "
+                              "this string"),
+           cl::value_desc("string"), cl::cat(BenchCat));
+
+static cl::opt<unsigned> Iterations("iterations",
+                                    cl::desc("Iterations of each benchmark"),
+                                    cl::init(1000), cl::cat(BenchCat));
+
+static cl::opt<bool> ListBenchmarks("list",
+                                    cl::desc("List the benchmarks"),
+                                    cl::init(false), cl::cat(BenchCat));
+
+namespace {
+
+struct Benchmark {
+  const char *Name;
+  const char *Desc;
+  // Returns false if the benchmark found its code to be wrong.
+  bool (*Run)();
+};
+
+} // end anonymous namespace
+
+// Start a line of results with the name of the benchmark and its variant.
+static raw_ostream &Row(StringRef Name, StringRef Variant) {
+  return outs() << format("%-16s %-12s ", Name.str().c_str(),
+                          Variant.str().c_str());
+}
+
+// Time Iterations calls of Fn, and print and return the average in
+// nanoseconds.
+static double Measure(StringRef Name, StringRef Variant, uint64_t Bytes,
+                      const std::function<void()> &Fn) {
+  // Warm up the caches.
+  Fn();
+
+  uint64_t Start = GetHighResolutionTime();
+  for (unsigned I = 0; I < Iterations; ++I)
+    Fn();
+  uint64_t Elapsed = GetHighResolutionTime() - Start;
+
+  double Nanoseconds = double(Elapsed) / Iterations;
+  Row(Name, Variant) << format("%12.1f ns", Nanoseconds);
+  if (Bytes != 0)
+    outs() << format(" %10.1f MB/s", Bytes / (1024.0 * 1024.0) /
+                                         (Nanoseconds / 1e9));
+  outs() << "\n";
+  return Nanoseconds;
+}
+
+// Fill a frame with a pseudo-random picture: runs of a color, as in the
+// pictures of the games, rather than noise.
+static void FillFrame(std::vector<uint8_t> &Frame) {
+  uint32_t Seed = 1234;
+  uint8_t Color = 0;
+  for (size_t I = 0; I < Frame.size(); ++I) {
+    Seed = Seed * 1103515245 + 12345;
+    if ((Seed >> 16) % 8 == 0)
+      Color = uint8_t(Seed >> 24);
+    Frame[I] = Color;
+  }
+}
+
+static bool BenchConvert() {
+  std::vector<uint8_t> Frame(MAXWIDTH * MAXHEIGHT);
+  std::vector<uint32_t> Pixels(MAXWIDTH * MAXHEIGHT);
+  uint32_t Clut[256];
+
+  FillFrame(Frame);
+  for (unsigned I = 0; I < 256; ++I)
+    Clut[I] = RGBA32(I, 255 - I, I / 2);
+
+  uint OldIsa = GetConvertIsa();
+  for (uint Isa = ISA_SCALAR; Isa <= GetBestIsa(); ++Isa) {
+    SetConvertIsa(Isa);
+    Measure("convert", GetIsaName(Isa), Pixels.size() * sizeof(uint32_t),
+            [&] {
+              for (unsigned Y = 0; Y < MAXHEIGHT; ++Y)
+                ConvertPixels(&Pixels[Y * MAXWIDTH], &Frame[Y * MAXWIDTH],
+                              MAXWIDTH, Clut);
+            });
+  }
+  SetConvertIsa(OldIsa);
+  return true;
+}
+
+#if defined(SCI_HEADLESS_DISPLAY)
+// Check that the visual pixels of the framebuffer show the CLUT's colors.
+static bool CheckFramebuffer(const std::vector<uint8_t> &Frame,
+                             const char *Step) {
+  RPalette Clut;
+  GetDisplayCLUT(&Clut);
+  SyncDisplay();
+
+  const uint32_t *Pixels = GetDisplayPixels();
+  for (unsigned I = 0; I < Frame.size(); ++I) {
+    if (I / MAXWIDTH >= 150 && I / MAXWIDTH < 160)
+      continue;
+    const Guns &Gun = Clut.gun[Frame[I]];
+    if (Pixels[I] != RGBA32(Gun.r, Gun.g, Gun.b)) {
+      errs() << format("error: %s: pixel %u is %08x, not %08x\n", Step, I,
+                       Pixels[I], RGBA32(Gun.r, Gun.g, Gun.b));
+      return false;
+    }
+  }
+  return true;
+}
+
+// Present a frame, with rows 150 to 159 showing the priority map, then
+// change its CLUT: cycle 8 colors shown by 20 rows of water, and fade the
+// whole palette, against displaying the frame again.
+static bool BenchClut() {
+  std::vector<uint8_t> Frame(MAXWIDTH * MAXHEIGHT);
+  RPalette Pal = RPalette();
+
+  FillFrame(Frame);
+  for (unsigned I = 0; I < Frame.size(); ++I) {
+    bool Water = I / MAXWIDTH >= 20 && I / MAXWIDTH < 40;
+    if (Water)
+      Frame[I] = uint8_t(200 + I % 8);
+    else if (Frame[I] >= 200 && Frame[I] < 208)
+      Frame[I] -= 8;
+  }
+  for (unsigned I = 0; I < PAL_CLUT_SIZE; ++I) {
+    Pal.gun[I] = {PAL_IN_USE, uint8_t(I), uint8_t(255 - I), uint8_t(I * 7)};
+    Pal.palIntensity[I] = MAX_INTENSITY;
+  }
+
+  InitDisplay();
+  SetDisplayCLUT(&Pal);
+  Display(0, 0, MAXHEIGHT, MAXWIDTH, Frame.data(), VMAP);
+  Display(150, 0, 160, MAXWIDTH, Frame.data(), PMAP);
+  FlushDisplay();
+  bool Ok = CheckFramebuffer(Frame, "frame");
+
+  auto Cycle = [&] {
+    Guns First = Pal.gun[200];
+    for (unsigned I = 200; I < 207; ++I)
+      Pal.gun[I] = Pal.gun[I + 1];
+    Pal.gun[207] = First;
+    SetDisplayCLUT(&Pal);
+    FlushDisplay();
+    SyncDisplay();
+  };
+  int Intensity = MAX_INTENSITY;
+  auto Fade = [&] {
+    Intensity = Intensity > 0 ? Intensity - 10 : MAX_INTENSITY;
+    for (int16_t &Level : Pal.palIntensity)
+      Level = int16_t(Intensity);
+    SetDisplayCLUT(&Pal);
+    FlushDisplay();
+    SyncDisplay();
+  };
+
+  for (unsigned I = 0; Ok && I < 11; ++I) {
+    Cycle();
+    Ok = CheckFramebuffer(Frame, "cycle");
+  }
+  for (unsigned I = 0; Ok && I < 11; ++I) {
+    Fade();
+    Ok = CheckFramebuffer(Frame, "fade");
+  }
+
+  if (Ok) {
+    DisplayStats Before, After;
+    GetDisplayStats(&Before);
+    Measure("clut", "cycle", 0, Cycle);
+    GetDisplayStats(&After);
+    Row("clut", "cycle") << format("%12.1f pixels\n",
+                                   double(After.recolored - Before.recolored) /
+                                       (After.frames - Before.frames));
+
+    Measure("clut", "fade", 0, Fade);
+    Measure("clut", "redraw", 0, [&] {
+      Display(0, 0, MAXHEIGHT, MAXWIDTH, Frame.data(), VMAP);
+      FlushDisplay();
+      SyncDisplay();
+    });
+  }
+
+  EndDisplay();
+  return Ok;
+}
+#endif
+
+// Check the span writes of every level against the scalar ones, over all
+// alignments and the lengths of a line.
+static bool CheckSpans() {
+  static const uint8_t Masks[] = {0xf0, 0x0f, 0xff, 0x3c};
+  std::vector<uint8_t> Start(MAXWIDTH + 16), Dots(MAXWIDTH + 16), Expected,
+      Actual;
+
+  uint32_t Seed = 4321;
+  for (size_t I = 0; I < Start.size(); ++I) {
+    Seed = Seed * 1103515245 + 12345;
+    Start[I] = uint8_t(Seed >> 24);
+    Dots[I] = (Seed >> 8) & 1 ? 0xff : 0x00;
+  }
+
+  for (uint Isa = ISA_SSE2; Isa <= GetBestIsa(); ++Isa) {
+    if (!SetSpanIsa(Isa))
+      continue;
+    for (unsigned Offset = 0; Offset < 16; ++Offset)
+      for (unsigned Count = 0; Count <= MAXWIDTH; ++Count)
+        for (uint8_t Mask : Masks) {
+          uint8_t Value = uint8_t(0xa5 & Mask);
+
+          Expected = Start;
+          SetSpanIsa(ISA_SCALAR);
+          FillBits(&Expected[Offset], Mask, Value, Count);
+          Actual = Start;
+          SetSpanIsa(Isa);
+          FillBits(&Actual[Offset], Mask, Value, Count);
+          if (Actual != Expected) {
+            errs() << format("error: %s FillBits differs at offset %u, "
+                             "count %u, mask %02x\n",
+                             GetIsaName(Isa), Offset, Count, Mask);
+            return false;
+          }
+
+          Expected = Start;
+          SetSpanIsa(ISA_SCALAR);
+          FillBytes(&Expected[Offset], Value, Count);
+          Actual = Start;
+          SetSpanIsa(Isa);
+          FillBytes(&Actual[Offset], Value, Count);
+          if (Actual != Expected) {
+            errs() << format("error: %s FillBytes differs at offset %u, "
+                             "count %u\n",
+                             GetIsaName(Isa), Offset, Count);
+            return false;
+          }
+
+          Expected = Start;
+          SetSpanIsa(ISA_SCALAR);
+          FillMasked(&Expected[Offset], &Dots[Offset], Value, Count);
+          Actual = Start;
+          SetSpanIsa(Isa);
+          FillMasked(&Actual[Offset], &Dots[Offset], Value, Count);
+          if (Actual != Expected) {
+            errs() << format("error: %s FillMasked differs at offset %u, "
+                             "count %u\n",
+                             GetIsaName(Isa), Offset, Count);
+            return false;
+          }
+        }
+  }
+  return true;
+}
+
+static bool BenchSpans() {
+  std::vector<uint8_t> Map(MAXWIDTH * MAXHEIGHT);
+
+  uint OldIsa = GetSpanIsa();
+  bool Ok = CheckSpans();
+  for (uint Isa = ISA_SCALAR; Ok && Isa <= GetBestIsa(); ++Isa) {
+    if (!SetSpanIsa(Isa))
+      continue;
+    Measure("spans", GetIsaName(Isa), Map.size(), [&] {
+      for (unsigned Y = 0; Y < MAXHEIGHT; ++Y)
+        FillBits(&Map[Y * MAXWIDTH], 0xf0, 0x70, MAXWIDTH);
+    });
+  }
+  SetSpanIsa(OldIsa);
+  return Ok;
+}
+
+// Check the cel span draws of every level against the scalar ones, over all
+// alignments, the lengths of a line and the kinds of priority.
+static bool CheckCelSpans() {
+  // Compare, mask and store values as drawing a cel computes them.
+  static const uint8_t Pris[][3] = {
+      {0x7f, 0x0f, 0x70}, {0xff, 0x0f, 0xff}, {0xff, 0xff, 0x00},
+      {0x3f, 0xff, 0x00}};
+  std::vector<uint8_t> Vis(MAXWIDTH + 16), Pc(MAXWIDTH + 16),
+      Pixels(MAXWIDTH + 16), ExpectedVis, ExpectedPc, ActualVis, ActualPc;
+
+  uint32_t Seed = 8765;
+  for (size_t I = 0; I < Vis.size(); ++I) {
+    Seed = Seed * 1103515245 + 12345;
+    Vis[I] = uint8_t(Seed >> 24);
+    Pc[I] = uint8_t(Seed >> 16);
+    Pixels[I] = uint8_t(Seed >> 8);
+  }
+
+  for (uint Isa = ISA_SSE2; Isa <= GetBestIsa(); ++Isa) {
+    if (!SetSpanIsa(Isa))
+      continue;
+    for (unsigned Offset = 0; Offset < 16; ++Offset)
+      for (unsigned Count = 0; Count <= MAXWIDTH; ++Count)
+        for (const auto &Pri : Pris) {
+          ExpectedVis = Vis;
+          ExpectedPc = Pc;
+          SetSpanIsa(ISA_SCALAR);
+          BlitCelSpan(&ExpectedVis[Offset], &ExpectedPc[Offset],
+                      &Pixels[Offset], Count, Pri[0], Pri[1], Pri[2]);
+          ActualVis = Vis;
+          ActualPc = Pc;
+          SetSpanIsa(Isa);
+          BlitCelSpan(&ActualVis[Offset], &ActualPc[Offset], &Pixels[Offset],
+                      Count, Pri[0], Pri[1], Pri[2]);
+          if (ActualVis != ExpectedVis || ActualPc != ExpectedPc) {
+            errs() << format("error: %s BlitCelSpan differs at offset %u, "
+                             "count %u, priority %02x\n",
+                             GetIsaName(Isa), Offset, Count, Pri[0]);
+            return false;
+          }
+        }
+  }
+  return true;
+}
+
+namespace {
+
+// A span of a cel drawn at a place of the maps.
+struct CelRun {
+  unsigned Offset;
+  unsigned Count;
+};
+
+} // end anonymous namespace
+
+// Draw a full screen cel, then many small sprites: 200 of 24x32 pixels, each
+// row being opaque but for a few pixels at its ends.
+static bool BenchCels() {
+  std::vector<uint8_t> Vis(MAXWIDTH * MAXHEIGHT), Pc(MAXWIDTH * MAXHEIGHT),
+      Pixels(MAXWIDTH * MAXHEIGHT);
+  std::vector<CelRun> Sprites;
+
+  FillFrame(Pixels);
+  uint32_t Seed = 2468;
+  for (unsigned S = 0; S < 200; ++S) {
+    Seed = Seed * 1103515245 + 12345;
+    unsigned X = (Seed >> 8) % (MAXWIDTH - 24);
+    unsigned Y = (Seed >> 20) % (MAXHEIGHT - 32);
+    for (unsigned Row = 0; Row < 32; ++Row) {
+      Seed = Seed * 1103515245 + 12345;
+      unsigned Left = (Seed >> 16) % 6, Right = (Seed >> 24) % 6;
+      Sprites.push_back({(Y + Row) * MAXWIDTH + X + Left, 24 - Left - Right});
+    }
+  }
+  uint64_t SpriteBytes = 0;
+  for (const CelRun &Run : Sprites)
+    SpriteBytes += Run.Count;
+
+  uint OldIsa = GetSpanIsa();
+  bool Ok = CheckCelSpans();
+  for (uint Isa = ISA_SCALAR; Ok && Isa <= GetBestIsa(); ++Isa) {
+    if (!SetSpanIsa(Isa))
+      continue;
+
+    // Half of the screen behind the cel, in alternate bands.
+    for (size_t I = 0; I < Pc.size(); ++I)
+      Pc[I] = (I / (MAXWIDTH * 8)) % 2 ? 0xf0 : 0x30;
+
+    Measure("cels", (std::string("screen-") + GetIsaName(Isa)).c_str(),
+            Vis.size(), [&] {
+              for (unsigned Y = 0; Y < MAXHEIGHT; ++Y)
+                BlitCelSpan(&Vis[Y * MAXWIDTH], &Pc[Y * MAXWIDTH],
+                            &Pixels[Y * MAXWIDTH], MAXWIDTH, 0x7f, 0x0f,
+                            0x70);
+            });
+    Measure("cels", (std::string("sprites-") + GetIsaName(Isa)).c_str(),
+            SpriteBytes, [&] {
+              for (const CelRun &Run : Sprites)
+                BlitCelSpan(&Vis[Run.Offset], &Pc[Run.Offset],
+                            &Pixels[Run.Offset], Run.Count, 0x7f, 0x0f, 0x70);
+            });
+  }
+  SetSpanIsa(OldIsa);
+  return Ok;
+}
+
+// Draw a screen of text: 20 lines of 40 glyphs, each 7 dots wide and 9 high.
+static bool BenchGlyphs() {
+  std::vector<uint8_t> Vis(MAXWIDTH * MAXHEIGHT), Masks(7 * 9 * 64);
+
+  uint32_t Seed = 1357;
+  for (uint8_t &M : Masks) {
+    Seed = Seed * 1103515245 + 12345;
+    M = (Seed >> 16) % 3 == 0 ? 0xff : 0x00;
+  }
+
+  uint OldIsa = GetSpanIsa();
+  bool Ok = CheckSpans();
+  for (uint Isa = ISA_SCALAR; Ok && Isa <= GetBestIsa(); ++Isa) {
+    if (!SetSpanIsa(Isa))
+      continue;
+    Measure("glyphs", GetIsaName(Isa), 20 * 40 * 7 * 9, [&] {
+      for (unsigned Line = 0; Line < 20; ++Line)
+        for (unsigned Char = 0; Char < 40; ++Char) {
+          const uint8_t *Glyph = &Masks[(Line * 40 + Char) % 64 * 7 * 9];
+          for (unsigned Row = 0; Row < 9; ++Row)
+            FillMasked(&Vis[(Line * 10 + Row) * MAXWIDTH + Char * 8],
+                       &Glyph[Row * 7], 0x0f, 7);
+        }
+    });
+  }
+  SetSpanIsa(OldIsa);
+  return Ok;
+}
+
+namespace {
+
+// An actor of a cast, as the cast is sorted for drawing.
+struct CastActor {
+  unsigned Id;
+  int Y;
+  int Z;
+};
+
+} // end anonymous namespace
+
+static int CompareActors(const void *A, const void *B) {
+  const CastActor &ActorA = *static_cast<const CastActor *>(A);
+  const CastActor &ActorB = *static_cast<const CastActor *>(B);
+  if (ActorA.Y != ActorB.Y)
+    return ActorA.Y < ActorB.Y ? -1 : 1;
+  if (ActorA.Z != ActorB.Z)
+    return ActorA.Z < ActorB.Z ? -1 : 1;
+  return 0;
+}
+
+// Check the sort against a stable one, then sort a cast of 500 actors in list
+// order, and the same cast as it is from the previous frame: mostly sorted.
+static bool BenchSort() {
+  std::vector<CastActor> Cast(500), Sorted, Expected, Scratch(Cast.size() / 2);
+
+  uint32_t Seed = 9753;
+  for (unsigned I = 0; I < Cast.size(); ++I) {
+    Seed = Seed * 1103515245 + 12345;
+    Cast[I] = {I, int((Seed >> 16) % MAXHEIGHT), int((Seed >> 8) % 4)};
+  }
+
+  Expected = Cast;
+  std::stable_sort(Expected.begin(), Expected.end(),
+                   [](const CastActor &A, const CastActor &B) {
+                     return CompareActors(&A, &B) < 0;
+                   });
+  Sorted = Cast;
+  StableSort(Sorted.data(), Sorted.size(), sizeof(CastActor), CompareActors,
+             Scratch.data());
+  for (unsigned I = 0; I < Cast.size(); ++I)
+    if (Sorted[I].Id != Expected[I].Id) {
+      errs() << format("error: StableSort differs at %u\n", I);
+      return false;
+    }
+
+  // Some actors moved a line since the cast was sorted.
+  std::vector<CastActor> Moved = Expected;
+  for (unsigned I = 0; I < Moved.size(); I += 7)
+    Moved[I].Y += I % 2 ? 1 : -1;
+
+  Measure("sort", "list-order", 0, [&] {
+    Sorted = Cast;
+    StableSort(Sorted.data(), Sorted.size(), sizeof(CastActor), CompareActors,
+               Scratch.data());
+  });
+  Measure("sort", "prev-frame", 0, [&] {
+    Sorted = Moved;
+    StableSort(Sorted.data(), Sorted.size(), sizeof(CastActor), CompareActors,
+               Scratch.data());
+  });
+  return true;
+}
+
+// Fill entries 1 to Count of a palette with colors in use, in ramps of eight
+// shades as in the palettes of the games, and clear the others.
+static void BuildPalette(RPalette &Pal, unsigned Count, uint32_t Seed) {
+  Pal = RPalette();
+  unsigned R = 0, G = 0, B = 0;
+  for (unsigned I = 1; I <= Count && I < PAL_CLUT_SIZE - 1; ++I) {
+    if ((I - 1) % 8 == 0) {
+      Seed = Seed * 1103515245 + 12345;
+      R = (Seed >> 24) & 0xff;
+      G = (Seed >> 16) & 0xff;
+      B = (Seed >> 8) & 0xff;
+    }
+    unsigned Shade = 16 - (I - 1) % 8;
+    Pal.gun[I] = {PAL_IN_USE, uint8_t(R * Shade / 16), uint8_t(G * Shade / 16),
+                  uint8_t(B * Shade / 16)};
+  }
+}
+
+// Set the system palette to Pal, plus black and white.
+static void SetSysPalette(const RPalette &Pal) {
+  for (unsigned I = 0; I < PAL_CLUT_SIZE; ++I)
+    g_sysPalette.gun[I] = Pal.gun[I];
+  g_sysPalette.gun[0] = {PAL_IN_USE, 0, 0, 0};
+  g_sysPalette.gun[PAL_CLUT_SIZE - 1] = {PAL_IN_USE, 255, 255, 255};
+  SysColorsChanged(0, PAL_CLUT_SIZE);
+}
+
+// Check the matches of the index against a scan of the system palette, for
+// random colors and the colors of the palette themselves.
+static bool CheckSysColors(const char *State) {
+  static const uint Leasts[] = {0, 8, 40, uint(-1)};
+
+  uint32_t Seed = 8642;
+  for (unsigned I = 0; I < 4096 + PAL_CLUT_SIZE; ++I) {
+    Seed = Seed * 1103515245 + 12345;
+    uint8_t R = uint8_t(Seed >> 24), G = uint8_t(Seed >> 16),
+            B = uint8_t(Seed >> 8);
+    if (I >= 4096) {
+      const Guns &Gun = g_sysPalette.gun[I - 4096];
+      R = Gun.r;
+      G = Gun.g;
+      B = Gun.b;
+    }
+    for (uint Least : Leasts) {
+      uint Expected = FastMatch(&g_sysPalette, R, G, B, PAL_CLUT_SIZE, Least);
+      uint Index = MatchSysColor(R, G, B, Least);
+      if (Index != Expected) {
+        errs() << format("error: %s: MatchSysColor(%u, %u, %u, %d) is %u, "
+                         "not %u\n",
+                         State, R, G, B, int(Least), Index, Expected);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Check the index with palettes of a few to all colors, as they are set and
+// as palettes are merged into them, then time the matching of colors and the
+// merging of a palette of 254 colors, half of them new, into a full system
+// palette, against matching by scans of the palette.
+static bool BenchPalette() {
+  RPalette Saved = g_sysPalette, Pal, Src;
+  uint OldPicNotValid = g_picNotValid;
+  bool Ok = true;
+
+  // Merge without setting the display's palette.
+  g_picNotValid = 1;
+
+  for (unsigned Count : {4, 20, 40, 128, 254}) {
+    BuildPalette(Pal, Count, 1000 + Count);
+    SetSysPalette(Pal);
+    std::string State = "palette of " + std::to_string(Count);
+    if (!(Ok = CheckSysColors(State.c_str())))
+      break;
+
+    BuildPalette(Src, 254, 2000 + Count);
+    RSetPalette(&Src, PAL_MATCH);
+    State += " merged";
+    if (!(Ok = CheckSysColors(State.c_str())))
+      break;
+  }
+
+  if (Ok) {
+    BuildPalette(Pal, 254, 3000);
+    SetSysPalette(Pal);
+    BuildPalette(Src, 254, 4000);
+    for (unsigned I = 1; I < PAL_CLUT_SIZE - 1; I += 2)
+      Src.gun[I] = Pal.gun[I];
+
+    std::vector<Guns> Colors(256);
+    uint32_t Seed = 7531;
+    for (Guns &Color : Colors) {
+      Seed = Seed * 1103515245 + 12345;
+      Color = {0, uint8_t(Seed >> 24), uint8_t(Seed >> 16), uint8_t(Seed >> 8)};
+    }
+
+    std::vector<uint> Matches(Colors.size());
+    Measure("palette", "match-scan", 0, [&] {
+      for (unsigned I = 0; I < Colors.size(); ++I)
+        Matches[I] = FastMatch(&g_sysPalette, Colors[I].r, Colors[I].g,
+                               Colors[I].b, PAL_CLUT_SIZE, uint(-1));
+    });
+    Measure("palette", "match-index", 0, [&] {
+      for (unsigned I = 0; I < Colors.size(); ++I)
+        Matches[I] =
+            MatchSysColor(Colors[I].r, Colors[I].g, Colors[I].b, uint(-1));
+    });
+
+    // What a merge into a full palette did before the index.
+    Measure("palette", "merge-scan", 0, [&] {
+      for (unsigned I = 1; I < PAL_CLUT_SIZE - 1; ++I) {
+        const Guns &Gun = Src.gun[I];
+        uint Index =
+            FastMatch(&g_sysPalette, Gun.r, Gun.g, Gun.b, PAL_CLUT_SIZE, 0);
+        if (Index == PAL_CLUT_SIZE)
+          Index = FastMatch(&g_sysPalette, Gun.r, Gun.g, Gun.b, PAL_CLUT_SIZE,
+                            uint(-1));
+        Src.mapTo[I] = uint8_t(Index);
+      }
+    });
+    double Merge = Measure("palette", "merge", 0,
+                           [&] { RSetPalette(&Src, PAL_MATCH); });
+    Row("palette", "merge") << format("%12.0f merges/s\n", 1e9 / Merge);
+  }
+
+  g_sysPalette = Saved;
+  SysColorsChanged(0, PAL_CLUT_SIZE);
+  g_picNotValid = OldPicNotValid;
+  return Ok;
+}
+
+// Append a point to a picture, in the absolute coordinate encoding.
+static void AddPoint(std::vector<uint8_t> &Pic, int X, int Y) {
+  Pic.push_back(uint8_t(((X >> 8) << 4) | (Y >> 8)));
+  Pic.push_back(uint8_t(X));
+  Pic.push_back(uint8_t(Y));
+}
+
+// Build a picture like those of the games: outlined areas of a color,
+// priority and control, filled, with some lines and brushes on top.
+static std::vector<uint8_t> BuildPicture() {
+  const int CellWidth = MAXWIDTH / 8, CellHeight = (MAXHEIGHT - 10) / 6;
+  std::vector<uint8_t> Pic;
+
+  for (int Row = 0; Row < 6; ++Row)
+    for (int Col = 0; Col < 8; ++Col) {
+      int Left = Col * CellWidth + 2, Top = Row * CellHeight + 2;
+      int Right = Left + CellWidth - 5, Bottom = Top + CellHeight - 5;
+
+      Pic.insert(Pic.end(), {0xf0, uint8_t((Row * 8 + Col) * 4 + 1), 0xf2,
+                             uint8_t(Row + 1), 0xfb, uint8_t(Col + 1)});
+      Pic.push_back(0xf6);
+      AddPoint(Pic, Left, Top);
+      AddPoint(Pic, Right, Top);
+      AddPoint(Pic, Right, Bottom);
+      AddPoint(Pic, Left, Bottom);
+      AddPoint(Pic, Left, Top);
+      Pic.push_back(0xf8);
+      AddPoint(Pic, (Left + Right) / 2, (Top + Bottom) / 2);
+    }
+
+  // The background, around all the areas.
+  Pic.insert(Pic.end(), {0xf0, 0x02, 0xf2, 0x0f, 0xfc, 0xf8});
+  AddPoint(Pic, 0, 0);
+
+  // Diagonals and a trail of brushes.
+  Pic.insert(Pic.end(), {0xf0, 0x07, 0xf6});
+  AddPoint(Pic, 0, 0);
+  AddPoint(Pic, MAXWIDTH - 1, MAXHEIGHT - 11);
+  AddPoint(Pic, 0, MAXHEIGHT - 11);
+  AddPoint(Pic, MAXWIDTH - 1, 0);
+  Pic.insert(Pic.end(), {0xf9, 0x06, 0xfa});
+  for (int X = 10; X < MAXWIDTH - 10; X += 6)
+    AddPoint(Pic, X, 100 + (X % 40));
+
+  Pic.push_back(0xff);
+  return Pic;
+}
+
+#if defined(SCI_HEADLESS_DISPLAY)
+static bool BenchPicture() {
+  std::vector<uint8_t> Pic = BuildPicture();
+
+  // The graphics open a port with font 0. There being no game, give them an
+  // empty one.
+  static const uint16_t EmptyFont[4] = {0, 0, 8, 0};
+  SetResOverride(RES_FONT, 0, EmptyFont, sizeof(EmptyFont));
+
+  if (!CInitGraph()) {
+    errs() << "error: Can't initialize the graphics\n";
+    return false;
+  }
+
+  uint OldIsa = GetSpanIsa();
+  for (uint Isa = ISA_SCALAR; Isa <= GetBestIsa(); ++Isa) {
+    if (!SetSpanIsa(Isa))
+      continue;
+    Measure("pic", GetIsaName(Isa), 0, [&] {
+      FlushPicCache();
+      DrawPic(Pic.data(), 0, true, 0);
+    });
+  }
+  SetSpanIsa(OldIsa);
+
+  Measure("pic", "cached", 0, [&] { DrawPic(Pic.data(), 0, true, 0); });
+
+  CEndGraph();
+  return true;
+}
+#endif
+
+#if defined(SCI_HEADLESS_DISPLAY)
+// Build a view of one 24x32 cel, each row opaque but for a pixel at each end.
+static std::vector<uint8_t> BuildView() {
+  const unsigned Width = 24, Height = 32;
+  std::vector<uint8_t> Data(sizeof(View) + sizeof(Loop) + sizeof(Cel));
+
+  View *V = reinterpret_cast<View *>(Data.data());
+  V->numLoops = 1;
+  V->vFlags = COLOR256;
+  V->loopOff[0] = sizeof(View);
+  Loop *L = reinterpret_cast<Loop *>(&Data[sizeof(View)]);
+  L->numCels = 1;
+  L->celOff[0] = sizeof(View) + sizeof(Loop);
+  Cel *C = reinterpret_cast<Cel *>(&Data[sizeof(View) + sizeof(Loop)]);
+  C->xDim = Width;
+  C->yDim = Height;
+  C->skipColor = 0xff;
+
+  // Skip a pixel, copy the opaque ones, skip the last.
+  for (unsigned Y = 0; Y < Height; ++Y) {
+    Data.push_back(0xc1);
+    Data.push_back(Width - 2);
+    for (unsigned X = 1; X < Width - 1; ++X)
+      Data.push_back(uint8_t(Y * 8 + X));
+    Data.push_back(0xc1);
+  }
+  return Data;
+}
+
+namespace {
+
+// Actors made up for a room: each an object with the indexed properties of
+// an actor, and a palette property found by selector. They stand in rows
+// close enough for the actors of a row to be drawn over those behind.
+class Room {
+public:
+  Room(unsigned Columns, unsigned Rows);
+
+  List *cast() { return &Cast; }
+
+  // Move the actors along their rows as a walk cycle does.
+  void step();
+
+private:
+  static const unsigned PaletteVar = 3 + 4 * OBJOFSSIZE;
+  static const unsigned NumVars = PaletteVar + 1;
+
+  std::vector<std::vector<uint8_t>> Objects;
+  std::vector<ObjID> Selectors;
+  std::vector<KeyedNode> Nodes;
+  List Cast = LIST_INITIALIZER;
+  unsigned Frame = 0;
+};
+
+} // end anonymous namespace
+
+Room::Room(unsigned Columns, unsigned Rows)
+    : Selectors(NumVars, ObjID(-1)) {
+  // Leave room for a rectangle after every property, and for the header
+  // properties of an object before them.
+  for (unsigned I = 0; I < OBJOFSSIZE; ++I)
+    g_objOfs[I] = 3 + 4 * I;
+  Selectors[PaletteVar] = s_palette;
+  // The base rectangle, for the scripts that set it by selector.
+  for (unsigned I = 0; I < 4; ++I)
+    Selectors[g_objOfs[actBR] + I] = ObjID(s_baseRect + I);
+
+  unsigned NumActors = Columns * Rows;
+  Objects.resize(NumActors);
+  Nodes.resize(NumActors);
+  for (unsigned I = 0; I < NumActors; ++I) {
+    Objects[I].assign(OBJSIZE(NumVars), 0);
+    ObjHeader *Header = reinterpret_cast<ObjHeader *>(Objects[I].data());
+    Header->varSelNum = NumVars;
+    Obj *Actor = reinterpret_cast<Obj *>(Header + 1);
+    Actor->props = Selectors.data();
+    IndexedProp(Actor, actX) = 16 + (I % Columns) * (288 / Columns);
+    IndexedProp(Actor, actY) = 48 + (I / Columns) * (144 / Rows);
+    Node *N = reinterpret_cast<Node *>(&Nodes[I]);
+    AddToEnd(&Cast, N);
+    SetKey(N, Actor);
+  }
+}
+
+void Room::step() {
+  int Dir = (Frame++ / 8) % 2 ? -1 : 1;
+  for (Node *N = FirstNode(&Cast); N != NULL; N = NextNode(N))
+    IndexedProp(reinterpret_cast<Obj *>(GetKey(N)), actX) += Dir;
+}
+
+// Return a hash of the frames presented while animating a room with the
+// cast drawn by 'Threads' threads.
+static uint32_t HashRoomFrames(unsigned Columns, unsigned Rows,
+                               unsigned Threads) {
+  Room TheRoom(Columns, Rows);
+  uint32_t Hash = 2166136261u;
+
+  SetComposeThreads(Threads);
+  ShowBits(GetBounds(), VMAP);
+  for (unsigned I = 0; I < 24; ++I) {
+    TheRoom.step();
+    Animate(TheRoom.cast(), false);
+    SyncDisplay();
+    const uint32_t *Pixels = GetDisplayPixels();
+    for (unsigned P = 0; P < MAXWIDTH * MAXHEIGHT; ++P)
+      Hash = (Hash ^ Pixels[P]) * 16777619u;
+  }
+  DisposeLastCast();
+  return Hash;
+}
+
+// Animate a room of 64 walking actors, and check that once the caches are
+// warm a frame allocates no memory and looks up no view. Then animate rooms
+// with the cast drawn by 1 to MAXCOMPOSETHREADS threads, checking that the
+// frames are the same whatever the number of threads.
+static bool BenchAnimate() {
+  std::vector<uint8_t> ViewData = BuildView();
+  static const uint16_t EmptyFont[4] = {0, 0, 8, 0};
+  SetResOverride(RES_FONT, 0, EmptyFont, sizeof(EmptyFont));
+  SetResOverride(RES_VIEW, 0, ViewData.data(), uint(ViewData.size()));
+
+  if (!CInitGraph()) {
+    errs() << "error: Can't initialize the graphics\n";
+    return false;
+  }
+
+  RWindow PicWind = {};
+  ROpenPort(&PicWind.port);
+  g_picWind = &PicWind;
+  g_picNotValid = 0;
+  InitPicture();
+
+  bool Ok = true;
+  uint OldThreads = GetComposeThreads();
+  SetComposeThreads(1);
+  {
+    Room TheRoom(8, 8);
+    for (unsigned I = 0; I < 16; ++I) {
+      TheRoom.step();
+      Animate(TheRoom.cast(), false);
+    }
+
+    AnimateStats Before, After;
+    GetAnimateStats(&Before);
+    Measure("animate", "64-actors", 0, [&] {
+      TheRoom.step();
+      Animate(TheRoom.cast(), false);
+    });
+    GetAnimateStats(&After);
+
+    unsigned Frames = After.frames - Before.frames;
+    Row("animate", "64-actors")
+        << format("%12.2f allocs, %.2f view loads per frame\n",
+                  double(After.allocs - Before.allocs) / Frames,
+                  double(After.viewLoads - Before.viewLoads) / Frames);
+    if (After.allocs != Before.allocs) {
+      errs() << "error: Animate allocated memory in steady state\n";
+      Ok = false;
+    }
+    DisposeLastCast();
+  }
+
+  static const struct {
+    unsigned Columns, Rows;
+  } Rooms[] = {{8, 8}, {16, 10}};
+  for (const auto &R : Rooms) {
+    uint32_t Expected = HashRoomFrames(R.Columns, R.Rows, 1);
+    double Single = 0;
+    for (unsigned Threads = 1; Ok && Threads <= MAXCOMPOSETHREADS;
+         ++Threads) {
+      if (HashRoomFrames(R.Columns, R.Rows, Threads) != Expected) {
+        errs() << format("error: The cast drawn by %u threads differs\n",
+                         Threads);
+        Ok = false;
+        break;
+      }
+
+      Room TheRoom(R.Columns, R.Rows);
+      std::string Variant =
+          std::to_string(R.Columns * R.Rows) + "/" + std::to_string(Threads);
+      double Nanoseconds = Measure("animate-bands", Variant, 0, [&] {
+        TheRoom.step();
+        Animate(TheRoom.cast(), false);
+      });
+      if (Threads == 1)
+        Single = Nanoseconds;
+      Row("animate-bands", Variant)
+          << format("%12.2fx\n", Single / Nanoseconds);
+      DisposeLastCast();
+    }
+  }
+  SetComposeThreads(OldThreads);
+
+  g_picWind = NULL;
+  ResUnLoad(RES_VIEW, 0);
+  ClearResOverride(RES_VIEW, 0);
+  CEndGraph();
+  return Ok;
+}
+// Return the set of values of the priority map (if MapSet has PMAP) or of
+// the control map in a rectangle of the screen, reading every pixel as
+// OnControl() did before the summaries.
+static uint ScanMap(uint MapSet, const RRect &R) {
+  uint Mask = 0;
+  for (int Y = R.top; Y < R.bottom; ++Y)
+    for (int X = R.left; X < R.right; ++X) {
+      uint8_t Pixel = g_pcHndl[g_baseTable[Y] + X];
+      Mask |= 1U << ((MapSet & PMAP) != 0 ? Pixel >> 4 : Pixel & 0x0f);
+    }
+  return Mask;
+}
+
+// Check OnControl() against scans of the maps for random rectangles, from
+// the size of the base of an actor to the whole screen.
+static bool CheckOnControl(const char *State) {
+  uint32_t Seed = 9753;
+  for (unsigned I = 0; I < 2048; ++I) {
+    RRect R;
+    int MaxWidth = I % 4 != 0 ? 32 : MAXWIDTH;
+    int MaxHeight = I % 4 != 0 ? 8 : MAXHEIGHT;
+    Seed = Seed * 1103515245 + 12345;
+    R.left = int16_t((Seed >> 8) % MAXWIDTH);
+    R.top = int16_t((Seed >> 20) % MAXHEIGHT);
+    Seed = Seed * 1103515245 + 12345;
+    R.right = int16_t(std::min<int>(R.left + 1 + (Seed >> 8) % MaxWidth,
+                                    MAXWIDTH));
+    R.bottom = int16_t(std::min<int>(R.top + 1 + (Seed >> 20) % MaxHeight,
+                                     MAXHEIGHT));
+
+    for (uint MapSet : {uint(PMAP), uint(CMAP)}) {
+      uint Expected = ScanMap(MapSet, R);
+      uint Mask = OnControl(MapSet, &R);
+      if (Mask != Expected) {
+        const char *Map = MapSet == PMAP ? "PMAP" : "CMAP";
+        errs() << format("error: %s: OnControl(%s, %d, %d, %d, %d) is %04x, "
+                         "not %04x\n",
+                         State, Map, R.left, R.top, R.right, R.bottom, Mask,
+                         Expected);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Check OnControl() on a picture as the writers of the maps change it: the
+// picture, a room of actors, filled rectangles and restored bits. Then time,
+// against scans of the map, what a frame of a collision-heavy room asks: the
+// controls under the base of each actor, as CantBeHere does, and the
+// priorities and controls of large areas, as the scripts of hotspots do.
+static bool BenchOnControl() {
+  std::vector<uint8_t> Pic = BuildPicture();
+  std::vector<uint8_t> ViewData = BuildView();
+  static const uint16_t EmptyFont[4] = {0, 0, 8, 0};
+  SetResOverride(RES_FONT, 0, EmptyFont, sizeof(EmptyFont));
+  SetResOverride(RES_VIEW, 0, ViewData.data(), uint(ViewData.size()));
+
+  if (!CInitGraph()) {
+    errs() << "error: Can't initialize the graphics\n";
+    return false;
+  }
+
+  RWindow PicWind = {};
+  ROpenPort(&PicWind.port);
+  RSetPort(&PicWind.port);
+  g_picWind = &PicWind;
+  g_picNotValid = 0;
+  InitPicture();
+
+  bool Ok = CheckOnControl("cleared maps");
+  DrawPic(Pic.data(), 0, true, 0);
+  Ok = Ok && CheckOnControl("picture");
+  // There are no windows to show the picture through: leave it undrawn.
+  g_picNotValid = 0;
+
+  // Give the actors priorities above those of the areas of the picture and
+  // below that of its background, for them to draw into the priority map.
+  Room TheRoom(16, 10);
+  unsigned Priority = 0;
+  for (Node *N = FirstNode(TheRoom.cast()); N != NULL; N = NextNode(N)) {
+    Obj *Actor = reinterpret_cast<Obj *>(GetKey(N));
+    IndexedProp(Actor, actSignal) |= FIXPRI;
+    IndexedProp(Actor, actPri) = 8 + Priority++ % 7;
+  }
+  for (unsigned I = 0; Ok && I < 12; ++I) {
+    TheRoom.step();
+    Animate(TheRoom.cast(), false);
+    Ok = CheckOnControl("room");
+  }
+
+  if (Ok) {
+    RRect Area = {40, 30, 200, 180};
+    Handle Bits = SaveBits(&Area, PMAP | CMAP);
+    RFillRect(&Area, CMAP, 0, 0, 5);
+    Ok = CheckOnControl("filled control");
+    RFillRect(&Area, PMAP | CMAP, 0, 9, 3);
+    Ok = Ok && CheckOnControl("filled priority and control");
+    RestoreBits(Bits);
+    Ok = Ok && CheckOnControl("restored bits");
+  }
+
+  if (Ok) {
+    // A stopped actor, left drawn in the maps with its control box.
+    RRect Seen = {100, 150, 132, 174}, Box = {124, 150, 132, 174};
+    Handle Bits = SaveBits(&Seen, VMAP | PMAP | CMAP);
+    DrawCel(reinterpret_cast<View *>(ResLoad(RES_VIEW, 0)), 0, 0, &Seen, 12,
+            NULL);
+    Ok = CheckOnControl("stopped actor");
+    RFillRect(&Box, CMAP, 0, 0, 15);
+    Ok = Ok && CheckOnControl("control box");
+    RestoreBits(Bits);
+    Ok = Ok && CheckOnControl("restored actor");
+  }
+
+  if (Ok) {
+    std::vector<RRect> Bases;
+    for (Node *N = FirstNode(TheRoom.cast()); N != NULL; N = NextNode(N)) {
+      Obj *Actor = reinterpret_cast<Obj *>(GetKey(N));
+      int X = IndexedProp(Actor, actX), Y = IndexedProp(Actor, actY);
+      Bases.push_back({int16_t(Y - 2), int16_t(X - 12), int16_t(Y + 1),
+                       int16_t(X + 12)});
+    }
+    const RRect Hotspots[] = {{0, 0, MAXHEIGHT, MAXWIDTH / 2},
+                              {40, 60, 160, 260},
+                              {100, 0, 190, MAXWIDTH}};
+
+    // The masks found, one for each base and two for each hotspot.
+    std::vector<uint> Masks(Bases.size() + 2 * std::size(Hotspots));
+    auto FindBases = [&](uint (*Find)(uint, const RRect &)) {
+      for (unsigned I = 0; I < Bases.size(); ++I)
+        Masks[I] = Find(CMAP, Bases[I]);
+    };
+    auto FindHotspots = [&](uint (*Find)(uint, const RRect &)) {
+      unsigned I = Bases.size();
+      for (const RRect &R : Hotspots) {
+        Masks[I++] = Find(PMAP, R);
+        Masks[I++] = Find(CMAP, R);
+      }
+    };
+    auto Summarize = [](uint MapSet, const RRect &R) {
+      return OnControl(MapSet, &R);
+    };
+
+    MapSummaryStats Before, After;
+    GetMapSummaryStats(&Before);
+    double Summaries = Measure("oncontrol", "frame", 0, [&] {
+      TheRoom.step();
+      Animate(TheRoom.cast(), false);
+      FindBases(Summarize);
+      FindHotspots(Summarize);
+    });
+    GetMapSummaryStats(&After);
+    double Scans = Measure("oncontrol", "frame-scan", 0, [&] {
+      TheRoom.step();
+      Animate(TheRoom.cast(), false);
+      FindBases(ScanMap);
+      FindHotspots(ScanMap);
+    });
+
+    unsigned Frames = Iterations + 1;
+    Row("oncontrol", "frame")
+        << format("%12.2fx, %.1f rows summarized per frame\n",
+                  Scans / Summaries, double(After.rows - Before.rows) / Frames);
+    Ok = CheckOnControl("timed room");
+
+    Measure("oncontrol", "bases", 0, [&] { FindBases(Summarize); });
+    Measure("oncontrol", "bases-scan", 0, [&] { FindBases(ScanMap); });
+    Measure("oncontrol", "hotspots", 0, [&] { FindHotspots(Summarize); });
+    Measure("oncontrol", "hotspots-scan", 0, [&] { FindHotspots(ScanMap); });
+  }
+  DisposeLastCast();
+
+  g_picWind = NULL;
+  ResUnLoad(RES_VIEW, 0);
+  ClearResOverride(RES_VIEW, 0);
+  CEndGraph();
+  return Ok;
+}
+// Return what CantBeHere() did before the grid: the illegal controls under
+// the base rectangle of Him, or unless Him is hidden or ignores actors, the
+// first actor of the cast, in list order, whose base rectangle meets it.
+static uintptr_t ScanCantBeHere(List *Cast, Obj *Him) {
+  RRect R, Other;
+  RectFromNative(IndexedPropAddr(Him, actBR), &R);
+  if (uintptr_t Controls =
+          OnControl(CMAP, &R) & IndexedProp(Him, actIllegalBits))
+    return Controls;
+  if ((IndexedProp(Him, actSignal) & (ignrAct | HIDDEN)) != 0)
+    return 0;
+
+  for (Node *N = FirstNode(Cast); N != NULL; N = NextNode(N)) {
+    Obj *Me = reinterpret_cast<Obj *>(reinterpret_cast<KNode *>(N)->nVal);
+    if (Me == Him ||
+        (IndexedProp(Me, actSignal) & (NOUPDATE | ignrAct | HIDDEN)) != 0)
+      continue;
+    RectFromNative(IndexedPropAddr(Me, actBR), &Other);
+    if (R.left < Other.right && R.right > Other.left && R.top < Other.bottom &&
+        R.bottom > Other.top)
+      return uintptr_t(Me);
+  }
+  return 0;
+}
+
+// Walk the actors of a room a step each, as their movers do: set the base
+// rectangle, and step back if CantBeHere() says so. Check that it answers as
+// ScanCantBeHere() when Check is set, and ask ScanCantBeHere() instead when
+// UseScan is set.
+static bool WalkRoom(Room &TheRoom, uint32_t &Seed, bool Check,
+                     bool UseScan) {
+  uintptr_t Args[3], Acc;
+
+  ForgetCastGrid();
+  for (Node *N = FirstNode(TheRoom.cast()); N != NULL; N = NextNode(N)) {
+    Obj *Actor = reinterpret_cast<Obj *>(GetKey(N));
+    Seed = Seed * 1103515245 + 12345;
+    int DX = int((Seed >> 16) % 3) - 1, DY = int((Seed >> 24) % 3) - 1;
+    bool Jump = (Seed >> 8) % 32 == 0;
+    IndexedProp(Actor, actX) += Jump ? DX * 40 : DX;
+    IndexedProp(Actor, actY) += Jump ? DY * 20 : DY;
+
+    Args[0] = 1;
+    Args[1] = uintptr_t(Actor);
+    KBaseSetter(Args, &Acc);
+
+    // Put somewhere else, as by posn:, without asking.
+    if (Jump)
+      continue;
+
+    if (UseScan) {
+      Acc = ScanCantBeHere(TheRoom.cast(), Actor);
+    } else {
+      Args[0] = 2;
+      Args[2] = uintptr_t(TheRoom.cast());
+      KCantBeHere(Args, &Acc);
+      if (Check && Acc != ScanCantBeHere(TheRoom.cast(), Actor)) {
+        errs() << "error: CantBeHere() found another actor than a scan\n";
+        return false;
+      }
+    }
+
+    if (Acc != 0) {
+      IndexedProp(Actor, actX) -= DX;
+      IndexedProp(Actor, actY) -= DY;
+      Args[0] = 1;
+      KBaseSetter(Args, &Acc);
+    }
+  }
+  return true;
+}
+
+// Put actors onto others by setting their base rectangles by selector, as a
+// script does, and check that CantBeHere() for the others answers as
+// ScanCantBeHere(). The actors put are sorted in far cells of the grid.
+static bool PutOnto(Room &TheRoom, uint32_t &Seed) {
+  std::vector<Obj *> Actors;
+  for (Node *N = FirstNode(TheRoom.cast()); N != NULL; N = NextNode(N))
+    Actors.push_back(reinterpret_cast<Obj *>(GetKey(N)));
+
+  uintptr_t Args[3], Acc;
+  for (unsigned I = 0; I < 4; ++I) {
+    Seed = Seed * 1103515245 + 12345;
+    unsigned A = (Seed >> 16) % Actors.size(), B = (Seed >> 8) % Actors.size();
+    if (A == B)
+      continue;
+    if (A > B)
+      std::swap(A, B);
+
+    // The actor put comes first in the list, for it to be the one found.
+    Obj *Put = Actors[A], *Him = Actors[B];
+    for (unsigned K = 0; K < 4; ++K)
+      SetProperty(Put, s_baseRect + K, IndexedPropAddr(Him, actBR)[K]);
+
+    Args[0] = 2;
+    Args[1] = uintptr_t(Him);
+    Args[2] = uintptr_t(TheRoom.cast());
+    KCantBeHere(Args, &Acc);
+    if (Acc != ScanCantBeHere(TheRoom.cast(), Him)) {
+      errs() << "error: CantBeHere() missed an actor put by selector\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+// Check CantBeHere() against scans of the cast as the actors of rooms walk
+// about, stop, hide and ignore each other, are put onto each other by
+// scripts, and as the cast list changes.
+// Then time a cycle of the walks of every actor against scanning the cast.
+static bool BenchCantBeHere() {
+  std::vector<uint8_t> ViewData = BuildView();
+  static const uint16_t EmptyFont[4] = {0, 0, 8, 0};
+  SetResOverride(RES_FONT, 0, EmptyFont, sizeof(EmptyFont));
+  SetResOverride(RES_VIEW, 0, ViewData.data(), uint(ViewData.size()));
+
+  if (!CInitGraph()) {
+    errs() << "error: Can't initialize the graphics\n";
+    return false;
+  }
+
+  RWindow PicWind = {};
+  ROpenPort(&PicWind.port);
+  RSetPort(&PicWind.port);
+  g_picWind = &PicWind;
+  InitPicture();
+
+  bool Ok = true;
+  static const struct {
+    unsigned Columns, Rows;
+  } Rooms[] = {{4, 4}, {8, 4}, {8, 8}, {12, 8}};
+  for (const auto &R : Rooms) {
+    Room TheRoom(R.Columns, R.Rows);
+    uint32_t Seed = 4321;
+    unsigned I = 0;
+    for (Node *N = FirstNode(TheRoom.cast()); N != NULL; N = NextNode(N))
+      IndexedProp(reinterpret_cast<Obj *>(GetKey(N)), actYStep) = 2;
+
+    for (unsigned Cycle = 0; Ok && Cycle < 64; ++Cycle) {
+      // Stop, hide or let ignore others one actor in five at times.
+      for (Node *N = FirstNode(TheRoom.cast()); N != NULL; N = NextNode(N)) {
+        static const uint Signals[] = {NOUPDATE, HIDDEN, ignrAct};
+        uintptr_t &Signal = IndexedProp(reinterpret_cast<Obj *>(GetKey(N)),
+                                        actSignal);
+        Signal = ++I % 5 == Cycle % 5 ? Signals[Cycle % 3] : 0;
+      }
+
+      // Put the first actor at the front of the list again for a while.
+      uintptr_t Args[3], Acc;
+      Obj *First = reinterpret_cast<Obj *>(GetKey(FirstNode(TheRoom.cast())));
+      if (Cycle % 16 == 4) {
+        Args[0] = 1;
+        Args[1] = uintptr_t(First);
+        KNewNode(Args, &Acc);
+        Args[0] = 2;
+        Args[1] = uintptr_t(TheRoom.cast());
+        Args[2] = Acc;
+        KAddToFront(Args, &Acc);
+      } else if (Cycle % 16 == 12) {
+        Args[0] = 2;
+        Args[1] = uintptr_t(TheRoom.cast());
+        Args[2] = uintptr_t(First);
+        KDeleteKey(Args, &Acc);
+      }
+
+      Ok = WalkRoom(TheRoom, Seed, true, false) && PutOnto(TheRoom, Seed);
+    }
+    if (!Ok)
+      break;
+
+    for (Node *N = FirstNode(TheRoom.cast()); N != NULL; N = NextNode(N))
+      IndexedProp(reinterpret_cast<Obj *>(GetKey(N)), actSignal) = 0;
+
+    std::string Variant = std::to_string(R.Columns * R.Rows);
+    CastGridStats Before, After;
+    GetCastGridStats(&Before);
+    double Grid = Measure("cantbehere", Variant, 0,
+                          [&] { WalkRoom(TheRoom, Seed, false, false); });
+    GetCastGridStats(&After);
+    double Scan = Measure("cantbehere", Variant + "-scan", 0,
+                          [&] { WalkRoom(TheRoom, Seed, false, true); });
+    Row("cantbehere", Variant)
+        << format("%12.2fx, %.1f actors looked at, %.2f builds per cycle\n",
+                  Scan / Grid,
+                  double(After.tested - Before.tested) /
+                      (After.queries - Before.queries),
+                  double(After.builds - Before.builds) / (Iterations + 1));
+  }
+
+  g_picWind = NULL;
+  ResUnLoad(RES_VIEW, 0);
+  ClearResOverride(RES_VIEW, 0);
+  CEndGraph();
+  return Ok;
+}
+#endif
+
+namespace {
+
+// Polygons made up for a room: objects with the type, size and points
+// properties of a polygon, found by selector, in a list. A contained access
+// polygon keeps the actors off the edges of the screen, and the others stand
+// in a grid of cells, each about its cell's center, some of them concave and
+// some reaching into the cells next to theirs, with a wall across a few.
+class PolygonRoom {
+public:
+  struct Point {
+    int X, Y;
+  };
+  struct Polygon {
+    unsigned Type;
+    std::vector<Point> Points;
+  };
+
+  PolygonRoom(unsigned Columns, unsigned Rows);
+
+  List *polygons() { return &Polygons; }
+  const std::vector<Polygon> &shapes() const { return Shapes; }
+
+private:
+  static const unsigned NumVars = 6;
+
+  std::vector<Polygon> Shapes;
+  std::vector<std::vector<uintptr_t>> Points;
+  std::vector<std::vector<uint8_t>> Objects;
+  std::vector<ObjID> Selectors;
+  std::vector<KeyedNode> Nodes;
+  List Polygons = LIST_INITIALIZER;
+};
+
+} // end anonymous namespace
+
+PolygonRoom::PolygonRoom(unsigned Columns, unsigned Rows)
+    : Selectors(NumVars, ObjID(-1)) {
+  Selectors[3] = s_type;
+  Selectors[4] = s_size;
+  Selectors[5] = s_points;
+
+  Shapes.push_back({PContainedAccess,
+                    {{4, 4}, {150, 4}, {160, 12}, {170, 4}, {315, 4},
+                     {315, 185}, {4, 185}, {4, 100}}});
+  uint32_t Seed = 97;
+  double CellWidth = 300.0 / Columns, CellHeight = 170.0 / Rows;
+  for (unsigned I = 0; I < Columns * Rows; ++I) {
+    Polygon P;
+    P.Type = I % 4 == 3 ? PNearestAccess : PBarredAccess;
+    Seed = Seed * 1103515245 + 12345;
+    unsigned Corners = 3 + (Seed >> 16) % 6;
+    double CX = 10 + (I % Columns + 0.5) * CellWidth;
+    double CY = 10 + (I / Columns + 0.5) * CellHeight;
+    double Radius = 0.5 * std::min<double>(CellWidth, CellHeight);
+    for (unsigned C = 0; C < Corners; ++C) {
+      Seed = Seed * 1103515245 + 12345;
+      double Angle = 2 * M_PI * (C + 0.4 * ((Seed >> 8) % 100) / 100) / Corners;
+      double Reach = Radius * (0.4 + 0.7 * ((Seed >> 20) % 100) / 100);
+      P.Points.push_back({int(lround(CX + Reach * cos(Angle))),
+                          int(lround(CY + Reach * sin(Angle)))});
+    }
+    Shapes.push_back(P);
+  }
+  Shapes.push_back({PBarredAccess, {{60, 95}, {140, 95}}});
+
+  Points.resize(Shapes.size());
+  Objects.resize(Shapes.size());
+  Nodes.resize(Shapes.size());
+  for (unsigned I = 0; I < Shapes.size(); ++I) {
+    for (const Point &Pt : Shapes[I].Points) {
+      Points[I].push_back(uintptr_t(Pt.X));
+      Points[I].push_back(uintptr_t(Pt.Y));
+    }
+    Objects[I].assign(OBJSIZE(NumVars), 0);
+    ObjHeader *Header = reinterpret_cast<ObjHeader *>(Objects[I].data());
+    Header->varSelNum = NumVars;
+    Obj *Polygon = reinterpret_cast<Obj *>(Header + 1);
+    Polygon->props = Selectors.data();
+    Polygon->vars[3] = Shapes[I].Type;
+    Polygon->vars[4] = Shapes[I].Points.size();
+    Polygon->vars[5] = uintptr_t(Points[I].data());
+    Node *N = reinterpret_cast<Node *>(&Nodes[I]);
+    AddToEnd(&Polygons, N);
+    SetKey(N, Polygon);
+  }
+}
+
+using Point = PolygonRoom::Point;
+using Shapes = std::vector<PolygonRoom::Polygon>;
+
+static int SideOf(Point A, Point B, int64_t X, int64_t Y) {
+  int64_t Side =
+      (int64_t(B.X) - A.X) * (Y - A.Y) - (int64_t(B.Y) - A.Y) * (X - A.X);
+  return Side < 0 ? -1 : Side > 0;
+}
+
+// Return whether the point (X/2,Y/2) is outside a polygon (0), on an edge (1)
+// or inside (2), by the winding number of the polygon around it.
+static int WhereInShape(const PolygonRoom::Polygon &P, int64_t X, int64_t Y) {
+  int Winding = 0;
+  for (size_t I = 0; I < P.Points.size(); ++I) {
+    Point A = P.Points[I], B = P.Points[(I + 1) % P.Points.size()];
+    Point A2 = {2 * A.X, 2 * A.Y}, B2 = {2 * B.X, 2 * B.Y};
+    int Side = SideOf(A2, B2, X, Y);
+    if (Side == 0 && std::min<int64_t>(A2.X, B2.X) <= X &&
+        X <= std::max<int64_t>(A2.X, B2.X) &&
+        std::min<int64_t>(A2.Y, B2.Y) <= Y &&
+        Y <= std::max<int64_t>(A2.Y, B2.Y))
+      return 1;
+    if (A2.Y <= Y && B2.Y > Y && Side > 0)
+      ++Winding;
+    else if (A2.Y > Y && B2.Y <= Y && Side < 0)
+      --Winding;
+  }
+  return Winding != 0 ? 2 : 0;
+}
+
+// Return true if an actor can't be at (X/2,Y/2).
+static bool Barred(const Shapes &Polys, int64_t X, int64_t Y) {
+  bool Contained = false, AnyContained = false;
+  for (const PolygonRoom::Polygon &P : Polys) {
+    int Where = WhereInShape(P, X, Y);
+    if (P.Type != PContainedAccess && Where == 2)
+      return true;
+    if (P.Type == PContainedAccess) {
+      AnyContained = true;
+      Contained |= Where != 0;
+    }
+  }
+  return AnyContained && !Contained;
+}
+
+// Return true if an actor may go straight from A to B: crossing no edge,
+// passing through no corner, and with its middle where the actor may be.
+static bool ClearWay(const Shapes &Polys, Point A, Point B) {
+  int64_t DX = B.X - A.X, DY = B.Y - A.Y;
+  for (const PolygonRoom::Polygon &P : Polys) {
+    size_t Count = P.Points.size();
+    for (size_t I = 0; I < Count; ++I) {
+      Point C = P.Points[I], D = P.Points[(I + 1) % Count];
+      int64_t Along = (C.X - A.X) * DX + (C.Y - A.Y) * DY;
+      if (SideOf(A, B, C.X, C.Y) == 0 && Along > 0 &&
+          Along < DX * DX + DY * DY)
+        return false;
+      if ((Count > 2 || I == 0) &&
+          SideOf(A, B, C.X, C.Y) * SideOf(A, B, D.X, D.Y) < 0 &&
+          SideOf(C, D, A.X, A.Y) * SideOf(C, D, B.X, B.Y) < 0)
+        return false;
+    }
+  }
+  return !Barred(Polys, A.X + B.X, A.Y + B.Y);
+}
+
+static double Distance(Point A, Point B) {
+  return std::hypot(double(B.X - A.X), double(B.Y - A.Y));
+}
+
+// Return the length of the shortest way from S to G through any corners of
+// the polygons, by Dijkstra's algorithm, or HUGE_VAL if there is none.
+static double ShortestWay(const Shapes &Polys, Point S, Point G) {
+  std::vector<Point> Nodes = {S, G};
+  for (const PolygonRoom::Polygon &P : Polys)
+    for (Point C : P.Points)
+      if (!Barred(Polys, 2 * C.X, 2 * C.Y))
+        Nodes.push_back(C);
+
+  std::vector<double> Cost(Nodes.size(), HUGE_VAL);
+  std::vector<bool> Done(Nodes.size(), false);
+  Cost[0] = 0;
+  for (;;) {
+    size_t U = Nodes.size();
+    for (size_t I = 0; I < Nodes.size(); ++I)
+      if (!Done[I] && Cost[I] < HUGE_VAL &&
+          (U == Nodes.size() || Cost[I] < Cost[U]))
+        U = I;
+    if (U == Nodes.size() || U == 1)
+      return Cost[1];
+    Done[U] = true;
+    for (size_t V = 0; V < Nodes.size(); ++V)
+      if (!Done[V] && Cost[U] + Distance(Nodes[U], Nodes[V]) < Cost[V] &&
+          ClearWay(Polys, Nodes[U], Nodes[V]))
+        Cost[V] = Cost[U] + Distance(Nodes[U], Nodes[V]);
+  }
+}
+
+static std::vector<Point> TakePath(uintptr_t *Path) {
+  std::vector<Point> Points;
+  for (unsigned I = 0; Path[2 * I] != PATHEND; ++I)
+    Points.push_back({int(Path[2 * I]), int(Path[2 * I + 1])});
+  free(Path);
+  return Points;
+}
+
+// Return a point where an actor may be, at random.
+static Point FreePoint(const Shapes &Polys, uint32_t &Seed) {
+  for (;;) {
+    Seed = Seed * 1103515245 + 12345;
+    Point P = {int((Seed >> 8) % 320), int((Seed >> 20) % 190)};
+    if (!Barred(Polys, 2 * P.X, 2 * P.Y))
+      return P;
+  }
+}
+
+// Check the paths of AvoidPath() at each ISA level: from the start to the
+// goal by clear ways, and as short as the shortest way through all corners.
+// From inside a polygon or to inside one, check they go by somewhere free.
+// Check Intersections() against counting the edges crossed.
+static bool CheckPaths(PolygonRoom &Room, uint32_t Seed) {
+  const Shapes &Polys = Room.shapes();
+  for (unsigned Query = 0; Query < 48; ++Query) {
+    Point S = FreePoint(Polys, Seed), G = FreePoint(Polys, Seed);
+    // Into the polygons, at their centers, at times.
+    const PolygonRoom::Polygon &Inside = Polys[1 + Query % (Polys.size() - 2)];
+    Point Center = {0, 0};
+    for (Point C : Inside.Points) {
+      Center.X += C.X;
+      Center.Y += C.Y;
+    }
+    Center.X /= int(Inside.Points.size());
+    Center.Y /= int(Inside.Points.size());
+    // Along the edge of the screen, through a straight corner.
+    if (Query == 0) {
+      S = {4, 60};
+      G = {4, 140};
+    } else if (Query % 8 == 1 && Barred(Polys, 2 * Center.X, 2 * Center.Y))
+      G = Center;
+    else if (Query % 8 == 5 && Barred(Polys, 2 * Center.X, 2 * Center.Y))
+      S = Center;
+
+    std::vector<Point> First;
+    for (uint Isa = ISA_SCALAR; Isa <= GetBestIsa(); ++Isa) {
+      if (!SetAvoidIsa(Isa))
+        continue;
+      std::vector<Point> Path =
+          TakePath(AvoidPath(S.X, S.Y, G.X, G.Y, Room.polygons()));
+      if (Isa == ISA_SCALAR)
+        First = Path;
+      if (Path.size() != First.size() ||
+          !std::equal(Path.begin(), Path.end(), First.begin(),
+                      [](Point A, Point B) {
+                        return A.X == B.X && A.Y == B.Y;
+                      })) {
+        errs() << format("error: AvoidPath() (%s) found another path than "
+                         "the scalar code\n", GetIsaName(Isa));
+        return false;
+      }
+
+      uint Crossed = 0, Counted = 0;
+      for (const PolygonRoom::Polygon &P : Polys) {
+        size_t Count = P.Points.size();
+        for (size_t I = 0; I < (Count == 2 ? 1 : Count); ++I) {
+          Point C = P.Points[I], D = P.Points[(I + 1) % Count];
+          Counted += SideOf(S, G, C.X, C.Y) * SideOf(S, G, D.X, D.Y) < 0 &&
+                     SideOf(C, D, S.X, S.Y) * SideOf(C, D, G.X, G.Y) < 0;
+        }
+      }
+      Crossed = Intersections(S.X, S.Y, G.X, G.Y, Room.polygons());
+      if (Crossed != Counted) {
+        errs() << format("error: Intersections() (%s) found %u edges crossed, "
+                         "not %u\n", GetIsaName(Isa), Crossed, Counted);
+        return false;
+      }
+    }
+
+    if (First.empty() || First.front().X != S.X || First.front().Y != S.Y) {
+      errs() << "error: AvoidPath() doesn't start at the start\n";
+      return false;
+    }
+    // The way out of a polygon, and the way into one, aren't clear.
+    size_t From = Barred(Polys, 2 * S.X, 2 * S.Y) ? 1 : 0;
+    size_t To = First.size() - 1;
+    if (Barred(Polys, 2 * G.X, 2 * G.Y)) {
+      if (Barred(Polys, 2 * First.back().X, 2 * First.back().Y)) {
+        errs() << "error: AvoidPath() ends where the actor can't be\n";
+        return false;
+      }
+    } else if (First.back().X != G.X || First.back().Y != G.Y) {
+      errs() << "error: AvoidPath() doesn't end at the goal\n";
+      return false;
+    }
+
+    double Length = 0;
+    for (size_t I = From; I < To; ++I) {
+      if (!ClearWay(Polys, First[I], First[I + 1])) {
+        errs() << format("error: AvoidPath() goes from (%d,%d) to (%d,%d) "
+                         "across a polygon\n", First[I].X, First[I].Y,
+                         First[I + 1].X, First[I + 1].Y);
+        return false;
+      }
+      Length += Distance(First[I], First[I + 1]);
+    }
+    double Shortest = ShortestWay(Polys, First[From], First[To]);
+    if (std::fabs(Length - Shortest) > 1e-6) {
+      errs() << format("error: AvoidPath() from (%d,%d) to (%d,%d) is %.3f "
+                       "long, not %.3f\n", S.X, S.Y, G.X, G.Y, Length,
+                       Shortest);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Check the paths around the polygons of rooms, then time finding them with
+// the graph of the polygons cached, and building it, at each ISA level, and
+// counting the edges a segment crosses.
+static bool BenchAvoidPath() {
+  static const struct {
+    unsigned Columns, Rows;
+  } Rooms[] = {{5, 2}, {5, 4}, {8, 5}};
+
+  uint OldIsa = GetAvoidIsa();
+  bool Ok = true;
+  for (const auto &R : Rooms) {
+    PolygonRoom Room(R.Columns, R.Rows);
+    ForgetPolygons();
+    if (!(Ok = CheckPaths(Room, 1234)))
+      break;
+
+    std::vector<std::pair<Point, Point>> Queries;
+    uint32_t Seed = 5678;
+    for (unsigned I = 0; I < 64; ++I) {
+      Point S = FreePoint(Room.shapes(), Seed);
+      Queries.push_back({S, FreePoint(Room.shapes(), Seed)});
+    }
+
+    std::string Polygons = std::to_string(R.Columns * R.Rows);
+    for (uint Isa = ISA_SCALAR; Isa <= GetBestIsa(); ++Isa) {
+      if (!SetAvoidIsa(Isa))
+        continue;
+      std::string Variant = Polygons + "-" + GetIsaName(Isa);
+      unsigned Q = 0;
+      AvoidStats Before, After;
+      GetAvoidStats(&Before);
+      Measure("avoidpath", Variant, 0, [&] {
+        const auto &P = Queries[Q++ % Queries.size()];
+        free(AvoidPath(P.first.X, P.first.Y, P.second.X, P.second.Y,
+                       Room.polygons()));
+      });
+      GetAvoidStats(&After);
+      Row("avoidpath", Variant)
+          << format("%14.1f segments, %.1f corners taken\n",
+                    double(After.segments - Before.segments) /
+                        (After.queries - Before.queries),
+                    double(After.expanded - Before.expanded) /
+                        (After.queries - Before.queries));
+
+      Measure("avoidpath", Polygons + "-build-" + GetIsaName(Isa), 0, [&] {
+        const auto &P = Queries[Q++ % Queries.size()];
+        ForgetPolygons();
+        free(AvoidPath(P.first.X, P.first.Y, P.second.X, P.second.Y,
+                       Room.polygons()));
+      });
+
+      Measure("intersections", Variant, 0, [&] {
+        const auto &P = Queries[Q++ % Queries.size()];
+        Intersections(P.first.X, P.first.Y, P.second.X, P.second.Y,
+                      Room.polygons());
+      });
+    }
+    ForgetPolygons();
+  }
+  SetAvoidIsa(OldIsa);
+  return Ok;
+}
+
+namespace {
+
+// A word of the vocabulary of the parser checks.
+struct VocabEntry {
+  const char *Text;
+  uint16_t Classes;
+  uint16_t Group;
+};
+
+} // end anonymous namespace
+
+static const VocabEntry Vocabulary[] = {
+    {"a", WC_ARTICLE, 0x300},
+    {"at", WC_PREP, 0x200},
+    {"book", WC_NOUN, 0x106},
+    {"box", WC_NOUN, 0x102},
+    {"carefully", WC_ADVERB, 0x400},
+    {"coin", WC_NOUN, 0x103},
+    {"door", WC_NOUN, 0x100},
+    {"down", WC_PREP, 0x204},
+    {"get", WC_IMPERATIVE, 0x011},
+    {"give", WC_IMPERATIVE, 0x015},
+    {"gold", WC_NOUN | WC_ADJECTIVE, 0x109},
+    {"grab", WC_IMPERATIVE, 0x013},
+    {"in", WC_PREP, 0x201},
+    {"it", WC_PRONOUN, 0x108},
+    {"key", WC_NOUN, 0x101},
+    {"lamp", WC_NOUN, 0x0ff},
+    {"light", WC_NOUN, 0x104},
+    {"look", WC_IMPERATIVE | WC_NOUN, 0x010},
+    {"man", WC_NOUN, 0x105},
+    {"on", WC_PREP, 0x202},
+    {"open", WC_IMPERATIVE, 0x016},
+    {"open", WC_ADJECTIVE, 0x01b},
+    {"pick", WC_IMPERATIVE, 0x018},
+    {"put", WC_IMPERATIVE, 0x014},
+    {"read", WC_IMPERATIVE, 0x019},
+    {"red", WC_ADJECTIVE, 0x10b},
+    {"silver", WC_NOUN | WC_ADJECTIVE, 0x10a},
+    {"small", WC_ADJECTIVE, 0x10c},
+    {"take", WC_IMPERATIVE, 0x011},
+    {"the", WC_ARTICLE, 0x300},
+    {"to", WC_PREP, 0x205},
+    {"turn", WC_IMPERATIVE, 0x017},
+    {"up", WC_PREP, 0x203},
+    {"with", WC_PREP, 0x207},
+};
+
+// Return the group of a word of the said specs, or -1.
+static int GroupNamed(StringRef Name) {
+  if (Name == "open-adj")
+    return 0x01b;
+  if (Name == "number")
+    return NUMBERGROUP;
+  for (const VocabEntry &E : Vocabulary)
+    if (Name == E.Text)
+      return E.Group;
+  return -1;
+}
+
+// Encode the vocabulary as the resource has it: an index of where each letter
+// starts, then the words in order, each with the number of letters it shares
+// with the one before. 'Extra' words no input uses make it as large as the
+// vocabularies of the games.
+static std::vector<uint8_t> BuildVocabulary(unsigned Extra) {
+  std::vector<std::pair<std::string, uint32_t>> Words;
+  for (const VocabEntry &E : Vocabulary)
+    Words.push_back({E.Text, uint32_t(E.Classes) << 12 | E.Group});
+  for (unsigned I = 0; I < Extra; ++I) {
+    std::string Text;
+    for (unsigned N = I + 1000; N != 0; N /= 26)
+      Text += char('a' + N % 26);
+    Words.push_back({Text + "x", uint32_t(WC_NOUN) << 12 | (0x500 + I)});
+  }
+  std::stable_sort(Words.begin(), Words.end(),
+                   [](const std::pair<std::string, uint32_t> &A,
+                      const std::pair<std::string, uint32_t> &B) {
+                     return A.first < B.first;
+                   });
+
+  std::vector<uint8_t> Res(26 * sizeof(uint16_t), 0);
+  std::string Prev;
+  for (const auto &W : Words) {
+    const std::string &Text = W.first;
+    unsigned Letter = unsigned(Text[0] - 'a');
+    if (Res[Letter * 2] == 0 && Res[Letter * 2 + 1] == 0) {
+      Res[Letter * 2] = uint8_t(Res.size());
+      Res[Letter * 2 + 1] = uint8_t(Res.size() >> 8);
+    }
+
+    unsigned Common = 0;
+    while (Common < Prev.size() && Common + 1 < Text.size() &&
+           Prev[Common] == Text[Common])
+      ++Common;
+    Res.push_back(uint8_t(Common));
+    for (unsigned I = Common; I < Text.size(); ++I)
+      Res.push_back(uint8_t(Text[I] | (I + 1 == Text.size() ? 0x80 : 0)));
+    Res.push_back(uint8_t(W.second >> 16));
+    Res.push_back(uint8_t(W.second >> 8));
+    Res.push_back(uint8_t(W.second));
+    Prev = Text;
+  }
+  return Res;
+}
+
+// Plurals of the nouns.
+static std::vector<uint8_t> BuildSuffixes() {
+  std::vector<uint8_t> Res;
+  auto Add = [&](const char *From, uint16_t Classes, const char *To,
+                 uint16_t Mask) {
+    Res.push_back('*');
+    Res.insert(Res.end(), From, From + strlen(From) + 1);
+    Res.push_back(uint8_t(Classes >> 8));
+    Res.push_back(uint8_t(Classes));
+    Res.push_back('*');
+    Res.insert(Res.end(), To, To + strlen(To) + 1);
+    Res.push_back(uint8_t(Mask >> 8));
+    Res.push_back(uint8_t(Mask));
+  };
+  Add("s", WC_NOUN, "", WC_NOUN);
+  Add("ies", WC_NOUN, "y", WC_NOUN);
+  Res.push_back(0xff);
+  return Res;
+}
+
+// Return the bytes of a said spec written as in the scripts, such as
+// "look<at/door".
+static std::vector<uint8_t> SaidBytes(StringRef Text) {
+  static const char Ops[] = ",&/()[]#<>";
+  std::vector<uint8_t> Bytes;
+  for (size_t I = 0; I < Text.size();) {
+    const char *Op = strchr(Ops, Text[I]);
+    if (Op != nullptr) {
+      Bytes.push_back(uint8_t(SAID_COMMA + (Op - Ops)));
+      ++I;
+      continue;
+    }
+    size_t End = Text.find_first_of(Ops, I);
+    int Group = GroupNamed(Text.slice(I, End));
+    Bytes.push_back(uint8_t(Group >> 8));
+    Bytes.push_back(uint8_t(Group));
+    I = std::min<size_t>(End, Text.size());
+  }
+  Bytes.push_back(SAID_END);
+  return Bytes;
+}
+
+namespace {
+
+// A script of said specs and synonyms, loaded as the games' are.
+class SaidScript {
+public:
+  static const uint Num = 990;
+
+  SaidScript(const std::vector<std::string> &Specs,
+             const std::vector<std::pair<uint16_t, uint16_t>> &Synonyms) {
+    std::vector<uint8_t> Res;
+    auto AddSegment = [&](uint16_t Type, const std::vector<uint8_t> &Data) {
+      uint16_t Size = uint16_t(sizeof(SegHeader) + (Data.size() + 1) / 2 * 2);
+      Res.push_back(uint8_t(Type));
+      Res.push_back(uint8_t(Type >> 8));
+      Res.push_back(uint8_t(Size));
+      Res.push_back(uint8_t(Size >> 8));
+      Res.insert(Res.end(), Data.begin(), Data.end());
+      Res.resize(Res.size() + Data.size() % 2);
+    };
+
+    std::vector<uint8_t> Pairs;
+    for (const auto &S : Synonyms)
+      for (uint16_t Group : {S.first, S.second}) {
+        Pairs.push_back(uint8_t(Group));
+        Pairs.push_back(uint8_t(Group >> 8));
+      }
+    AddSegment(SEG_SYNONYMS, Pairs);
+
+    std::vector<uint8_t> Bytes;
+    for (const std::string &Spec : Specs) {
+      Offsets.push_back(unsigned(Bytes.size()));
+      std::vector<uint8_t> Said = SaidBytes(Spec);
+      Bytes.insert(Bytes.end(), Said.begin(), Said.end());
+    }
+    AddSegment(SEG_SAIDSPECS, Bytes);
+    Res.resize(Res.size() + 2, 0);
+
+    SetResOverride(RES_SCRIPT, Num, Res.data(), uint(Res.size()));
+    S = LoadScript(Num);
+  }
+
+  ~SaidScript() {
+    DisposeScript(Num);
+    ClearResOverride(RES_SCRIPT, Num);
+  }
+
+  Script *script() const { return S; }
+  const byte *spec(size_t I) const {
+    return S->saidSpecs + Offsets[I];
+  }
+
+private:
+  Script *S;
+  std::vector<unsigned> Offsets;
+};
+
+} // end anonymous namespace
+
+static const struct {
+  const char *Input;
+  const char *Spec;
+  int Result;
+} SaidChecks[] = {
+    {"look", "look", SAID_MATCH},
+    {"look", "look/door", SAID_NOMATCH},
+    {"look", "look[/door]", SAID_MATCH},
+    {"look", "look>", SAID_PARTIAL},
+    {"look", "/door", SAID_NOMATCH},
+    {"look", "get", SAID_NOMATCH},
+    {"look at the door", "look<at/door", SAID_MATCH},
+    {"look at the door", "look/door", SAID_MATCH},
+    {"look at the door", "look", SAID_NOMATCH},
+    {"look at the door", "look>", SAID_PARTIAL},
+    {"look at the door", "/door", SAID_MATCH},
+    {"look at the door", "get/door", SAID_NOMATCH},
+    {"look at the door", "look[<at]/door", SAID_MATCH},
+    {"look at the door", "look<in/door", SAID_NOMATCH},
+    {"LOOK AT THE DOOR!", "look<at/door", SAID_MATCH},
+    {"get the gold key", "get,take/key", SAID_MATCH},
+    {"get the gold key", "get/key<gold", SAID_MATCH},
+    {"get the gold key", "get/key<silver", SAID_NOMATCH},
+    {"get the gold key", "get/key[<silver]", SAID_MATCH},
+    {"get the gold key", "get/(key,coin)", SAID_MATCH},
+    {"get the gold key", "get/gold", SAID_NOMATCH},
+    {"get the gold", "get/gold", SAID_MATCH},
+    {"put the key in the box", "put/key/box", SAID_MATCH},
+    {"put the key in the box", "put/key/box<in", SAID_MATCH},
+    {"put the key in the box", "put/key/box<on", SAID_NOMATCH},
+    {"put the key in the box", "put/key", SAID_NOMATCH},
+    {"put the key in the box", "put/key>", SAID_PARTIAL},
+    {"put the key in the box", "put//box", SAID_MATCH},
+    {"put the key in the box", "put[/key/box]", SAID_MATCH},
+    {"put the key", "put[/key/box]", SAID_MATCH},
+    {"grab keys", "get/key", SAID_MATCH},
+    {"grab keys", "grab/key", SAID_NOMATCH},
+    {"pick up the coin", "pick<up/coin", SAID_MATCH},
+    {"pick up the coin", "pick<down/coin", SAID_NOMATCH},
+    {"turn the light on", "turn<on/light", SAID_MATCH},
+    {"turn the light on", "turn<down/light", SAID_NOMATCH},
+    {"carefully open the red box", "open<carefully/box<red", SAID_MATCH},
+    {"carefully open the red box", "open/box<small", SAID_NOMATCH},
+    {"look at the open box", "look<at/box<open-adj", SAID_MATCH},
+    {"look at the open box", "look/box<open", SAID_NOMATCH},
+    {"give the book to the man", "give/book/man", SAID_MATCH},
+    {"give the book to the man", "give//man<to", SAID_MATCH},
+    {"give the book to the man", "give/man", SAID_NOMATCH},
+    {"read it", "read/it", SAID_MATCH},
+    {"read it", "read/book", SAID_NOMATCH},
+    {"get 5 coins", "get/coin<number", SAID_MATCH},
+    {"look lamp", "look/lamp", SAID_MATCH},
+    {"look lamp", "look/door", SAID_NOMATCH},
+    {"look at the door with the key", "look<at/door/key<with", SAID_MATCH},
+    {"look at the door", "look<", SAID_NOMATCH},
+    {"look at the door", "look/door/key/box", SAID_NOMATCH},
+    {"look at the door", "look/(door", SAID_NOMATCH},
+    {"look lamp", "look/door/key/lamp/box", SAID_NOMATCH},
+    {"look lamp", "look,get/lamp", SAID_MATCH},
+};
+
+static const struct {
+  const char *Input;
+  int Result;
+  const char *BadWord;
+} ParseChecks[] = {
+    {"xyzzy the door", PARSE_BADWORD, "xyzzy"},
+    {"", PARSE_NOWORDS, ""},
+    {" ,. ", PARSE_NOWORDS, ""},
+    {"door look get", PARSE_BADORDER, ""},
+    {"the", PARSE_BADORDER, ""},
+};
+
+static bool CheckSaids(const SaidScript &TheScript,
+                       const std::vector<std::string> &Specs) {
+  char BadWord[MAXWORDLEN + 1];
+  for (const auto &C : ParseChecks) {
+    strcpy(BadWord, "");
+    int Result = ParseInput(C.Input, BadWord);
+    if (Result != C.Result ||
+        (Result == PARSE_BADWORD && strcmp(BadWord, C.BadWord) != 0)) {
+      errs() << format("error: ParseInput(\"%s\") is %d \"%s\", not %d\n",
+                       C.Input, Result, static_cast<const char *>(BadWord),
+                       C.Result);
+      return false;
+    }
+    if (MatchSaid(TheScript.spec(0)) != SAID_NOMATCH) {
+      errs() << format("error: Said matches after \"%s\"\n", C.Input);
+      return false;
+    }
+  }
+
+  for (const auto &C : SaidChecks) {
+    int Result = ParseInput(C.Input, BadWord);
+    if (Result != PARSE_OK) {
+      errs() << format("error: ParseInput(\"%s\") is %d\n", C.Input, Result);
+      return false;
+    }
+
+    // The spec in the script, and a copy of it elsewhere.
+    size_t I = std::find(Specs.begin(), Specs.end(), C.Spec) - Specs.begin();
+    std::vector<uint8_t> Copy = SaidBytes(C.Spec);
+    int InScript = MatchSaid(TheScript.spec(I));
+    int Alone = MatchSaid(reinterpret_cast<const byte *>(Copy.data()));
+    if (InScript != C.Result || Alone != C.Result) {
+      errs() << format("error: Said('%s') of \"%s\" is %d and %d, not %d\n",
+                       C.Spec, C.Input, InScript, Alone, C.Result);
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool BenchParse() {
+  std::vector<uint8_t> Words = BuildVocabulary(1500);
+  std::vector<uint8_t> Suffixes = BuildSuffixes();
+  SetResOverride(RES_VOCAB, WORDS_VOCAB, Words.data(), uint(Words.size()));
+  SetResOverride(RES_VOCAB, SUFFIX_VOCAB, Suffixes.data(),
+                 uint(Suffixes.size()));
+  ForgetVocabulary();
+
+  std::vector<std::string> Specs, Inputs;
+  for (const auto &C : SaidChecks) {
+    if (std::find(Specs.begin(), Specs.end(), C.Spec) == Specs.end())
+      Specs.push_back(C.Spec);
+    if (std::find(Inputs.begin(), Inputs.end(), C.Input) == Inputs.end())
+      Inputs.push_back(C.Input);
+  }
+
+  bool Ok;
+  {
+    SaidScript TheScript(Specs, {{0x013, 0x011}});
+    ClearSynonyms();
+    AddSynonyms(
+        static_cast<const SegHeader *>(TheScript.script()->synonyms));
+
+    // The specs of the script are compiled once.
+    ParseStats Before, After;
+    Ok = CheckSaids(TheScript, Specs);
+    GetParseStats(&Before);
+    for (size_t I = 0; I < Specs.size(); ++I)
+      MatchSaid(TheScript.spec(I));
+    GetParseStats(&After);
+    if (Ok && After.compiles != Before.compiles) {
+      errs() << format("error: %u said specs compiled again\n",
+                       After.compiles - Before.compiles);
+      Ok = false;
+    }
+
+    if (Ok) {
+      char BadWord[MAXWORDLEN + 1];
+      unsigned I = 0;
+      Measure("parse", "input", 0, [&] {
+        ParseInput(Inputs[I++ % Inputs.size()].c_str(), BadWord);
+      });
+
+      ParseInput("put the key in the box", BadWord);
+      double All = Measure("said", std::to_string(Specs.size()) + "-specs", 0,
+                           [&] {
+                             for (size_t J = 0; J < Specs.size(); ++J)
+                               MatchSaid(TheScript.spec(J));
+                           });
+      Row("said", "per-spec") << format("%12.1f ns\n", All / Specs.size());
+
+      Measure("said", "compile", 0, [&] {
+        free(TheScript.script()->saids);
+        TheScript.script()->saids = nullptr;
+        MatchSaid(TheScript.spec(0));
+      });
+
+      Measure("vocabulary", "read", Words.size(), [&] {
+        ForgetVocabulary();
+        ParseInput("look", BadWord);
+      });
+    }
+    ClearSynonyms();
+  }
+
+  ForgetVocabulary();
+  ClearResOverride(RES_VOCAB, WORDS_VOCAB);
+  ClearResOverride(RES_VOCAB, SUFFIX_VOCAB);
+  return Ok;
+}
+
+namespace {
+
+// Bits put most significant first, as GetBitsMSB() reads them, or least
+// significant first, as GetBitsLSB() does.
+class BitWriter {
+public:
+  explicit BitWriter(bool MSBFirst) : MSBFirst(MSBFirst) {}
+
+  void put(unsigned Value, unsigned NumBits) {
+    for (unsigned I = 0; I < NumBits; ++I) {
+      unsigned Bit = MSBFirst ? Value >> (NumBits - 1 - I) : Value >> I;
+      if (Count % 8 == 0)
+        Bytes.push_back(0);
+      if (Bit & 1)
+        Bytes.back() |= MSBFirst ? 0x80 >> (Count % 8) : 1 << (Count % 8);
+      ++Count;
+    }
+  }
+
+  std::vector<uint8_t> Bytes;
+
+private:
+  bool MSBFirst;
+  size_t Count = 0;
+};
+
+// The canonical codes of a DCL table, from the lengths of its codes.
+struct DCLCodes {
+  std::vector<unsigned> Code, Length;
+};
+
+} // end anonymous namespace
+
+// Make a resource up: rows of runs of a dozen colors, as in the pictures and
+// views of the games, some of them repeating the row above.
+static std::vector<uint8_t> MakeResource() {
+  static const uint8_t Colors[] = {0,  7,  8,  15, 2,  6,
+                                   4,  1,  42, 43, 98, 255};
+  std::vector<uint8_t> Data(320 * 200);
+  uint32_t Seed = 2468;
+  uint8_t Color = 0;
+  for (size_t I = 0; I < Data.size(); ++I) {
+    Seed = Seed * 1103515245 + 12345;
+    if (I >= 320 && (Seed >> 16) % 64 < 24) {
+      Data[I] = Data[I - 320];
+      continue;
+    }
+    if ((Seed >> 16) % 6 == 0)
+      Color = Colors[(Seed >> 24) % sizeof(Colors)];
+    Data[I] = Color;
+  }
+  return Data;
+}
+
+// Compress with LZW, as the decoder of compression type 2 reads it: codes of
+// 9 to 12 bits, the table growing a code wider as the decoder's does.
+static std::vector<uint8_t> CompressLZW(const std::vector<uint8_t> &Data) {
+  BitWriter W(true);
+  std::unordered_map<uint32_t, unsigned> Table;
+  unsigned Next = 0x102, Emitted = 0;
+  unsigned Bits = 9, DecoderNext = 0x102, DecoderEnd = 0x1ff;
+
+  // The decoder adds a code for each code it reads but the first.
+  auto Emit = [&](unsigned Code) {
+    W.put(Code, Bits);
+    if (++Emitted >= 2 && DecoderNext <= DecoderEnd &&
+        ++DecoderNext == DecoderEnd && Bits != 12) {
+      ++Bits;
+      DecoderEnd = DecoderEnd * 2 + 1;
+    }
+  };
+
+  unsigned Prefix = Data[0];
+  for (size_t I = 1; I < Data.size(); ++I) {
+    uint32_t Key = Prefix << 8 | Data[I];
+    auto It = Table.find(Key);
+    if (It != Table.end()) {
+      Prefix = It->second;
+      continue;
+    }
+    Emit(Prefix);
+    if (Next <= 0xfff)
+      Table[Key] = Next++;
+    Prefix = Data[I];
+  }
+  Emit(Prefix);
+  W.put(0x101, Bits);
+  return W.Bytes;
+}
+
+// Compress with a Huffman tree of the eight most frequent bytes, four bits
+// each, the others following an escape bit.
+static std::vector<uint8_t> CompressHuffman(const std::vector<uint8_t> &Data) {
+  std::vector<unsigned> Order(256), Count(256);
+  for (uint8_t B : Data)
+    ++Count[B];
+  for (unsigned I = 0; I < 256; ++I)
+    Order[I] = I;
+  std::stable_sort(Order.begin(), Order.end(), [&](unsigned A, unsigned B) {
+    return Count[A] > Count[B];
+  });
+
+  // The root sends a 0 bit to a complete tree of depth 3, whose nodes come
+  // in heap order, and a 1 bit to a literal. The terminator is a literal of
+  // the most frequent byte, which never needs one.
+  BitWriter W(true);
+  W.put(16, 8);
+  W.put(Order[0], 8);
+  W.put(0, 8);
+  W.put(0x10, 8);
+  for (unsigned H = 1; H < 8; ++H) {
+    W.put(0, 8);
+    W.put(H << 4 | (H + 1), 8);
+  }
+  std::vector<int> Leaf(256, -1);
+  for (unsigned H = 8; H < 16; ++H) {
+    Leaf[Order[H - 8]] = int(H - 8);
+    W.put(Order[H - 8], 8);
+    W.put(0, 8);
+  }
+
+  for (uint8_t B : Data) {
+    if (Leaf[B] >= 0) {
+      W.put(unsigned(Leaf[B]), 4);
+    } else {
+      W.put(1, 1);
+      W.put(B, 8);
+    }
+  }
+  W.put(1, 1);
+  W.put(Order[0], 8);
+  return W.Bytes;
+}
+
+// Make the canonical codes of a DCL table from the runs of code lengths that
+// Explode.c builds it from.
+static DCLCodes MakeDCLCodes(const uint8_t *Runs, size_t NumRuns) {
+  DCLCodes C;
+  for (size_t I = 0; I < NumRuns; ++I)
+    C.Length.insert(C.Length.end(), (Runs[I] >> 4) + 1, Runs[I] & 15);
+  C.Code.resize(C.Length.size());
+
+  unsigned First = 0;
+  for (unsigned Len = 1; Len <= 13; ++Len) {
+    for (size_t Sym = 0; Sym < C.Length.size(); ++Sym)
+      if (C.Length[Sym] == Len)
+        C.Code[Sym] = First++;
+    First <<= 1;
+  }
+  return C;
+}
+
+// Put a DCL code, which is stored bit-inverted and first bit first.
+static void PutDCLCode(BitWriter &W, const DCLCodes &C, unsigned Sym) {
+  for (unsigned I = C.Length[Sym]; I-- > 0;)
+    W.put(((C.Code[Sym] >> I) & 1) ^ 1, 1);
+}
+
+// Compress with DCL implode: uncoded literals, a 4K window, and the longest
+// match at the last position of each three bytes.
+static std::vector<uint8_t> CompressDCL(const std::vector<uint8_t> &Data) {
+  static const uint8_t LenRuns[] = {2, 35, 36, 53, 38, 23};
+  static const uint8_t DistRuns[] = {2, 20, 53, 230, 247, 151, 248};
+  static const unsigned LenBase[16] = {3,  2,  4,  5,  6,  7,   8,   9,
+                                       10, 12, 16, 24, 40, 72, 136, 264};
+  static const unsigned LenExtra[16] = {0, 0, 0, 0, 0, 0, 0, 0,
+                                        1, 2, 3, 4, 5, 6, 7, 8};
+  const DCLCodes LenCodes = MakeDCLCodes(LenRuns, sizeof(LenRuns));
+  const DCLCodes DistCodes = MakeDCLCodes(DistRuns, sizeof(DistRuns));
+  const unsigned DictBits = 6, MaxLen = 518, Window = 4096;
+
+  BitWriter W(false);
+  auto PutLength = [&](unsigned Len) {
+    unsigned Sym = 0;
+    while (Len < LenBase[Sym] || Len >= LenBase[Sym] + (1U << LenExtra[Sym]))
+      ++Sym;
+    PutDCLCode(W, LenCodes, Sym);
+    W.put(Len - LenBase[Sym], LenExtra[Sym]);
+  };
+
+  W.put(0, 8);
+  W.put(DictBits, 8);
+
+  std::vector<int> Last(1 << 14, -1);
+  auto Hash = [&](size_t I) {
+    return ((Data[I] << 8 ^ Data[I + 1] << 4 ^ Data[I + 2]) * 2654435761u) >>
+           18;
+  };
+
+  for (size_t I = 0; I < Data.size();) {
+    unsigned Len = 0, Dist = 0;
+    if (I + 3 <= Data.size()) {
+      int &Slot = Last[Hash(I)];
+      if (Slot >= 0 && I - Slot <= Window) {
+        size_t Max = std::min<size_t>(MaxLen, Data.size() - I);
+        while (Len < Max && Data[Slot + Len] == Data[I + Len])
+          ++Len;
+        Dist = unsigned(I - Slot);
+      }
+      Slot = int(I);
+    }
+
+    if (Len < 3) {
+      W.put(0, 1);
+      W.put(Data[I++], 8);
+      continue;
+    }
+
+    W.put(1, 1);
+    PutLength(Len);
+    PutDCLCode(W, DistCodes, (Dist - 1) >> DictBits);
+    W.put((Dist - 1) & ((1 << DictBits) - 1), DictBits);
+    for (size_t End = I + Len; ++I < End;)
+      if (I + 3 <= Data.size())
+        Last[Hash(I)] = int(I);
+  }
+
+  W.put(1, 1);
+  PutLength(519);
+  return W.Bytes;
+}
+
+// Compress a made-up resource with each method, check that it decompresses to
+// what it was, and time decompressing it.
+static bool BenchDecompress() {
+  InitDecompressors();
+
+  std::vector<uint8_t> Data = MakeResource();
+  std::vector<uint8_t> Out(Data.size());
+
+  static const struct {
+    const char *Name;
+    uint Compression;
+    std::vector<uint8_t> (*Compress)(const std::vector<uint8_t> &);
+  } Codecs[] = {
+      {"lzw", COMP_LZW1, CompressLZW},
+      {"huffman", COMP_HUFFMAN, CompressHuffman},
+      {"dcl", COMP_DCL, CompressDCL},
+  };
+  for (const auto &C : Codecs) {
+    std::vector<uint8_t> Packed = C.Compress(Data);
+    std::fill(Out.begin(), Out.end(), 0);
+    if (!Decompress(C.Compression, Out.data(), uint(Out.size()), Packed.data(),
+                    uint(Packed.size())) ||
+        Out != Data) {
+      errs() << "error: " << C.Name << " didn't decompress what it compressed\n";
+      return false;
+    }
+
+    Measure("decompress", C.Name, Data.size(), [&] {
+      Decompress(C.Compression, Out.data(), uint(Out.size()), Packed.data(),
+                 uint(Packed.size()));
+    });
+    Row("decompress", C.Name)
+        << format("%12.2fx smaller\n", double(Data.size()) / Packed.size());
+  }
+
+  std::vector<uint8_t> Packed(LzBound(Data.size()));
+  Packed.resize(LzCompress(Packed.data(), uint(Packed.size()), Data.data(),
+                           uint(Data.size())));
+  std::fill(Out.begin(), Out.end(), 0);
+  if (Packed.empty() ||
+      !LzDecompress(Out.data(), uint(Out.size()), Packed.data(),
+                    uint(Packed.size())) ||
+      Out != Data) {
+    errs() << "error: lz didn't decompress what it compressed\n";
+    return false;
+  }
+  Measure("decompress", "lz", Data.size(), [&] {
+    LzDecompress(Out.data(), uint(Out.size()), Packed.data(),
+                 uint(Packed.size()));
+  });
+  Row("decompress", "lz")
+      << format("%12.2fx smaller\n", double(Data.size()) / Packed.size());
+  return true;
+}
+
+static const Benchmark Benchmarks[] = {
+    {"convert", "Palette to RGBA32 conversion of a frame, per ISA level",
+     BenchConvert},
+#if defined(SCI_HEADLESS_DISPLAY)
+    {"clut", "Changes of the CLUT of a presented frame", BenchClut},
+#endif
+    {"spans", "Span writes to the priority/control map, per ISA level",
+     BenchSpans},
+    {"cels", "Priority tested drawing of cel spans, per ISA level",
+     BenchCels},
+    {"glyphs", "Drawing of the rows of font glyphs, per ISA level",
+     BenchGlyphs},
+    {"sort", "Sorting of a cast by y and z", BenchSort},
+    {"palette", "Matching of colors, and merging of palettes, into the "
+                "system palette", BenchPalette},
+#if defined(SCI_HEADLESS_DISPLAY)
+    {"pic", "Drawing of a picture, per ISA level of the span writes",
+     BenchPicture},
+    {"animate", "A frame of a room of walking actors", BenchAnimate},
+    {"oncontrol", "Priorities and controls found under the actors of a room",
+     BenchOnControl},
+    {"cantbehere", "Actors of a room looking for the others in their way",
+     BenchCantBeHere},
+#endif
+    {"avoidpath", "Paths around the polygons of a room, per ISA level",
+     BenchAvoidPath},
+    {"parse", "Inputs parsed, and matched against the said specs of a script",
+     BenchParse},
+    {"decompress", "Decompression of a resource, per compression method",
+     BenchDecompress},
+};
+
+int main(int argc, char *argv[]) {
+  InitLLVM X(argc, argv);
+
+  cl::HideUnrelatedOptions(BenchCat);
+  cl::ParseCommandLineOptions(argc, argv, "SCI microbenchmarks\n");
+
+  if (ListBenchmarks) {
+    for (const Benchmark &B : Benchmarks)
+      outs() << format("%-16s %s\n", B.Name, B.Desc);
+    return EXIT_SUCCESS;
+  }
+
+  if (Iterations == 0) {
+    errs() << "error: The iteration count must be positive\n";
+    return EXIT_FAILURE;
+  }
+
+  InitTimer();
+
+  for (const Benchmark &B : Benchmarks)
+    if (StringRef(B.Name).contains(Filter) && !B.Run())
+      return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,246 @@
+//===- Main.cpp -----------------------------------------------------------===//
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+//===----------------------------------------------------------------------===//
+//
+// Repack the resource volumes of a game into a resource archive.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <vector>
+
+extern "C" {
+#include "sci/Kernel/ResArchive.h"
+#include "sci/Kernel/ResCache.h"
+#include "sci/Kernel/ResSource.h"
+#include "sci/Kernel/Resource.h"
+#include "sci/Kernel/View.h"
+#include "sci/Kernel/VolLoad.h"
+#include "sci/Utils/ErrMsg.h"
+#include "sci/Utils/Lz.h"
+#include "sci/Utils/Timer.h"
+}
+
+using namespace llvm;
+
+static cl::OptionCategory RepackCat("Repack Options");
+
+static cl::opt<std::string> GameDir("source", cl::desc("Game directory"),
+                                    cl::value_desc("directory"),
+                                    cl::cat(RepackCat));
+static cl::alias GameDirA("s", cl::aliasopt(GameDir));
+
+static cl::opt<std::string> OutputFile("output", cl::desc("Output archive"),
+                                       cl::value_desc("file"),
+                                       cl::init(ARCNAME), cl::cat(RepackCat));
+static cl::alias OutputFileA("o", cl::aliasopt(OutputFile));
+
+static cl::opt<bool> NoCompress("no-compress",
+                                cl::desc("Store the resources uncompressed"),
+                                cl::init(false), cl::cat(RepackCat));
+
+static cl::opt<bool> Benchmark("benchmark",
+                               cl::desc("Compare loading all the resources "
+                                        "from the volumes and the archive"),
+                               cl::init(false), cl::cat(RepackCat));
+
+namespace {
+
+struct Packed {
+  int ResType;
+  size_t ResNum;
+  ArcEntry Entry;
+  std::vector<uint8_t> Data;
+};
+
+} // end anonymous namespace
+
+static void AddKey(int ResType, size_t ResNum, void *Arg) {
+  auto *Keys = static_cast<std::vector<std::pair<int, size_t>> *>(Arg);
+  Keys->emplace_back(ResType, ResNum);
+}
+
+static uint32_t TypeInfo(int ResType, const uint8_t *Data, size_t Size) {
+  if (ResType == RES_VIEW && Size >= sizeof(View))
+    return reinterpret_cast<const View *>(Data)->numLoops;
+  return 0;
+}
+
+static bool Pack(Packed &P) {
+  Handle H = DoLoadVolume(P.ResType, P.ResNum);
+  if (!H)
+    return false;
+
+  const uint8_t *Data = static_cast<const uint8_t *>(H);
+  uint Length = ResHandleSize(H);
+
+  memset(&P.Entry, 0, sizeof(ArcEntry));
+  P.Entry.resType = static_cast<uint8_t>(P.ResType);
+  P.Entry.resNum = static_cast<uint16_t>(P.ResNum);
+  P.Entry.length = Length;
+  P.Entry.checksum = ArcChecksum(Data, Length);
+  P.Entry.info = TypeInfo(P.ResType, Data, Length);
+  P.Entry.compression = ARC_STORED;
+
+  if (!NoCompress) {
+    P.Data.resize(LzBound(Length));
+    uint Size = LzCompress(P.Data.data(), P.Data.size(), Data, Length);
+    if (Size != 0 && Size < Length) {
+      P.Data.resize(Size);
+      P.Entry.compression = ARC_LZ;
+    }
+  }
+
+  if (P.Entry.compression == ARC_STORED)
+    P.Data.assign(Data, Data + Length);
+
+  P.Entry.packedSize = static_cast<uint32_t>(P.Data.size());
+  DisposeResHandle(H);
+  return true;
+}
+
+static bool Write(std::vector<Packed> &Resources, raw_fd_ostream &OS) {
+  uint32_t NumBuckets = 16;
+  while (NumBuckets < Resources.size() * 2)
+    NumBuckets *= 2;
+
+  // Lay out the payloads after the hash table, each on a page.
+  uint64_t Offset = sizeof(ArcHeader) + NumBuckets * sizeof(ArcEntry);
+  std::vector<ArcEntry> Buckets(NumBuckets);
+  for (Packed &P : Resources) {
+    Offset = alignTo(Offset, ARCPAGESIZE);
+    P.Entry.offset = Offset;
+    Offset += P.Data.size();
+
+    uint32_t I = ARCHASH(P.ResType, P.ResNum) & (NumBuckets - 1);
+    while (Buckets[I].resType != 0)
+      I = (I + 1) & (NumBuckets - 1);
+    Buckets[I] = P.Entry;
+  }
+
+  ArcHeader Header;
+  Header.magic = ARCMAGIC;
+  Header.numEntries = static_cast<uint32_t>(Resources.size());
+  Header.numBuckets = NumBuckets;
+  Header.pageSize = ARCPAGESIZE;
+
+  OS.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+  OS.write(reinterpret_cast<const char *>(Buckets.data()),
+           Buckets.size() * sizeof(ArcEntry));
+
+  uint64_t Pos = sizeof(ArcHeader) + NumBuckets * sizeof(ArcEntry);
+  for (const Packed &P : Resources) {
+    OS.write_zeros(P.Entry.offset - Pos);
+    OS.write(reinterpret_cast<const char *>(P.Data.data()), P.Data.size());
+    Pos = P.Entry.offset + P.Data.size();
+  }
+  return !OS.has_error();
+}
+
+static void PrintRate(StringRef Name, uint64_t Bytes, uint64_t Nanoseconds) {
+  double Seconds = Nanoseconds / 1e9;
+  outs() << format("%-8s %10.3f ms %10.1f MB/s\n", Name.data(),
+                   Nanoseconds / 1e6,
+                   Seconds > 0 ? Bytes / (1024.0 * 1024.0) / Seconds : 0.0);
+}
+
+static uint64_t LoadAll(const std::vector<Packed> &Resources,
+                        uint64_t &Nanoseconds) {
+  uint64_t Bytes = 0;
+  uint64_t Start = GetHighResolutionTime();
+  for (const Packed &P : Resources) {
+    Handle H = DoLoad(P.ResType, P.ResNum);
+    if (!H)
+      continue;
+    Bytes += ResHandleSize(H);
+    DisposeResHandle(H);
+  }
+  Nanoseconds = GetHighResolutionTime() - Start;
+  return Bytes;
+}
+
+// Time the same loads, through DoLoad(), without and then with the archive.
+static void RunBenchmark(const std::vector<Packed> &Resources) {
+  uint64_t Nanoseconds;
+  uint64_t Bytes = LoadAll(Resources, Nanoseconds);
+  PrintRate("volumes", Bytes, Nanoseconds);
+
+  if (!OpenResArchive(OutputFile.c_str())) {
+    errs() << "error: Failed to open \"" << OutputFile << "\"\n";
+    return;
+  }
+
+  Bytes = LoadAll(Resources, Nanoseconds);
+  PrintRate("archive", Bytes, Nanoseconds);
+  CloseResArchive();
+}
+
+int main(int argc, char *argv[]) {
+  InitLLVM X(argc, argv);
+
+  cl::HideUnrelatedOptions(RepackCat);
+  cl::ParseCommandLineOptions(argc, argv, "SCI resource repacker\n");
+
+  std::error_code EC;
+  if (!GameDir.empty()) {
+    EC = sys::fs::set_current_path(GameDir);
+    if (EC) {
+      errs() << "error: Failed to read game directory \"" << GameDir << "\" ("
+             << EC.message() << ")\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Load from the volumes themselves, not a cache, an older archive or the
+  // patch files.
+  g_resCacheEnabled = false;
+  SetPanicProc(NULL);
+  InitTimer();
+  InitResource();
+  CloseResArchive();
+
+  std::vector<std::pair<int, size_t>> Keys;
+  ForEachResIndex(SRC_VOLUME, AddKey, &Keys);
+  std::sort(Keys.begin(), Keys.end());
+
+  std::vector<Packed> Resources;
+  uint64_t Length = 0;
+  for (const auto &Key : Keys) {
+    Packed P;
+    P.ResType = Key.first;
+    P.ResNum = Key.second;
+    if (!Pack(P)) {
+      errs() << "warning: Failed to load resource " << P.ResType << "/"
+             << P.ResNum << "\n";
+      continue;
+    }
+    Length += P.Entry.length;
+    Resources.push_back(std::move(P));
+  }
+
+  raw_fd_ostream OS(OutputFile, EC);
+  if (EC) {
+    errs() << "error: Failed to create output file \"" << OutputFile << "\" ("
+           << EC.message() << ")\n";
+    return EXIT_FAILURE;
+  }
+
+  if (!Write(Resources, OS)) {
+    errs() << "error: Failed to write \"" << OutputFile << "\"\n";
+    return EXIT_FAILURE;
+  }
+  OS.close();
+
+  outs() << Resources.size() << " resources, " << Length << " bytes\n";
+
+  if (Benchmark)
+    RunBenchmark(Resources);
+  return EXIT_SUCCESS;
+}